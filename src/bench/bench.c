@@ -0,0 +1,196 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bench/bench.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/string/string_utils.h>
+
+void
+benchSamplesCreate(mem_arena* arena, bench_samples* samples, uint32 capacity)
+{
+	samples->samples = arena_push_array_zero(arena, uint64, capacity);
+	samples->count = 0;
+	samples->capacity = capacity;
+}
+
+void
+benchSamplesAdd(bench_samples* samples, uint64 nanoseconds)
+{
+	if (samples->count < samples->capacity)
+		samples->samples[samples->count++] = nanoseconds;
+}
+
+internal int
+benchCompareSamples(const void* left, const void* right)
+{
+	uint64 left_sample = *(const uint64*)left;
+	uint64 right_sample = *(const uint64*)right;
+	return (left_sample > right_sample) - (left_sample < right_sample);
+}
+
+/**
+ * Returns the nearest-rank percentile of a sorted, non-empty sample set.
+ */
+internal real64
+benchPercentile(bench_samples* samples, uint32 percentile)
+{
+	uint64 rank = ((uint64)percentile * samples->count + 99) / 100;
+	if (rank == 0)
+		rank = 1;
+	return (real64)samples->samples[rank - 1];
+}
+
+void
+benchSummarize(bench_samples* samples, bench_summary* summary)
+{
+
+	*summary = (bench_summary){0};
+	if (samples->count == 0)
+		return;
+
+	qsort(samples->samples, samples->count, sizeof(uint64), &benchCompareSamples);
+
+	real64 total = 0.0;
+	for (uint32 sample_index = 0; sample_index < samples->count; ++sample_index)
+		total += (real64)samples->samples[sample_index];
+	summary->mean = total / (real64)samples->count;
+
+	real64 variance = 0.0;
+	for (uint32 sample_index = 0; sample_index < samples->count; ++sample_index)
+	{
+		real64 deviation = (real64)samples->samples[sample_index] - summary->mean;
+		variance += deviation * deviation;
+	}
+	summary->stddev = sqrt(variance / (real64)samples->count);
+
+	summary->min = (real64)samples->samples[0];
+	summary->max = (real64)samples->samples[samples->count - 1];
+	summary->p50 = benchPercentile(samples, 50);
+	summary->p90 = benchPercentile(samples, 90);
+	summary->p99 = benchPercentile(samples, 99);
+
+}
+
+void
+benchTextCreate(mem_arena* arena, bench_text* text, size_t reserve)
+{
+
+	text->buffer = arena_push_array(arena, char, reserve);
+	text->size = reserve;
+	text->length = 0;
+	text->overflow = false;
+	text->buffer[0] = '\0';
+
+}
+
+void
+benchTextAppend(bench_text* text, const char* format, ...)
+{
+
+	if (text->overflow)
+		return;
+
+	size_t available = text->size - text->length;
+
+	va_list arguments;
+	va_start(arguments, format);
+	int formatted_length = vsnprintf(text->buffer + text->length, available, format, arguments);
+	va_end(arguments);
+
+	// Leave the text as it was if the formatted text didn't fit.
+	if (formatted_length < 0 || (size_t)formatted_length >= available)
+	{
+		text->buffer[text->length] = '\0';
+		text->overflow = true;
+		return;
+	}
+
+	text->length += (size_t)formatted_length;
+
+}
+
+void
+benchTextReset(bench_text* text)
+{
+	text->length = 0;
+	text->overflow = false;
+	text->buffer[0] = '\0';
+}
+
+bool
+benchTextWrite(bench_text* text, const char* path)
+{
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, path, PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE))
+		return false;
+
+	size_t bytes_written = platformWriteFile(&fh, text->buffer, text->length);
+	platformCloseFile(&fh);
+
+	return (bytes_written == text->length);
+
+}
+
+char*
+benchLoadFile(mem_arena* arena, const char* path)
+{
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return NULL;
+
+	char* file_buffer = arena_push_array_zero(arena, char, fh.file_size + 1);
+	size_t bytes_read = platformReadFile(&fh, file_buffer, fh.file_size);
+	file_buffer[bytes_read] = '\0';
+	platformCloseFile(&fh);
+
+	return file_buffer;
+
+}
+
+const char*
+benchFindArgument(int argc, char** argv, const char* prefix)
+{
+	const char* value = NULL;
+	for (int argument_index = 1; argument_index < argc; ++argument_index)
+	{
+		size_t location = 0;
+		if (strSearchToken(prefix, argv[argument_index], 0, &location) && location == 0)
+			value = argv[argument_index] + strLength(prefix);
+	}
+	return value;
+}
+
+bool
+benchFindResult(const char* json, const char* entry_name, const char* field_name, real64* value)
+{
+
+	char entry_token[256];
+	char field_token[256];
+	snprintf(entry_token, sizeof(entry_token), "\"name\": \"%s\"", entry_name);
+	snprintf(field_token, sizeof(field_token), "\"%s\": ", field_name);
+
+	size_t entry_location = 0;
+	if (!strSearchToken(entry_token, json, 0, &entry_location))
+		return false;
+
+	// The field must belong to this entry, not one of the entries after it.
+	size_t search_offset = entry_location + strLength(entry_token);
+	size_t next_entry_location = STR_END;
+	strSearchToken("\"name\": ", json, search_offset, &next_entry_location);
+
+	size_t field_location = 0;
+	if (!strSearchToken(field_token, json, search_offset, &field_location) ||
+		field_location > next_entry_location)
+		return false;
+
+	char* value_end = NULL;
+	const char* value_start = json + field_location + strLength(field_token);
+	*value = strtod(value_start, &value_end);
+
+	return (value_end != value_start);
+
+}
@@ -0,0 +1,155 @@
+/**
+ * Shared support for the benchmark executables. Timing samples are collected
+ * into fixed-capacity sets and summarized into percentiles, results are built up
+ * as text on the arena and written out as JSON, and earlier results can be read
+ * back in as a baseline to compare against.
+ *
+ * The benchmarks aren't part of Sourcery itself and are built as their own
+ * executables, see CMAKELISTS.txt.
+ */
+#ifndef SOURCERY_BENCH_BENCH_H
+#define SOURCERY_BENCH_BENCH_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+
+typedef struct bench_samples
+{
+	uint64* samples;
+	uint32 	count;
+	uint32 	capacity;
+} bench_samples;
+
+/**
+ * The summary of a sample set. Every value is in nanoseconds.
+ */
+typedef struct bench_summary
+{
+	real64 min;
+	real64 mean;
+	real64 p50;
+	real64 p90;
+	real64 p99;
+	real64 max;
+	real64 stddev;
+} bench_summary;
+
+/**
+ * A text buffer reserved up-front from the arena. Only the pages the text reaches
+ * are ever touched, so generous reservations are cheap.
+ */
+typedef struct bench_text
+{
+	char* 	buffer;
+	size_t 	size;
+	size_t 	length;
+	bool 	overflow;
+} bench_text;
+
+/**
+ * Creates an empty sample set.
+ *
+ * @param arena The arena to place the samples on.
+ * @param samples The sample set to initialize.
+ * @param capacity The most samples the set can hold.
+ */
+void
+benchSamplesCreate(mem_arena* arena, bench_samples* samples, uint32 capacity);
+
+/**
+ * Adds a sample to the set. Samples beyond the set's capacity are dropped.
+ *
+ * @param samples The sample set.
+ * @param nanoseconds The sample, in nanoseconds.
+ */
+void
+benchSamplesAdd(bench_samples* samples, uint64 nanoseconds);
+
+/**
+ * Summarizes a sample set. The samples are sorted in place. Percentiles use the
+ * nearest-rank method, so they are always one of the samples.
+ *
+ * @param samples The sample set to summarize.
+ * @param summary The summary to fill out, zeroed if the set is empty.
+ */
+void
+benchSummarize(bench_samples* samples, bench_summary* summary);
+
+/**
+ * Creates an empty text buffer.
+ *
+ * @param arena The arena to reserve the text buffer from.
+ * @param text The text buffer to initialize.
+ * @param reserve The size of the reservation, which bounds the length of the text.
+ */
+void
+benchTextCreate(mem_arena* arena, bench_text* text, size_t reserve);
+
+/**
+ * Appends formatted text onto a text buffer. Text that doesn't fit within the
+ * buffer's reservation is dropped and the buffer is marked as overflowed.
+ *
+ * @param text The text buffer.
+ * @param format The printf-style format string.
+ */
+void
+benchTextAppend(bench_text* text, const char* format, ...);
+
+/**
+ * Empties a text buffer so that it can be reused.
+ *
+ * @param text The text buffer.
+ */
+void
+benchTextReset(bench_text* text);
+
+/**
+ * Writes the contents of a text buffer to a file, replacing the file.
+ *
+ * @param text The text buffer.
+ * @param path The path of the file to write.
+ *
+ * @returns True if the whole buffer was written, false if not.
+ */
+bool
+benchTextWrite(bench_text* text, const char* path);
+
+/**
+ * Loads an entire file onto the arena as a null-terminated string.
+ *
+ * @param arena The arena to place the file on.
+ * @param path The path of the file to load.
+ *
+ * @returns The contents of the file, or NULL if it couldn't be opened.
+ */
+char*
+benchLoadFile(mem_arena* arena, const char* path);
+
+/**
+ * Finds the value of a "--name=value" argument.
+ *
+ * @param argc The number of arguments.
+ * @param argv The arguments.
+ * @param prefix The argument's prefix, including the "=".
+ *
+ * @returns The value of the last matching argument, or NULL if there isn't one.
+ */
+const char*
+benchFindArgument(int argc, char** argv, const char* prefix);
+
+/**
+ * Finds a numeric field of an entry within results previously written by a
+ * benchmark. Entries are the JSON objects with a "name" field, and the field is
+ * looked for between the entry's name and the name of the next entry. This only
+ * understands the layout the benchmarks write, it isn't a general JSON reader.
+ *
+ * @param json The results to search.
+ * @param entry_name The name of the entry.
+ * @param field_name The name of the numeric field.
+ * @param value Set to the value of the field.
+ *
+ * @returns True if the field was found, false if not.
+ */
+bool
+benchFindResult(const char* json, const char* entry_name, const char* field_name, real64* value);
+
+#endif
@@ -0,0 +1,758 @@
+/**
+ * Sourcery Bench
+ *
+ * Measures Sourcery end-to-end on synthetic workloads. Each workload generates a
+ * script, runs the sourcery executable over it within a fresh directory and
+ * checks that the script's output landed. Every iteration is timed per phase:
+ * 		1. 	generate 	Building the script and writing it to disk.
+ * 		2. 	run 		Spawning sourcery on the script until it exits, which
+ * 						includes the process start-up a user would see.
+ *
+ * Results are written as JSON with latency percentiles per phase and throughput
+ * per workload. Passing an earlier result file as a baseline compares the run
+ * phase's median against it and fails if any workload regressed by more than the
+ * threshold.
+ *
+ * A streamed workload is piped to sourcery's standard input rather than written
+ * to a file. The bench generates a piece of the script and repeats it through a
+ * second copy of itself, so a stream larger than memory or the disk can be run
+ * through the whole pipeline. Streamed workloads are too large to run by default
+ * and only run when named with "--workload=".
+ *
+ * 		sourcery_bench [OPT:--sourcery=(path)] [OPT:--args=(arguments)] [OPT:--iterations=(n)]
+ * 			[OPT:--scale=(n)] [OPT:--workload=(name)] [OPT:--workdir=(path)] [OPT:--output=(file)]
+ * 			[OPT:--baseline=(file)] [OPT:--threshold=(percent)] [OPT:--keep] [OPT:--help]
+ *
+ * The sourcery executable defaults to the one beside the bench executable. The
+ * "--args" parameter is passed to sourcery ahead of the script, so a run with an
+ * option can be compared against a baseline run without it.
+ *
+ * Workloads run within a fresh directory the bench creates under the workdir, and
+ * only that directory is removed afterwards, so pointing "--workdir" at a
+ * directory that holds anything else never touches it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <bench/bench.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/process/process.h>
+#include <sourcery/string/string_utils.h>
+#include <sourcery/time/clock.h>
+
+#define BENCH_HEAP_SIZE 			MEGABYTES(512)
+#define BENCH_SCRIPT_RESERVE 		MEGABYTES(128)
+#define BENCH_RESULTS_RESERVE 		MEGABYTES(1)
+#define BENCH_PATH_SIZE 			KILOBYTES(4)
+
+#define BENCH_DEFAULT_ITERATIONS 	10
+#define BENCH_DEFAULT_SCALE 		1
+#define BENCH_DEFAULT_THRESHOLD 	5.0
+#define BENCH_DEFAULT_OUTPUT 		"sourcery_bench.json"
+#define BENCH_SCRIPT_NAME 			"bench.sry"
+#define BENCH_STREAM_END_NAME 		"stream_end.txt"
+#define BENCH_RUN_DIRECTORY_NAME 	"run"
+#define BENCH_RUN_DIRECTORY_TRIES 	1000
+
+#if defined(PLATFORM_WINDOWS)
+#	define BENCH_DEFAULT_WORKDIR 	"sourcery_bench_work"
+#	define BENCH_EXECUTABLE_NAME 	"sourcery.exe"
+#	define BENCH_PATH_SEPARATOR 	'\\'
+#	define BENCH_NULL_DEVICE 		"NUL"
+#	define BENCH_REMOVE_COMMAND 	"rmdir /s /q"
+#	define BENCH_REMOVE_EMPTY_COMMAND 	"rmdir"
+#else
+#	define BENCH_DEFAULT_WORKDIR 	"/tmp/sourcery_bench"
+#	define BENCH_EXECUTABLE_NAME 	"sourcery"
+#	define BENCH_PATH_SEPARATOR 	'/'
+#	define BENCH_NULL_DEVICE 		"/dev/null"
+#	define BENCH_REMOVE_COMMAND 	"rm -rf"
+#	define BENCH_REMOVE_EMPTY_COMMAND 	"rmdir"
+#endif
+
+/**
+ * Builds a workload's script into the text buffer.
+ *
+ * @param script The text buffer to build the script into.
+ * @param scale The size multiplier of the workload.
+ * @param verify_path Set to a path the script creates, which is checked after each run.
+ *
+ * @returns The number of files and directories the script generates.
+ */
+typedef uint64 (*bench_generator)(bench_text* script, uint32 scale, const char** verify_path);
+
+/**
+ * A workload run over a script file, or streamed through standard input when it
+ * has a stream size. A streamed workload's script is repeated until the stream is
+ * at least that many bytes.
+ */
+typedef struct bench_workload
+{
+	const char* 	name;
+	const char* 	description;
+	bench_generator generate;
+	uint64 			stream_bytes;
+} bench_workload;
+
+typedef struct bench_result
+{
+	const bench_workload* workload;
+
+	uint64 	script_bytes;
+	uint64 	generated_entries;
+	uint32 	failures;
+
+	bench_samples 	generate_samples;
+	bench_samples 	run_samples;
+	bench_summary 	generate_summary;
+	bench_summary 	run_summary;
+} bench_result;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Workload Generators
+ * ---------------------------------------------------------------------------------------------------------------------
+ */
+
+/**
+ * Mostly prose with no directives at all, which measures the cost of reading and
+ * classifying lines.
+ */
+internal uint64
+benchGenerateProse(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint64 line_count = 100000 * (uint64)scale;
+	for (uint64 line_index = 0; line_index < line_count; ++line_index)
+	{
+		benchTextAppend(script, "Line %llu of the prose workload, with # and ! but no directive.\n",
+			(unsigned long long)line_index);
+	}
+
+	*verify_path = NULL;
+	return 0;
+}
+
+/**
+ * Thousands of single-line file directives, which measures per-file creation.
+ */
+internal uint64
+benchGenerateOneLiners(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint64 file_count = 2000 * (uint64)scale;
+	benchTextAppend(script, "#!%%out\n");
+	for (uint64 file_index = 0; file_index < file_count; ++file_index)
+	{
+		benchTextAppend(script, "#!+out/file_%llu.txt:generated file %llu\n",
+			(unsigned long long)file_index, (unsigned long long)file_index);
+	}
+
+	*verify_path = "out/file_0.txt";
+	return file_count + 1;
+}
+
+/**
+ * A handful of files with very large multiline bodies, which measures how fast
+ * verbatim text is moved from the script into the generated files.
+ */
+internal uint64
+benchGenerateLargeBodies(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint32 file_count = 4;
+	uint64 body_lines = 25000 * (uint64)scale;
+	for (uint32 file_index = 0; file_index < file_count; ++file_index)
+	{
+		benchTextAppend(script, "#!+body_%u.c:<<(/* Generated body %u. */\n", file_index, file_index);
+		for (uint64 line_index = 0; line_index < body_lines; ++line_index)
+		{
+			benchTextAppend(script, "int value_%u_%llu = %llu; // Padding the body out to a realistic width.\n",
+				file_index, (unsigned long long)line_index, (unsigned long long)line_index);
+		}
+		benchTextAppend(script, ")>>\n");
+	}
+
+	*verify_path = "body_0.c";
+	return file_count;
+}
+
+/**
+ * Many deep directory chains, which measures directory creation.
+ */
+internal uint64
+benchGenerateDeepTree(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint32 branch_count = 32 * scale;
+	uint32 depth = 16;
+
+	char directory_path[BENCH_PATH_SIZE];
+	benchTextAppend(script, "#!%%tree\n");
+	for (uint32 branch_index = 0; branch_index < branch_count; ++branch_index)
+	{
+		int path_length = snprintf(directory_path, sizeof(directory_path), "tree/branch_%u", branch_index);
+		benchTextAppend(script, "#!%%%s\n", directory_path);
+		for (uint32 depth_index = 1; depth_index < depth; ++depth_index)
+		{
+			path_length += snprintf(directory_path + path_length, sizeof(directory_path) - (size_t)path_length,
+				"/level_%u", depth_index);
+			benchTextAppend(script, "#!%%%s\n", directory_path);
+		}
+	}
+
+	*verify_path = "tree/branch_0/level_1";
+	return (uint64)branch_count * depth + 1;
+}
+
+/**
+ * Commands that do nothing, which measures the cost of spawning each command.
+ */
+internal uint64
+benchGenerateCommands(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint64 command_count = 50 * (uint64)scale;
+	for (uint64 command_index = 0; command_index < command_count; ++command_index)
+		benchTextAppend(script, "#!!exit 0\n");
+
+	*verify_path = NULL;
+	return 0;
+}
+
+/**
+ * A piece of a stream larger than 4GB, which checks that offsets past 32 bits hold
+ * up through the whole pipeline. Every piece writes the same files, and the bench
+ * ends the stream with a file holding its size, which has to land intact.
+ */
+internal uint64
+benchGenerateHugeStream(bench_text* script, uint32 scale, const char** verify_path)
+{
+	uint64 line_count = 16000 * (uint64)scale;
+	for (uint64 line_index = 0; line_index < line_count; ++line_index)
+	{
+		benchTextAppend(script, "Line %llu of a piece of the huge stream, with # and ! but no directive.\n",
+			(unsigned long long)line_index);
+		if (line_index % 4000 == 0)
+			benchTextAppend(script, "#!+stream_piece.txt:<<(Body of the piece at line %llu.\n)>>\n",
+				(unsigned long long)line_index);
+	}
+
+	*verify_path = BENCH_STREAM_END_NAME;
+	return 1;
+}
+
+persist const bench_workload bench_workloads[] =
+{
+	{ "prose", 			"Prose-heavy script without directives", 		&benchGenerateProse, 		0 },
+	{ "one_liners", 	"Thousands of single-line file directives", 	&benchGenerateOneLiners, 	0 },
+	{ "large_bodies", 	"Huge multiline file bodies", 					&benchGenerateLargeBodies, 	0 },
+	{ "deep_tree", 		"Deep directory trees", 						&benchGenerateDeepTree, 	0 },
+	{ "commands", 		"Command-heavy script", 						&benchGenerateCommands, 	0 },
+	{ "huge_stream", 	"Stream of more than 4GB through stdin", 		&benchGenerateHugeStream,
+		GIGABYTES(4) + MEGABYTES(64) },
+};
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Harness
+ * ---------------------------------------------------------------------------------------------------------------------
+ */
+
+persist const char* bench_usage =
+	"sourcery_bench [OPT:--sourcery=(path)] [OPT:--args=(arguments)] [OPT:--iterations=(n)]\n"
+	"	[OPT:--scale=(n)] [OPT:--workload=(name)] [OPT:--workdir=(path)] [OPT:--output=(file)]\n"
+	"	[OPT:--baseline=(file)] [OPT:--threshold=(percent)] [OPT:--keep] [OPT:--help]\n"
+	"\n"
+	"	--sourcery=    The sourcery executable, by default the one beside the bench.\n"
+	"	--args=        Arguments passed to sourcery ahead of the script.\n"
+	"	--iterations=  Timed runs per workload, %u by default.\n"
+	"	--scale=       Size multiplier of every workload, %u by default.\n"
+	"	--workload=    Only runs the named workload. Streamed workloads only run when named.\n"
+	"	--workdir=     Where the bench creates its run directory, %s by default.\n"
+	"	--output=      Where the results are written, %s by default.\n"
+	"	--baseline=    Earlier results to compare each workload's median run time against.\n"
+	"	--threshold=   The slowdown in percent that fails the comparison, %.1f by default.\n"
+	"	--keep         Keeps the run directory instead of removing it.\n"
+	"	--help         Prints this and exits.\n";
+
+internal void
+benchPrintUsage(void)
+{
+	printf(bench_usage, BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_SCALE, BENCH_DEFAULT_WORKDIR,
+		BENCH_DEFAULT_OUTPUT, BENCH_DEFAULT_THRESHOLD);
+	printf("\nWorkloads:\n");
+	for (size_t workload_index = 0; workload_index < sizeof(bench_workloads) / sizeof(bench_workloads[0]); ++workload_index)
+		printf("	%-14s %s\n", bench_workloads[workload_index].name, bench_workloads[workload_index].description);
+}
+
+internal bool
+benchIsAbsolutePath(const char* path)
+{
+#if defined(PLATFORM_WINDOWS)
+	return (path[0] == '\\' || path[0] == '/' || (path[0] != '\0' && path[1] == ':'));
+#else
+	return (path[0] == '/');
+#endif
+}
+
+/**
+ * Resolves a path against the working directory the bench was started in, since
+ * the bench changes into each workload's directory while it runs.
+ */
+internal char*
+benchResolvePath(mem_arena* arena, const char* base_directory, const char* path)
+{
+	char* resolved_path = arena_push_array_zero(arena, char, BENCH_PATH_SIZE);
+	if (benchIsAbsolutePath(path))
+		snprintf(resolved_path, BENCH_PATH_SIZE, "%s", path);
+	else
+		snprintf(resolved_path, BENCH_PATH_SIZE, "%s%c%s", base_directory, BENCH_PATH_SEPARATOR, path);
+	return resolved_path;
+}
+
+/**
+ * Creates a directory for this run under the workdir. The name is numbered until
+ * it doesn't already exist, so the directory is always one this run created and
+ * can be removed whole afterwards.
+ *
+ * @returns The path of the run directory, or NULL if none could be created.
+ */
+internal char*
+benchCreateRunDirectory(mem_arena* arena, const char* workdir)
+{
+	char* run_directory = arena_push_array_zero(arena, char, BENCH_PATH_SIZE);
+	for (uint32 run_index = 0; run_index < BENCH_RUN_DIRECTORY_TRIES; ++run_index)
+	{
+		snprintf(run_directory, BENCH_PATH_SIZE, "%s%c%s%u", workdir, BENCH_PATH_SEPARATOR,
+			BENCH_RUN_DIRECTORY_NAME, run_index);
+		if (platformCreateDirectory(run_directory))
+			return run_directory;
+		if (platformGetPathType(run_directory) == PLATFORM_PATHTYPE_NONE)
+			return NULL;
+	}
+	return NULL;
+}
+
+/**
+ * Finds the sourcery executable beside the bench executable.
+ */
+internal char*
+benchFindSourcery(mem_arena* arena, const char* bench_path)
+{
+	char* sourcery_path = arena_push_array_zero(arena, char, BENCH_PATH_SIZE);
+
+	size_t directory_length = 0;
+	for (size_t c_index = 0; bench_path[c_index] != '\0'; ++c_index)
+	{
+		if (bench_path[c_index] == '/' || bench_path[c_index] == '\\')
+			directory_length = c_index + 1;
+	}
+
+	snprintf(sourcery_path, BENCH_PATH_SIZE, "%.*s%s", (int)directory_length, bench_path, BENCH_EXECUTABLE_NAME);
+	return sourcery_path;
+}
+
+/**
+ * Writes a script to standard output over and over, followed by a file directive
+ * whose body is the number of bytes written before it. This is the other end of
+ * a streamed workload's pipe.
+ *
+ * @returns The exit status of the bench, which is zero if the whole stream was written.
+ */
+internal int
+benchEmitStream(mem_arena* arena, const char* script_path, uint64 repeat_count)
+{
+
+	char* script = benchLoadFile(arena, script_path);
+	if (script == NULL)
+		return -1;
+
+	size_t script_length = strLength(script);
+	for (uint64 repeat_index = 0; repeat_index < repeat_count; ++repeat_index)
+	{
+		if (fwrite(script, 1, script_length, stdout) != script_length)
+			return -1;
+	}
+
+	printf("#!+%s:%llu\n", BENCH_STREAM_END_NAME, (unsigned long long)(repeat_count * script_length));
+	return (fflush(stdout) == 0) ? 0 : -1;
+
+}
+
+/**
+ * Runs one iteration of a workload within its own directory.
+ *
+ * @returns True if sourcery succeeded and created what it was expected to, false if not.
+ */
+internal bool
+benchRunIteration(mem_arena* arena, bench_result* result, bench_text* script, const char* bench_path,
+	const char* sourcery_path, const char* sourcery_args, const char* workload_directory, uint32 iteration,
+	uint32 scale, bool record)
+{
+
+	size_t stash_point = arena_stash(arena);
+
+	char* iteration_directory = arena_push_array_zero(arena, char, BENCH_PATH_SIZE);
+	snprintf(iteration_directory, BENCH_PATH_SIZE, "%s%c%u", workload_directory, BENCH_PATH_SEPARATOR, iteration);
+	platformCreateDirectory(iteration_directory);
+	if (!platformSetWorkingDirectory(iteration_directory))
+	{
+		arena_restore(arena, stash_point);
+		return false;
+	}
+
+	// Phase 1, generate the script.
+	uint64 generate_start = platformGetTimeNanoseconds();
+	const char* verify_path = NULL;
+	benchTextReset(script);
+	result->generated_entries = result->workload->generate(script, scale, &verify_path);
+	bool script_written = !script->overflow && benchTextWrite(script, BENCH_SCRIPT_NAME);
+	uint64 generate_time = platformGetTimeNanoseconds() - generate_start;
+	result->script_bytes = script->length;
+
+	// Phase 2, run sourcery over the script. A streamed workload is piped to it by
+	// the bench, repeating the script until the stream is large enough.
+	char* command = arena_push_array_zero(arena, char, BENCH_PATH_SIZE);
+	uint64 stream_size = 0;
+	if (result->workload->stream_bytes != 0 && script->length != 0)
+	{
+		uint64 repeat_count = (result->workload->stream_bytes + script->length - 1) / script->length;
+		stream_size = repeat_count * script->length;
+		result->script_bytes = stream_size;
+		snprintf(command, BENCH_PATH_SIZE, "\"%s\" --emit=%s --repeat=%llu | \"%s\" %s --stdin > %s", bench_path,
+			BENCH_SCRIPT_NAME, (unsigned long long)repeat_count, sourcery_path, sourcery_args, BENCH_NULL_DEVICE);
+	}
+	else
+	{
+		snprintf(command, BENCH_PATH_SIZE, "\"%s\" %s %s > %s", sourcery_path, sourcery_args, BENCH_SCRIPT_NAME,
+			BENCH_NULL_DEVICE);
+	}
+
+	uint64 run_start = platformGetTimeNanoseconds();
+	int run_status = script_written ? platformRunCLIProcess(command, NULL) : -1;
+	uint64 run_time = platformGetTimeNanoseconds() - run_start;
+
+	bool succeeded = (script_written && run_status == 0 &&
+		(verify_path == NULL || platformGetPathType(verify_path) != PLATFORM_PATHTYPE_NONE));
+
+	// The end of a stream has to record every byte that came before it.
+	if (succeeded && stream_size != 0)
+	{
+		char* stream_end = benchLoadFile(arena, BENCH_STREAM_END_NAME);
+		succeeded = (stream_end != NULL && strtoull(stream_end, NULL, 10) == stream_size);
+	}
+
+	if (record)
+	{
+		benchSamplesAdd(&result->generate_samples, generate_time);
+		benchSamplesAdd(&result->run_samples, run_time);
+		if (!succeeded)
+			result->failures++;
+	}
+
+	arena_restore(arena, stash_point);
+	return succeeded;
+
+}
+
+internal void
+benchAppendSummary(bench_text* json, const char* phase_name, bench_summary* summary, bool last)
+{
+	benchTextAppend(json,
+		"        \"%s\": { \"min_ms\": %.4f, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, "
+		"\"p99_ms\": %.4f, \"max_ms\": %.4f, \"stddev_ms\": %.4f }%s\n",
+		phase_name,
+		summary->min / NANOSECONDS_PER_MILLISECOND, summary->mean / NANOSECONDS_PER_MILLISECOND,
+		summary->p50 / NANOSECONDS_PER_MILLISECOND, summary->p90 / NANOSECONDS_PER_MILLISECOND,
+		summary->p99 / NANOSECONDS_PER_MILLISECOND, summary->max / NANOSECONDS_PER_MILLISECOND,
+		summary->stddev / NANOSECONDS_PER_MILLISECOND, last ? "" : ",");
+}
+
+/**
+ * Throughput is taken from the median run, so a single slow outlier doesn't skew it.
+ */
+internal real64
+benchPerSecond(real64 amount, bench_summary* summary)
+{
+	if (summary->p50 <= 0.0)
+		return 0.0;
+	return amount * (real64)NANOSECONDS_PER_SECOND / summary->p50;
+}
+
+internal void
+benchWriteResults(bench_text* json, bench_result* results, uint32 result_count,
+	const char* sourcery_path, const char* sourcery_args, uint32 iterations, uint32 scale)
+{
+
+	benchTextAppend(json, "{\n");
+	benchTextAppend(json, "  \"sourcery\": \"");
+	for (const char* c = sourcery_path; *c != '\0'; ++c)
+		benchTextAppend(json, (*c == '\\' || *c == '"') ? "\\%c" : "%c", *c);
+	benchTextAppend(json, "\",\n");
+	benchTextAppend(json, "  \"arguments\": \"");
+	for (const char* c = sourcery_args; *c != '\0'; ++c)
+		benchTextAppend(json, (*c == '\\' || *c == '"') ? "\\%c" : "%c", *c);
+	benchTextAppend(json, "\",\n");
+	benchTextAppend(json, "  \"iterations\": %u,\n", iterations);
+	benchTextAppend(json, "  \"scale\": %u,\n", scale);
+	benchTextAppend(json, "  \"workloads\": [\n");
+
+	for (uint32 result_index = 0; result_index < result_count; ++result_index)
+	{
+		bench_result* result = &results[result_index];
+		benchTextAppend(json, "    {\n");
+		benchTextAppend(json, "      \"name\": \"%s\",\n", result->workload->name);
+		benchTextAppend(json, "      \"description\": \"%s\",\n", result->workload->description);
+		benchTextAppend(json, "      \"script_bytes\": %llu,\n", (unsigned long long)result->script_bytes);
+		benchTextAppend(json, "      \"generated_entries\": %llu,\n", (unsigned long long)result->generated_entries);
+		benchTextAppend(json, "      \"failures\": %u,\n", result->failures);
+		benchTextAppend(json, "      \"scripts_per_second\": %.3f,\n",
+			benchPerSecond(1.0, &result->run_summary));
+		benchTextAppend(json, "      \"entries_per_second\": %.3f,\n",
+			benchPerSecond((real64)result->generated_entries, &result->run_summary));
+		benchTextAppend(json, "      \"run_p50_ms\": %.4f,\n", result->run_summary.p50 / NANOSECONDS_PER_MILLISECOND);
+		benchTextAppend(json, "      \"megabytes_per_second\": %.3f,\n",
+			benchPerSecond((real64)result->script_bytes / (real64)MEGABYTES(1), &result->run_summary));
+		benchTextAppend(json, "      \"phases\": {\n");
+		benchAppendSummary(json, "generate", &result->generate_summary, false);
+		benchAppendSummary(json, "run", &result->run_summary, true);
+		benchTextAppend(json, "      }\n");
+		benchTextAppend(json, "    }%s\n", (result_index + 1 < result_count) ? "," : "");
+	}
+
+	benchTextAppend(json, "  ]\n");
+	benchTextAppend(json, "}\n");
+
+}
+
+/**
+ * Compares the run phase's median of each workload against a baseline.
+ *
+ * @returns True if no workload regressed beyond the threshold, false if any did.
+ */
+internal bool
+benchCompareBaseline(const char* baseline, bench_result* results, uint32 result_count, real64 threshold)
+{
+
+	bool passed = true;
+	printf("\n%-14s %14s %14s %10s\n", "workload", "baseline p50", "current p50", "change");
+	for (uint32 result_index = 0; result_index < result_count; ++result_index)
+	{
+		bench_result* result = &results[result_index];
+
+		real64 baseline_p50 = 0.0;
+		if (!benchFindResult(baseline, result->workload->name, "run_p50_ms", &baseline_p50) || baseline_p50 <= 0.0)
+		{
+			printf("%-14s %14s\n", result->workload->name, "missing");
+			continue;
+		}
+
+		real64 current_p50 = result->run_summary.p50 / NANOSECONDS_PER_MILLISECOND;
+		real64 change = (current_p50 - baseline_p50) / baseline_p50 * 100.0;
+		bool regressed = (change > threshold);
+		if (regressed)
+			passed = false;
+
+		printf("%-14s %12.3fms %12.3fms %+9.2f%%%s\n", result->workload->name, baseline_p50, current_p50,
+			change, regressed ? "  REGRESSED" : "");
+	}
+
+	return passed;
+
+}
+
+int
+main(int argc, char** argv)
+{
+
+	size_t heap_size = BENCH_HEAP_SIZE;
+	void* heap = NULL;
+	if (!virtual_allocate(&heap, &heap_size, 0))
+	{
+		printf("Error: Unable to allocate the bench's heap.\n");
+		return -1;
+	}
+	mem_arena arena = {0};
+	arena_allocate(heap, heap_size, &arena);
+
+	// A streamed workload runs a second bench to write its stream.
+	const char* emit_value = benchFindArgument(argc, argv, "--emit=");
+	if (emit_value != NULL)
+	{
+		const char* repeat_value = benchFindArgument(argc, argv, "--repeat=");
+		return benchEmitStream(&arena, emit_value, repeat_value ? strtoull(repeat_value, NULL, 10) : 1);
+	}
+
+	for (int argument_index = 1; argument_index < argc; ++argument_index)
+	{
+		if (strEquals(argv[argument_index], "--help"))
+		{
+			benchPrintUsage();
+			return 0;
+		}
+	}
+
+	// Gather the options.
+	const char* iterations_value = benchFindArgument(argc, argv, "--iterations=");
+	const char* scale_value = benchFindArgument(argc, argv, "--scale=");
+	const char* threshold_value = benchFindArgument(argc, argv, "--threshold=");
+	const char* workload_filter = benchFindArgument(argc, argv, "--workload=");
+	const char* output_path = benchFindArgument(argc, argv, "--output=");
+	const char* baseline_path = benchFindArgument(argc, argv, "--baseline=");
+	const char* sourcery_value = benchFindArgument(argc, argv, "--sourcery=");
+	const char* workdir_value = benchFindArgument(argc, argv, "--workdir=");
+	const char* args_value = benchFindArgument(argc, argv, "--args=");
+	const char* sourcery_args = args_value ? args_value : "";
+
+	bool keep_workdir = false;
+	for (int argument_index = 1; argument_index < argc; ++argument_index)
+	{
+		if (strEquals(argv[argument_index], "--keep"))
+			keep_workdir = true;
+	}
+
+	uint32 iterations = iterations_value ? (uint32)strtoul(iterations_value, NULL, 10) : BENCH_DEFAULT_ITERATIONS;
+	uint32 scale = scale_value ? (uint32)strtoul(scale_value, NULL, 10) : BENCH_DEFAULT_SCALE;
+	real64 threshold = threshold_value ? strtod(threshold_value, NULL) : BENCH_DEFAULT_THRESHOLD;
+	if (iterations == 0 || scale == 0)
+	{
+		printf("Error: The iterations and scale must be at least 1.\n");
+		return -1;
+	}
+
+	char* base_directory = arena_push_array_zero(&arena, char, BENCH_PATH_SIZE);
+	if (!platformGetWorkingDirectory(base_directory, BENCH_PATH_SIZE))
+	{
+		printf("Error: Unable to determine the working directory.\n");
+		return -1;
+	}
+
+	char* bench_path = benchResolvePath(&arena, base_directory, argv[0]);
+	char* sourcery_path = benchResolvePath(&arena, base_directory,
+		sourcery_value ? sourcery_value : benchFindSourcery(&arena, argv[0]));
+	char* workdir = benchResolvePath(&arena, base_directory, workdir_value ? workdir_value : BENCH_DEFAULT_WORKDIR);
+	char* output = benchResolvePath(&arena, base_directory, output_path ? output_path : BENCH_DEFAULT_OUTPUT);
+
+	if (platformGetPathType(sourcery_path) != PLATFORM_PATHTYPE_FILE)
+	{
+		printf("Error: Unable to find sourcery at %s, provide it with --sourcery=.\n", sourcery_path);
+		return -1;
+	}
+
+	char* baseline = NULL;
+	if (baseline_path != NULL)
+	{
+		baseline = benchLoadFile(&arena, baseline_path);
+		if (baseline == NULL)
+		{
+			printf("Error: Unable to open the baseline %s.\n", baseline_path);
+			return -1;
+		}
+	}
+
+	// Anything already in the workdir is left alone, only the run directory is ours.
+	bool created_workdir = platformCreateDirectory(workdir);
+	char* run_directory = benchCreateRunDirectory(&arena, workdir);
+	if (run_directory == NULL)
+	{
+		printf("Error: Unable to create a run directory under %s.\n", workdir);
+		return -1;
+	}
+
+	bench_text script = {0};
+	benchTextCreate(&arena, &script, BENCH_SCRIPT_RESERVE);
+
+	uint32 workload_count = (uint32)(sizeof(bench_workloads) / sizeof(bench_workloads[0]));
+	bench_result* results = arena_push_array_zero(&arena, bench_result, workload_count);
+	uint32 result_count = 0;
+
+	printf("%-14s %12s %12s %12s %14s\n", "workload", "run p50", "run p90", "run p99", "entries/s");
+	for (uint32 workload_index = 0; workload_index < workload_count; ++workload_index)
+	{
+		const bench_workload* workload = &bench_workloads[workload_index];
+		if (workload_filter != NULL && !strEquals(workload_filter, workload->name))
+			continue;
+		if (workload_filter == NULL && workload->stream_bytes != 0)
+			continue;
+
+		bench_result* result = &results[result_count++];
+		result->workload = workload;
+		benchSamplesCreate(&arena, &result->generate_samples, iterations);
+		benchSamplesCreate(&arena, &result->run_samples, iterations);
+
+		char* workload_directory = arena_push_array_zero(&arena, char, BENCH_PATH_SIZE);
+		snprintf(workload_directory, BENCH_PATH_SIZE, "%s%c%s", run_directory, BENCH_PATH_SEPARATOR, workload->name);
+		platformCreateDirectory(workload_directory);
+
+		// A warm-up iteration fills the OS caches and isn't recorded. A stream never
+		// touches the disk, so it has nothing to warm up.
+		if (workload->stream_bytes == 0)
+		{
+			benchRunIteration(&arena, result, &script, bench_path, sourcery_path, sourcery_args,
+				workload_directory, 0, scale, false);
+		}
+		for (uint32 iteration = 1; iteration <= iterations; ++iteration)
+		{
+			benchRunIteration(&arena, result, &script, bench_path, sourcery_path, sourcery_args,
+				workload_directory, iteration, scale, true);
+		}
+
+		platformSetWorkingDirectory(base_directory);
+		benchSummarize(&result->generate_samples, &result->generate_summary);
+		benchSummarize(&result->run_samples, &result->run_summary);
+
+		printf("%-14s %10.3fms %10.3fms %10.3fms %14.1f%s\n", workload->name,
+			result->run_summary.p50 / NANOSECONDS_PER_MILLISECOND,
+			result->run_summary.p90 / NANOSECONDS_PER_MILLISECOND,
+			result->run_summary.p99 / NANOSECONDS_PER_MILLISECOND,
+			benchPerSecond((real64)result->generated_entries, &result->run_summary),
+			result->failures ? "  FAILED" : "");
+		fflush(stdout);
+	}
+
+	if (result_count == 0)
+	{
+		printf("Error: There is no workload named %s.\n", workload_filter);
+		return -1;
+	}
+
+	// Write out the results.
+	bench_text json = {0};
+	benchTextCreate(&arena, &json, BENCH_RESULTS_RESERVE);
+	benchWriteResults(&json, results, result_count, sourcery_path, sourcery_args, iterations, scale);
+	if (!benchTextWrite(&json, output))
+		printf("Error: Unable to write the results to %s.\n", output);
+	else
+		printf("Results were written to %s.\n", output);
+
+	// The workdir itself is only removed if the bench created it and nothing else
+	// has been put in it since.
+	if (!keep_workdir)
+	{
+		char* remove_command = arena_push_array_zero(&arena, char, BENCH_PATH_SIZE);
+		snprintf(remove_command, BENCH_PATH_SIZE, "%s \"%s\"", BENCH_REMOVE_COMMAND, run_directory);
+		platformRunCLIProcess(remove_command, NULL);
+		if (created_workdir)
+		{
+			snprintf(remove_command, BENCH_PATH_SIZE, "%s \"%s\" 2> %s", BENCH_REMOVE_EMPTY_COMMAND, workdir,
+				BENCH_NULL_DEVICE);
+			platformRunCLIProcess(remove_command, NULL);
+		}
+	}
+	else
+		printf("The workloads were kept in %s.\n", run_directory);
+
+	int exit_status = 0;
+	for (uint32 result_index = 0; result_index < result_count; ++result_index)
+	{
+		if (results[result_index].failures != 0)
+			exit_status = 1;
+	}
+
+	if (baseline != NULL && !benchCompareBaseline(baseline, results, result_count, threshold))
+	{
+		printf("One or more workloads regressed by more than %.2f%%.\n", threshold);
+		exit_status = 1;
+	}
+
+	return exit_status;
+
+}
@@ -0,0 +1,636 @@
+/**
+ * Sourcery Microbench
+ *
+ * Measures the string and arena routines that sit in Sourcery's inner loops, each
+ * alongside the libc routine that does the same job, across a range of input sizes
+ * and source alignments. The libc column is the bar a faster implementation has
+ * to reach, and the ratio shows how far off the current implementation is.
+ *
+ * Each case is warmed up by doubling its batch size until a batch takes long
+ * enough to time reliably, then the batch is repeated and the per-call time is
+ * summarized over the repeats.
+ *
+ * 		sourcery_microbench [OPT:--filter=(text)] [OPT:--repeats=(n)] [OPT:--output=(file)]
+ * 			[OPT:--baseline=(file)] [OPT:--threshold=(percent)]
+ *
+ * A case only runs if its name contains the filter text.
+ */
+
+// The memmem() reference is an extension that glibc only declares when asked to.
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <bench/bench.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/memory/memutils.h>
+#include <sourcery/string/string_utils.h>
+#include <sourcery/time/clock.h>
+
+#define MICRO_HEAP_SIZE 			MEGABYTES(256)
+#define MICRO_ARENA_SIZE 			MEGABYTES(64)
+#define MICRO_RESULTS_RESERVE 		MEGABYTES(1)
+#define MICRO_BUFFER_PADDING 		256
+
+#define MICRO_DEFAULT_REPEATS 		25
+#define MICRO_DEFAULT_THRESHOLD 	5.0
+#define MICRO_DEFAULT_OUTPUT 		"sourcery_microbench.json"
+#define MICRO_MIN_BATCH_TIME 		(200 * 1000)
+#define MICRO_NEEDLE 				"#!needle"
+
+persist const size_t micro_sizes[] = { 16, 64, 256, KILOBYTES(4), KILOBYTES(64), MEGABYTES(1) };
+persist const size_t micro_alignments[] = { 0, 1, 7 };
+
+/**
+ * The input every case runs over. The source holds letters up to a needle and a
+ * newline which end exactly at the source size, followed by the null-terminator,
+ * so every routine has to walk the whole input.
+ */
+typedef struct micro_input
+{
+	char* 	source;
+	size_t 	size;
+
+	char* 	dest;
+	size_t 	dest_size;
+
+	mem_arena* arena;
+} micro_input;
+
+/**
+ * Runs a routine over the input a number of times.
+ *
+ * @returns A value derived from the routine's results. Each result also passes
+ * through microConsume(), which is what keeps the calls from being optimized away.
+ */
+typedef uint64 (*micro_proc)(micro_input* input, uint64 iterations);
+
+typedef struct micro_case
+{
+	const char* name;
+	const char* reference_name;
+	micro_proc 	sourcery;
+	micro_proc 	reference;
+} micro_case;
+
+typedef struct micro_result
+{
+	char 			name[64];
+	const char* 	reference_name;
+	size_t 			size;
+	size_t 			alignment;
+	bench_summary 	sourcery_summary;
+	bench_summary 	reference_summary;
+	bool 			has_reference;
+} micro_result;
+
+persist volatile uint64 micro_sink;
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#	define microBarrier() _ReadWriteBarrier()
+#else
+#	define microBarrier() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+ * Hands a call's result to the sink, then stops the compiler from assuming memory
+ * is unchanged across the barrier. Every case passes each call's result through
+ * here, so a call on unchanging input can neither be dropped nor hoisted out of
+ * its loop, in the Sourcery column and the libc column alike.
+ *
+ * @returns The value, to be folded into the case's checksum.
+ */
+internal uint64
+microConsume(uint64 value)
+{
+	micro_sink = value;
+	microBarrier();
+	return value;
+}
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Cases
+ * ---------------------------------------------------------------------------------------------------------------------
+ */
+
+internal uint64
+microStrLength(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+		checksum += microConsume(strLength(input->source));
+	return checksum;
+}
+
+internal uint64
+microLibcStrlen(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+		checksum += microConsume(strlen(input->source));
+	return checksum;
+}
+
+internal uint64
+microStrLineLength(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+		checksum += microConsume(strLineLength(input->source, 0));
+	return checksum;
+}
+
+internal uint64
+microLibcMemchr(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+		checksum += microConsume((uint64)((char*)memchr(input->source, '\n', input->size) - input->source));
+	return checksum;
+}
+
+internal uint64
+microStrCopyLine(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		size_t next_offset = 0;
+		checksum += microConsume(strCopyLine(input->dest, input->dest_size, input->source, 0, &next_offset));
+		checksum += next_offset;
+	}
+	return checksum;
+}
+
+internal uint64
+microLibcMemchrMemcpy(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		size_t line_length = (size_t)((char*)memchr(input->source, '\n', input->size) - input->source);
+		memcpy(input->dest, input->source, line_length);
+		input->dest[line_length] = '\0';
+		checksum += microConsume(line_length);
+	}
+	return checksum;
+}
+
+internal uint64
+microStrSearchToken(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		size_t location = 0;
+		strSearchToken(MICRO_NEEDLE, input->source, 0, &location);
+		checksum += microConsume(location);
+	}
+	return checksum;
+}
+
+internal uint64
+microLibcMemmem(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+#if defined(PLATFORM_WINDOWS)
+		const char* match = strstr(input->source, MICRO_NEEDLE);
+#else
+		const char* match = (const char*)memmem(input->source, input->size, MICRO_NEEDLE, sizeof(MICRO_NEEDLE) - 1);
+#endif
+		checksum += microConsume((uint64)(match - input->source));
+	}
+	return checksum;
+}
+
+internal uint64
+microStrSubstring(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		strSubstring(input->dest, input->dest_size, input->source, 0, STR_END);
+		checksum += microConsume((uint8)input->dest[i % input->size]);
+	}
+	return checksum;
+}
+
+internal uint64
+microStrCopy(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		strCopy(input->dest, input->dest_size, input->source, input->size);
+		checksum += microConsume((uint8)input->dest[i % input->size]);
+	}
+	return checksum;
+}
+
+internal uint64
+microLibcMemcpy(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		memcpy(input->dest, input->source, input->size);
+		checksum += microConsume((uint8)input->dest[i % input->size]);
+	}
+	return checksum;
+}
+
+internal uint64
+microMemorySet(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		memory_set(input->dest, input->size, (uint8)i);
+		checksum += microConsume((uint8)input->dest[i % input->size]);
+	}
+	return checksum;
+}
+
+internal uint64
+microLibcMemset(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		memset(input->dest, (int)(uint8)i, input->size);
+		checksum += microConsume((uint8)input->dest[i % input->size]);
+	}
+	return checksum;
+}
+
+internal uint64
+microArenaPush(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		if (input->arena->offset + input->size >= input->arena->size)
+			arena_clear(input->arena);
+		checksum += microConsume((uint64)(size_t)arena_push(input->arena, input->size));
+	}
+	return checksum;
+}
+
+internal uint64
+microArenaPushZero(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		if (input->arena->offset + input->size >= input->arena->size)
+			arena_clear(input->arena);
+		uint8* buffer = (uint8*)arena_push_zero(input->arena, input->size);
+		checksum += microConsume(buffer[i % input->size]);
+	}
+	return checksum;
+}
+
+/**
+ * The same bump allocation as arena_push_zero(), zeroed with memset().
+ */
+internal uint64
+microLibcPushMemset(micro_input* input, uint64 iterations)
+{
+	uint64 checksum = 0;
+	for (uint64 i = 0; i < iterations; ++i)
+	{
+		if (input->arena->offset + input->size >= input->arena->size)
+			arena_clear(input->arena);
+		uint8* buffer = (uint8*)arena_push(input->arena, input->size);
+		memset(buffer, 0, input->size);
+		checksum += microConsume(buffer[i % input->size]);
+	}
+	return checksum;
+}
+
+persist const micro_case micro_cases[] =
+{
+	{ "strLength", 			"strlen", 			&microStrLength, 		&microLibcStrlen },
+	{ "strLineLength", 		"memchr", 			&microStrLineLength, 	&microLibcMemchr },
+	{ "strCopyLine", 		"memchr+memcpy", 	&microStrCopyLine, 		&microLibcMemchrMemcpy },
+	{ "strSearchToken", 	"memmem", 			&microStrSearchToken, 	&microLibcMemmem },
+	{ "strSubstring", 		"memcpy", 			&microStrSubstring, 	&microLibcMemcpy },
+	{ "strCopy", 			"memcpy", 			&microStrCopy, 			&microLibcMemcpy },
+	{ "memory_set", 		"memset", 			&microMemorySet, 		&microLibcMemset },
+	{ "arena_push", 		NULL, 				&microArenaPush, 		NULL },
+	{ "arena_push_zero", 	"push+memset", 		&microArenaPushZero, 	&microLibcPushMemset },
+};
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Harness
+ * ---------------------------------------------------------------------------------------------------------------------
+ */
+
+/**
+ * Lays out the source as described by micro_input.
+ */
+internal void
+microFillSource(char* source, size_t size)
+{
+	size_t needle_length = sizeof(MICRO_NEEDLE) - 1;
+	size_t letter_count = size - needle_length - 1;
+	for (size_t c_index = 0; c_index < letter_count; ++c_index)
+		source[c_index] = (char)('a' + (c_index % 26));
+	memcpy(source + letter_count, MICRO_NEEDLE, needle_length);
+	source[size - 1] = '\n';
+	source[size] = '\0';
+}
+
+/**
+ * Warms a routine up, finding a batch size that takes long enough to time, and
+ * then times the batch repeatedly.
+ *
+ * @returns The number of calls within each timed batch.
+ */
+internal uint64
+microMeasure(micro_proc proc, micro_input* input, bench_samples* samples, uint32 repeats)
+{
+
+	uint64 iterations = 1;
+	while (true)
+	{
+		uint64 batch_start = platformGetTimeNanoseconds();
+		micro_sink += proc(input, iterations);
+		uint64 batch_time = platformGetTimeNanoseconds() - batch_start;
+		if (batch_time >= MICRO_MIN_BATCH_TIME)
+			break;
+		iterations *= 2;
+	}
+
+	for (uint32 repeat = 0; repeat < repeats; ++repeat)
+	{
+		uint64 batch_start = platformGetTimeNanoseconds();
+		micro_sink += proc(input, iterations);
+		benchSamplesAdd(samples, platformGetTimeNanoseconds() - batch_start);
+	}
+
+	return iterations;
+
+}
+
+/**
+ * Scales a summary of batch times down to the time of a single call.
+ */
+internal void
+microPerCall(bench_summary* summary, uint64 iterations)
+{
+	real64 divisor = (real64)iterations;
+	summary->min /= divisor;
+	summary->mean /= divisor;
+	summary->p50 /= divisor;
+	summary->p90 /= divisor;
+	summary->p99 /= divisor;
+	summary->max /= divisor;
+	summary->stddev /= divisor;
+}
+
+internal real64
+microGigabytesPerSecond(size_t size, real64 nanoseconds)
+{
+	if (nanoseconds <= 0.0)
+		return 0.0;
+	return (real64)size / nanoseconds;
+}
+
+internal void
+microWriteResults(bench_text* json, micro_result* results, uint32 result_count, uint32 repeats)
+{
+
+	benchTextAppend(json, "{\n");
+	benchTextAppend(json, "  \"repeats\": %u,\n", repeats);
+	benchTextAppend(json, "  \"cases\": [\n");
+
+	for (uint32 result_index = 0; result_index < result_count; ++result_index)
+	{
+		micro_result* result = &results[result_index];
+		benchTextAppend(json, "    {\n");
+		benchTextAppend(json, "      \"name\": \"%s\",\n", result->name);
+		benchTextAppend(json, "      \"size\": %zu,\n", result->size);
+		benchTextAppend(json, "      \"alignment\": %zu,\n", result->alignment);
+		benchTextAppend(json, "      \"sourcery_ns\": %.4f,\n", result->sourcery_summary.p50);
+		benchTextAppend(json, "      \"sourcery_min_ns\": %.4f,\n", result->sourcery_summary.min);
+		benchTextAppend(json, "      \"sourcery_stddev_ns\": %.4f,\n", result->sourcery_summary.stddev);
+		benchTextAppend(json, "      \"sourcery_gigabytes_per_second\": %.4f",
+			microGigabytesPerSecond(result->size, result->sourcery_summary.p50));
+
+		if (result->has_reference)
+		{
+			benchTextAppend(json, ",\n      \"reference\": \"%s\",\n", result->reference_name);
+			benchTextAppend(json, "      \"reference_ns\": %.4f,\n", result->reference_summary.p50);
+			benchTextAppend(json, "      \"reference_min_ns\": %.4f,\n", result->reference_summary.min);
+			benchTextAppend(json, "      \"reference_stddev_ns\": %.4f,\n", result->reference_summary.stddev);
+			benchTextAppend(json, "      \"reference_gigabytes_per_second\": %.4f,\n",
+				microGigabytesPerSecond(result->size, result->reference_summary.p50));
+			benchTextAppend(json, "      \"ratio\": %.4f\n",
+				result->reference_summary.p50 > 0.0 ? result->sourcery_summary.p50 / result->reference_summary.p50 : 0.0);
+		}
+		else
+		{
+			benchTextAppend(json, "\n");
+		}
+
+		benchTextAppend(json, "    }%s\n", (result_index + 1 < result_count) ? "," : "");
+	}
+
+	benchTextAppend(json, "  ]\n");
+	benchTextAppend(json, "}\n");
+
+}
+
+/**
+ * Compares each case's median time per call against a baseline.
+ *
+ * @returns True if no case regressed beyond the threshold, false if any did.
+ */
+internal bool
+microCompareBaseline(const char* baseline, micro_result* results, uint32 result_count, real64 threshold)
+{
+
+	bool passed = true;
+	uint32 missing_count = 0;
+	printf("\n%-32s %14s %14s %10s\n", "case", "baseline", "current", "change");
+	for (uint32 result_index = 0; result_index < result_count; ++result_index)
+	{
+		micro_result* result = &results[result_index];
+
+		real64 baseline_ns = 0.0;
+		if (!benchFindResult(baseline, result->name, "sourcery_ns", &baseline_ns) || baseline_ns <= 0.0)
+		{
+			missing_count++;
+			continue;
+		}
+
+		real64 change = (result->sourcery_summary.p50 - baseline_ns) / baseline_ns * 100.0;
+		bool regressed = (change > threshold);
+		if (regressed)
+			passed = false;
+
+		printf("%-32s %12.2fns %12.2fns %+9.2f%%%s\n", result->name, baseline_ns, result->sourcery_summary.p50,
+			change, regressed ? "  REGRESSED" : "");
+	}
+
+	if (missing_count != 0)
+		printf("%u case(s) weren't in the baseline.\n", missing_count);
+
+	return passed;
+
+}
+
+int
+main(int argc, char** argv)
+{
+
+	size_t heap_size = MICRO_HEAP_SIZE;
+	void* heap = NULL;
+	if (!virtual_allocate(&heap, &heap_size, 0))
+	{
+		printf("Error: Unable to allocate the microbench's heap.\n");
+		return -1;
+	}
+	mem_arena arena = {0};
+	arena_allocate(heap, heap_size, &arena);
+
+	const char* filter = benchFindArgument(argc, argv, "--filter=");
+	const char* repeats_value = benchFindArgument(argc, argv, "--repeats=");
+	const char* threshold_value = benchFindArgument(argc, argv, "--threshold=");
+	const char* output_path = benchFindArgument(argc, argv, "--output=");
+	const char* baseline_path = benchFindArgument(argc, argv, "--baseline=");
+
+	uint32 repeats = repeats_value ? (uint32)strtoul(repeats_value, NULL, 10) : MICRO_DEFAULT_REPEATS;
+	real64 threshold = threshold_value ? strtod(threshold_value, NULL) : MICRO_DEFAULT_THRESHOLD;
+	if (repeats == 0)
+	{
+		printf("Error: The repeats must be at least 1.\n");
+		return -1;
+	}
+
+	char* baseline = NULL;
+	if (baseline_path != NULL)
+	{
+		baseline = benchLoadFile(&arena, baseline_path);
+		if (baseline == NULL)
+		{
+			printf("Error: Unable to open the baseline %s.\n", baseline_path);
+			return -1;
+		}
+	}
+
+	// The buffers are sized for the largest input at the largest alignment.
+	uint32 size_count = (uint32)(sizeof(micro_sizes) / sizeof(micro_sizes[0]));
+	uint32 alignment_count = (uint32)(sizeof(micro_alignments) / sizeof(micro_alignments[0]));
+	uint32 case_count = (uint32)(sizeof(micro_cases) / sizeof(micro_cases[0]));
+	size_t buffer_size = micro_sizes[size_count - 1] + MICRO_BUFFER_PADDING;
+
+	char* source_buffer = arena_push_array_zero(&arena, char, buffer_size);
+	char* dest_buffer = arena_push_array_zero(&arena, char, buffer_size);
+	uint8* case_region = arena_push_array(&arena, uint8, MICRO_ARENA_SIZE);
+	mem_arena case_arena = {0};
+	arena_allocate(case_region, MICRO_ARENA_SIZE, &case_arena);
+
+	uint32 result_capacity = case_count * size_count * alignment_count;
+	micro_result* results = arena_push_array_zero(&arena, micro_result, result_capacity);
+	uint32 result_count = 0;
+
+	bench_samples samples = {0};
+	benchSamplesCreate(&arena, &samples, repeats);
+
+	printf("%-32s %14s %14s %8s %10s\n", "case", "sourcery", "libc", "ratio", "GB/s");
+	for (uint32 case_index = 0; case_index < case_count; ++case_index)
+	{
+		const micro_case* current_case = &micro_cases[case_index];
+		for (uint32 size_index = 0; size_index < size_count; ++size_index)
+		{
+			for (uint32 alignment_index = 0; alignment_index < alignment_count; ++alignment_index)
+			{
+				size_t size = micro_sizes[size_index];
+				size_t alignment = micro_alignments[alignment_index];
+
+				micro_result* result = &results[result_count];
+				snprintf(result->name, sizeof(result->name), "%s/%zu/%zu", current_case->name, size, alignment);
+				if (filter != NULL)
+				{
+					size_t location = 0;
+					if (!strSearchToken(filter, result->name, 0, &location))
+						continue;
+				}
+				result_count++;
+
+				// Both buffers start on a cache line, then are offset by the alignment.
+				micro_input input = {0};
+				input.source = (char*)(((size_t)source_buffer + 63) & ~(size_t)63) + alignment;
+				input.dest = (char*)(((size_t)dest_buffer + 63) & ~(size_t)63) + alignment;
+				input.size = size;
+				input.dest_size = size + 1;
+				input.arena = &case_arena;
+				microFillSource(input.source, size);
+
+				result->reference_name = current_case->reference_name;
+				result->size = size;
+				result->alignment = alignment;
+
+				samples.count = 0;
+				arena_clear(&case_arena);
+				uint64 iterations = microMeasure(current_case->sourcery, &input, &samples, repeats);
+				benchSummarize(&samples, &result->sourcery_summary);
+				microPerCall(&result->sourcery_summary, iterations);
+
+				if (current_case->reference != NULL)
+				{
+					samples.count = 0;
+					arena_clear(&case_arena);
+					iterations = microMeasure(current_case->reference, &input, &samples, repeats);
+					benchSummarize(&samples, &result->reference_summary);
+					microPerCall(&result->reference_summary, iterations);
+					result->has_reference = true;
+
+					printf("%-32s %12.2fns %12.2fns %7.2fx %10.3f\n", result->name,
+						result->sourcery_summary.p50, result->reference_summary.p50,
+						result->sourcery_summary.p50 / result->reference_summary.p50,
+						microGigabytesPerSecond(size, result->sourcery_summary.p50));
+				}
+				else
+				{
+					printf("%-32s %12.2fns %14s %8s %10.3f\n", result->name, result->sourcery_summary.p50,
+						"-", "-", microGigabytesPerSecond(size, result->sourcery_summary.p50));
+				}
+				fflush(stdout);
+			}
+		}
+	}
+
+	if (result_count == 0)
+	{
+		printf("Error: No case matches the filter %s.\n", filter);
+		return -1;
+	}
+
+	bench_text json = {0};
+	benchTextCreate(&arena, &json, MICRO_RESULTS_RESERVE);
+	microWriteResults(&json, results, result_count, repeats);
+	const char* output = output_path ? output_path : MICRO_DEFAULT_OUTPUT;
+	if (!benchTextWrite(&json, output))
+		printf("Error: Unable to write the results to %s.\n", output);
+	else
+		printf("Results were written to %s.\n", output);
+
+	int exit_status = 0;
+	if (baseline != NULL && !microCompareBaseline(baseline, results, result_count, threshold))
+	{
+		printf("One or more cases regressed by more than %.2f%%.\n", threshold);
+		exit_status = 1;
+	}
+
+	return exit_status;
+
+}
@@ -1,11 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <main.h>
 #include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory_scan.h>
+#include <sourcery/filesystem/watch.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/log/log.h>
+#include <sourcery/ipc/local_socket.h>
 #include <sourcery/memory/alloc.h>
 #include <sourcery/memory/memutils.h>
+#include <sourcery/perf/perf_zones.h>
+#include <sourcery/pipeline/script_pipeline.h>
+#include <sourcery/process/command_report.h>
 #include <sourcery/process/process.h>
 #include <sourcery/string/string_utils.h>
 #include <sourcery/structures/node_trunk.h>
+#include <sourcery/time/clock.h>
+#include <sourcery/trace/trace.h>
 
 /**
  * 
@@ -48,44 +59,15 @@
  * 				can have its own heap memory block which will prevent any race-conditions.
  * 				
  * 		5b. Optional File Modification
- * 				The second pass will generate a second source file in memory, running
- * 				procedurally, until EOF. A second file will be generated in-memory as
- * 				this happens, constructing a directive-stripped version of each file.
- * 				
  * 				If Sourcery is designated to do modifications and the file isn't in
- * 				script-mode, the second-pass will dump these changes to disk after
- * 				storing a backup in ".sourcery".
+ * 				script-mode, each file that had directives is streamed through a
+ * 				stripper after storing a backup in ".sourcery". The stripper copies
+ * 				everything but the directive lines and their multiline bodies into a
+ * 				temporary file, which is renamed over the original. Files without
+ * 				directives are known from the first pass and are never rewritten.
  * 
  */
 
-/**
- * Loads a text source from a file and places it within a memory arena.
- */
-internal char*
-loadSource(mem_arena* arena, const char* file)
-{
-	// Attempt to open the file.
-	filehandle fh = {0};
-	if (!platformOpenFile(&fh, file, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
-	{
-		printf("Error: Unable to open the file %s for reading.\n", file);
-		exit(1);
-	}
-
-	// Once the file is open, determine how large the text file is and add one
-	// byte for null-termination to create the buffer using the memory arena.
-	size_t file_size = fh.file_size + 1;
-	char* file_buffer = arena_push_array_zero(arena, char, file_size);
-
-	// Read the file into the buffer.
-	size_t bytes_read = platformReadFile(&fh, file_buffer, file_size);
-
-	// Close the file handle.
-	platformCloseFile(&fh);
-
-	return file_buffer;
-}
-
 /**
  * Virtually allocates n-bytes from the heap times the number of executing threads.
  * Used for partitioning areas of the heap to a particular thread. The size provided
@@ -96,11 +78,12 @@ loadSource(mem_arena* arena, const char* file)
  * @param pre_thread_size The size, in bytes, that should be virtually allocated for
  * each thread.
  * @param final_size The size, in bytes, that was actually virtually allocated.
+ * @param flags Any of the VIRTUAL_ALLOCATE flags.
  * 
  * @returns A pointer to the virtually allocated heap.
  */
 internal void*
-allocateHeap(uint32 num_threads, size_t pre_thread_size, size_t* final_size)
+allocateHeap(uint32 num_threads, size_t pre_thread_size, size_t* final_size, uint32 flags)
 {
 	void* v_heap_ptr = NULL;
 
@@ -116,7 +99,7 @@ allocateHeap(uint32 num_threads, size_t pre_thread_size, size_t* final_size)
 
 	size_t request_size = pre_thread_size * num_threads; // Preserve the request amount for debugging purposes.
 	size_t v_heap_size = request_size;
-	if (!virtual_allocate(&v_heap_ptr, &v_heap_size, offset))
+	if (!virtual_allocate_flags(&v_heap_ptr, &v_heap_size, offset, flags))
 	{
 		printf("Error: Unable to allocated the necessary amount of heap %zu to run.\n", v_heap_size);
 		exit(1);
@@ -129,261 +112,340 @@ allocateHeap(uint32 num_threads, size_t pre_thread_size, size_t* final_size)
 	return v_heap_ptr;
 }
 
-internal uint32
-getDirectiveType(char directive_character)
+/**
+ * Hashes the contents of a file in fixed-size chunks.
+ * 
+ * @param arena The memory arena to place the chunk buffer on.
+ * @param file_name The path to the file to hash.
+ * @param content_hash Set to the hash of the file's contents.
+ * 
+ * @returns True if the file could be read, false if not.
+ */
+internal bool
+hashSourceFile(mem_arena* arena, const char* file_name, uint64* content_hash)
 {
-	switch(directive_character)
-	{
-		case '#':
-			return (uint32)DIRECTIVE_HEADER;
-		case '!':
-			return (uint32)DIRECTIVE_COMMAND;
-		case '%':
-			return (uint32)DIRECTIVE_MAKEDIR;
-		case '+':
-			return (uint32)DIRECTIVE_MAKEFILE;
-		default:
-			return (uint32)DIRECTIVE_UNDEFINED;
-	}
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, file_name, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	size_t stash_point = arena_stash(arena);
+	void* chunk_buffer = arena_push(arena, WATCH_HASH_CHUNK_SIZE);
+
+	uint64 hash = HASH64_SEED;
+	size_t bytes_read = 0;
+	while ((bytes_read = platformReadFile(&fh, chunk_buffer, WATCH_HASH_CHUNK_SIZE)) > 0)
+		hash = hashMemory64(chunk_buffer, bytes_read, hash);
+
+	arena_restore(arena, stash_point);
+	platformCloseFile(&fh);
+
+	*content_hash = hash;
+	return true;
+
 }
 
-internal node_trunk*
-createSourceTree(mem_arena* arena, char* source)
+/**
+ * Records a script so that it can be re-run by watch mode.
+ * 
+ * @param arena The memory arena to place the record on.
+ * @param scripts The list of watched scripts to add to.
+ * @param file_name The path to the script.
+ * 
+ * @returns The record of the script.
+ */
+internal watched_script*
+addWatchedScript(mem_arena* arena, node_trunk* scripts, const char* file_name)
 {
-	// Generate a tree for each line in the source file.
-	node_trunk* sourceTree = createLinkedList(arena);
-
-	// Go through each line and then build the linked list.
-	int lineIndex = 0;
-	int offset = 0;
-	while (offset >= 0)
-	{
-		
-		// Create the line source structure.
-		line_source* currentLineSource = pushNodeStruct(arena, sourceTree, line_source);
-		
-		// Determine the length of the line, allocate a line buffer, then copy
-		// over the contents of the string from the text source.
-		size_t currentLineLength = strLineLength(source, offset);
-		char* lineBuffer = arena_push_array_zero(arena, char, currentLineLength + 1);
 
-		offset = strCopyLine(lineBuffer, currentLineLength + 1, source, offset);
+	watched_script* script = pushNodeStruct(arena, scripts, watched_script);
+	size_t path_size = strLength(file_name) + 1;
+	script->path = arena_push_array_zero(arena, char, path_size);
+	strCopy(script->path, path_size, file_name, path_size);
 
-		// Fill out the line source structure. We assume the directive is undefined
-		// until line processing begins.
-		currentLineSource->lineDirectiveType = DIRECTIVE_UNDEFINED;
-		currentLineSource->lineNumber = lineIndex++;
-		currentLineSource->stringPtr = lineBuffer;
-		currentLineSource->stringLength = currentLineLength;
+	// Split the path into the directory to watch and the entry name to expect.
+	size_t separator_location = path_size;
+	for (size_t c_index = 0; c_index + 1 < path_size; ++c_index)
+	{
+		if (file_name[c_index] == '/' || file_name[c_index] == '\\')
+			separator_location = c_index;
+	}
 
+	if (separator_location == path_size)
+	{
+		script->directory = ".";
+		script->name = script->path;
+	}
+	else
+	{
+		script->directory = arena_push_array_zero(arena, char, separator_location + 2);
+		strSubstring(script->directory, separator_location + 2, file_name, 0,
+			(separator_location == 0) ? 1 : separator_location);
+		script->name = script->path + separator_location + 1;
 	}
 
-	// Reverse the source file to be in the proper orientation.
-	reverseLinkedList(sourceTree);
+	script->pending = false;
+	script->exists = hashSourceFile(arena, script->path, &script->content_hash);
+	return script;
 
-	// Return the trunk.
-	return sourceTree;
 }
 
 /**
- * Processes a file, handling directives, and then performing
- * any actions that the directives require. An arena is required
- * for storing the file and should be sized appropriately.
+ * Records a directory that watch mode should watch, without watching it yet.
  * 
- * @param arena The memory arena to perform dynamic storage allocations with.
- * @param file_name The path to the file to process.
+ * @param arena The memory arena to place the record on.
+ * @param directories The list of watched directories to add to.
+ * @param directory_path The path to the directory.
+ * 
+ * @returns The record of the directory.
  */
-internal void
-processSourceFile(mem_arena* arena, const char* file_name)
+internal watched_directory*
+addWatchedDirectory(mem_arena* arena, node_trunk* directories, const char* directory_path)
 {
 
-	// Stash the current position of the arena offset pointer.
-	size_t stash_point = arena_stash(arena);
+	watched_directory* directory = pushNodeStruct(arena, directories, watched_directory);
+	size_t path_size = strLength(directory_path) + 1;
+	directory->path = arena_push_array_zero(arena, char, path_size);
+	strCopy(directory->path, path_size, directory_path, path_size);
+	directory->watched = false;
+	return directory;
 
-	// Get the text source and then split into a source line tree.
-	char* text_source = loadSource(arena, file_name);
-	node_trunk* sourceTree = createSourceTree(arena, text_source);
+}
 
-	// Determine each directive type. Once we know what each directive type is,
-	// we can then begin processing each directive based on each type.
-	node_branch* currentNode = sourceTree->next;
-	while (currentNode != NULL)
-	{
-		line_source* currentLine = (line_source*)currentNode->branch;
+/**
+ * Watches a directory, unless it's already being watched.
+ * 
+ * @param arena The memory arena to place a new record on.
+ * @param watch The filewatch to add the directory to.
+ * @param directories The list of watched directories.
+ * @param directory_path The path to the directory.
+ * @param watch_id Set to the identifier of the directory's watch.
+ * 
+ * @returns True if the directory is being watched, false if it couldn't be.
+ */
+internal bool
+watchDirectory(mem_arena* arena, filewatch* watch, node_trunk* directories, const char* directory_path,
+	uint32* watch_id)
+{
 
-		// In the event that the line is shorter than 3 characters, we skip.
-		if (currentLine->stringLength > 2)
+	watched_directory* directory = NULL;
+	for (node_branch* currentNode = directories->next; currentNode != NULL; currentNode = currentNode->next)
+	{
+		watched_directory* current_directory = (watched_directory*)currentNode->branch;
+		if (strEquals(current_directory->path, directory_path))
 		{
-			// Ensure the directive is at the start.
-			int token_location = strSearchToken("#!", currentLine->stringPtr, 0);
-			if (token_location == 0)
-			{
-				// The 3rd character determines the directive type.
-				currentLine->lineDirectiveType = getDirectiveType(currentLine->stringPtr[2]);
-			}
+			directory = current_directory;
+			break;
 		}
+	}
 
-		currentNode = currentNode->next;
+	if (directory == NULL)
+		directory = addWatchedDirectory(arena, directories, directory_path);
+	if (!directory->watched)
+	{
+		directory->watched = platformAddWatch(watch, directory->path, &directory->watch_id);
+		if (!directory->watched)
+			printf("Warning: Unable to watch %s for changes.\n", directory->path);
 	}
 
-	// Now that we have the directive types defined, we can begin processing each
-	// directive as we come across them.
-	currentNode = sourceTree->next;
-	while (currentNode != NULL)
+	*watch_id = directory->watch_id;
+	return directory->watched;
+
+}
+
+/**
+ * Determines if a changed entry is one that watch mode already knows to pass over,
+ * and records it if not so that the next change to it is passed over.
+ * 
+ * @returns True if the entry was passed over before.
+ */
+internal bool
+passOverEntry(mem_arena* arena, node_trunk* passed_entries, uint32 watch_id, const char* name)
+{
+
+	for (node_branch* currentNode = passed_entries->next; currentNode != NULL; currentNode = currentNode->next)
 	{
-		line_source* currentLine = (line_source*)currentNode->branch;
-		if (currentLine->lineDirectiveType != DIRECTIVE_NONE &&
-			currentLine->lineDirectiveType != DIRECTIVE_UNDEFINED)
-		{
+		passed_entry* entry = (passed_entry*)currentNode->branch;
+		if (entry->watch_id == watch_id && strEquals(entry->name, name))
+			return true;
+	}
 
-			// Set a stash point so we can freely allocate per directive.
-			size_t directive_stash_point = arena_stash(arena);
+	passed_entry* entry = pushNodeStruct(arena, passed_entries, passed_entry);
+	size_t name_size = strLength(name) + 1;
+	entry->name = arena_push_array_zero(arena, char, name_size);
+	strCopy(entry->name, name_size, name, name_size);
+	entry->watch_id = watch_id;
+	return false;
 
-			char* directive_buffer = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-			strSubstring(directive_buffer, currentLine->stringLength+1, currentLine->stringPtr, 3, -1);
+}
 
-			// Perform the required processes.
-			switch(currentLine->lineDirectiveType)
-			{
-				
-				case DIRECTIVE_MAKEDIR:
-				{
-					// We can now create the directory.
-					if (platformCreateDirectory(directive_buffer))
-					{
-						printf("Directory was created at %s.\n", directive_buffer);
-					}
-					else
-					{
-						printf("Directory couldn't be created at %s.\n", directive_buffer);
-					}
-					break;
-				}
-				case DIRECTIVE_MAKEFILE:
-				{
-					// The makefile procedure make be multiline, and therefore we need to
-					// account for that by scanning ahead for the contents should that be the case.
-					char* new_file_name = directive_buffer;
-					char* text_contents = NULL;
-
-					// Seperate the filename from the next.
-					size_t text_seperator_location = strSearchToken(":", directive_buffer, 0);
-					if (text_seperator_location != -1)
-					{
+/**
+ * Walks the roots again for the scripts and, with "-r", the directories that have
+ * appeared since the last walk. The walk filters them exactly as the first run's
+ * did. New scripts are marked pending, so they run with the rest of the burst.
+ * 
+ * @param arena The memory arena to place the new records on.
+ * @param watch The filewatch new directories are added to.
+ * @param targets Everything being watched.
+ */
+internal void
+rescanWatchRoots(mem_arena* arena, filewatch* watch, watch_targets* targets)
+{
 
-						// We need to pull the file name out.
-						new_file_name = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-						strSubstring(new_file_name, currentLine->stringLength+1, directive_buffer,
-							0, text_seperator_location);
+	directory_scan scan = {0};
+	if (!directoryScanCreate(&scan, targets->recursive, targets->extensions, platformGetProcessorCount()))
+		return;
 
-						// Now we need fetch the next contents.
-						text_contents = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-						strSubstring(text_contents, currentLine->stringLength+1, directive_buffer,
-							text_seperator_location+1, -1);
+	directoryScanKeepDirectories(&scan);
+	for (node_branch* currentNode = targets->roots->next; currentNode != NULL; currentNode = currentNode->next)
+		directoryScanPushDirectory(&scan, *(char**)currentNode->branch);
+	directoryScanStart(&scan);
 
-					}
+	char* path = NULL;
+	while (directoryScanNextFile(&scan, &path))
+	{
+		bool known = false;
+		for (node_branch* currentNode = targets->scripts->next; currentNode != NULL && !known;
+			currentNode = currentNode->next)
+		{
+			known = strEquals(((watched_script*)currentNode->branch)->path, path);
+		}
+		if (known)
+			continue;
+
+		// A new script runs once things settle, whatever it holds.
+		watched_script* script = addWatchedScript(arena, targets->scripts, path);
+		script->exists = false;
+		script->pending = true;
+		watchDirectory(arena, watch, targets->directories, script->directory, &script->watch_id);
+		printf("Watching new script %s.\n", script->path);
+	}
 
-					// In most cases, files are generated using the multiline operator. We need to ensure
-					// that we capture all the data properly.
-					node_trunk* text_trunk = createLinkedList(arena);
-					size_t multiline_location = strSearchToken("<<(", directive_buffer, 0);
-					if (multiline_location != -1)
-					{
+	uint32 watch_id = 0;
+	while (directoryScanNextDirectory(&scan, &path))
+		watchDirectory(arena, watch, targets->directories, path, &watch_id);
 
-						// Since the first line may contain the ending token, we should set the loop up to
-						// check for that. We can allocate a new string on the heap all string data which comes
-						// after the multiline operator.
-						char* working_line = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-						strSubstring(working_line, currentLine->stringLength+1, directive_buffer,
-							multiline_location+3, -1);
-
-						// We now need to go through each node in the loop and search for the multiline end operator.
-						while (currentNode != NULL)
-						{
-							size_t multiline_end_location = strSearchToken(")>>", working_line, 0);
-							size_t end_location = -1;
-							if (multiline_end_location != -1)
-								end_location = multiline_end_location;
-							
-							node_branch* current_branch = pushNode(arena, text_trunk, sizeof(char**));
-							char** current_text_ptr = (char**)current_branch->branch;
-							*current_text_ptr = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-							strSubstring(*current_text_ptr, currentLine->stringLength+1, working_line,
-								0, end_location);
-
-							// Exit the loop.
-							if (multiline_end_location != -1)
-								break;
-							else
-							{
-								currentNode = currentNode->next;
-								currentLine = (line_source*)currentNode->branch;
-								working_line = currentLine->stringPtr;
-							}
-						}
-					}
+	directoryScanDestroy(&scan);
 
-					// Even though there isn't a multiline operator used, we should use the linked-list
-					// to write to the file rather than utilizing if-statements to perform the same work.
-					else
-					{
-						if (text_contents != NULL)
-						{
-							node_branch* current_branch = pushNode(arena, text_trunk, sizeof(char**));
-							char** current_text_ptr = (char**)current_branch->branch;
-							*current_text_ptr = arena_push_array_zero(arena, char, currentLine->stringLength+1);
-							strSubstring(*current_text_ptr, currentLine->stringLength+1, directive_buffer,
-								text_seperator_location+1, -1);
-						}
-					}
+}
+
+/**
+ * Keeps the process alive and re-runs scripts as their contents change. Changes
+ * tend to arrive in bursts as an editor saves, so events are collected until the
+ * watched directories have been quiet for WATCH_DEBOUNCE_MILLISECONDS. Only the
+ * scripts whose contents hash differently from their last run are re-run.
+ * 
+ * An entry nothing knows about yet that appears within a watched directory walks
+ * the roots again, which picks up new scripts and, with "-r", new directories. An
+ * entry that walk passes over is remembered, so rewriting a generated file doesn't
+ * walk the roots each time. A changed ignore file forgets those entries, since it
+ * may now let them in. This never returns, the process is expected to be
+ * interrupted.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param context The context the scripts are processed with.
+ * @param targets Everything to watch.
+ */
+internal void
+watchSourceFiles(mem_arena* arena, sourcery_context* context, watch_targets* targets)
+{
 
-					// Since the text trunk will be backwards, we need to reverse it.
-					reverseLinkedList(text_trunk);
+	filewatch watch = {0};
+	void* event_buffer = arena_push(arena, WATCH_EVENT_BUFFER_SIZE);
+	if (!platformCreateWatch(&watch, event_buffer, WATCH_EVENT_BUFFER_SIZE))
+	{
+		printf("Error: Unable to watch for changes on this system.\n");
+		return;
+	}
 
-					// Process the linked list of all the strings that we need to write to file.
-					filehandle directivefh = {0};
-					if (platformOpenFile(&directivefh, new_file_name,
-						PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE))
-					{
-						node_branch* current_filetext_branch = text_trunk->next;
-						while (current_filetext_branch != NULL)
-						{
-							char* write_text_ptr = *((char**)current_filetext_branch->branch);
-							platformWriteFile(&directivefh, write_text_ptr, strLength(write_text_ptr));
-							platformWriteFile(&directivefh, "\n", 1);
-							current_filetext_branch = current_filetext_branch->next;
-						}
-						platformCloseFile(&directivefh);
-						printf("File %s was created.\n", new_file_name);
-					}
-					else
-					{
-						printf("Unable to create %s.\n", new_file_name);
-					}
+	// Every directory walked is watched, along with the directory of each script.
+	// Scripts sharing a directory share its watch.
+	uint32 watch_id = 0;
+	for (node_branch* currentNode = targets->directories->next; currentNode != NULL; currentNode = currentNode->next)
+		watchDirectory(arena, &watch, targets->directories, ((watched_directory*)currentNode->branch)->path, &watch_id);
+	for (node_branch* currentNode = targets->scripts->next; currentNode != NULL; currentNode = currentNode->next)
+	{
+		watched_script* script = (watched_script*)currentNode->branch;
+		watchDirectory(arena, &watch, targets->directories, script->directory, &script->watch_id);
+	}
 
-					break;
+	node_trunk* scripts = targets->scripts;
+	printf("Watching %zu script(s) for changes.\n", scripts->count);
+	fflush(stdout);
+
+	while (true)
+	{
+
+		// Collect a burst of changes, then wait for things to settle.
+		watchevent event = {0};
+		uint32 timeout_milliseconds = PLATFORM_WATCH_INFINITE;
+		bool rescan = false;
+		while (platformReadWatch(&watch, timeout_milliseconds, &event))
+		{
+			bool known = false;
+			for (node_branch* currentNode = scripts->next; currentNode != NULL; currentNode = currentNode->next)
+			{
+				watched_script* script = (watched_script*)currentNode->branch;
+				if (script->watch_id == event.watch_id &&
+					(event.name == NULL || strEquals(event.name, script->name)))
+				{
+					script->pending = true;
+					known = (event.name != NULL);
 				}
-				case DIRECTIVE_COMMAND:
+			}
+
+			if (!known && targets->roots->count != 0)
+			{
+				if (event.name != NULL && strEquals(event.name, DIRECTORY_SCAN_IGNORE_FILE))
 				{
-					printf("Executing '%s'.\n", directive_buffer);
-					platformRunCLIProcess(directive_buffer);
-					break;
+					targets->passed_entries->next = NULL;
+					targets->passed_entries->count = 0;
+					rescan = true;
 				}
-				default:
+				else if (event.name == NULL || !passOverEntry(arena, targets->passed_entries, event.watch_id, event.name))
 				{
-					printf("Unrecognized/unimplemented directive on line %4d\n%s\n", currentLine->lineNumber, currentLine->stringPtr);
-					break;
+					rescan = true;
 				}
 			}
+			timeout_milliseconds = WATCH_DEBOUNCE_MILLISECONDS;
+		}
+
+		if (rescan)
+			rescanWatchRoots(arena, &watch, targets);
 
-			// Restore the stash point back to where it should be.
-			arena_restore(arena, directive_stash_point);
+		for (node_branch* currentNode = scripts->next; currentNode != NULL; currentNode = currentNode->next)
+		{
+			watched_script* script = (watched_script*)currentNode->branch;
+			if (!script->pending)
+				continue;
+			script->pending = false;
+
+			// Writes that leave the bytes as they were aren't worth a re-run.
+			uint64 content_hash = 0;
+			if (!hashSourceFile(arena, script->path, &content_hash))
+			{
+				script->exists = false;
+				continue;
+			}
+			if (script->exists && content_hash == script->content_hash)
+				continue;
+
+			script->exists = true;
+			script->content_hash = content_hash;
+
+			// Anything may have happened to the directories since the last run.
+			sourceryInvalidate(context);
+
+			uint64 start_time = platformGetTimeNanoseconds();
+			sourceryProcessFile(context, script->path);
+			sourceryCommit(context);
+			uint64 elapsed_time = platformGetTimeNanoseconds() - start_time;
+
+			printf("Re-ran %s in %.3fms.\n", script->path, (real64)elapsed_time / (real64)NANOSECONDS_PER_MILLISECOND);
+			fflush(stdout);
 		}
-		currentNode = currentNode->next;
-	}
 
-	// Restore the arena back to its last position.
-	arena_restore(arena, stash_point);
+	}
 
 }
 
@@ -400,6 +462,114 @@ processSourceFile(mem_arena* arena, const char* file_name)
  * 			Any and all source files will, by default, not be modified. Therefore,
  * 			the flag "-u" is required to allow this behavior. Text files that are
  * 			set to "script mode" will not be modified regardless of this flag's presence.
+ * 			The sources a run strips can be put back with "sourcery --rollback".
+ * 
+ * 		sourcery [OPT:(-r)] [OPT:--ext=(extensions)] [directory(s)]
+ * 			Directories are walked by a pool of threads and every file found is
+ * 			processed as soon as it is discovered. The "--ext" parameter takes a
+ * 			comma-separated list of extensions, such as "--ext=c,h", and limits the
+ * 			walk to those files. Entries matching the patterns within a ".sourceryignore"
+ * 			file are skipped in that directory and every directory below it.
+ * 			Whichever way they're found, the next few scripts are read and indexed
+ * 			on separate threads while the current one is processed.
+ * 
+ * 		sourcery [OPT:--watch] [file(s) or directory(s)]
+ * 			After the initial run, the process stays alive and re-runs each script
+ * 			whose contents change. Bursts of changes are debounced and scripts whose
+ * 			bytes didn't actually change are skipped. New scripts within the provided
+ * 			directories are picked up as they appear, along with new subdirectories
+ * 			when "-r" is provided.
+ * 
+ * 		sourcery [OPT:--stream] [OPT:--stdin] [file(s)]
+ * 			Streams each script in fixed-size chunks rather than loading it whole,
+ * 			executing directives as soon as their lines are read. Memory use is bound
+ * 			to the chunk size plus the longest line, so scripts of any size can be run.
+ * 			The "--stdin" parameter streams a script from standard input after all
+ * 			of the provided files are processed.
+ * 
+ * 		sourcery [OPT:--batch-commands] [file(s) or directory(s)]
+ * 			Runs the command directives of each script through a single shell that
+ * 			lives as long as the script, rather than spawning a shell per command.
+ * 			Commands share the shell's state, so a "cd" carries over to the script's
+ * 			later commands. Platforms without a shell fall back to a process per
+ * 			command.
+ * 
+ * 		sourcery [OPT:--quiet] [OPT:--verbose] [file(s) or directory(s)]
+ * 			Output is written by a separate thread and ordered by script. The
+ * 			"--quiet" parameter only prints errors and a summary of the run, the
+ * 			"--verbose" parameter also prints each script as it's processed.
+ * 
+ * 		sourcery [OPT:--no-cache] [file(s) or directory(s)]
+ * 			Command directives may declare their inputs, outputs and the environment
+ * 			variables they depend on, such as "#!! {in: a.json} {out: a.h} gen a.json".
+ * 			Their outputs are stored under ".sourcery/cache" and are restored instead
+ * 			of re-running the command while its inputs are unchanged. The "--no-cache"
+ * 			parameter runs every command regardless.
+ * 
+ * 		sourcery [OPT:--durability=(none|run|file)] [file(s) or directory(s)]
+ * 			Decides how durably generated files and the cache reach the disk. "none"
+ * 			leaves them for the system to flush. "run" writes them to temporary names,
+ * 			flushes each filesystem once before every command and at the end of the
+ * 			run, then renames them into place. "file" flushes and renames each file as
+ * 			it's written. Either of the last two leaves every file whole after a crash.
+ * 
+ * 		sourcery [OPT:--huge-pages] [file(s) or directory(s)]
+ * 			Backs the application heap with huge pages, which cuts the page faults
+ * 			and TLB misses of large scripts. Explicit huge pages are used when the
+ * 			system has reserved them, transparent huge pages otherwise.
+ * 
+ * 		sourcery [OPT:--tar=(file)] [file(s) or directory(s)]
+ * 			Writes the directories and files that the scripts generate into a tar
+ * 			archive rather than creating them, in one sequential write. An archive
+ * 			file of "-" writes the archive to standard output, in which case logs
+ * 			and command output go to standard error. Can't be used in watch mode.
+ * 
+ * 		sourcery [OPT:--trace=(file)] [file(s) or directory(s)]
+ * 			Records how long each phase of the run takes, on every thread, and writes
+ * 			the zones to the file in the Chrome trace event format. Tracing is only
+ * 			compiled into PERFDEBUG builds.
+ * 
+ * 		sourcery [OPT:--mem-stats] [file(s) or directory(s)]
+ * 			Accounts for every allocation made on the application arena and prints
+ * 			the arena's high-water mark, operation counts and the bytes pushed by each
+ * 			phase and directive type once the run finishes. The script pipeline's
+ * 			slots, which load and index the scripts read ahead, are totalled after it.
+ * 
+ * 		sourcery [OPT:--pipeline-stats] [file(s) or directory(s)]
+ * 			Prints how deep each queue between the reading, indexing and processing
+ * 			of scripts ran and how long each stage waited on its neighbours once the
+ * 			run finishes, which shows the stage that holds the rest back.
+ * 
+ * 		sourcery [OPT:--perf-counters] [file(s) or directory(s)]
+ * 			Reads the hardware performance counters around each phase of the run, on
+ * 			every thread, and prints the cycles, instructions, cache misses, branch
+ * 			misses and page faults of each phase once the run finishes. Counters are
+ * 			only compiled into PERFDEBUG builds and are only available on Linux.
+ * 
+ * 		sourcery [OPT:--command-report(=file)] [file(s) or directory(s)]
+ * 			Records the exit status, wall time, CPU time, peak memory and block I/O
+ * 			of every command directive, and prints the totals and the slowest commands
+ * 			once the run finishes. If a file is provided, every recorded command is
+ * 			also written to it as JSON.
+ * 
+ * 		sourcery --daemon [OPT:--socket=(path)]
+ * 			Stays resident and runs the requests sent to it by clients, so that each
+ * 			request skips the start-up of a fresh process. Requests run within the
+ * 			client's working directory and write to the client's terminal. The socket
+ * 			defaults to "sourcery.sock" within $XDG_RUNTIME_DIR, or otherwise within a
+ * 			directory of the user's own in the temporary directory. Only clients of
+ * 			the same user are accepted.
+ * 
+ * 		sourcery --client [OPT:--socket=(path)] [OPT:(-r)] [file(s) or directory(s)]
+ * 			Forwards the rest of the command-line to a running daemon and exits with
+ * 			its status. If no daemon is running, the request is run in-process instead.
+ * 			Watch mode can't be used through the daemon.
+ * 
+ * 		sourcery --rollback
+ * 			Restores the files saved by the latest run that modified its sources.
+ * 			Each file's contents are stored once under ".sourcery/rollback" in the
+ * 			calling directory, however many snapshots hold them, and repeated
+ * 			rollbacks step back through earlier runs.
  * 
  * TBI CLI Features:
  * 		sourcery [OPT:--config (config_file)] [OPT:(-r)(-u)] [file(s) or directory(s)]
@@ -413,13 +583,6 @@ processSourceFile(mem_arena* arena, const char* file_name)
  * 			configs honor the order they passed in, which means file_a, file_b,
  * 			and file_c are 4, 5, and 6 in the load chain.
  * 
- * 		sourcery --rollback
- * 			In the event that a macro doesn't go as planned, Sourcery will store
- * 			copies of the project prior to the last usage of "sourcery -u". Rollbacks
- * 			are stored in a private directory in the root calling directory. This
- * 			directory is called ".sourcery" which contains the meta files necessary
- * 			to perform the rollbacks.
- * 
  */
 
 /**
@@ -447,6 +610,8 @@ bool
 validateParsedCLI(mem_arena* arena, cliargs* arguments)
 {
 
+	(void)arena;
+
 	node_branch* currentBranch = arguments->argumentTree->next;
 	while (currentBranch != NULL)
 	{
@@ -454,7 +619,7 @@ validateParsedCLI(mem_arena* arena, cliargs* arguments)
 		if (argument->argumentType == ARGTYPE_TOKEN)
 		{
 			char* argumentString = (char*)argument->argumentPtr;
-			printf("TOKEN : Index %d: %s\n", argument->argumentIndex, argumentString);
+			logInfo("TOKEN : Index %d: %s\n", argument->argumentIndex, argumentString);
 		}
 		else if (argument->argumentType == ARGTYPE_FLAG)
 		{
@@ -462,29 +627,29 @@ validateParsedCLI(mem_arena* arena, cliargs* arguments)
 			bool flags[52];
 			setCLIFlagsArray(flags, (uint64*)argument->argumentPtr);
 
-			printf("FLAGS : Index %d: -", argument->argumentIndex);
-
-			// Lowers first.
+			// Lowers first, then uppers.
+			char flag_letters[53];
+			size_t flag_count = 0;
 			for (size_t flagIndex = 0; flagIndex < 26; ++flagIndex)
 			{
 				if (flags[flagIndex] == true)
-					printf("%c", (int)('a' + flagIndex));
+					flag_letters[flag_count++] = (char)('a' + flagIndex);
 			}
 
-			// Uppers next.
 			for (size_t flagIndex = 26; flagIndex < 52; ++flagIndex)
 			{
 				if (flags[flagIndex] == true)
-					printf("%c", (int)('A' + (flagIndex - 26)));
+					flag_letters[flag_count++] = (char)('A' + (flagIndex - 26));
 			}
+			flag_letters[flag_count] = '\0';
 
-			printf("\n");
+			logInfo("FLAGS : Index %d: -%s\n", argument->argumentIndex, flag_letters);
 
 		}
 		else // Parameters.
 		{
 			char* argumentString = (char*)argument->argumentPtr;
-			printf("PARAM : Index %d: %s\n", argument->argumentIndex, argumentString);
+			logInfo("PARAM : Index %d: %s\n", argument->argumentIndex, argumentString);
 		}
 
 		currentBranch = currentBranch->next;
@@ -493,6 +658,88 @@ validateParsedCLI(mem_arena* arena, cliargs* arguments)
 	return true;
 }
 
+/**
+ * Searches the parsed CLI arguments for a parameter.
+ * 
+ * @param arguments The cliargs structure to search.
+ * @param parameter The name of the parameter, without the leading "--".
+ * 
+ * @returns The argument if it was found, NULL if not.
+ */
+argument_properties*
+findCLIParameter(cliargs* arguments, const char* parameter)
+{
+	node_branch* currentBranch = arguments->argumentTree->next;
+	while (currentBranch != NULL)
+	{
+		argument_properties* argument = (argument_properties*)currentBranch->branch;
+		if (argument->argumentType == ARGTYPE_PARAMETER &&
+			strEquals((char*)argument->argumentPtr, parameter))
+			return argument;
+		currentBranch = currentBranch->next;
+	}
+	return NULL;
+}
+
+/**
+ * Searches the parsed CLI arguments for a parameter that carries a value in the
+ * form "--name=value".
+ * 
+ * @param arguments The cliargs structure to search.
+ * @param parameter The name of the parameter, without the leading "--".
+ * 
+ * @returns The value following the '=' if the parameter was found, NULL if not.
+ */
+char*
+findCLIParameterValue(cliargs* arguments, const char* parameter)
+{
+	size_t parameterLength = strLength(parameter);
+	node_branch* currentBranch = arguments->argumentTree->next;
+	while (currentBranch != NULL)
+	{
+		argument_properties* argument = (argument_properties*)currentBranch->branch;
+		char* argumentString = (char*)argument->argumentPtr;
+		if (argument->argumentType == ARGTYPE_PARAMETER &&
+			strLength(argumentString) > parameterLength && argumentString[parameterLength] == '=')
+		{
+			size_t characterIndex = 0;
+			while (characterIndex < parameterLength && argumentString[characterIndex] == parameter[characterIndex])
+				characterIndex++;
+			if (characterIndex == parameterLength)
+				return argumentString + parameterLength + 1;
+		}
+		currentBranch = currentBranch->next;
+	}
+	return NULL;
+}
+
+/**
+ * Determines if a flag was set in any of the flag groups passed on the CLI.
+ * 
+ * @param arguments The cliargs structure to search.
+ * @param flag The alpha character of the flag.
+ * 
+ * @returns True if the flag was set, false if not.
+ */
+bool
+findCLIFlag(cliargs* arguments, char flag)
+{
+	if (!charIsAlpha(flag))
+		return false;
+
+	uint8 alphaPosition = charIsLower(flag) ? charLowerAlphaOffset(flag) : charUpperAlphaOffset(flag) + 26;
+	node_branch* currentBranch = arguments->argumentTree->next;
+	while (currentBranch != NULL)
+	{
+		argument_properties* argument = (argument_properties*)currentBranch->branch;
+		if (argument->argumentType == ARGTYPE_FLAG &&
+			((*(uint64*)argument->argumentPtr >> alphaPosition) & 0x1))
+			return true;
+		currentBranch = currentBranch->next;
+	}
+	return false;
+}
+
 /**
  * Parses the command line interface.
  * 
@@ -519,7 +766,7 @@ parseCLI(mem_arena* arena, cliargs* arguments, int argc, char** argv, parseproc
 	
 	// Create the argument list.
 	uint32_t currentArgumentIndex = 0;
-	for (size_t index = 1; index < argc; ++index)
+	for (size_t index = 1; index < (size_t)argc; ++index)
 	{
 
 		// Determine the size of the string.
@@ -562,7 +809,7 @@ parseCLI(mem_arena* arena, cliargs* arguments, int argc, char** argv, parseproc
 			// Determine how many flags we need to compile.
 			size_t flagCount = 1;
 			size_t startingIndex = index;
-			while (index+1 < argc)
+			while (index+1 < (size_t)argc)
 			{
 				// Look ahead.
 				if (strLength(argv[index]) > 1 &&
@@ -614,7 +861,7 @@ parseCLI(mem_arena* arena, cliargs* arguments, int argc, char** argv, parseproc
 			
 			// Create and store the string.
 			char* argStringPtr = arena_push_array_zero(arena, char, argumentStringLength+1);
-			strSubstring(argStringPtr, argumentStringLength+1, argv[index], 2, -1);
+			strSubstring(argStringPtr, argumentStringLength+1, argv[index], 2, STR_END);
 			currentArgprops->argumentPtr = argStringPtr;
 			currentArgprops->argumentSize = sizeof(char) * strLength(argStringPtr)+1;
 
@@ -631,40 +878,753 @@ parseCLI(mem_arena* arena, cliargs* arguments, int argc, char** argv, parseproc
 
 }
 
-int
-main(int argc, char** argv)
+/**
+ * Finds the value of a "--name=value" argument without needing the arguments to
+ * have been parsed, for the options that matter before parsing happens.
+ * 
+ * @param argc The number of arguments.
+ * @param argv The arguments, beginning with the invocation name.
+ * @param prefix The argument's prefix, including the "=".
+ * 
+ * @returns The value of the last matching argument, or NULL if there isn't one.
+ */
+internal const char*
+findArgumentValue(int argc, char** argv, const char* prefix)
+{
+	const char* value = NULL;
+	for (int argument_index = 1; argument_index < argc; ++argument_index)
+	{
+		size_t location = 0;
+		if (strSearchToken(prefix, argv[argument_index], 0, &location) && location == 0)
+			value = argv[argument_index] + strLength(prefix);
+	}
+	return value;
+}
+
+/**
+ * Prints the memory accounting gathered for an arena, or a set of arenas of the
+ * same size, over a run.
+ * 
+ * @param title The heading of the report.
+ * @param arena_size The size of the arena, or of each arena in the set.
+ * @param stats The gathered stats.
+ */
+internal void
+printMemoryStats(const char* title, size_t arena_size, mem_arena_stats* stats)
 {
 
-	// Determine if there are file(s) to open. Multiple files may be provided.
-	/*if (argc < 2)
+	real64 megabyte = (real64)MEGABYTES(1);
+	printf("%s:\n", title);
+	printf("\tArena size:    %10.3fMB\n", (real64)arena_size / megabyte);
+	printf("\tPeak offset:   %10.3fMB (%.2f%% of the arena)\n", (real64)stats->peak_offset / megabyte,
+		(real64)stats->peak_offset / (real64)arena_size * 100.0);
+	printf("\tPushes:        %10llu (%.3fMB pushed, %.3fMB zeroed)\n", (unsigned long long)stats->push_count,
+		(real64)stats->bytes_pushed / megabyte, (real64)stats->bytes_zeroed / megabyte);
+	printf("\tPops:          %10llu\n", (unsigned long long)stats->pop_count);
+	printf("\tRestores:      %10llu\n", (unsigned long long)stats->restore_count);
+	printf("\tClears:        %10llu\n", (unsigned long long)stats->clear_count);
+
+	printf("\t%-24s %10s %14s %14s\n", "Tag", "Pushes", "Pushed (KB)", "Zeroed (KB)");
+	for (uint32 tag_index = 0; tag_index < stats->tag_count; ++tag_index)
 	{
-		printf("Error: Supply the file-name(s) to process.\n");
-		exit(1);
-	}*/
+		mem_arena_tag_stats* tag = &stats->tags[tag_index];
+		if (tag->push_count == 0)
+			continue;
 
-	// Initialize the application memory space we will need to run the application.
-	// Since this is currently a single-threaded application, we will reserve 64MB
-	// for the main thread. Text files aren't very large, so this should suffice.
-	size_t virtual_heap_size = 0;
-	void* virtual_heap_ptr = allocateHeap(1, MEGABYTES(64), &virtual_heap_size);
-	mem_arena application_memory_heap = {0};
-	arena_allocate(virtual_heap_ptr, virtual_heap_size, &application_memory_heap);
+		printf("\t%-24s %10llu %14.2f %14.2f\n", tag->name, (unsigned long long)tag->push_count,
+			(real64)tag->bytes_pushed / (real64)KILOBYTES(1), (real64)tag->bytes_zeroed / (real64)KILOBYTES(1));
+	}
+
+}
+
+/**
+ * Prints how each queue of the script pipeline ran. A queue that waits on being
+ * full is held back by the stage after it, one that waits on being empty by the
+ * stage before it.
+ * 
+ * @param stats The stats of the pipeline.
+ */
+internal void
+printPipelineStats(script_pipeline_stats* stats)
+{
+
+	const char* queue_names[3] = { "read -> index", "index -> execute", "execute -> read" };
+	spsc_queue_stats* queues[3] = { &stats->read_queue, &stats->ready_queue, &stats->free_queue };
+	real64 millisecond = 1000000.0;
+
+	printf("Pipeline Stats:\n");
+	printf("\tScripts loaded:  %10llu\n", (unsigned long long)stats->scripts_loaded);
+	printf("\tScripts indexed: %10llu\n", (unsigned long long)stats->scripts_indexed);
+	printf("\tScripts reread:  %10llu\n", (unsigned long long)stats->scripts_reread);
+
+	printf("\t%-18s %10s %11s %11s %11s %15s %11s %15s\n", "Queue", "Scripts", "Mean depth", "Peak depth",
+		"Full waits", "Full wait (ms)", "Empty waits", "Empty wait (ms)");
+	for (uint32 queue_index = 0; queue_index < 3; ++queue_index)
+	{
+		spsc_queue_stats* queue = queues[queue_index];
+		real64 mean_depth = (queue->push_count != 0) ? (real64)queue->depth_total / (real64)queue->push_count : 0.0;
+		printf("\t%-18s %10llu %11.2f %11llu %11llu %15.3f %11llu %15.3f\n", queue_names[queue_index],
+			(unsigned long long)queue->push_count, mean_depth, (unsigned long long)queue->depth_peak,
+			(unsigned long long)queue->full_waits, (real64)queue->full_wait_time / millisecond,
+			(unsigned long long)queue->empty_waits, (real64)queue->empty_wait_time / millisecond);
+	}
+
+}
+
+/**
+ * Begins the reports requested on the command-line. Reports have to begin before
+ * the arguments are parsed for parsing to be covered, so they're found without
+ * the parsed arguments.
+ * 
+ * @param arena The memory arena of the run.
+ * @param argc The number of arguments.
+ * @param argv The arguments, beginning with the invocation name.
+ * @param reports The reports to fill out.
+ */
+internal void
+beginRun(mem_arena* arena, int argc, char** argv, run_reports* reports)
+{
+
+	// Quiet runs only log errors and the summary, verbose runs log every script.
+	reports->verbosity = LOG_LEVEL_INFO;
+	if (findArgumentValue(argc, argv, "--quiet") != NULL)
+		reports->verbosity = LOG_LEVEL_ERROR;
+	else if (findArgumentValue(argc, argv, "--verbose") != NULL)
+		reports->verbosity = LOG_LEVEL_DEBUG;
+	logBegin(arena, reports->verbosity);
+
+	reports->trace_path = findArgumentValue(argc, argv, "--trace=");
+#if defined(SOURCERY_TRACE)
+	if (reports->trace_path != NULL)
+	{
+		traceBegin(arena);
+		TRACE_NAME_THREAD("main");
+	}
+#else
+	if (reports->trace_path != NULL)
+		printf("Warning: Tracing isn't compiled into this build, use the PERFDEBUG build type.\n");
+#endif
+
+	// The counters only count zones begun after they're opened.
+	reports->perf_counters = (findArgumentValue(argc, argv, "--perf-counters") != NULL);
+#if defined(SOURCERY_PERF_COUNTERS)
+	if (reports->perf_counters)
+	{
+		reports->perf_counters = perfZonesBegin(arena);
+		TRACE_NAME_THREAD("main");
+	}
+#else
+	if (reports->perf_counters)
+		printf("Warning: Performance counters aren't compiled into this build, use the PERFDEBUG build type.\n");
+	reports->perf_counters = false;
+#endif
+
+	// The command report takes an optional "=file" to write its JSON to.
+	const char* command_report = findArgumentValue(argc, argv, "--command-report");
+	reports->command_report = (command_report != NULL);
+	if (command_report != NULL && command_report[0] == '=' && command_report[1] != '\0')
+		reports->command_report_path = command_report + 1;
+	if (reports->command_report)
+		commandReportBegin(arena);
+
+	reports->memory_report = (findArgumentValue(argc, argv, "--mem-stats") != NULL);
+	if (reports->memory_report)
+		arena_stats_attach(arena, &reports->memory_stats);
+
+	reports->pipeline_report = (findArgumentValue(argc, argv, "--pipeline-stats") != NULL);
+
+}
+
+/**
+ * Finishes the reports that were requested for a run. The log is written out and
+ * the summary printed, tracing stops and the trace is written out, the counters
+ * are closed and printed, the command report is printed and written out, the
+ * memory accounting is printed and detached, and the pipeline stats are printed.
+ * 
+ * @param arena The memory arena of the run.
+ * @param reports The reports begun by beginRun().
+ */
+internal void
+finishRun(mem_arena* arena, run_reports* reports)
+{
+
+	// The reports are printed directly, after everything that was logged.
+	logEnd();
+	if (reports->verbosity != LOG_LEVEL_INFO)
+	{
+		run_summary* summary = &reports->summary;
+		printf("Processed %llu script(s): %llu file(s) and %llu directory(s) created, %llu command(s) run, "
+			"%llu restored from the cache, %llu stripped, %llu failure(s).\n", (unsigned long long)summary->scripts,
+			(unsigned long long)summary->files_created, (unsigned long long)summary->directories_created,
+			(unsigned long long)summary->commands_run, (unsigned long long)summary->commands_restored,
+			(unsigned long long)summary->sources_stripped, (unsigned long long)summary->failures);
+	}
 
+#if defined(SOURCERY_PERF_COUNTERS)
+	if (reports->perf_counters)
+	{
+		perfZonesEnd();
+		perfZonesPrintReport();
+	}
+#endif
+
+	if (reports->command_report)
+	{
+		commandReportEnd();
+		commandReportPrint();
+		if (reports->command_report_path != NULL)
+		{
+			if (commandReportWriteJSON(arena, reports->command_report_path))
+				printf("Command report was written to %s.\n", reports->command_report_path);
+			else
+				printf("Error: Unable to write the command report to %s.\n", reports->command_report_path);
+		}
+	}
+
+	if (reports->memory_report)
+	{
+		arena_stats_detach(arena);
+		printMemoryStats("Memory Stats", arena->size, &reports->memory_stats);
+
+		// Scripts loaded ahead by the pipeline are loaded and indexed on its slots.
+		if (reports->pipeline_stats.memory_tracked)
+		{
+			printMemoryStats("Script Slot Memory Stats", SCRIPT_PIPELINE_SLOT_SIZE,
+				&reports->pipeline_stats.memory);
+		}
+	}
+
+	if (reports->pipeline_report)
+		printPipelineStats(&reports->pipeline_stats);
+
+#if defined(SOURCERY_TRACE)
+	if (reports->trace_path != NULL)
+	{
+		traceEnd();
+		if (traceWriteChrome(arena, reports->trace_path))
+			printf("Trace was written to %s.\n", reports->trace_path);
+		else
+			printf("Error: Unable to write the trace to %s.\n", reports->trace_path);
+	}
+#endif
+
+}
+
+/**
+ * Runs Sourcery over a set of command-line arguments. Everything placed on the
+ * arena during the run is released before returning, so a long-lived process can
+ * run any number of times without growing.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param argc The number of arguments.
+ * @param argv The arguments, beginning with the invocation name.
+ * @param allow_watch If false, watch mode is refused since the run must return.
+ * 
+ * @returns The exit status of the run, which is non-zero if anything in it failed,
+ * a command that failed or exited with a non-zero status included.
+ */
+internal int
+runSourcery(mem_arena* arena, int argc, char** argv, bool allow_watch)
+{
+
+	size_t stash_point = arena_stash(arena);
+
+	run_reports reports = {0};
+	beginRun(arena, argc, argv, &reports);
+
+	// Scripts are processed on the application arena. Generated directories and files
+	// are created in place unless they're archived. An archive written to standard
+	// output takes it before anything else is printed.
+	sourcery_context context = {0};
+	sourceryCreate(&context, arena);
+	context.options.summary = &reports.summary;
+	const char* archive_path = findArgumentValue(argc, argv, "--tar=");
+	if (archive_path != NULL)
+	{
+		logFlush();
+		if (!sourcerySetArchive(&context, archive_path))
+		{
+			logError("Error: Unable to open the archive %s.\n", archive_path);
+			finishRun(arena, &reports);
+			sourceryDestroy(&context);
+			arena_restore(arena, stash_point);
+			return -1;
+		}
+	}
+
+	TRACE_ZONE_BEGIN("parseCLI");
+	uint32 previous_tag = arena_stats_tag(arena, "parseCLI");
 	cliargs cli_arguments = {0};
-	if (!parseCLI(&application_memory_heap, &cli_arguments, argc, argv, &validateParsedCLI))
+	bool arguments_valid = parseCLI(arena, &cli_arguments, argc, argv, &validateParsedCLI);
+	arena_stats_untag(arena, previous_tag);
+	TRACE_ZONE_END();
+	if (!arguments_valid)
 	{
-		printf("Arguments are incorrect.\n");
+		logError("Arguments are incorrect.\n");
+		finishRun(arena, &reports);
+		sourceryDestroy(&context);
+		arena_restore(arena, stash_point);
 		return -1;
 	}
 	else
 	{
-		printf("Arguments are correct.\n");
+		logInfo("Arguments are correct.\n");
+	}
+
+	bool watch_mode = (findCLIParameter(&cli_arguments, "watch") != NULL);
+	if (watch_mode && !allow_watch)
+	{
+		logError("Error: Watch mode can't be used through the daemon.\n");
+		finishRun(arena, &reports);
+		sourceryDestroy(&context);
+		arena_restore(arena, stash_point);
+		return -1;
+	}
+	else if (watch_mode && archive_path != NULL)
+	{
+		// The archive ends with the initial run, so there's nothing to re-run into.
+		logError("Error: An archive can't be written in watch mode.\n");
+		finishRun(arena, &reports);
+		sourceryDestroy(&context);
+		arena_restore(arena, stash_point);
+		return -1;
+	}
+
+	// Files are left for the system to flush unless a run or every file is asked
+	// to reach the disk before it replaces what was there.
+	const char* durability = findCLIParameterValue(&cli_arguments, "durability");
+	if (durability != NULL)
+	{
+		if (strEquals(durability, "none"))
+			sourcerySetDurability(&context, FILE_COMMIT_NONE);
+		else if (strEquals(durability, "run"))
+			sourcerySetDurability(&context, FILE_COMMIT_RUN);
+		else if (strEquals(durability, "file"))
+			sourcerySetDurability(&context, FILE_COMMIT_FILE);
+		else
+		{
+			logError("Error: Unknown durability %s, expected none, run or file.\n", durability);
+			finishRun(arena, &reports);
+			sourceryDestroy(&context);
+			arena_restore(arena, stash_point);
+			return -1;
+		}
+	}
+
+	// A rollback restores the files saved by the latest run that modified sources,
+	// rather than running any scripts.
+	if (findCLIParameter(&cli_arguments, "rollback") != NULL)
+	{
+		uint32 files_restored = 0;
+		uint32 rollback_status = sourceryRollback(&context, &files_restored);
+		bool committed = sourceryCommit(&context);
+		if (rollback_status == ROLLBACK_RESTORE_NOTHING)
+			logInfo("There's nothing to roll back.\n");
+		else if (rollback_status == ROLLBACK_RESTORE_COMPLETE && committed)
+			logInfo("Rolled back %u file(s).\n", files_restored);
+		else
+			logError("Error: Only %u file(s) could be rolled back.\n", files_restored);
+
+		finishRun(arena, &reports);
+		sourceryDestroy(&context);
+		arena_restore(arena, stash_point);
+		return (rollback_status == ROLLBACK_RESTORE_FAILED || !committed) ? 1 : 0;
+	}
+
+	// Files are queued as-is, directories are walked in the background and their
+	// files are processed as the walk discovers them.
+	uint32 scan_thread_count = platformGetProcessorCount();
+	directory_scan script_scan = {0};
+	if (!directoryScanCreate(&script_scan, findCLIFlag(&cli_arguments, 'r'),
+		findCLIParameterValue(&cli_arguments, "ext"), scan_thread_count))
+	{
+		logError("Error: Unable to allocate the memory needed to scan directories.\n");
+		finishRun(arena, &reports);
+		sourceryDestroy(&context);
+		arena_restore(arena, stash_point);
+		return -1;
+	}
+
+	node_branch* currentBranch = cli_arguments.argumentTree->next;
+	while (currentBranch != NULL)
+	{
+		argument_properties* argument = (argument_properties*)currentBranch->branch;
+		if (argument->argumentType == ARGTYPE_TOKEN)
+		{
+			char* argumentString = (char*)argument->argumentPtr;
+			if (platformGetPathType(argumentString) == PLATFORM_PATHTYPE_DIRECTORY)
+				directoryScanPushDirectory(&script_scan, argumentString);
+			else
+				directoryScanPushFile(&script_scan, argumentString);
+		}
+		currentBranch = currentBranch->next;
+	}
+
+	// Process each of the files provided. Streaming trades the in-memory source
+	// tree for bounded memory use. Batching runs each script's commands through a
+	// single shell. Commands that declare their outputs are cached unless the cache
+	// is bypassed. A file that can't be opened ends the run.
+	run_options* options = &context.options;
+	options->stream_mode = (findCLIParameter(&cli_arguments, "stream") != NULL);
+	options->batch_commands = (findCLIParameter(&cli_arguments, "batch-commands") != NULL);
+	options->command_cache = (findCLIParameter(&cli_arguments, "no-cache") == NULL);
+	options->strip_directives = findCLIFlag(&cli_arguments, 'u');
+
+	// Watch mode keeps every directory the walk enters, so scripts that appear in
+	// them later are noticed.
+	watch_targets targets = {0};
+	if (watch_mode)
+	{
+		targets.scripts = createLinkedList(arena);
+		targets.directories = createLinkedList(arena);
+		targets.roots = createLinkedList(arena);
+		targets.passed_entries = createLinkedList(arena);
+		targets.recursive = findCLIFlag(&cli_arguments, 'r');
+		targets.extensions = findCLIParameterValue(&cli_arguments, "ext");
+		directoryScanKeepDirectories(&script_scan);
+
+		for (currentBranch = cli_arguments.argumentTree->next; currentBranch != NULL; currentBranch = currentBranch->next)
+		{
+			argument_properties* argument = (argument_properties*)currentBranch->branch;
+			if (argument->argumentType != ARGTYPE_TOKEN ||
+				platformGetPathType((char*)argument->argumentPtr) != PLATFORM_PATHTYPE_DIRECTORY)
+				continue;
+			char** root = pushNodeStruct(arena, targets.roots, char*);
+			*root = (char*)argument->argumentPtr;
+		}
+	}
+
+	// The scripts after the current one are read and indexed by the pipeline while
+	// it's processed. Streamed scripts are never held whole, so they're only hinted
+	// to the system's cache.
+	script_pipeline pipeline = {0};
+	bool pipelined = scriptPipelineCreate(&pipeline, &script_scan, !options->stream_mode);
+	if (pipelined && reports.memory_report)
+		scriptPipelineTrackMemory(&pipeline);
+	directoryScanStart(&script_scan);
+	if (pipelined)
+		scriptPipelineStart(&pipeline);
+
+	int exit_status = 0;
+	while (true)
+	{
+
+		char* script_path = NULL;
+		script_slot* slot = NULL;
+		if (pipelined ? !scriptPipelineNext(&pipeline, &slot) : !directoryScanNextFile(&script_scan, &script_path))
+			break;
+		if (slot != NULL)
+			script_path = slot->path;
+
+		TRACE_ZONE_BEGIN("processSourceFile");
+		bool processed = (slot != NULL && slot->loaded) ?
+			sourceryProcessLoadedFile(&context, script_path, &slot->fh, slot->text, slot->text_size,
+				slot->indexed ? &slot->index : NULL) :
+			sourceryProcessFile(&context, script_path);
+		TRACE_ZONE_END();
+		if (slot != NULL)
+			scriptPipelineRelease(&pipeline, slot);
+		if (!processed)
+		{
+			exit_status = 1;
+			break;
+		}
+
+		if (watch_mode)
+			addWatchedScript(arena, targets.scripts, script_path);
+	}
+
+	if (pipelined)
+	{
+		scriptPipelineDestroy(&pipeline);
+		reports.pipeline_stats = pipeline.stats;
+	}
+
+	// The walk is complete once every file has been taken.
+	char* directory_path = NULL;
+	while (watch_mode && exit_status == 0 && directoryScanNextDirectory(&script_scan, &directory_path))
+		addWatchedDirectory(arena, targets.directories, directory_path);
+	directoryScanDestroy(&script_scan);
+
+	// Standard input can only ever be streamed.
+	if (exit_status == 0 && findCLIParameter(&cli_arguments, "stdin") != NULL)
+	{
+		filehandle stdin_fh = {0};
+		if (platformOpenStandardInput(&stdin_fh))
+		{
+			TRACE_ZONE_BEGIN("processSourceStream");
+			sourceryProcessStream(&context, &stdin_fh, "stdin");
+			TRACE_ZONE_END();
+			platformCloseFile(&stdin_fh);
+		}
+		else
+		{
+			logError("Error: Unable to open standard input for reading.\n");
+			exit_status = -1;
+		}
+	}
+
+	// Whatever the scripts left pending is committed as the run's last group.
+	if (!sourceryCommit(&context))
+		exit_status = 1;
+
+	// The reports cover the initial run, watching never ends.
+	finishRun(arena, &reports);
+
+	// Everything stays resident between runs, so re-runs only pay for the script.
+	if (exit_status == 0 && watch_mode)
+	{
+		reverseLinkedList(targets.scripts);
+		watchSourceFiles(arena, &context, &targets);
+	}
+
+	// An archive is only finished after the reports, which go to standard error while
+	// an archive is being written to standard output.
+	if (!sourceryDestroy(&context))
+	{
+		logError("Error: Unable to write the archive %s.\n", archive_path);
+		exit_status = 1;
+	}
+
+	// Failures that didn't stop the run, such as a command exiting with an error,
+	// still fail it.
+	if (exit_status == 0 && reports.summary.failures != 0)
+		exit_status = 1;
+
+	arena_restore(arena, stash_point);
+	return exit_status;
+
+}
+
+/**
+ * Finds the socket path passed on the command-line through "--socket=".
+ * 
+ * @returns The socket path, or the default socket within the user's socket
+ * directory if none was provided. NULL if there's no such directory.
+ */
+internal const char*
+findSocketPath(int argc, char** argv)
+{
+
+	const char* socket_path = findArgumentValue(argc, argv, "--socket=");
+	if (socket_path != NULL)
+		return socket_path;
+
+	persist char default_path[KILOBYTES(4)];
+	if (!platformGetLocalSocketDirectory(default_path, sizeof(default_path)))
+		return NULL;
+
+	size_t directory_length = strLength(default_path);
+	size_t name_size = sizeof(DAEMON_SOCKET_NAME);
+	if (directory_length + 1 + name_size > sizeof(default_path))
+		return NULL;
+
+	default_path[directory_length] = '/';
+	strCopy(default_path + directory_length + 1, name_size, DAEMON_SOCKET_NAME, name_size);
+	return default_path;
+
+}
+
+/**
+ * Stays resident and runs each request sent by a client over the daemon's socket.
+ * The heap, the scan threads' memory and everything the OS caches for us are
+ * already warm, so a request only pays for the work itself. Each request runs
+ * within the client's working directory and writes to the client's own standard
+ * handles, which are sent along with the request.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param socket_path The path to listen on.
+ * 
+ * @returns The exit status of the daemon, which only returns if it fails to start.
+ */
+internal int
+runDaemon(mem_arena* arena, const char* socket_path)
+{
+
+	if (socket_path == NULL)
+	{
+		printf("Error: There's no private directory for the daemon's socket, provide one with --socket=.\n");
+		return -1;
+	}
+
+	localsocket listener = {0};
+	if (!platformListenLocalSocket(&listener, socket_path))
+	{
+		printf("Error: Unable to listen on %s, is a daemon already running or does the path belong to another user?\n", socket_path);
+		return -1;
 	}
 
-	//processSourceFile(&application_memory_heap, argv[1]);
+	char daemon_directory[KILOBYTES(4)];
+	if (!platformGetWorkingDirectory(daemon_directory, sizeof(daemon_directory)))
+		daemon_directory[0] = '\0';
+
+	printf("Listening on %s.\n", socket_path);
+	fflush(stdout);
+
+	while (true)
+	{
+
+		localsocket connection = {0};
+		if (!platformAcceptLocalSocket(&listener, &connection))
+			continue;
+
+		size_t stash_point = arena_stash(arena);
+
+		// Receive the request, rejecting anything that isn't well-formed.
+		daemon_request_header header = {0};
+		standard_handles client_handles = {0};
+		if (!platformReceiveLocalSocket(&connection, &header, sizeof(header), &client_handles) ||
+			header.magic != DAEMON_REQUEST_MAGIC || header.argument_count == 0 ||
+			header.payload_size == 0 || header.payload_size > DAEMON_MAX_REQUEST_SIZE)
+		{
+			platformReleaseStandardHandles(&client_handles);
+			platformCloseLocalSocket(&connection, NULL);
+			continue;
+		}
+
+		char* payload = arena_push_array_zero(arena, char, header.payload_size + 1);
+		char** request_argv = arena_push_array_zero(arena, char*, header.argument_count + 1);
+		bool request_valid = platformReceiveLocalSocket(&connection, payload, header.payload_size, NULL);
+
+		// The payload is the working directory followed by each of the arguments.
+		char* working_directory = payload;
+		size_t payload_offset = strLength(working_directory) + 1;
+		for (uint32 argument_index = 0; request_valid && argument_index < header.argument_count; ++argument_index)
+		{
+			if (payload_offset >= header.payload_size)
+			{
+				request_valid = false;
+				break;
+			}
+			request_argv[argument_index] = payload + payload_offset;
+			payload_offset += strLength(payload + payload_offset) + 1;
+		}
+
+		int32 exit_status = -1;
+		standard_handles daemon_handles = {0};
+		if (request_valid && platformSetWorkingDirectory(working_directory) &&
+			platformSwapStandardHandles(&client_handles, &daemon_handles))
+		{
+			exit_status = (int32)runSourcery(arena, (int)header.argument_count, request_argv, false);
+			fflush(stdout);
+			fflush(stderr);
+
+			platformSwapStandardHandles(&daemon_handles, &client_handles);
+			platformReleaseStandardHandles(&daemon_handles);
+		}
+		platformSetWorkingDirectory(daemon_directory);
+
+		platformSendLocalSocket(&connection, &exit_status, sizeof(exit_status), false);
+		platformReleaseStandardHandles(&client_handles);
+		platformCloseLocalSocket(&connection, NULL);
+
+		arena_restore(arena, stash_point);
+
+	}
+
+}
+
+/**
+ * Forwards the command-line to a running daemon and waits for it to finish. The
+ * client does nothing else, so it skips allocating the heap altogether.
+ * 
+ * @param argc The number of arguments.
+ * @param argv The arguments, beginning with the invocation name.
+ * @param exit_status Set to the exit status of the daemon's run.
+ * 
+ * @returns True if the daemon ran the request, false if it couldn't be reached.
+ */
+internal bool
+runClient(int argc, char** argv, int* exit_status)
+{
+
+	persist char payload[DAEMON_MAX_REQUEST_SIZE];
+	daemon_request_header header = {0};
+	header.magic = DAEMON_REQUEST_MAGIC;
+
+	if (!platformGetWorkingDirectory(payload, sizeof(payload)))
+		return false;
+	size_t payload_size = strLength(payload) + 1;
+
+	// Everything but the client's own arguments is forwarded.
+	for (int argument_index = 0; argument_index < argc; ++argument_index)
+	{
+		size_t location = 0;
+		const char* argument = argv[argument_index];
+		if (strEquals(argument, "--client") ||
+			(strSearchToken("--socket=", argument, 0, &location) && location == 0))
+			continue;
+
+		size_t argument_size = strLength(argument) + 1;
+		if (payload_size + argument_size > sizeof(payload))
+		{
+			printf("Error: The arguments exceed the %zu byte request limit.\n", sizeof(payload));
+			*exit_status = -1;
+			return true;
+		}
+
+		strCopy(payload + payload_size, sizeof(payload) - payload_size, argument, argument_size);
+		payload_size += argument_size;
+		header.argument_count++;
+	}
+	header.payload_size = (uint32)payload_size;
+
+	const char* socket_path = findSocketPath(argc, argv);
+	localsocket connection = {0};
+	if (socket_path == NULL || !platformConnectLocalSocket(&connection, socket_path))
+		return false;
+
+	// Our output has to land ahead of the daemon's.
+	fflush(stdout);
+
+	int32 daemon_status = -1;
+	bool completed = platformSendLocalSocket(&connection, &header, sizeof(header), true) &&
+		platformSendLocalSocket(&connection, payload, payload_size, false) &&
+		platformReceiveLocalSocket(&connection, &daemon_status, sizeof(daemon_status), NULL);
+	platformCloseLocalSocket(&connection, NULL);
+
+	if (!completed)
+	{
+		printf("Error: The daemon closed the connection before finishing the request.\n");
+		daemon_status = -1;
+	}
+
+	*exit_status = (int)daemon_status;
+	return true;
+
+}
+
+int
+main(int argc, char** argv)
+{
+
+	// A client forwards its request to the daemon when one is running. If not, it
+	// simply runs the request itself.
+	bool client_mode = (argc > 1 && strEquals(argv[1], "--client"));
+	if (client_mode)
+	{
+		int client_status = 0;
+		if (runClient(argc, argv, &client_status))
+			return client_status;
+	}
+
+	// Initialize the application memory space we will need to run the application.
+	// Since this is currently a single-threaded application, we will reserve 64MB
+	// for the main thread. Text files aren't very large, so this should suffice.
+	// Huge pages are asked for before the arguments are parsed, since the heap is
+	// what they're parsed on.
+	uint32 heap_flags = 0;
+	if (findArgumentValue(argc, argv, "--huge-pages") != NULL)
+		heap_flags |= VIRTUAL_ALLOCATE_HUGE_PAGES;
+	size_t virtual_heap_size = 0;
+	void* virtual_heap_ptr = allocateHeap(1, MEGABYTES(64), &virtual_heap_size, heap_flags);
+	mem_arena application_memory_heap = {0};
+	arena_allocate(virtual_heap_ptr, virtual_heap_size, &application_memory_heap);
+
+	if (argc > 1 && strEquals(argv[1], "--daemon"))
+		return runDaemon(&application_memory_heap, findSocketPath(argc, argv));
 
 	// Calling virtual free isn't required since the OS will automatically reclaim
 	// everything for us. Just exit.
-	return 0;
+	return runSourcery(&application_memory_heap, argc, argv, true);
 }
-
@@ -1,33 +1,135 @@
 #ifndef SOURCERY_MAIN_H
 #define SOURCERY_MAIN_H
 #include <sourcery/generics.h>
+#include <sourcery/sourcery.h>
 #include <sourcery/memory/alloc.h>
+#include <sourcery/pipeline/script_pipeline.h>
 #include <sourcery/structures/node_trunk.h>
 
 /**
  * -----------------------------------------------------------------------------
- * Line Source & Enumerations
+ * Watch Mode
  * -----------------------------------------------------------------------------
  */
 
-#define DIRECTIVE_NONE 				0
-#define DIRECTIVE_UNDEFINED 		1
-#define DIRECTIVE_MAKEFILE 			2
-#define DIRECTIVE_MAKEDIR 			3
-#define DIRECTIVE_COMMAND 			4
-#define DIRECTIVE_HEADER 			5
-#define DIRECTIVE_VARIABLE 			6
-#define DIRECTIVE_MACROINLINE 		7
-#define DIRECTIVE_MACROFUNCTION		8
+/**
+ * How long the watched directories must stay quiet before a burst of changes is
+ * acted on, the chunk size used to hash scripts and the size of the buffer that
+ * change events are read into.
+ */
+#define WATCH_DEBOUNCE_MILLISECONDS 	15
+#define WATCH_HASH_CHUNK_SIZE 			KILOBYTES(64)
+#define WATCH_EVENT_BUFFER_SIZE 		KILOBYTES(16)
+
+/**
+ * A script that is re-run whenever its contents change. The hash of its contents
+ * from the last run is kept so that writes which don't change a script's bytes,
+ * or changes to its neighbours, don't cause it to be re-run.
+ */
+typedef struct watched_script
+{
+	char* 	path;
+	char* 	directory;
+	char* 	name;
+
+	uint32 	watch_id;
+	bool 	pending;
+	bool 	exists;
+	uint64 	content_hash;
+} watched_script;
+
+/**
+ * A directory watched for changes, either one that was walked to find scripts or
+ * the directory of a script that was named directly.
+ */
+typedef struct watched_directory
+{
+	char* 	path;
+	uint32 	watch_id;
+	bool 	watched;
+} watched_directory;
+
+/**
+ * An entry that appeared within a watched directory but wasn't kept by the walk
+ * that followed, so that further changes to it don't walk the roots again.
+ */
+typedef struct passed_entry
+{
+	uint32 	watch_id;
+	char* 	name;
+} passed_entry;
+
+/**
+ * Everything watch mode watches. The roots are the directories provided on the
+ * command-line, which are walked again with the run's own options whenever a new
+ * entry appears within a watched directory, so new scripts are filtered exactly
+ * as the first run's were.
+ */
+typedef struct watch_targets
+{
+	node_trunk* 	scripts;
+	node_trunk* 	directories;
+	node_trunk* 	roots;
+	node_trunk* 	passed_entries;
+
+	bool 			recursive;
+	const char* 	extensions;
+} watch_targets;
+
+/**
+ * -----------------------------------------------------------------------------
+ * Run Reports
+ * -----------------------------------------------------------------------------
+ */
 
-typedef struct line_source
+/**
+ * The reports requested for a single run. They're begun before the arguments are
+ * parsed and finished on every path out of the run.
+ */
+typedef struct run_reports
 {
-	char* 	stringPtr;
-	size_t 	stringLength;
+	uint32 			verbosity;
+	run_summary 	summary;
 
-	uint32 	lineNumber;
-	uint32 	lineDirectiveType;
-} line_source;
+	const char* 	trace_path;
+	bool 			perf_counters;
+
+	bool 			command_report;
+	const char* 	command_report_path;
+
+	bool 				memory_report;
+	mem_arena_stats 	memory_stats;
+
+	bool 					pipeline_report;
+	script_pipeline_stats 	pipeline_stats;
+} run_reports;
+
+/**
+ * -----------------------------------------------------------------------------
+ * Daemon Mode
+ * -----------------------------------------------------------------------------
+ */
+
+/**
+ * The name of the socket a daemon listens on within the user's socket directory
+ * when one isn't provided, the largest request a client may send and the magic
+ * value every request begins with.
+ */
+#define DAEMON_SOCKET_NAME 			"sourcery.sock"
+#define DAEMON_MAX_REQUEST_SIZE 	KILOBYTES(64)
+#define DAEMON_REQUEST_MAGIC 		0x59435253
+
+/**
+ * Sent by a client ahead of its request. The payload that follows holds the
+ * client's working directory and then each of its arguments, all null-terminated.
+ * The daemon answers each request with the run's exit status as an int32.
+ */
+typedef struct daemon_request_header
+{
+	uint32 	magic;
+	uint32 	argument_count;
+	uint32 	payload_size;
+} daemon_request_header;
 
 /**
  * -----------------------------------------------------------------------------
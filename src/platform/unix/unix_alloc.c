@@ -0,0 +1,146 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <sourcery/memory/alloc.h>
+
+/**
+ * Unlike VirtualFree(), munmap() requires the size of the mapping. The start and
+ * size of the mapping are stashed just before the region handed back to the
+ * caller, within a header that's at least a page.
+ */
+#define VIRTUAL_HEADER_SIZE (sizeof(size_t) * 2)
+
+/**
+ * The memory policy that prefers a node without requiring it, from the kernel's
+ * mempolicy.h, which isn't always installed.
+ */
+#define VIRTUAL_MPOL_PREFERRED 1
+
+/**
+ * Maps anonymous memory, returning NULL if it couldn't be mapped.
+ */
+internal void*
+virtual_map(void* base_hint, size_t mapping_size, int extra_flags)
+{
+	void* mapping_ptr = mmap(base_hint, mapping_size, PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|extra_flags, -1, 0);
+	return (mapping_ptr == MAP_FAILED) ? NULL : mapping_ptr;
+}
+
+bool virtual_allocate(void** region, size_t* region_size, uint64 base)
+{
+	return virtual_allocate_flags(region, region_size, base, 0);
+}
+
+bool virtual_allocate_flags(void** region, size_t* region_size, uint64 base, uint32 flags)
+{
+
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+	// Round up to the nearest page boundary. Huge pages are only worth asking for
+	// when the region spans at least one of them.
+	size_t requested_size = ((*region_size + page_size - 1) / page_size) * page_size;
+	bool huge_pages = ((flags & VIRTUAL_ALLOCATE_HUGE_PAGES) && requested_size >= VIRTUAL_HUGE_PAGE_SIZE);
+
+	// The base is only a hint, the kernel is free to place the mapping elsewhere.
+	void* base_hint = (base != 0) ? (void*)(size_t)(base - page_size) : NULL;
+	void* mapping_ptr = NULL;
+	size_t mapping_size = 0;
+	uint8* region_ptr = NULL;
+
+	// Explicit huge pages are whole huge pages, header included.
+#if defined(MAP_HUGETLB)
+	if (huge_pages)
+	{
+		size_t huge_size = ((requested_size + VIRTUAL_HUGE_PAGE_SIZE - 1) / VIRTUAL_HUGE_PAGE_SIZE) *
+			VIRTUAL_HUGE_PAGE_SIZE;
+		mapping_size = huge_size + VIRTUAL_HUGE_PAGE_SIZE;
+		mapping_ptr = virtual_map(NULL, mapping_size, MAP_HUGETLB);
+		if (mapping_ptr != NULL)
+			region_ptr = (uint8*)mapping_ptr + VIRTUAL_HUGE_PAGE_SIZE;
+	}
+#endif
+
+	// Transparent huge pages are only used for the huge-page-aligned parts of a
+	// mapping, so the region is aligned within a mapping with room to spare.
+	if (mapping_ptr == NULL)
+	{
+		size_t alignment = huge_pages ? VIRTUAL_HUGE_PAGE_SIZE : page_size;
+		mapping_size = requested_size + page_size + (alignment - page_size);
+		mapping_ptr = virtual_map(base_hint, mapping_size, 0);
+		if (mapping_ptr == NULL)
+			return false;
+
+		size_t region_address = (size_t)mapping_ptr + page_size;
+		region_address = ((region_address + alignment - 1) / alignment) * alignment;
+		region_ptr = (uint8*)region_address;
+
+#if defined(MADV_HUGEPAGE)
+		if (huge_pages)
+			madvise(region_ptr, requested_size, MADV_HUGEPAGE);
+#endif
+	}
+
+	size_t* header = (size_t*)(region_ptr - VIRTUAL_HEADER_SIZE);
+	header[0] = (size_t)mapping_ptr;
+	header[1] = mapping_size;
+
+	// Nothing but the header has been touched, so every page of the region is
+	// placed by the policy.
+	if (flags & VIRTUAL_ALLOCATE_LOCAL_NODE)
+		virtual_bind_local_node(region_ptr, mapping_size - (size_t)(region_ptr - (uint8*)mapping_ptr));
+
+	*region = region_ptr;
+	*region_size = mapping_size - (size_t)(region_ptr - (uint8*)mapping_ptr);
+
+	return true;
+
+}
+
+bool virtual_bind_local_node(void* region, size_t region_size)
+{
+
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+	unsigned int processor = 0;
+	unsigned int node = 0;
+	if (syscall(SYS_getcpu, &processor, &node, NULL) != 0)
+		return false;
+
+	// The kernel reads one less node than it's told to, so the mask is kept to the
+	// nodes it'll read.
+	unsigned long node_mask = 0;
+	if (node >= sizeof(node_mask) * 8 - 1)
+		return false;
+	node_mask = 1UL << node;
+
+	return (syscall(SYS_mbind, region, region_size, VIRTUAL_MPOL_PREFERRED, &node_mask,
+		sizeof(node_mask) * 8, 0) == 0);
+#else
+	(void)region;
+	(void)region_size;
+	return false;
+#endif
+
+}
+
+bool virtual_free(void** region)
+{
+
+	size_t* header = (size_t*)((uint8*)(*region) - VIRTUAL_HEADER_SIZE);
+	void* mapping_ptr = (void*)header[0];
+	size_t mapping_size = header[1];
+
+	if (munmap(mapping_ptr, mapping_size) != 0)
+		return false;
+
+	*region = NULL;
+	return true;
+
+}
+
+#endif
@@ -0,0 +1,27 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <errno.h>
+#include <time.h>
+
+#include <sourcery/time/clock.h>
+
+uint64
+platformGetTimeNanoseconds(void)
+{
+	struct timespec current_time;
+	clock_gettime(CLOCK_MONOTONIC, &current_time);
+	return (uint64)current_time.tv_sec * NANOSECONDS_PER_SECOND + (uint64)current_time.tv_nsec;
+}
+
+void
+platformSleepMilliseconds(uint32 milliseconds)
+{
+	struct timespec remaining_time;
+	remaining_time.tv_sec = milliseconds / 1000;
+	remaining_time.tv_nsec = (long)(milliseconds % 1000) * 1000000L;
+	while (nanosleep(&remaining_time, &remaining_time) != 0 && errno == EINTR);
+}
+
+#endif
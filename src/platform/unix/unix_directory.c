@@ -0,0 +1,179 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <sourcery/filesystem/directory.h>
+
+/**
+ * Directories are enumerated with getdents64 directly rather than readdir(), which
+ * lets the caller decide how large each batch of entries is and avoids the heap
+ * allocation fdopendir() makes for every directory.
+ */
+typedef struct unix_dirent64
+{
+	uint64 			d_ino;
+	int64 			d_off;
+	unsigned short 	d_reclen;
+	unsigned char 	d_type;
+	char 			d_name[];
+} unix_dirent64;
+
+internal uint32
+unixPathTypeFromMode(mode_t mode)
+{
+	if (S_ISREG(mode)) return PLATFORM_PATHTYPE_FILE;
+	if (S_ISDIR(mode)) return PLATFORM_PATHTYPE_DIRECTORY;
+	return PLATFORM_PATHTYPE_OTHER;
+}
+
+bool
+platformOpenDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path,
+	void* buffer, size_t buffer_size)
+{
+
+	int parent_handle = (parent != NULL) ? (int)parent->platform_handle_ptr : AT_FDCWD;
+	int unix_handle = openat(parent_handle, name, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+	if (unix_handle < 0)
+		return false;
+
+	dh->platform_handle_ptr = (size_t)unix_handle;
+	dh->platform_handle_size = sizeof(int);
+	dh->path = path;
+	dh->buffer = (uint8*)buffer;
+	dh->buffer_size = buffer_size;
+	dh->buffer_length = 0;
+	dh->buffer_offset = 0;
+	dh->end_of_directory = false;
+
+	return true;
+
+}
+
+bool
+platformOpenParentDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path)
+{
+	return platformOpenDirectory(dh, parent, name, path, NULL, 0);
+}
+
+uint32
+platformCreateDirectoryAt(dirhandle* parent, const char* name, const char* path)
+{
+
+	(void)path;
+
+	int parent_handle = (parent != NULL) ? (int)parent->platform_handle_ptr : AT_FDCWD;
+	if (mkdirat(parent_handle, name, 0755) == 0)
+		return PLATFORM_CREATEDIR_CREATED;
+	if (errno != EEXIST)
+		return PLATFORM_CREATEDIR_FAILED;
+
+	// Whatever exists has to be a directory, links to one included.
+	struct stat path_status;
+	if (fstatat(parent_handle, name, &path_status, 0) == 0 && S_ISDIR(path_status.st_mode))
+		return PLATFORM_CREATEDIR_EXISTS;
+	return PLATFORM_CREATEDIR_FAILED;
+
+}
+
+bool
+platformReadDirectory(dirhandle* dh, direntry* entry)
+{
+
+	while (true)
+	{
+
+		// Refill the buffer with the next batch of entries.
+		if (dh->buffer_offset >= dh->buffer_length)
+		{
+			if (dh->end_of_directory)
+				return false;
+
+			long bytes_read = syscall(SYS_getdents64, (int)dh->platform_handle_ptr,
+				dh->buffer, dh->buffer_size);
+			if (bytes_read < 0 && errno == EINTR)
+				continue;
+			if (bytes_read <= 0)
+			{
+				dh->end_of_directory = true;
+				return false;
+			}
+
+			dh->buffer_length = (size_t)bytes_read;
+			dh->buffer_offset = 0;
+		}
+
+		unix_dirent64* unix_entry = (unix_dirent64*)(dh->buffer + dh->buffer_offset);
+		dh->buffer_offset += unix_entry->d_reclen;
+
+		// Skip the self and parent entries.
+		const char* entry_name = unix_entry->d_name;
+		if (entry_name[0] == '.' && (entry_name[1] == '\0' ||
+			(entry_name[1] == '.' && entry_name[2] == '\0')))
+			continue;
+
+		entry->name = entry_name;
+		switch (unix_entry->d_type)
+		{
+			case DT_REG: 		entry->type = PLATFORM_PATHTYPE_FILE; break;
+			case DT_DIR: 		entry->type = PLATFORM_PATHTYPE_DIRECTORY; break;
+			case DT_UNKNOWN: 	entry->type = PLATFORM_PATHTYPE_UNKNOWN; break;
+			default: 			entry->type = PLATFORM_PATHTYPE_OTHER; break;
+		}
+
+		return true;
+
+	}
+
+}
+
+void
+platformCloseDirectory(dirhandle* dh)
+{
+
+	if (dh->platform_handle_size != 0)
+	{
+		close((int)dh->platform_handle_ptr);
+		dh->platform_handle_ptr = 0;
+		dh->platform_handle_size = 0;
+	}
+
+}
+
+uint32
+platformGetPathType(const char* path)
+{
+	struct stat path_status;
+	if (stat(path, &path_status) != 0)
+		return PLATFORM_PATHTYPE_NONE;
+	return unixPathTypeFromMode(path_status.st_mode);
+}
+
+uint32
+platformGetPathTypeAt(dirhandle* dh, const char* name)
+{
+	struct stat path_status;
+	if (fstatat((int)dh->platform_handle_ptr, name, &path_status, AT_SYMLINK_NOFOLLOW) != 0)
+		return PLATFORM_PATHTYPE_NONE;
+	return unixPathTypeFromMode(path_status.st_mode);
+}
+
+bool
+platformGetWorkingDirectory(char* buffer, size_t buffer_size)
+{
+	return (getcwd(buffer, buffer_size) != NULL);
+}
+
+bool
+platformSetWorkingDirectory(const char* path)
+{
+	return (chdir(path) == 0);
+}
+
+#endif
@@ -0,0 +1,431 @@
+#include <sourcery/generics.h>
+/**
+ * -----------------------------------------------------------------------------
+ * Target System: Unix
+ * -----------------------------------------------------------------------------
+ */
+#if defined(PLATFORM_UNIX)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#	include <linux/fs.h>
+#endif
+
+#include <sourcery/filehandle.h>
+
+bool
+platformOpenFile(filehandle* fh, const char* file_path, uint32_t file_context, uint32_t file_mode)
+{
+
+	// Initialize the filehandle struct with the context and mode.
+	fh->context = file_context;
+	fh->mode = file_mode;
+
+	// Determine the access mode for the file.
+	int open_flags = (file_mode == PLATFORM_FILEMODE_READONLY) ? O_RDONLY : O_RDWR;
+
+	// Determine how the file should be handled, matching the Win32 dispositions.
+	if (file_context == PLATFORM_FILECONTEXT_NEW)
+		open_flags |= O_CREAT|O_EXCL;
+	else if (file_context != PLATFORM_FILECONTEXT_EXISTING)
+		open_flags |= O_CREAT;
+
+	if (file_mode == PLATFORM_FILEMODE_TRUNCATE)
+		open_flags |= O_TRUNC;
+
+	int unix_handle = open(file_path, open_flags|O_CLOEXEC, 0644);
+	if (unix_handle < 0)
+		return PLATFORM_FILEOPEN_FAILED;
+
+	// Set platform handle pointer and size.
+	fh->platform_handle_size = sizeof(int);
+	fh->platform_handle_ptr = (size_t)unix_handle;
+
+	// Once we have the file opened, we should capture the file size.
+	struct stat file_status = {0};
+	fstat(unix_handle, &file_status);
+	fh->file_size = (size_t)file_status.st_size;
+
+	// Set the read and write pointers to their respective locations.
+	fh->read_ptr = 0;
+	fh->write_ptr = (file_mode == PLATFORM_FILEMODE_APPEND) ? fh->file_size : 0;
+
+	return PLATFORM_FILEOPEN_SUCCESS;
+
+}
+
+bool
+platformOpenStandardInput(filehandle* fh)
+{
+
+	fh->context = PLATFORM_FILECONTEXT_STREAM;
+	fh->mode = PLATFORM_FILEMODE_READONLY;
+	fh->platform_handle_size = sizeof(int);
+	fh->platform_handle_ptr = (size_t)STDIN_FILENO;
+	fh->file_size = 0;
+	fh->read_ptr = 0;
+	fh->write_ptr = 0;
+
+	return PLATFORM_FILEOPEN_SUCCESS;
+
+}
+
+bool
+platformClaimStandardOutput(filehandle* fh)
+{
+
+	// The archive keeps a duplicate, standard output itself now points at standard error.
+	int unix_handle = dup(STDOUT_FILENO);
+	if (unix_handle < 0)
+		return PLATFORM_FILEOPEN_FAILED;
+	if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+	{
+		close(unix_handle);
+		return PLATFORM_FILEOPEN_FAILED;
+	}
+	fcntl(unix_handle, F_SETFD, FD_CLOEXEC);
+
+	fh->context = PLATFORM_FILECONTEXT_STREAM;
+	fh->mode = PLATFORM_FILEMODE_APPEND;
+	fh->platform_handle_size = sizeof(int);
+	fh->platform_handle_ptr = (size_t)unix_handle;
+	fh->file_size = 0;
+	fh->read_ptr = 0;
+	fh->write_ptr = 0;
+
+	return PLATFORM_FILEOPEN_SUCCESS;
+
+}
+
+void
+platformReleaseStandardOutput(filehandle* fh)
+{
+
+	if (fh->platform_handle_size != 0)
+	{
+		fflush(stdout);
+		dup2((int)fh->platform_handle_ptr, STDOUT_FILENO);
+		close((int)fh->platform_handle_ptr);
+		fh->platform_handle_ptr = 0;
+		fh->platform_handle_size = 0;
+	}
+
+}
+
+void
+platformCloseFile(filehandle* fh)
+{
+
+	if (fh->platform_handle_size != 0)
+	{
+		// Streams are borrowed from the process, so they aren't ours to close.
+		if (fh->context != PLATFORM_FILECONTEXT_STREAM)
+			close((int)fh->platform_handle_ptr);
+		fh->platform_handle_ptr = 0;
+		fh->platform_handle_size = 0;
+	}
+
+}
+
+size_t
+platformReadFile(filehandle* fh, void* buffer, size_t buffer_size)
+{
+
+	// Continually read into the buffer until we have reached buffer size or reach EOF.
+	// Positional reads keep the read pointer independent of the write pointer.
+	int unix_handle = (int)fh->platform_handle_ptr;
+	size_t total_read = 0;
+	while (total_read < buffer_size)
+	{
+
+		ssize_t bytes_read = 0;
+		if (fh->context == PLATFORM_FILECONTEXT_STREAM)
+			bytes_read = read(unix_handle, (uint8*)buffer + total_read, buffer_size - total_read);
+		else
+			bytes_read = pread(unix_handle, (uint8*)buffer + total_read, buffer_size - total_read,
+				(off_t)(fh->read_ptr + total_read));
+
+		if (bytes_read < 0 && errno == EINTR)
+			continue;
+
+		// If we read zero bytes, we are probably EOF.
+		if (bytes_read <= 0)
+			break;
+
+		total_read += (size_t)bytes_read;
+	}
+
+	// Update the read position.
+	fh->read_ptr += total_read;
+
+	return total_read;
+
+}
+
+size_t
+platformWriteFile(filehandle* fh, void* buffer, size_t buffer_size)
+{
+
+	int unix_handle = (int)fh->platform_handle_ptr;
+	size_t total_written = 0;
+	while (total_written < buffer_size)
+	{
+
+		// Streams can't be positioned, they're only ever appended to.
+		ssize_t bytes_written = (fh->context == PLATFORM_FILECONTEXT_STREAM) ?
+			write(unix_handle, (uint8*)buffer + total_written, buffer_size - total_written) :
+			pwrite(unix_handle, (uint8*)buffer + total_written,
+			buffer_size - total_written, (off_t)(fh->write_ptr + total_written));
+
+		if (bytes_written < 0 && errno == EINTR)
+			continue;
+		if (bytes_written <= 0)
+			break;
+
+		total_written += (size_t)bytes_written;
+	}
+
+	// Update the write position and the file size.
+	fh->write_ptr += total_written;
+	if (fh->write_ptr > fh->file_size)
+		fh->file_size = fh->write_ptr;
+
+	return total_written;
+
+}
+
+size_t
+platformCopyFileRange(filehandle* destination, filehandle* source, size_t source_offset, size_t size)
+{
+
+	size_t total_copied = 0;
+#if defined(SYS_copy_file_range)
+	if (destination->context == PLATFORM_FILECONTEXT_STREAM || source->context == PLATFORM_FILECONTEXT_STREAM)
+		return 0;
+
+	// Both offsets are passed explicitly, so neither file's position is moved. The
+	// kernel takes them as 64-bit offsets.
+	while (total_copied < size)
+	{
+
+		int64 read_offset = (int64)(source_offset + total_copied);
+		int64 write_offset = (int64)(destination->write_ptr + total_copied);
+		long bytes_copied = syscall(SYS_copy_file_range, (int)source->platform_handle_ptr, &read_offset,
+			(int)destination->platform_handle_ptr, &write_offset, size - total_copied, 0);
+
+		if (bytes_copied < 0 && errno == EINTR)
+			continue;
+		if (bytes_copied <= 0)
+			break;
+
+		total_copied += (size_t)bytes_copied;
+	}
+
+	// Update the write position and the file size.
+	destination->write_ptr += total_copied;
+	if (destination->write_ptr > destination->file_size)
+		destination->file_size = destination->write_ptr;
+#else
+	(void)destination;
+	(void)source;
+	(void)source_offset;
+	(void)size;
+#endif
+
+	return total_copied;
+
+}
+
+bool
+platformCloneFile(filehandle* destination, filehandle* source)
+{
+
+#if defined(FICLONE)
+	if (ioctl((int)destination->platform_handle_ptr, FICLONE, (int)source->platform_handle_ptr) != 0)
+		return false;
+
+	destination->file_size = source->file_size;
+	destination->write_ptr = source->file_size;
+	return true;
+#else
+	(void)destination;
+	(void)source;
+	return false;
+#endif
+
+}
+
+bool
+platformSyncFile(filehandle* fh)
+{
+
+	// The file's size is flushed along with its data, which is all a new file needs.
+	int sync_status = 0;
+	while ((sync_status = fdatasync((int)fh->platform_handle_ptr)) != 0 && errno == EINTR);
+	return (sync_status == 0);
+
+}
+
+/**
+ * Flushes a file through to the disk by its path, as platformSyncFile() does an
+ * open file.
+ */
+internal bool
+unixSyncPath(const char* path)
+{
+
+	int unix_handle = open(path, O_RDONLY|O_CLOEXEC);
+	if (unix_handle < 0)
+		return false;
+
+	int sync_status = 0;
+	while ((sync_status = fdatasync(unix_handle)) != 0 && errno == EINTR);
+	close(unix_handle);
+	return (sync_status == 0);
+
+}
+
+bool
+platformSyncFilesystems(char** paths, uint32 path_count)
+{
+
+#if defined(SYS_syncfs)
+	// Files are mostly on the same filesystem or two, so the filesystems already
+	// flushed are simply remembered in a short list.
+	dev_t synced_devices[16];
+	uint32 synced_count = 0;
+	bool synced = true;
+	for (uint32 path_index = 0; path_index < path_count; ++path_index)
+	{
+
+		struct stat file_status = {0};
+		if (stat(paths[path_index], &file_status) != 0)
+		{
+			synced = false;
+			continue;
+		}
+
+		bool device_synced = false;
+		for (uint32 device_index = 0; device_index < synced_count && !device_synced; ++device_index)
+			device_synced = (synced_devices[device_index] == file_status.st_dev);
+		if (device_synced)
+			continue;
+
+		// Files on filesystems past the list are flushed one by one.
+		if (synced_count == sizeof(synced_devices) / sizeof(synced_devices[0]))
+		{
+			if (!unixSyncPath(paths[path_index]))
+				synced = false;
+			continue;
+		}
+		synced_devices[synced_count++] = file_status.st_dev;
+
+		int unix_handle = open(paths[path_index], O_RDONLY|O_CLOEXEC);
+		if (unix_handle < 0 || syscall(SYS_syncfs, unix_handle) != 0)
+			synced = false;
+		if (unix_handle >= 0)
+			close(unix_handle);
+
+	}
+	return synced;
+#else
+	// Without syncfs, each file is flushed. sync() would flush every filesystem on
+	// the machine, and POSIX doesn't promise that it waits for the writes.
+	bool synced = true;
+	for (uint32 path_index = 0; path_index < path_count; ++path_index)
+	{
+		if (!unixSyncPath(paths[path_index]))
+			synced = false;
+	}
+	return synced;
+#endif
+
+}
+
+/**
+ * Fills out a stamp from a file's status.
+ */
+internal void
+unixStampFromStatus(struct stat* file_status, file_stamp* stamp)
+{
+
+	stamp->device = (uint64)file_status->st_dev;
+	stamp->index = (uint64)file_status->st_ino;
+	stamp->size = (uint64)file_status->st_size;
+#if defined(__APPLE__)
+	stamp->modified_time = (uint64)file_status->st_mtimespec.tv_sec * 1000000000ULL +
+		(uint64)file_status->st_mtimespec.tv_nsec;
+#else
+	stamp->modified_time = (uint64)file_status->st_mtim.tv_sec * 1000000000ULL +
+		(uint64)file_status->st_mtim.tv_nsec;
+#endif
+
+}
+
+bool
+platformGetFileStamp(filehandle* fh, file_stamp* stamp)
+{
+
+	struct stat file_status = {0};
+	if (fstat((int)fh->platform_handle_ptr, &file_status) != 0)
+		return false;
+
+	unixStampFromStatus(&file_status, stamp);
+	return true;
+
+}
+
+bool
+platformGetPathStamp(const char* file_path, file_stamp* stamp)
+{
+
+	struct stat file_status = {0};
+	if (stat(file_path, &file_status) != 0)
+		return false;
+
+	unixStampFromStatus(&file_status, stamp);
+	return true;
+
+}
+
+bool
+platformPrefetchFile(filehandle* fh)
+{
+
+	// A length of zero runs to the end of the file. The kernel queues the reads and
+	// returns without waiting on them.
+#if defined(POSIX_FADV_WILLNEED)
+	return (posix_fadvise((int)fh->platform_handle_ptr, 0, 0, POSIX_FADV_WILLNEED) == 0);
+#else
+	(void)fh;
+	return false;
+#endif
+
+}
+
+bool
+platformCreateDirectory(const char* file_path)
+{
+	return (mkdir(file_path, 0755) == 0);
+}
+
+bool
+platformRenameFile(const char* source_path, const char* destination_path)
+{
+	return (rename(source_path, destination_path) == 0);
+}
+
+bool
+platformRemoveFile(const char* file_path)
+{
+	return (unlink(file_path) == 0);
+}
+
+#endif
@@ -0,0 +1,369 @@
+// SO_PEERCRED and its credentials are only declared by glibc for GNU sources.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <sourcery/ipc/local_socket.h>
+
+internal bool
+unixFillSocketAddress(struct sockaddr_un* address, const char* socket_path)
+{
+	size_t path_length = strlen(socket_path);
+	if (path_length >= sizeof(address->sun_path))
+		return false;
+
+	memset(address, 0, sizeof(*address));
+	address->sun_family = AF_UNIX;
+	memcpy(address->sun_path, socket_path, path_length + 1);
+	return true;
+}
+
+/**
+ * Determines if a directory can only be reached by the current user, which is
+ * when the user owns it and nobody else has any permissions on it.
+ */
+internal bool
+unixIsPrivateDirectory(const char* directory_path)
+{
+	struct stat status;
+	return (lstat(directory_path, &status) == 0 && S_ISDIR(status.st_mode) &&
+		status.st_uid == geteuid() && (status.st_mode & (S_IRWXG|S_IRWXO)) == 0);
+}
+
+/**
+ * Determines if the current user may remove whatever is at a socket path. Only a
+ * socket of our own is ever removed, anything else is left where it is.
+ *
+ * @returns True if the path is our own socket or there's nothing there.
+ */
+internal bool
+unixMayReplaceSocket(const char* socket_path)
+{
+	struct stat status;
+	if (lstat(socket_path, &status) != 0)
+		return (errno == ENOENT);
+	return (S_ISSOCK(status.st_mode) && status.st_uid == geteuid());
+}
+
+/**
+ * Determines if the process at the other end of a connection runs as the current
+ * user. Requests carry our terminal and run commands as whoever the daemon is, so
+ * neither end talks to another user.
+ */
+internal bool
+unixPeerIsUser(int unix_handle)
+{
+#if defined(SO_PEERCRED)
+	struct ucred credentials;
+	socklen_t credentials_size = sizeof(credentials);
+	if (getsockopt(unix_handle, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_size) != 0)
+		return false;
+	return (credentials.uid == geteuid());
+#else
+	uid_t peer_user = 0;
+	gid_t peer_group = 0;
+	if (getpeereid(unix_handle, &peer_user, &peer_group) != 0)
+		return false;
+	return (peer_user == geteuid());
+#endif
+}
+
+bool
+platformGetLocalSocketDirectory(char* buffer, size_t buffer_size)
+{
+
+	const char* runtime_directory = getenv("XDG_RUNTIME_DIR");
+	if (runtime_directory != NULL && runtime_directory[0] == '/' && unixIsPrivateDirectory(runtime_directory))
+	{
+		int length = snprintf(buffer, buffer_size, "%s", runtime_directory);
+		return (length > 0 && (size_t)length < buffer_size);
+	}
+
+	// Otherwise a directory of our own is made in the temporary directory. One that
+	// already exists is only used if it's still ours alone.
+	const char* temporary_directory = getenv("TMPDIR");
+	if (temporary_directory == NULL || temporary_directory[0] != '/')
+		temporary_directory = "/tmp";
+
+	int length = snprintf(buffer, buffer_size, "%s/sourcery-%lu", temporary_directory,
+		(unsigned long)geteuid());
+	if (length <= 0 || (size_t)length >= buffer_size)
+		return false;
+
+	if (mkdir(buffer, 0700) != 0 && errno != EEXIST)
+		return false;
+	return unixIsPrivateDirectory(buffer);
+
+}
+
+bool
+platformListenLocalSocket(localsocket* listener, const char* socket_path)
+{
+
+	struct sockaddr_un address;
+	if (!unixFillSocketAddress(&address, socket_path))
+		return false;
+
+	// Don't replace a socket that something is still listening on.
+	localsocket existing = {0};
+	if (platformConnectLocalSocket(&existing, socket_path))
+	{
+		platformCloseLocalSocket(&existing, NULL);
+		return false;
+	}
+	if (!unixMayReplaceSocket(socket_path))
+		return false;
+	unlink(socket_path);
+
+	int unix_handle = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+	if (unix_handle < 0)
+		return false;
+
+	// The socket is created readable and writable by us alone. Nothing else runs
+	// yet, so the process-wide mask is safe to change around the bind.
+	mode_t previous_mask = umask(0177);
+	int bind_result = bind(unix_handle, (struct sockaddr*)&address, sizeof(address));
+	umask(previous_mask);
+
+	if (bind_result != 0 || listen(unix_handle, 64) != 0)
+	{
+		close(unix_handle);
+		return false;
+	}
+
+	// A client going away mid-write must not take the listener down with it. The
+	// commands a request runs get the default disposition back when spawned.
+	signal(SIGPIPE, SIG_IGN);
+
+	listener->platform_handle_ptr = (size_t)unix_handle;
+	listener->platform_handle_size = sizeof(int);
+	return true;
+
+}
+
+bool
+platformAcceptLocalSocket(localsocket* listener, localsocket* connection)
+{
+
+	int unix_handle = -1;
+	do
+	{
+		unix_handle = accept((int)listener->platform_handle_ptr, NULL, NULL);
+	} while (unix_handle < 0 && errno == EINTR);
+
+	if (unix_handle < 0)
+		return false;
+
+	// The connection mustn't leak into the commands a request runs.
+	fcntl(unix_handle, F_SETFD, FD_CLOEXEC);
+
+	if (!unixPeerIsUser(unix_handle))
+	{
+		close(unix_handle);
+		return false;
+	}
+
+	connection->platform_handle_ptr = (size_t)unix_handle;
+	connection->platform_handle_size = sizeof(int);
+	return true;
+
+}
+
+bool
+platformConnectLocalSocket(localsocket* connection, const char* socket_path)
+{
+
+	struct sockaddr_un address;
+	if (!unixFillSocketAddress(&address, socket_path))
+		return false;
+
+	int unix_handle = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+	if (unix_handle < 0)
+		return false;
+
+	if (connect(unix_handle, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+		!unixPeerIsUser(unix_handle))
+	{
+		close(unix_handle);
+		return false;
+	}
+
+	connection->platform_handle_ptr = (size_t)unix_handle;
+	connection->platform_handle_size = sizeof(int);
+	return true;
+
+}
+
+bool
+platformSendLocalSocket(localsocket* connection, const void* buffer, size_t buffer_size,
+	bool attach_standard_handles)
+{
+
+	int unix_handle = (int)connection->platform_handle_ptr;
+	size_t total_sent = 0;
+	while (total_sent < buffer_size)
+	{
+
+		struct iovec io_vector = { (uint8*)buffer + total_sent, buffer_size - total_sent };
+		struct msghdr message = {0};
+		message.msg_iov = &io_vector;
+		message.msg_iovlen = 1;
+
+		// The descriptors ride along with the first chunk of data only.
+		union
+		{
+			struct cmsghdr 	header;
+			uint8 			storage[CMSG_SPACE(sizeof(int) * 3)];
+		} control;
+
+		if (attach_standard_handles && total_sent == 0)
+		{
+			int standard_descriptors[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+			memset(&control, 0, sizeof(control));
+			message.msg_control = control.storage;
+			message.msg_controllen = sizeof(control.storage);
+
+			struct cmsghdr* control_header = CMSG_FIRSTHDR(&message);
+			control_header->cmsg_level = SOL_SOCKET;
+			control_header->cmsg_type = SCM_RIGHTS;
+			control_header->cmsg_len = CMSG_LEN(sizeof(standard_descriptors));
+			memcpy(CMSG_DATA(control_header), standard_descriptors, sizeof(standard_descriptors));
+		}
+
+		ssize_t bytes_sent = sendmsg(unix_handle, &message, MSG_NOSIGNAL);
+		if (bytes_sent < 0 && errno == EINTR)
+			continue;
+		if (bytes_sent <= 0)
+			return false;
+
+		total_sent += (size_t)bytes_sent;
+	}
+
+	return true;
+
+}
+
+bool
+platformReceiveLocalSocket(localsocket* connection, void* buffer, size_t buffer_size,
+	standard_handles* handles)
+{
+
+	if (handles != NULL)
+		handles->valid = false;
+
+	int unix_handle = (int)connection->platform_handle_ptr;
+	size_t total_received = 0;
+	while (total_received < buffer_size)
+	{
+
+		struct iovec io_vector = { (uint8*)buffer + total_received, buffer_size - total_received };
+		struct msghdr message = {0};
+		message.msg_iov = &io_vector;
+		message.msg_iovlen = 1;
+
+		union
+		{
+			struct cmsghdr 	header;
+			uint8 			storage[CMSG_SPACE(sizeof(int) * 3)];
+		} control;
+		message.msg_control = control.storage;
+		message.msg_controllen = sizeof(control.storage);
+
+		ssize_t bytes_received = recvmsg(unix_handle, &message, MSG_CMSG_CLOEXEC);
+		if (bytes_received < 0 && errno == EINTR)
+			continue;
+		if (bytes_received <= 0)
+			return false;
+
+		for (struct cmsghdr* control_header = CMSG_FIRSTHDR(&message); control_header != NULL;
+			control_header = CMSG_NXTHDR(&message, control_header))
+		{
+			if (control_header->cmsg_level != SOL_SOCKET || control_header->cmsg_type != SCM_RIGHTS ||
+				control_header->cmsg_len != CMSG_LEN(sizeof(int) * 3))
+				continue;
+
+			int received_descriptors[3];
+			memcpy(received_descriptors, CMSG_DATA(control_header), sizeof(received_descriptors));
+
+			// Descriptors nobody asked for still have to be closed.
+			for (uint32 handle_index = 0; handle_index < 3; ++handle_index)
+			{
+				if (handles != NULL)
+					handles->platform_handles[handle_index] = (size_t)received_descriptors[handle_index];
+				else
+					close(received_descriptors[handle_index]);
+			}
+			if (handles != NULL)
+				handles->valid = true;
+		}
+
+		total_received += (size_t)bytes_received;
+	}
+
+	return true;
+
+}
+
+void
+platformCloseLocalSocket(localsocket* socket, const char* socket_path)
+{
+
+	if (socket->platform_handle_size != 0)
+	{
+		close((int)socket->platform_handle_ptr);
+		socket->platform_handle_ptr = 0;
+		socket->platform_handle_size = 0;
+	}
+
+	if (socket_path != NULL && unixMayReplaceSocket(socket_path))
+		unlink(socket_path);
+
+}
+
+bool
+platformSwapStandardHandles(standard_handles* handles, standard_handles* previous)
+{
+
+	if (!handles->valid)
+		return false;
+
+	for (uint32 handle_index = 0; handle_index < 3; ++handle_index)
+	{
+		previous->platform_handles[handle_index] = (size_t)fcntl(handle_index, F_DUPFD_CLOEXEC, 3);
+		dup2((int)handles->platform_handles[handle_index], (int)handle_index);
+	}
+	previous->valid = true;
+
+	return true;
+
+}
+
+void
+platformReleaseStandardHandles(standard_handles* handles)
+{
+
+	if (!handles->valid)
+		return;
+
+	for (uint32 handle_index = 0; handle_index < 3; ++handle_index)
+		close((int)handles->platform_handles[handle_index]);
+	handles->valid = false;
+
+}
+
+#endif
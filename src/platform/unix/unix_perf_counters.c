@@ -0,0 +1,134 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <sourcery/perf/perf_counters.h>
+
+#if defined(__linux__)
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+persist const struct
+{
+	uint32 type;
+	uint64 config;
+} unix_perf_events[PERF_COUNTER_COUNT] =
+{
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+	{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+	{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+/**
+ * The counters are opened as a single group so that one read of the group's
+ * leader returns them all, taken at the same instant. The first counter that
+ * opens leads the group.
+ */
+bool
+platformOpenPerfCounters(perf_counters* counters)
+{
+
+	memset(counters, 0, sizeof(*counters));
+
+	int leader = -1;
+	for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = unix_perf_events[counter_index].type;
+		attributes.config = unix_perf_events[counter_index].config;
+		attributes.read_format = PERF_FORMAT_GROUP;
+		attributes.disabled = (leader < 0) ? 1 : 0;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+
+		int descriptor = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, leader, PERF_FLAG_FD_CLOEXEC);
+		if (descriptor < 0)
+			continue;
+
+		if (leader < 0)
+			leader = descriptor;
+
+		counters->platform_handles[counters->available_count++] = (size_t)descriptor;
+		counters->available[counter_index] = true;
+	}
+
+	if (leader < 0)
+		return false;
+
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	return true;
+
+}
+
+bool
+platformReadPerfCounters(perf_counters* counters, perf_sample* sample)
+{
+
+	memset(sample, 0, sizeof(*sample));
+	if (counters->available_count == 0)
+		return false;
+
+	// A group read returns the member count followed by each member's value.
+	uint64 values[PERF_COUNTER_COUNT + 1];
+	ssize_t bytes_read = read((int)counters->platform_handles[0], values, sizeof(values));
+	if (bytes_read < (ssize_t)sizeof(uint64) || values[0] != counters->available_count)
+		return false;
+
+	uint32 member_index = 0;
+	for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+	{
+		if (counters->available[counter_index])
+			sample->values[counter_index] = values[1 + member_index++];
+	}
+
+	return true;
+
+}
+
+void
+platformClosePerfCounters(perf_counters* counters)
+{
+
+	// Members are closed ahead of their leader.
+	for (uint32 member_index = counters->available_count; member_index > 0; --member_index)
+		close((int)counters->platform_handles[member_index - 1]);
+
+	memset(counters, 0, sizeof(*counters));
+
+}
+
+#else
+
+bool
+platformOpenPerfCounters(perf_counters* counters)
+{
+	*counters = (perf_counters){0};
+	return false;
+}
+
+bool
+platformReadPerfCounters(perf_counters* counters, perf_sample* sample)
+{
+	(void)counters;
+	*sample = (perf_sample){0};
+	return false;
+}
+
+void
+platformClosePerfCounters(perf_counters* counters)
+{
+	(void)counters;
+}
+
+#endif
+
+#endif
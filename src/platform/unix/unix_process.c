@@ -0,0 +1,484 @@
+#include <sourcery/process/process.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sourcery/time/clock.h>
+
+extern char** environ;
+
+/**
+ * Sets up spawn attributes that give the child the default SIGPIPE disposition. An
+ * ignored disposition survives exec, and a shell won't reset a signal that was
+ * ignored when it started, so anything that ignores SIGPIPE in this process, such
+ * as the daemon or an embedding application, would otherwise pass it on to every
+ * command. A pipeline like "yes | head -1" relies on SIGPIPE to end its writer.
+ */
+internal void
+unixCreateSpawnAttributes(posix_spawnattr_t* attributes)
+{
+	sigset_t default_signals;
+	sigemptyset(&default_signals);
+	sigaddset(&default_signals, SIGPIPE);
+
+	posix_spawnattr_init(attributes);
+	posix_spawnattr_setsigdefault(attributes, &default_signals);
+	posix_spawnattr_setflags(attributes, POSIX_SPAWN_SETSIGDEF);
+}
+
+/**
+ * Spawns "/bin/sh" with the default SIGPIPE disposition.
+ *
+ * @returns Zero if the shell was spawned, otherwise the error posix_spawn() gave.
+ */
+internal int
+unixSpawnShell(pid_t* process_id, posix_spawn_file_actions_t* file_actions, char** shell_argv)
+{
+	posix_spawnattr_t attributes;
+	unixCreateSpawnAttributes(&attributes);
+	int spawn_result = posix_spawn(process_id, "/bin/sh", file_actions, &attributes, shell_argv, environ);
+	posix_spawnattr_destroy(&attributes);
+	return spawn_result;
+}
+
+internal uint64
+unixTimevalToNanoseconds(struct timeval time)
+{
+	return (uint64)time.tv_sec * 1000000000ULL + (uint64)time.tv_usec * 1000ULL;
+}
+
+/**
+ * Waits for a spawned process to exit and fills out what it cost.
+ * 
+ * @returns The exit code of the process, or 128 plus the signal that killed it.
+ */
+internal int
+unixReapProcess(pid_t process_id, uint64 start_time, process_stats* stats)
+{
+
+	// The child's resource usage is collected as it's reaped, which also covers
+	// everything the shell itself waited on.
+	int process_status = 0;
+	struct rusage usage = {0};
+	while (wait4(process_id, &process_status, 0, &usage) < 0)
+	{
+		if (errno != EINTR)
+			return -1;
+	}
+
+	int exit_code = -1;
+	uint32 signal = 0;
+	if (WIFEXITED(process_status))
+	{
+		exit_code = WEXITSTATUS(process_status);
+	}
+	else if (WIFSIGNALED(process_status))
+	{
+		signal = (uint32)WTERMSIG(process_status);
+		exit_code = 128 + (int)signal;
+	}
+
+	if (stats != NULL)
+	{
+		stats->exit_code 				= exit_code;
+		stats->signal 					= signal;
+		stats->wall_nanoseconds 		= platformGetTimeNanoseconds() - start_time;
+		stats->user_nanoseconds 		= unixTimevalToNanoseconds(usage.ru_utime);
+		stats->system_nanoseconds 		= unixTimevalToNanoseconds(usage.ru_stime);
+#if defined(__APPLE__)
+		stats->max_resident_kilobytes 	= (uint64)usage.ru_maxrss / 1024;
+#else
+		stats->max_resident_kilobytes 	= (uint64)usage.ru_maxrss;
+#endif
+		stats->input_blocks 			= (uint64)usage.ru_inblock;
+		stats->output_blocks 			= (uint64)usage.ru_oublock;
+		stats->voluntary_switches 		= (uint64)usage.ru_nvcsw;
+		stats->involuntary_switches 	= (uint64)usage.ru_nivcsw;
+	}
+
+	return exit_code;
+
+}
+
+int
+platformRunCLIProcess(char* invoc, process_stats* stats)
+{
+
+	// Commands are handed to the shell, matching how they'd be typed on the CLI.
+	char* shell_argv[] = { "sh", "-c", invoc, NULL };
+
+	// Anything we've buffered must reach the terminal before the child's output does.
+	fflush(stdout);
+
+	uint64 start_time = platformGetTimeNanoseconds();
+
+	pid_t process_id = 0;
+	if (unixSpawnShell(&process_id, NULL, shell_argv) != 0)
+		return -1;
+
+	return unixReapProcess(process_id, start_time, stats);
+
+}
+
+#define UNIX_CAPTURE_PROCESS 	0
+#define UNIX_CAPTURE_OUTPUT 	1
+
+bool
+platformStartCaptureProcess(process_capture* capture, char* invoc)
+{
+
+	// Both ends are close-on-exec, so captures running at once don't hold each
+	// other's pipes open. The write end is duplicated onto the child's standard
+	// output, which clears the flag for it.
+	int output_pipe[2] = { -1, -1 };
+	if (pipe(output_pipe) != 0)
+		return false;
+	fcntl(output_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(output_pipe[1], F_SETFD, FD_CLOEXEC);
+
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_adddup2(&file_actions, output_pipe[1], STDOUT_FILENO);
+
+	char* shell_argv[] = { "sh", "-c", invoc, NULL };
+
+	uint64 start_time = platformGetTimeNanoseconds();
+	pid_t process_id = 0;
+	int spawn_result = unixSpawnShell(&process_id, &file_actions, shell_argv);
+	posix_spawn_file_actions_destroy(&file_actions);
+
+	close(output_pipe[1]);
+	if (spawn_result != 0)
+	{
+		close(output_pipe[0]);
+		return false;
+	}
+
+	capture->platform_handles[UNIX_CAPTURE_PROCESS] = (size_t)process_id;
+	capture->platform_handles[UNIX_CAPTURE_OUTPUT] = (size_t)output_pipe[0];
+	capture->running = true;
+	capture->start_time = start_time;
+	return true;
+
+}
+
+int
+platformFinishCaptureProcess(process_capture* capture, char* buffer, size_t buffer_size,
+	size_t* output_size, process_stats* stats)
+{
+
+	int output_fd = (int)capture->platform_handles[UNIX_CAPTURE_OUTPUT];
+	char discard_buffer[4096];
+	size_t total_size = 0;
+	while (true)
+	{
+		char* read_buffer = buffer + total_size;
+		size_t read_size = buffer_size - total_size;
+		if (total_size >= buffer_size)
+		{
+			read_buffer = discard_buffer;
+			read_size = sizeof(discard_buffer);
+		}
+
+		ssize_t result = read(output_fd, read_buffer, read_size);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+			break;
+		total_size += (size_t)result;
+	}
+	close(output_fd);
+
+	capture->running = false;
+	*output_size = total_size;
+	return unixReapProcess((pid_t)capture->platform_handles[UNIX_CAPTURE_PROCESS], capture->start_time, stats);
+
+}
+
+#define UNIX_SHELL_PROCESS 		0
+#define UNIX_SHELL_COMMANDS 	1
+#define UNIX_SHELL_STATUS 		2
+#define UNIX_SHELL_STATUS_FD 	3
+#define UNIX_SHELL_WRITE_BUFFER 4096
+
+bool
+platformOpenShellSession(shell_session* session)
+{
+
+	// Every end is close-on-exec, the ends the shell needs are duplicated onto its
+	// standard input and the status descriptor, which clears the flag for them.
+	int command_pipe[2] = { -1, -1 };
+	int status_pipe[2] = { -1, -1 };
+	if (pipe(command_pipe) != 0)
+		return false;
+	if (pipe(status_pipe) != 0)
+	{
+		close(command_pipe[0]);
+		close(command_pipe[1]);
+		return false;
+	}
+
+	for (int pipe_index = 0; pipe_index < 2; ++pipe_index)
+	{
+		fcntl(command_pipe[pipe_index], F_SETFD, FD_CLOEXEC);
+		fcntl(status_pipe[pipe_index], F_SETFD, FD_CLOEXEC);
+	}
+
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	posix_spawn_file_actions_adddup2(&file_actions, command_pipe[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&file_actions, status_pipe[1], UNIX_SHELL_STATUS_FD);
+
+	char* shell_argv[] = { "sh", NULL };
+
+	fflush(stdout);
+	pid_t process_id = 0;
+	int spawn_result = unixSpawnShell(&process_id, &file_actions, shell_argv);
+	posix_spawn_file_actions_destroy(&file_actions);
+
+	close(command_pipe[0]);
+	close(status_pipe[1]);
+	if (spawn_result != 0)
+	{
+		close(command_pipe[1]);
+		close(status_pipe[0]);
+		return false;
+	}
+
+	session->platform_handles[UNIX_SHELL_PROCESS] = (size_t)process_id;
+	session->platform_handles[UNIX_SHELL_COMMANDS] = (size_t)command_pipe[1];
+	session->platform_handles[UNIX_SHELL_STATUS] = (size_t)status_pipe[0];
+	session->open = true;
+	session->status_length = 0;
+	return true;
+
+}
+
+/**
+ * Waits for a session's shell to exit and releases its pipes.
+ * 
+ * @returns The shell's exit code.
+ */
+internal int
+unixReapShellSession(shell_session* session)
+{
+
+	close((int)session->platform_handles[UNIX_SHELL_COMMANDS]);
+	close((int)session->platform_handles[UNIX_SHELL_STATUS]);
+
+	int process_status = 0;
+	int exit_code = -1;
+	while (waitpid((pid_t)session->platform_handles[UNIX_SHELL_PROCESS], &process_status, 0) < 0)
+	{
+		if (errno != EINTR)
+			break;
+	}
+
+	if (WIFEXITED(process_status))
+		exit_code = WEXITSTATUS(process_status);
+	else if (WIFSIGNALED(process_status))
+		exit_code = 128 + WTERMSIG(process_status);
+
+	session->open = false;
+	session->status_length = 0;
+	return exit_code;
+
+}
+
+/**
+ * Writes all of a buffer to the shell's command pipe. A shell that has exited must
+ * show up as a failed write rather than kill the process, but the process-wide
+ * SIGPIPE disposition is left alone. SIGPIPE is blocked on this thread for the
+ * write instead, and one the write raised is taken before it's unblocked.
+ *
+ * @returns True if everything was written.
+ */
+internal bool
+unixWriteShellPipe(int fd, const char* buffer, size_t buffer_size)
+{
+
+	sigset_t pipe_signal;
+	sigset_t previous_mask;
+	sigset_t pending_signals;
+	sigemptyset(&pipe_signal);
+	sigaddset(&pipe_signal, SIGPIPE);
+	pthread_sigmask(SIG_BLOCK, &pipe_signal, &previous_mask);
+
+	// A SIGPIPE that was already pending isn't ours to take.
+	sigpending(&pending_signals);
+	bool already_pending = sigismember(&pending_signals, SIGPIPE);
+
+	size_t written = 0;
+	bool broken_pipe = false;
+	while (written < buffer_size)
+	{
+		ssize_t result = write(fd, buffer + written, buffer_size - written);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result < 0 && errno == EPIPE)
+			broken_pipe = true;
+		if (result <= 0)
+			break;
+		written += (size_t)result;
+	}
+
+	if (broken_pipe && !already_pending)
+	{
+		sigpending(&pending_signals);
+		int taken_signal = 0;
+		if (sigismember(&pending_signals, SIGPIPE))
+			sigwait(&pipe_signal, &taken_signal);
+	}
+	pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+
+	return (written == buffer_size);
+
+}
+
+/**
+ * Appends text to the command being written to the shell, writing it out when the
+ * buffer fills or when flushed with no text.
+ */
+internal bool
+unixWriteShellText(int fd, char* buffer, size_t* buffer_length, const char* text, size_t text_length)
+{
+
+	if (text_length == 0 || *buffer_length + text_length > UNIX_SHELL_WRITE_BUFFER)
+	{
+		if (!unixWriteShellPipe(fd, buffer, *buffer_length))
+			return false;
+		*buffer_length = 0;
+	}
+
+	// Anything longer than the buffer is written straight through.
+	if (text_length > UNIX_SHELL_WRITE_BUFFER)
+		return unixWriteShellPipe(fd, text, text_length);
+
+	for (size_t c_index = 0; c_index < text_length; ++c_index)
+		buffer[(*buffer_length)++] = text[c_index];
+	return true;
+
+}
+
+int
+platformRunShellCommand(shell_session* session, char* invoc, process_stats* stats)
+{
+
+	if (!session->open && !platformOpenShellSession(session))
+		return -1;
+
+	uint64 start_time = platformGetTimeNanoseconds();
+	uint64 sequence = ++session->sequence;
+	int command_fd = (int)session->platform_handles[UNIX_SHELL_COMMANDS];
+
+	// The command is single-quoted for eval, so that the shell parses it as a unit
+	// and a stray quote can't swallow the sentinel. It reads from /dev/null rather
+	// than the command pipe and doesn't inherit the status descriptor.
+	char buffer[UNIX_SHELL_WRITE_BUFFER];
+	size_t buffer_length = 0;
+	bool written = unixWriteShellText(command_fd, buffer, &buffer_length, "eval '", 6);
+
+	size_t segment_start = 0;
+	size_t c_index = 0;
+	for (; invoc[c_index] != '\0'; ++c_index)
+	{
+		if (invoc[c_index] != '\'')
+			continue;
+		written = written && unixWriteShellText(command_fd, buffer, &buffer_length,
+			invoc + segment_start, c_index - segment_start);
+		written = written && unixWriteShellText(command_fd, buffer, &buffer_length, "'\\''", 4);
+		segment_start = c_index + 1;
+	}
+	written = written && unixWriteShellText(command_fd, buffer, &buffer_length,
+		invoc + segment_start, c_index - segment_start);
+
+	char sentinel[96];
+	int sentinel_length = snprintf(sentinel, sizeof(sentinel),
+		"' </dev/null %d>&-; printf '%%s %%d\\n' %llu $? >&%d\n",
+		UNIX_SHELL_STATUS_FD, (unsigned long long)sequence, UNIX_SHELL_STATUS_FD);
+	written = written && unixWriteShellText(command_fd, buffer, &buffer_length, sentinel, (size_t)sentinel_length);
+
+	// Anything we've buffered must reach the terminal before the command's output does.
+	fflush(stdout);
+	written = written && unixWriteShellText(command_fd, buffer, &buffer_length, NULL, 0);
+
+	// Read status lines until this command's sentinel arrives. The shell closing the
+	// status pipe means the command exited it, in which case its exit code is the
+	// command's.
+	int exit_code = -1;
+	bool sentinel_found = false;
+	while (written && !sentinel_found)
+	{
+		char* line_end = NULL;
+		for (uint32 status_index = 0; status_index < session->status_length; ++status_index)
+		{
+			if (session->status_buffer[status_index] == '\n')
+			{
+				line_end = &session->status_buffer[status_index];
+				break;
+			}
+		}
+
+		if (line_end != NULL)
+		{
+			*line_end = '\0';
+			unsigned long long line_sequence = 0;
+			int line_status = 0;
+			if (sscanf(session->status_buffer, "%llu %d", &line_sequence, &line_status) == 2 &&
+				line_sequence == sequence)
+			{
+				exit_code = line_status;
+				sentinel_found = true;
+			}
+
+			uint32 consumed = (uint32)(line_end - session->status_buffer) + 1;
+			for (uint32 status_index = consumed; status_index < session->status_length; ++status_index)
+				session->status_buffer[status_index - consumed] = session->status_buffer[status_index];
+			session->status_length -= consumed;
+			continue;
+		}
+
+		// A line that fills the buffer isn't one of ours and is thrown away.
+		if (session->status_length == sizeof(session->status_buffer))
+			session->status_length = 0;
+
+		ssize_t result = read((int)session->platform_handles[UNIX_SHELL_STATUS],
+			session->status_buffer + session->status_length, sizeof(session->status_buffer) - session->status_length);
+		if (result < 0 && errno == EINTR)
+			continue;
+		if (result <= 0)
+			break;
+		session->status_length += (uint32)result;
+	}
+
+	if (!sentinel_found)
+		exit_code = unixReapShellSession(session);
+
+	if (stats != NULL)
+	{
+		process_stats empty_stats = {0};
+		*stats = empty_stats;
+		stats->exit_code = exit_code;
+		stats->wall_nanoseconds = platformGetTimeNanoseconds() - start_time;
+	}
+
+	return exit_code;
+
+}
+
+void
+platformCloseShellSession(shell_session* session)
+{
+	if (session->open)
+		unixReapShellSession(session);
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <sourcery/thread/thread.h>
+
+// The opaque storage must be able to hold the pthread primitives.
+_Static_assert(sizeof(pthread_mutex_t) <= sizeof(((platform_mutex*)0)->platform_storage),
+	"platform_mutex storage is too small for pthread_mutex_t.");
+_Static_assert(sizeof(pthread_cond_t) <= sizeof(((platform_condition*)0)->platform_storage),
+	"platform_condition storage is too small for pthread_cond_t.");
+
+internal void*
+unixThreadTrampoline(void* parameter)
+{
+	platform_thread* thread = (platform_thread*)parameter;
+	thread->proc(thread->user_data);
+	return NULL;
+}
+
+bool
+platformCreateThread(platform_thread* thread, threadproc proc, void* user_data)
+{
+
+	thread->proc = proc;
+	thread->user_data = user_data;
+
+	pthread_t unix_thread;
+	if (pthread_create(&unix_thread, NULL, unixThreadTrampoline, thread) != 0)
+		return false;
+
+	thread->platform_handle_ptr = (size_t)unix_thread;
+	return true;
+
+}
+
+void
+platformJoinThread(platform_thread* thread)
+{
+
+	if (thread->platform_handle_ptr != 0)
+	{
+		pthread_join((pthread_t)thread->platform_handle_ptr, NULL);
+		thread->platform_handle_ptr = 0;
+	}
+
+}
+
+uint32
+platformGetProcessorCount(void)
+{
+	long processor_count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (processor_count > 0) ? (uint32)processor_count : 1;
+}
+
+void
+platformCreateMutex(platform_mutex* mutex)
+{
+	pthread_mutex_init((pthread_mutex_t*)mutex->platform_storage, NULL);
+}
+
+void
+platformLockMutex(platform_mutex* mutex)
+{
+	pthread_mutex_lock((pthread_mutex_t*)mutex->platform_storage);
+}
+
+void
+platformUnlockMutex(platform_mutex* mutex)
+{
+	pthread_mutex_unlock((pthread_mutex_t*)mutex->platform_storage);
+}
+
+void
+platformDestroyMutex(platform_mutex* mutex)
+{
+	pthread_mutex_destroy((pthread_mutex_t*)mutex->platform_storage);
+}
+
+void
+platformCreateCondition(platform_condition* condition)
+{
+	pthread_cond_init((pthread_cond_t*)condition->platform_storage, NULL);
+}
+
+void
+platformDestroyCondition(platform_condition* condition)
+{
+	pthread_cond_destroy((pthread_cond_t*)condition->platform_storage);
+}
+
+void
+platformWaitCondition(platform_condition* condition, platform_mutex* mutex)
+{
+	pthread_cond_wait((pthread_cond_t*)condition->platform_storage,
+		(pthread_mutex_t*)mutex->platform_storage);
+}
+
+void
+platformSignalCondition(platform_condition* condition)
+{
+	pthread_cond_signal((pthread_cond_t*)condition->platform_storage);
+}
+
+void
+platformBroadcastCondition(platform_condition* condition)
+{
+	pthread_cond_broadcast((pthread_cond_t*)condition->platform_storage);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_UNIX)
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <sourcery/filesystem/watch.h>
+
+#define UNIX_WATCH_EVENTS (IN_CLOSE_WRITE|IN_MODIFY|IN_MOVED_TO|IN_CREATE)
+
+bool
+platformCreateWatch(filewatch* watch, void* buffer, size_t buffer_size)
+{
+
+	int unix_handle = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+	if (unix_handle < 0)
+		return false;
+
+	watch->platform_handle_ptr = (size_t)unix_handle;
+	watch->platform_handle_size = sizeof(int);
+	watch->buffer = (uint8*)buffer;
+	watch->buffer_size = buffer_size;
+	watch->buffer_length = 0;
+	watch->buffer_offset = 0;
+	watch->watch_count = 0;
+
+	return true;
+
+}
+
+bool
+platformAddWatch(filewatch* watch, const char* directory_path, uint32* watch_id)
+{
+
+	int watch_descriptor = inotify_add_watch((int)watch->platform_handle_ptr, directory_path,
+		UNIX_WATCH_EVENTS|IN_ONLYDIR);
+	if (watch_descriptor < 0)
+		return false;
+
+	*watch_id = (uint32)watch_descriptor;
+	watch->watch_count++;
+	return true;
+
+}
+
+bool
+platformReadWatch(filewatch* watch, uint32 timeout_milliseconds, watchevent* event)
+{
+
+	int unix_handle = (int)watch->platform_handle_ptr;
+	int poll_timeout = (timeout_milliseconds == PLATFORM_WATCH_INFINITE) ? -1 : (int)timeout_milliseconds;
+	while (true)
+	{
+
+		// Hand back whatever is left of the last batch first.
+		while (watch->buffer_offset < watch->buffer_length)
+		{
+			struct inotify_event* unix_event = (struct inotify_event*)(watch->buffer + watch->buffer_offset);
+			watch->buffer_offset += sizeof(struct inotify_event) + unix_event->len;
+
+			// Watches being removed aren't changes.
+			if (unix_event->mask & IN_IGNORED)
+				continue;
+
+			event->watch_id = (uint32)unix_event->wd;
+			event->name = (unix_event->len > 0) ? unix_event->name : NULL;
+			return true;
+		}
+
+		struct pollfd poll_handle = { unix_handle, POLLIN, 0 };
+		int poll_status = poll(&poll_handle, 1, poll_timeout);
+		if (poll_status < 0 && errno == EINTR)
+			continue;
+		if (poll_status <= 0)
+			return false;
+
+		ssize_t bytes_read = read(unix_handle, watch->buffer, watch->buffer_size);
+		if (bytes_read < 0 && (errno == EINTR || errno == EAGAIN))
+			continue;
+		if (bytes_read <= 0)
+			return false;
+
+		watch->buffer_length = (size_t)bytes_read;
+		watch->buffer_offset = 0;
+
+	}
+
+}
+
+void
+platformDestroyWatch(filewatch* watch)
+{
+
+	if (watch->platform_handle_size != 0)
+	{
+		close((int)watch->platform_handle_ptr);
+		watch->platform_handle_ptr = 0;
+		watch->platform_handle_size = 0;
+	}
+
+}
+
+#endif
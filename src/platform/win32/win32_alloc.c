@@ -10,12 +10,54 @@
 
 
 bool virtual_allocate(void** region, size_t* region_size, uint64 base)
+{
+	return virtual_allocate_flags(region, region_size, base, 0);
+}
+
+/**
+ * The node of the processor the calling thread is running on.
+ */
+internal USHORT
+virtual_get_local_node(void)
+{
+	PROCESSOR_NUMBER processor_number = {0};
+	GetCurrentProcessorNumberEx(&processor_number);
+	USHORT node = 0;
+	if (!GetNumaProcessorNodeEx(&processor_number, &node))
+		node = 0;
+	return node;
+}
+
+bool virtual_allocate_flags(void** region, size_t* region_size, uint64 base, uint32 flags)
 {
 
 	bool allocation_success = false;
+	DWORD allocation_type = MEM_COMMIT|MEM_RESERVE;
+	SIZE_T allocation_size = *region_size;
+	bool local_node = (flags & VIRTUAL_ALLOCATE_LOCAL_NODE) != 0;
+	USHORT node = local_node ? virtual_get_local_node() : 0;
+
+	// Large pages need the lock pages privilege and are committed up front, so they
+	// fall back to ordinary pages whenever they can't be had.
+	LPVOID allocation_ptr = NULL;
+	SIZE_T large_page_size = GetLargePageMinimum();
+	if ((flags & VIRTUAL_ALLOCATE_HUGE_PAGES) && large_page_size != 0 && allocation_size >= large_page_size)
+	{
+		SIZE_T large_size = ((allocation_size + large_page_size - 1) / large_page_size) * large_page_size;
+		DWORD large_type = allocation_type|MEM_LARGE_PAGES;
+		allocation_ptr = local_node ?
+			VirtualAllocExNuma(GetCurrentProcess(), (LPVOID)base, large_size, large_type, PAGE_READWRITE, node) :
+			VirtualAlloc((LPVOID)base, large_size, large_type, PAGE_READWRITE);
+	}
 
 	// Attempt to allocate.
-	LPVOID allocation_ptr = VirtualAlloc((LPVOID)base, *region_size, MEM_COMMIT|MEM_RESERVE, PAGE_READWRITE);
+	if (allocation_ptr == NULL)
+	{
+		allocation_ptr = local_node ?
+			VirtualAllocExNuma(GetCurrentProcess(), (LPVOID)base, allocation_size, allocation_type, PAGE_READWRITE, node) :
+			VirtualAlloc((LPVOID)base, allocation_size, allocation_type, PAGE_READWRITE);
+	}
+
 	if (allocation_ptr != NULL)
 	{
 
@@ -34,6 +76,17 @@ bool virtual_allocate(void** region, size_t* region_size, uint64 base)
 	return allocation_success;
 }
 
+bool virtual_bind_local_node(void* region, size_t region_size)
+{
+
+	// Pages of an existing region can't be moved to a node, but Windows already
+	// places each page on the node of the thread that first touches it.
+	(void)region;
+	(void)region_size;
+	return false;
+
+}
+
 bool virtual_free(void** region)
 {
 
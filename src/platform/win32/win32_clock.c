@@ -0,0 +1,37 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#pragma warning(suppress : 5105)
+#	include <windows.h>
+#pragma warning(disable : 5105)
+
+#include <sourcery/time/clock.h>
+
+uint64
+platformGetTimeNanoseconds(void)
+{
+
+	// The counter frequency is fixed at boot, so it only needs to be queried once.
+	persist LARGE_INTEGER counter_frequency = {0};
+	if (counter_frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&counter_frequency);
+
+	LARGE_INTEGER counter = {0};
+	QueryPerformanceCounter(&counter);
+
+	// Split the conversion to avoid overflowing the intermediate product.
+	uint64 seconds = (uint64)(counter.QuadPart / counter_frequency.QuadPart);
+	uint64 remainder = (uint64)(counter.QuadPart % counter_frequency.QuadPart);
+	return seconds * NANOSECONDS_PER_SECOND +
+		(remainder * NANOSECONDS_PER_SECOND) / (uint64)counter_frequency.QuadPart;
+
+}
+
+void
+platformSleepMilliseconds(uint32 milliseconds)
+{
+	Sleep(milliseconds);
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#pragma warning(suppress : 5105)
+#	include <windows.h>
+#pragma warning(disable : 5105)
+
+#include <sourcery/filesystem/directory.h>
+
+/**
+ * Win32 has no relative directory opens, so the full path is always used. The
+ * buffer holds the find data for the current entry, and the first entry is
+ * returned by FindFirstFileA() when the directory is opened.
+ */
+
+internal uint32
+win32PathTypeFromAttributes(DWORD attributes)
+{
+	if (attributes & FILE_ATTRIBUTE_REPARSE_POINT) return PLATFORM_PATHTYPE_OTHER;
+	if (attributes & FILE_ATTRIBUTE_DIRECTORY) return PLATFORM_PATHTYPE_DIRECTORY;
+	return PLATFORM_PATHTYPE_FILE;
+}
+
+bool
+platformOpenDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path,
+	void* buffer, size_t buffer_size)
+{
+
+	(void)parent;
+	(void)name;
+
+	// The search pattern is placed after the find data in the buffer.
+	size_t path_length = 0;
+	while (path[path_length] != '\0') path_length++;
+	if (buffer_size < sizeof(WIN32_FIND_DATAA) + path_length + 3)
+		return false;
+
+	char* search_pattern = (char*)buffer + sizeof(WIN32_FIND_DATAA);
+	for (size_t c_index = 0; c_index < path_length; ++c_index)
+		search_pattern[c_index] = path[c_index];
+	search_pattern[path_length + 0] = '\\';
+	search_pattern[path_length + 1] = '*';
+	search_pattern[path_length + 2] = '\0';
+
+	HANDLE win_handle = FindFirstFileA(search_pattern, (WIN32_FIND_DATAA*)buffer);
+	if (win_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	dh->platform_handle_ptr = (size_t)win_handle;
+	dh->platform_handle_size = sizeof(HANDLE);
+	dh->path = path;
+	dh->buffer = (uint8*)buffer;
+	dh->buffer_size = buffer_size;
+	dh->buffer_length = 1; // The first entry is already in the buffer.
+	dh->buffer_offset = 0;
+	dh->end_of_directory = false;
+
+	return true;
+
+}
+
+bool
+platformOpenParentDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path)
+{
+
+	// Win32 can't create relative to a handle, so only the path is kept.
+	(void)parent;
+	(void)name;
+
+	dh->platform_handle_ptr = 0;
+	dh->platform_handle_size = 0;
+	dh->path = path;
+	dh->buffer = NULL;
+	dh->buffer_size = 0;
+	dh->buffer_length = 0;
+	dh->buffer_offset = 0;
+	dh->end_of_directory = true;
+
+	return (platformGetPathType(path) == PLATFORM_PATHTYPE_DIRECTORY);
+
+}
+
+uint32
+platformCreateDirectoryAt(dirhandle* parent, const char* name, const char* path)
+{
+
+	(void)parent;
+	(void)name;
+
+	if (CreateDirectoryA(path, NULL))
+		return PLATFORM_CREATEDIR_CREATED;
+	if (GetLastError() != ERROR_ALREADY_EXISTS)
+		return PLATFORM_CREATEDIR_FAILED;
+
+	DWORD attributes = GetFileAttributesA(path);
+	if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+		return PLATFORM_CREATEDIR_EXISTS;
+	return PLATFORM_CREATEDIR_FAILED;
+
+}
+
+bool
+platformReadDirectory(dirhandle* dh, direntry* entry)
+{
+
+	WIN32_FIND_DATAA* find_data = (WIN32_FIND_DATAA*)dh->buffer;
+	while (!dh->end_of_directory)
+	{
+
+		// Fetch the next entry, unless the pending one hasn't been returned yet.
+		if (dh->buffer_offset >= dh->buffer_length)
+		{
+			if (!FindNextFileA((HANDLE)dh->platform_handle_ptr, find_data))
+			{
+				dh->end_of_directory = true;
+				return false;
+			}
+		}
+		dh->buffer_offset = dh->buffer_length;
+
+		// Skip the self and parent entries.
+		const char* entry_name = find_data->cFileName;
+		if (entry_name[0] == '.' && (entry_name[1] == '\0' ||
+			(entry_name[1] == '.' && entry_name[2] == '\0')))
+			continue;
+
+		entry->name = entry_name;
+		entry->type = win32PathTypeFromAttributes(find_data->dwFileAttributes);
+		return true;
+
+	}
+
+	return false;
+
+}
+
+void
+platformCloseDirectory(dirhandle* dh)
+{
+
+	if (dh->platform_handle_size != 0)
+	{
+		FindClose((HANDLE)dh->platform_handle_ptr);
+		dh->platform_handle_ptr = 0;
+		dh->platform_handle_size = 0;
+	}
+
+}
+
+uint32
+platformGetPathType(const char* path)
+{
+	DWORD attributes = GetFileAttributesA(path);
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return PLATFORM_PATHTYPE_NONE;
+	return (attributes & FILE_ATTRIBUTE_DIRECTORY) ? PLATFORM_PATHTYPE_DIRECTORY : PLATFORM_PATHTYPE_FILE;
+}
+
+uint32
+platformGetPathTypeAt(dirhandle* dh, const char* name)
+{
+
+	// Build the full path on the stack, Win32 paths are limited to MAX_PATH here.
+	char entry_path[MAX_PATH];
+	size_t path_index = 0;
+	for (const char* c = dh->path; *c != '\0' && path_index < MAX_PATH - 2; ++c)
+		entry_path[path_index++] = *c;
+	entry_path[path_index++] = '\\';
+	for (const char* c = name; *c != '\0' && path_index < MAX_PATH - 1; ++c)
+		entry_path[path_index++] = *c;
+	entry_path[path_index] = '\0';
+
+	DWORD attributes = GetFileAttributesA(entry_path);
+	if (attributes == INVALID_FILE_ATTRIBUTES)
+		return PLATFORM_PATHTYPE_NONE;
+	return win32PathTypeFromAttributes(attributes);
+
+}
+
+bool
+platformGetWorkingDirectory(char* buffer, size_t buffer_size)
+{
+	DWORD path_length = GetCurrentDirectoryA((DWORD)buffer_size, buffer);
+	return (path_length != 0 && path_length < buffer_size);
+}
+
+bool
+platformSetWorkingDirectory(const char* path)
+{
+	return (SetCurrentDirectoryA(path) != 0);
+}
+
+#endif
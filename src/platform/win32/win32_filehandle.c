@@ -11,8 +11,16 @@
 #	include <windows.h>
 #pragma warning(disable : 5105)
 
+#include <io.h>
+#include <stdio.h>
+
 #include <sourcery/filehandle.h>
 
+/**
+ * The C runtime descriptor standard output was duplicated onto while it's claimed.
+ */
+persist int win32_claimed_stdout = -1;
+
 int32
 platformOpenFile(filehandle* fh, const char* file_path, uint32_t file_context, uint32_t file_mode)
 {
@@ -33,7 +41,7 @@ platformOpenFile(filehandle* fh, const char* file_path, uint32_t file_context, u
 	else if (file_context == PLATFORM_FILECONTEXT_EXISTING)
 		creation_disposition = OPEN_EXISTING;
 	else if (file_context == PLATFORM_FILECONTEXT_ALWAYS)
-		creation_disposition = OPEN_ALWAYS;
+		creation_disposition = (file_mode == PLATFORM_FILEMODE_TRUNCATE) ? CREATE_ALWAYS : OPEN_ALWAYS;
 	else if (file_mode == PLATFORM_FILEMODE_TRUNCATE) // NOTE(Chris): Special condition.
 		creation_disposition = CREATE_ALWAYS;
 	else
@@ -64,13 +72,83 @@ platformOpenFile(filehandle* fh, const char* file_path, uint32_t file_context, u
 
 }
 
+int32
+platformOpenStandardInput(filehandle* fh)
+{
+
+	// Standard input is owned by the process, we only borrow the handle.
+	HANDLE win_handle = GetStdHandle(STD_INPUT_HANDLE);
+	if (win_handle == INVALID_HANDLE_VALUE || win_handle == NULL)
+		return PLATFORM_FILEOPEN_FAILED;
+
+	fh->context = PLATFORM_FILECONTEXT_STREAM;
+	fh->mode = PLATFORM_FILEMODE_READONLY;
+	fh->platform_handle_size = sizeof(HANDLE);
+	fh->platform_handle_ptr = (size_t)win_handle;
+	fh->file_size = 0;
+	fh->read_ptr = 0;
+	fh->write_ptr = 0;
+
+	return PLATFORM_FILEOPEN_SUCCESS;
+
+}
+
+int32
+platformClaimStandardOutput(filehandle* fh)
+{
+
+	// Both the C runtime's descriptor and the process's handle are redirected, the
+	// first for our own writes and the second for the processes we start.
+	int crt_handle = _dup(_fileno(stdout));
+	if (crt_handle < 0)
+		return PLATFORM_FILEOPEN_FAILED;
+	HANDLE win_handle = (HANDLE)_get_osfhandle(crt_handle);
+	if (_dup2(_fileno(stderr), _fileno(stdout)) != 0)
+	{
+		_close(crt_handle);
+		return PLATFORM_FILEOPEN_FAILED;
+	}
+	SetStdHandle(STD_OUTPUT_HANDLE, GetStdHandle(STD_ERROR_HANDLE));
+	win32_claimed_stdout = crt_handle;
+
+	fh->context = PLATFORM_FILECONTEXT_STREAM;
+	fh->mode = PLATFORM_FILEMODE_APPEND;
+	fh->platform_handle_size = sizeof(HANDLE);
+	fh->platform_handle_ptr = (size_t)win_handle;
+	fh->file_size = 0;
+	fh->read_ptr = 0;
+	fh->write_ptr = 0;
+
+	return PLATFORM_FILEOPEN_SUCCESS;
+
+}
+
+void
+platformReleaseStandardOutput(filehandle* fh)
+{
+
+	if (fh->platform_handle_size != 0 && win32_claimed_stdout >= 0)
+	{
+		fflush(stdout);
+		_dup2(win32_claimed_stdout, _fileno(stdout));
+		SetStdHandle(STD_OUTPUT_HANDLE, (HANDLE)_get_osfhandle(_fileno(stdout)));
+		_close(win32_claimed_stdout);
+		win32_claimed_stdout = -1;
+		fh->platform_handle_ptr = 0;
+		fh->platform_handle_size = 0;
+	}
+
+}
+
 void
 platformCloseFile(filehandle* fh)
 {
 
 	if (fh->platform_handle_ptr != 0)
 	{
-		CloseHandle((HANDLE)fh->platform_handle_ptr);
+		// Streams are borrowed from the process, so they aren't ours to close.
+		if (fh->context != PLATFORM_FILECONTEXT_STREAM)
+			CloseHandle((HANDLE)fh->platform_handle_ptr);
 		fh->platform_handle_ptr = 0;
 		fh->platform_handle_size = 0;
 	}
@@ -81,14 +159,18 @@ size_t
 platformReadFile(filehandle* fh, void* buffer, size_t buffer_size)
 {
 
-	// First, we must set the read pointer to the last known read position.
-	LARGE_INTEGER offset_position = {0};
-	offset_position.QuadPart = (LONGLONG)fh->read_ptr;
-	LARGE_INTEGER ending_position = {0};
-	BOOL setfp_status = SetFilePointerEx((HANDLE)fh->platform_handle_ptr, offset_position,
-		&ending_position, FILE_BEGIN);
-	fh->read_ptr = (size_t)ending_position.QuadPart; // Ensures that the last position is correct.
-	assert(setfp_status != 0);
+	// First, we must set the read pointer to the last known read position. Streams
+	// can't be seeked and are always read from wherever they currently are.
+	if (fh->context != PLATFORM_FILECONTEXT_STREAM)
+	{
+		LARGE_INTEGER offset_position = {0};
+		offset_position.QuadPart = (LONGLONG)fh->read_ptr;
+		LARGE_INTEGER ending_position = {0};
+		BOOL setfp_status = SetFilePointerEx((HANDLE)fh->platform_handle_ptr, offset_position,
+			&ending_position, FILE_BEGIN);
+		fh->read_ptr = (size_t)ending_position.QuadPart; // Ensures that the last position is correct.
+		assert(setfp_status != 0);
+	}
 
 	// Continually read into the buffer until we have reached buffer size or reach EOF.
 	DWORD total_read = 0;
@@ -99,7 +181,7 @@ platformReadFile(filehandle* fh, void* buffer, size_t buffer_size)
 		// Read in the bytes into the buffer.
 		DWORD bytes_read = 0;
 		read_status = ReadFile((HANDLE)fh->platform_handle_ptr,
-			buffer, buffer_size - total_read, &bytes_read, NULL);
+			(uint8*)buffer + total_read, buffer_size - total_read, &bytes_read, NULL);
 		total_read += bytes_read;
 
 		// If we read zero bytes, we are probably EOF.
@@ -119,6 +201,22 @@ size_t
 platformWriteFile(filehandle* fh, void* buffer, size_t buffer_size)
 {
 
+	// Streams can't be positioned, they're only ever appended to.
+	if (fh->context == PLATFORM_FILECONTEXT_STREAM)
+	{
+		DWORD stream_written = 0;
+		while (stream_written < buffer_size)
+		{
+			DWORD bytes_written = 0;
+			if (!WriteFile((HANDLE)fh->platform_handle_ptr, (uint8*)buffer + stream_written,
+				(DWORD)(buffer_size - stream_written), &bytes_written, NULL) || bytes_written == 0)
+				break;
+			stream_written += bytes_written;
+		}
+		fh->write_ptr += stream_written;
+		return stream_written;
+	}
+
 	// We need to ensure that our write pointer is at the last known right position.
 	LARGE_INTEGER offset_position = {0};
 	offset_position.QuadPart = (LONGLONG)fh->write_ptr;
@@ -155,6 +253,118 @@ platformWriteFile(filehandle* fh, void* buffer, size_t buffer_size)
 
 }
 
+size_t
+platformCopyFileRange(filehandle* destination, filehandle* source, size_t source_offset, size_t size)
+{
+
+	// Windows can only clone whole clusters on ReFS, so every range is written by
+	// the caller instead.
+	(void)destination;
+	(void)source;
+	(void)source_offset;
+	(void)size;
+	return 0;
+
+}
+
+int32
+platformCloneFile(filehandle* destination, filehandle* source)
+{
+
+	// Block cloning is limited to ReFS and whole clusters, so files are copied.
+	(void)destination;
+	(void)source;
+	return false;
+
+}
+
+int32
+platformSyncFile(filehandle* fh)
+{
+	return (FlushFileBuffers((HANDLE)fh->platform_handle_ptr) != 0);
+}
+
+int32
+platformSyncFilesystems(char** paths, uint32 path_count)
+{
+
+	// Flushing a whole volume takes administrator rights, so each file is flushed.
+	bool synced = true;
+	for (uint32 path_index = 0; path_index < path_count; ++path_index)
+	{
+		HANDLE win_handle = CreateFileA(paths[path_index], GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE,
+			NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (win_handle == INVALID_HANDLE_VALUE)
+		{
+			synced = false;
+			continue;
+		}
+		if (!FlushFileBuffers(win_handle))
+			synced = false;
+		CloseHandle(win_handle);
+	}
+	return synced;
+
+}
+
+/**
+ * Fills out a stamp from a file's information.
+ */
+internal void
+win32StampFromInformation(BY_HANDLE_FILE_INFORMATION* information, file_stamp* stamp)
+{
+
+	stamp->device = (uint64)information->dwVolumeSerialNumber;
+	stamp->index = ((uint64)information->nFileIndexHigh << 32) | (uint64)information->nFileIndexLow;
+	stamp->size = ((uint64)information->nFileSizeHigh << 32) | (uint64)information->nFileSizeLow;
+	stamp->modified_time = ((uint64)information->ftLastWriteTime.dwHighDateTime << 32) |
+		(uint64)information->ftLastWriteTime.dwLowDateTime;
+
+}
+
+int32
+platformGetFileStamp(filehandle* fh, file_stamp* stamp)
+{
+
+	BY_HANDLE_FILE_INFORMATION information = {0};
+	if (!GetFileInformationByHandle((HANDLE)fh->platform_handle_ptr, &information))
+		return false;
+
+	win32StampFromInformation(&information, stamp);
+	return true;
+
+}
+
+int32
+platformGetPathStamp(const char* file_path, file_stamp* stamp)
+{
+
+	// A handle without any access is enough to query the file, and doesn't conflict
+	// with whoever else has it open.
+	HANDLE win_handle = CreateFileA(file_path, 0, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (win_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	BY_HANDLE_FILE_INFORMATION information = {0};
+	bool stamped = (GetFileInformationByHandle(win_handle, &information) != 0);
+	CloseHandle(win_handle);
+	if (stamped)
+		win32StampFromInformation(&information, stamp);
+	return stamped;
+
+}
+
+int32
+platformPrefetchFile(filehandle* fh)
+{
+
+	// There's no hint to read a file ahead, so it's read when it's needed.
+	(void)fh;
+	return false;
+
+}
+
 int
 platformCreateDirectory(const char* file_path)
 {
@@ -166,4 +376,16 @@ platformCreateDirectory(const char* file_path)
 
 }
 
+bool
+platformRenameFile(const char* source_path, const char* destination_path)
+{
+	return (MoveFileExA(source_path, destination_path, MOVEFILE_REPLACE_EXISTING) != 0);
+}
+
+bool
+platformRemoveFile(const char* file_path)
+{
+	return (DeleteFileA(file_path) != 0);
+}
+
 #endif
\ No newline at end of file
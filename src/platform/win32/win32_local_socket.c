@@ -0,0 +1,89 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#include <sourcery/ipc/local_socket.h>
+
+/**
+ * Handing a client's console handles over to another process isn't supported on
+ * Win32 yet, so a daemon can't be started or connected to. The client falls back
+ * to running the request itself when it can't connect.
+ */
+
+bool
+platformGetLocalSocketDirectory(char* buffer, size_t buffer_size)
+{
+	(void)buffer;
+	(void)buffer_size;
+	return false;
+}
+
+bool
+platformListenLocalSocket(localsocket* listener, const char* socket_path)
+{
+	(void)listener;
+	(void)socket_path;
+	return false;
+}
+
+bool
+platformAcceptLocalSocket(localsocket* listener, localsocket* connection)
+{
+	(void)listener;
+	(void)connection;
+	return false;
+}
+
+bool
+platformConnectLocalSocket(localsocket* connection, const char* socket_path)
+{
+	(void)connection;
+	(void)socket_path;
+	return false;
+}
+
+bool
+platformSendLocalSocket(localsocket* connection, const void* buffer, size_t buffer_size,
+	bool attach_standard_handles)
+{
+	(void)connection;
+	(void)buffer;
+	(void)buffer_size;
+	(void)attach_standard_handles;
+	return false;
+}
+
+bool
+platformReceiveLocalSocket(localsocket* connection, void* buffer, size_t buffer_size,
+	standard_handles* handles)
+{
+	(void)connection;
+	(void)buffer;
+	(void)buffer_size;
+	if (handles != NULL)
+		handles->valid = false;
+	return false;
+}
+
+void
+platformCloseLocalSocket(localsocket* socket, const char* socket_path)
+{
+	(void)socket;
+	(void)socket_path;
+}
+
+bool
+platformSwapStandardHandles(standard_handles* handles, standard_handles* previous)
+{
+	(void)handles;
+	(void)previous;
+	return false;
+}
+
+void
+platformReleaseStandardHandles(standard_handles* handles)
+{
+	handles->valid = false;
+}
+
+#endif
@@ -0,0 +1,33 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#include <sourcery/perf/perf_counters.h>
+
+/**
+ * Win32 only exposes hardware counters through ETW, which needs administrator
+ * rights and a trace session. Until that is worth the trouble, none are available.
+ */
+
+bool
+platformOpenPerfCounters(perf_counters* counters)
+{
+	*counters = (perf_counters){0};
+	return false;
+}
+
+bool
+platformReadPerfCounters(perf_counters* counters, perf_sample* sample)
+{
+	(void)counters;
+	*sample = (perf_sample){0};
+	return false;
+}
+
+void
+platformClosePerfCounters(perf_counters* counters)
+{
+	(void)counters;
+}
+
+#endif
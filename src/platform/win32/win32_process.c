@@ -4,10 +4,22 @@
 
 #pragma warning(suppress : 5105)
 #	include <windows.h>
+#	include <psapi.h>
 #pragma warning(disable : 5105)
 
+#include <sourcery/time/clock.h>
+
+/**
+ * FILETIME durations are in 100 nanosecond intervals.
+ */
+internal uint64
+win32FiletimeToNanoseconds(FILETIME time)
+{
+	return ((((uint64)time.dwHighDateTime) << 32) | (uint64)time.dwLowDateTime) * 100;
+}
+
 int
-platformRunCLIProcess(char* invoc)
+platformRunCLIProcess(char* invoc, process_stats* stats)
 {
 
 	// I totally kidnapped this from Microsoft Docs, lol
@@ -15,6 +27,8 @@ platformRunCLIProcess(char* invoc)
 	PROCESS_INFORMATION pi = {0};
 	si.cb = sizeof(si);
 
+	uint64 start_time = platformGetTimeNanoseconds();
+
 	if (!CreateProcessA(NULL, invoc, NULL, NULL,
 		FALSE, 0, NULL, NULL, &si, &pi))
 	{
@@ -23,11 +37,164 @@ platformRunCLIProcess(char* invoc)
 
 	WaitForSingleObject(pi.hProcess, INFINITE);
 
+	DWORD exit_code = 0;
+	if (!GetExitCodeProcess(pi.hProcess, &exit_code))
+		exit_code = (DWORD)-1;
+
+	if (stats != NULL)
+	{
+		stats->exit_code = (int32)exit_code;
+		stats->wall_nanoseconds = platformGetTimeNanoseconds() - start_time;
+
+		FILETIME creation_time, exit_time, kernel_time, user_time;
+		if (GetProcessTimes(pi.hProcess, &creation_time, &exit_time, &kernel_time, &user_time))
+		{
+			stats->user_nanoseconds = win32FiletimeToNanoseconds(user_time);
+			stats->system_nanoseconds = win32FiletimeToNanoseconds(kernel_time);
+		}
+
+		PROCESS_MEMORY_COUNTERS memory_counters = {0};
+		if (K32GetProcessMemoryInfo(pi.hProcess, &memory_counters, sizeof(memory_counters)))
+			stats->max_resident_kilobytes = (uint64)memory_counters.PeakWorkingSetSize / 1024;
+
+		IO_COUNTERS io_counters = {0};
+		if (GetProcessIoCounters(pi.hProcess, &io_counters))
+		{
+			stats->input_blocks = io_counters.ReadOperationCount;
+			stats->output_blocks = io_counters.WriteOperationCount;
+		}
+	}
+
 	CloseHandle(pi.hProcess);
 	CloseHandle(pi.hThread);
 
-	return 0;
+	return (int)exit_code;
+
+}
+
+#define WIN32_CAPTURE_PROCESS 	0
+#define WIN32_CAPTURE_OUTPUT 	1
+
+bool
+platformStartCaptureProcess(process_capture* capture, char* invoc)
+{
+
+	// Only the write end is inheritable. It's closed as soon as the child has its
+	// copy, so captures started after it can't inherit it and hold it open.
+	SECURITY_ATTRIBUTES security = {0};
+	security.nLength = sizeof(security);
+	security.bInheritHandle = TRUE;
+
+	HANDLE output_read = NULL;
+	HANDLE output_write = NULL;
+	if (!CreatePipe(&output_read, &output_write, &security, 0))
+		return false;
+	SetHandleInformation(output_read, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOA si = {0};
+	PROCESS_INFORMATION pi = {0};
+	si.cb = sizeof(si);
+	si.dwFlags = STARTF_USESTDHANDLES;
+	si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+	si.hStdOutput = output_write;
+	si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+	uint64 start_time = platformGetTimeNanoseconds();
+	BOOL created = CreateProcessA(NULL, invoc, NULL, NULL, TRUE, 0, NULL, NULL, &si, &pi);
+	CloseHandle(output_write);
+	if (!created)
+	{
+		CloseHandle(output_read);
+		return false;
+	}
+	CloseHandle(pi.hThread);
+
+	capture->platform_handles[WIN32_CAPTURE_PROCESS] = (size_t)pi.hProcess;
+	capture->platform_handles[WIN32_CAPTURE_OUTPUT] = (size_t)output_read;
+	capture->running = true;
+	capture->start_time = start_time;
+	return true;
 
 }
 
-#endif
+int
+platformFinishCaptureProcess(process_capture* capture, char* buffer, size_t buffer_size,
+	size_t* output_size, process_stats* stats)
+{
+
+	HANDLE process = (HANDLE)capture->platform_handles[WIN32_CAPTURE_PROCESS];
+	HANDLE output_read = (HANDLE)capture->platform_handles[WIN32_CAPTURE_OUTPUT];
+
+	// A broken pipe is the child closing its end.
+	char discard_buffer[4096];
+	size_t total_size = 0;
+	while (true)
+	{
+		char* read_buffer = buffer + total_size;
+		DWORD read_size = (DWORD)min(buffer_size - total_size, 0x40000000);
+		if (total_size >= buffer_size)
+		{
+			read_buffer = discard_buffer;
+			read_size = sizeof(discard_buffer);
+		}
+
+		DWORD bytes_read = 0;
+		if (!ReadFile(output_read, read_buffer, read_size, &bytes_read, NULL) || bytes_read == 0)
+			break;
+		total_size += bytes_read;
+	}
+	CloseHandle(output_read);
+
+	WaitForSingleObject(process, INFINITE);
+
+	DWORD exit_code = 0;
+	if (!GetExitCodeProcess(process, &exit_code))
+		exit_code = (DWORD)-1;
+
+	if (stats != NULL)
+	{
+		stats->exit_code = (int32)exit_code;
+		stats->wall_nanoseconds = platformGetTimeNanoseconds() - capture->start_time;
+
+		FILETIME creation_time, exit_time, kernel_time, user_time;
+		if (GetProcessTimes(process, &creation_time, &exit_time, &kernel_time, &user_time))
+		{
+			stats->user_nanoseconds = win32FiletimeToNanoseconds(user_time);
+			stats->system_nanoseconds = win32FiletimeToNanoseconds(kernel_time);
+		}
+	}
+
+	CloseHandle(process);
+	capture->running = false;
+	*output_size = total_size;
+	return (int)exit_code;
+
+}
+
+/**
+ * Sessions aren't supported since commands are created directly rather than
+ * through a shell, so callers fall back to platformRunCLIProcess().
+ */
+bool
+platformOpenShellSession(shell_session* session)
+{
+	(void)session;
+	return false;
+}
+
+int
+platformRunShellCommand(shell_session* session, char* invoc, process_stats* stats)
+{
+	(void)session;
+	(void)invoc;
+	(void)stats;
+	return -1;
+}
+
+void
+platformCloseShellSession(shell_session* session)
+{
+	(void)session;
+}
+
+#endif
\ No newline at end of file
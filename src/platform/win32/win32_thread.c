@@ -0,0 +1,114 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#pragma warning(suppress : 5105)
+#	include <windows.h>
+#pragma warning(disable : 5105)
+
+#include <sourcery/thread/thread.h>
+
+internal DWORD WINAPI
+win32ThreadTrampoline(LPVOID parameter)
+{
+	platform_thread* thread = (platform_thread*)parameter;
+	thread->proc(thread->user_data);
+	return 0;
+}
+
+bool
+platformCreateThread(platform_thread* thread, threadproc proc, void* user_data)
+{
+
+	thread->proc = proc;
+	thread->user_data = user_data;
+
+	HANDLE win_handle = CreateThread(NULL, 0, win32ThreadTrampoline, thread, 0, NULL);
+	if (win_handle == NULL)
+		return false;
+
+	thread->platform_handle_ptr = (size_t)win_handle;
+	return true;
+
+}
+
+void
+platformJoinThread(platform_thread* thread)
+{
+
+	if (thread->platform_handle_ptr != 0)
+	{
+		WaitForSingleObject((HANDLE)thread->platform_handle_ptr, INFINITE);
+		CloseHandle((HANDLE)thread->platform_handle_ptr);
+		thread->platform_handle_ptr = 0;
+	}
+
+}
+
+uint32
+platformGetProcessorCount(void)
+{
+	SYSTEM_INFO system_info = {0};
+	GetSystemInfo(&system_info);
+	return (system_info.dwNumberOfProcessors > 0) ? (uint32)system_info.dwNumberOfProcessors : 1;
+}
+
+// Slim reader/writer locks and condition variables are both pointer sized.
+void
+platformCreateMutex(platform_mutex* mutex)
+{
+	InitializeSRWLock((PSRWLOCK)mutex->platform_storage);
+}
+
+void
+platformLockMutex(platform_mutex* mutex)
+{
+	AcquireSRWLockExclusive((PSRWLOCK)mutex->platform_storage);
+}
+
+void
+platformUnlockMutex(platform_mutex* mutex)
+{
+	ReleaseSRWLockExclusive((PSRWLOCK)mutex->platform_storage);
+}
+
+void
+platformDestroyMutex(platform_mutex* mutex)
+{
+	// SRW locks don't need to be released.
+	(void)mutex;
+}
+
+void
+platformCreateCondition(platform_condition* condition)
+{
+	InitializeConditionVariable((PCONDITION_VARIABLE)condition->platform_storage);
+}
+
+void
+platformDestroyCondition(platform_condition* condition)
+{
+	// Condition variables don't need to be released.
+	(void)condition;
+}
+
+void
+platformWaitCondition(platform_condition* condition, platform_mutex* mutex)
+{
+	SleepConditionVariableSRW((PCONDITION_VARIABLE)condition->platform_storage,
+		(PSRWLOCK)mutex->platform_storage, INFINITE, 0);
+}
+
+void
+platformSignalCondition(platform_condition* condition)
+{
+	WakeConditionVariable((PCONDITION_VARIABLE)condition->platform_storage);
+}
+
+void
+platformBroadcastCondition(platform_condition* condition)
+{
+	WakeAllConditionVariable((PCONDITION_VARIABLE)condition->platform_storage);
+}
+
+#endif
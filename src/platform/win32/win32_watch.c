@@ -0,0 +1,90 @@
+#include <sourcery/generics.h>
+
+#if defined(PLATFORM_WINDOWS)
+
+#pragma warning(suppress : 5105)
+#	include <windows.h>
+#pragma warning(disable : 5105)
+
+#include <sourcery/filesystem/watch.h>
+
+/**
+ * Change notification handles are kept in the caller's buffer so they can be
+ * waited on together. They don't report which entry changed, so every event has
+ * a NULL name and covers the whole directory.
+ */
+
+bool
+platformCreateWatch(filewatch* watch, void* buffer, size_t buffer_size)
+{
+
+	watch->platform_handle_ptr = 0;
+	watch->platform_handle_size = sizeof(HANDLE);
+	watch->buffer = (uint8*)buffer;
+	watch->buffer_size = buffer_size;
+	watch->buffer_length = 0;
+	watch->buffer_offset = 0;
+	watch->watch_count = 0;
+
+	return true;
+
+}
+
+bool
+platformAddWatch(filewatch* watch, const char* directory_path, uint32* watch_id)
+{
+
+	HANDLE* watch_handles = (HANDLE*)watch->buffer;
+	size_t watch_capacity = watch->buffer_size / sizeof(HANDLE);
+	if (watch->watch_count >= watch_capacity || watch->watch_count >= MAXIMUM_WAIT_OBJECTS)
+		return false;
+
+	HANDLE win_handle = FindFirstChangeNotificationA(directory_path, FALSE,
+		FILE_NOTIFY_CHANGE_LAST_WRITE|FILE_NOTIFY_CHANGE_FILE_NAME|FILE_NOTIFY_CHANGE_SIZE);
+	if (win_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	watch_handles[watch->watch_count] = win_handle;
+	*watch_id = watch->watch_count++;
+	return true;
+
+}
+
+bool
+platformReadWatch(filewatch* watch, uint32 timeout_milliseconds, watchevent* event)
+{
+
+	HANDLE* watch_handles = (HANDLE*)watch->buffer;
+	if (watch->watch_count == 0)
+	{
+		Sleep(timeout_milliseconds);
+		return false;
+	}
+
+	DWORD wait_status = WaitForMultipleObjects(watch->watch_count, watch_handles, FALSE, timeout_milliseconds);
+	if (wait_status < WAIT_OBJECT_0 || wait_status >= WAIT_OBJECT_0 + watch->watch_count)
+		return false;
+
+	// Re-arm the notification before reporting it so nothing is missed.
+	uint32 watch_index = (uint32)(wait_status - WAIT_OBJECT_0);
+	FindNextChangeNotification(watch_handles[watch_index]);
+
+	event->watch_id = watch_index;
+	event->name = NULL;
+	return true;
+
+}
+
+void
+platformDestroyWatch(filewatch* watch)
+{
+
+	HANDLE* watch_handles = (HANDLE*)watch->buffer;
+	for (uint32 watch_index = 0; watch_index < watch->watch_count; ++watch_index)
+		FindCloseChangeNotification(watch_handles[watch_index]);
+	watch->watch_count = 0;
+	watch->platform_handle_size = 0;
+
+}
+
+#endif
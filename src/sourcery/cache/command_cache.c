@@ -0,0 +1,375 @@
+#include <sourcery/cache/command_cache.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/string/string_utils.h>
+
+internal bool
+commandCacheIsSpace(char c)
+{
+	return (c == ' ' || c == '\t');
+}
+
+bool
+commandCacheParse(char* directive, command_cache_spec* spec)
+{
+
+	command_cache_spec empty_spec = {0};
+	*spec = empty_spec;
+
+	char* cursor = directive;
+	while (true)
+	{
+
+		while (commandCacheIsSpace(*cursor))
+			cursor++;
+
+		// Only a brace group naming one of the annotations is an annotation, anything
+		// else begins the command.
+		char** paths = NULL;
+		uint32* path_count = NULL;
+		size_t name_length = 0;
+		if (cursor[0] == '{' && cursor[1] == 'i' && cursor[2] == 'n' && cursor[3] == ':')
+		{
+			paths = spec->inputs;
+			path_count = &spec->input_count;
+			name_length = 4;
+		}
+		else if (cursor[0] == '{' && cursor[1] == 'o' && cursor[2] == 'u' && cursor[3] == 't' && cursor[4] == ':')
+		{
+			paths = spec->outputs;
+			path_count = &spec->output_count;
+			name_length = 5;
+		}
+		else if (cursor[0] == '{' && cursor[1] == 'e' && cursor[2] == 'n' && cursor[3] == 'v' && cursor[4] == ':')
+		{
+			paths = spec->environment;
+			path_count = &spec->environment_count;
+			name_length = 5;
+		}
+		else
+		{
+			break;
+		}
+
+		char* group_end = cursor + name_length;
+		while (*group_end != '\0' && *group_end != '}')
+			group_end++;
+		if (*group_end == '\0')
+			break;
+		*group_end = '\0';
+
+		char* token = cursor + name_length;
+		while (*token != '\0')
+		{
+			while (commandCacheIsSpace(*token))
+				*token++ = '\0';
+			if (*token == '\0')
+				break;
+
+			if (*path_count < COMMAND_CACHE_MAX_PATHS)
+				paths[(*path_count)++] = token;
+			while (*token != '\0' && !commandCacheIsSpace(*token))
+				token++;
+		}
+
+		cursor = group_end + 1;
+
+	}
+
+	spec->command = cursor;
+	return (spec->output_count > 0);
+
+}
+
+/**
+ * Continues a digest with a string and its terminator, so that neighbouring strings
+ * can't run together.
+ */
+internal void
+commandCacheHashString(hash_sha256* hash, const char* string)
+{
+	hashSha256Update(hash, string, strLength(string) + 1);
+}
+
+/**
+ * Continues a digest with the contents of a file.
+ */
+internal bool
+commandCacheHashFile(hash_sha256* hash, const char* path, uint8* buffer, uint64* file_size)
+{
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	uint64 total_read = 0;
+	size_t bytes_read = 0;
+	while ((bytes_read = platformReadFile(&fh, buffer, COMMAND_CACHE_CHUNK_SIZE)) > 0)
+	{
+		hashSha256Update(hash, buffer, bytes_read);
+		total_read += bytes_read;
+	}
+	platformCloseFile(&fh);
+
+	if (file_size != NULL)
+		*file_size = total_read;
+	return true;
+
+}
+
+bool
+commandCacheComputeKey(mem_arena* arena, command_cache_spec* spec, command_cache_key* key)
+{
+
+	size_t stash_point = arena_stash(arena);
+	uint8* buffer = arena_push_array(arena, uint8, COMMAND_CACHE_CHUNK_SIZE);
+
+	hash_sha256 hash;
+	hashSha256Begin(&hash);
+
+	uint32 version = COMMAND_CACHE_VERSION;
+	hashSha256Update(&hash, &version, sizeof(version));
+	commandCacheHashString(&hash, spec->command);
+
+	// The command resolves programs through PATH, so it always takes part.
+	const char* path_value = getenv("PATH");
+	commandCacheHashString(&hash, path_value ? path_value : "");
+	for (uint32 environment_index = 0; environment_index < spec->environment_count; ++environment_index)
+	{
+		const char* value = getenv(spec->environment[environment_index]);
+		commandCacheHashString(&hash, spec->environment[environment_index]);
+		commandCacheHashString(&hash, value ? value : "");
+	}
+
+	for (uint32 output_index = 0; output_index < spec->output_count; ++output_index)
+		commandCacheHashString(&hash, spec->outputs[output_index]);
+
+	// Each input's size is hashed ahead of its contents, so that the boundary
+	// between one input and the next is fixed.
+	bool inputs_read = true;
+	for (uint32 input_index = 0; input_index < spec->input_count && inputs_read; ++input_index)
+	{
+		commandCacheHashString(&hash, spec->inputs[input_index]);
+		hash_sha256 input_hash;
+		hashSha256Begin(&input_hash);
+		uint64 input_size = 0;
+		inputs_read = commandCacheHashFile(&input_hash, spec->inputs[input_index], buffer, &input_size);
+
+		uint8 input_digest[HASH_SHA256_SIZE];
+		hashSha256Finish(&input_hash, input_digest);
+		hashSha256Update(&hash, &input_size, sizeof(input_size));
+		hashSha256Update(&hash, input_digest, sizeof(input_digest));
+	}
+
+	uint8 digest[HASH_SHA256_SIZE];
+	hashSha256Finish(&hash, digest);
+	hashSha256Format(digest, key->text);
+
+	arena_restore(arena, stash_point);
+	return inputs_read;
+
+}
+
+/**
+ * Copies a file through the commit, which never leaves the destination partially
+ * written.
+ */
+internal bool
+commandCacheCopyFile(file_commit* commit, uint8* buffer, const char* source_path, const char* destination_path)
+{
+
+	filehandle source = {0};
+	if (!platformOpenFile(&source, source_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	commit_file destination = {0};
+	if (!fileCommitOpen(commit, &destination, destination_path, true))
+	{
+		platformCloseFile(&source);
+		return false;
+	}
+
+	size_t bytes_read = 0;
+	while (!destination.write_failed && (bytes_read = platformReadFile(&source, buffer, COMMAND_CACHE_CHUNK_SIZE)) > 0)
+		fileCommitWrite(&destination, buffer, bytes_read);
+
+	platformCloseFile(&source);
+	return fileCommitClose(commit, &destination, true);
+
+}
+
+bool
+commandCacheRestore(mem_arena* arena, file_commit* commit, command_cache_spec* spec, command_cache_key* key)
+{
+
+	char manifest_path[COMMAND_CACHE_PATH_SIZE];
+	snprintf(manifest_path, sizeof(manifest_path), "%s/%s", COMMAND_CACHE_COMMANDS, key->text);
+
+	filehandle manifest_fh = {0};
+	if (!platformOpenFile(&manifest_fh, manifest_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	size_t stash_point = arena_stash(arena);
+	char* manifest = arena_push_array_zero(arena, char, COMMAND_CACHE_MANIFEST_SIZE + 1);
+	uint8* buffer = arena_push_array(arena, uint8, COMMAND_CACHE_CHUNK_SIZE);
+	size_t manifest_length = platformReadFile(&manifest_fh, manifest, COMMAND_CACHE_MANIFEST_SIZE);
+	manifest[manifest_length] = '\0';
+	platformCloseFile(&manifest_fh);
+
+	// The manifest lists an object for each output, in the order they were declared.
+	// Every object is checked before any output is touched.
+	char* object_names[COMMAND_CACHE_MAX_PATHS];
+	uint32 object_count = 0;
+	bool manifest_valid = true;
+
+	int version = 0;
+	int header_length = 0;
+	if (sscanf(manifest, "sourcery-cache %d\n%n", &version, &header_length) != 1 ||
+		version != COMMAND_CACHE_VERSION || header_length <= 0)
+	{
+		manifest_valid = false;
+	}
+
+	char* line = manifest + (manifest_valid ? header_length : 0);
+	while (manifest_valid && *line != '\0' && object_count < COMMAND_CACHE_MAX_PATHS)
+	{
+		char* line_end = line;
+		while (*line_end != '\0' && *line_end != '\n')
+			line_end++;
+		if (*line_end == '\0')
+		{
+			manifest_valid = false;
+			break;
+		}
+		*line_end = '\0';
+
+		// Each line is "<object> <size> <output>".
+		char* object_name = line;
+		char* size_text = object_name;
+		while (*size_text != '\0' && *size_text != ' ')
+			size_text++;
+		if (*size_text == '\0')
+		{
+			manifest_valid = false;
+			break;
+		}
+		*size_text++ = '\0';
+
+		char* output_path = size_text;
+		while (*output_path != '\0' && *output_path != ' ')
+			output_path++;
+		if (*output_path == '\0')
+		{
+			manifest_valid = false;
+			break;
+		}
+		*output_path++ = '\0';
+
+		char object_path[COMMAND_CACHE_PATH_SIZE];
+		snprintf(object_path, sizeof(object_path), "%s/%s", COMMAND_CACHE_OBJECTS, object_name);
+
+		filehandle object_fh = {0};
+		if (object_count >= spec->output_count || !strEquals(output_path, spec->outputs[object_count]) ||
+			!platformOpenFile(&object_fh, object_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		{
+			manifest_valid = false;
+			break;
+		}
+
+		unsigned long long object_size = strtoull(size_text, NULL, 10);
+		manifest_valid = (object_fh.file_size == object_size);
+		platformCloseFile(&object_fh);
+
+		object_names[object_count++] = object_name;
+		line = line_end + 1;
+	}
+
+	manifest_valid = manifest_valid && (object_count == spec->output_count);
+	for (uint32 object_index = 0; object_index < object_count && manifest_valid; ++object_index)
+	{
+		char object_path[COMMAND_CACHE_PATH_SIZE];
+		snprintf(object_path, sizeof(object_path), "%s/%s", COMMAND_CACHE_OBJECTS, object_names[object_index]);
+		manifest_valid = commandCacheCopyFile(commit, buffer, object_path, spec->outputs[object_index]);
+	}
+
+	arena_restore(arena, stash_point);
+	return manifest_valid;
+
+}
+
+bool
+commandCacheStore(mem_arena* arena, file_commit* commit, command_cache_spec* spec, command_cache_key* key)
+{
+
+	platformCreateDirectory(COMMAND_CACHE_ROOT);
+	platformCreateDirectory(COMMAND_CACHE_DIRECTORY);
+	platformCreateDirectory(COMMAND_CACHE_OBJECTS);
+	platformCreateDirectory(COMMAND_CACHE_COMMANDS);
+
+	size_t stash_point = arena_stash(arena);
+	char* manifest = arena_push_array_zero(arena, char, COMMAND_CACHE_MANIFEST_SIZE);
+	uint8* buffer = arena_push_array(arena, uint8, COMMAND_CACHE_CHUNK_SIZE);
+	int manifest_length = snprintf(manifest, COMMAND_CACHE_MANIFEST_SIZE, "sourcery-cache %d\n", COMMAND_CACHE_VERSION);
+
+	// Objects are named by the digest of their contents, so an object that's already
+	// stored whole is already correct and outputs shared between commands are only
+	// stored once.
+	bool stored = true;
+	for (uint32 output_index = 0; output_index < spec->output_count && stored; ++output_index)
+	{
+		hash_sha256 object_hash;
+		hashSha256Begin(&object_hash);
+		uint64 object_size = 0;
+		if (!commandCacheHashFile(&object_hash, spec->outputs[output_index], buffer, &object_size))
+		{
+			stored = false;
+			break;
+		}
+
+		uint8 object_digest[HASH_SHA256_SIZE];
+		char object_name[HASH_SHA256_TEXT_SIZE];
+		hashSha256Finish(&object_hash, object_digest);
+		hashSha256Format(object_digest, object_name);
+
+		char object_path[COMMAND_CACHE_PATH_SIZE];
+		snprintf(object_path, sizeof(object_path), "%s/%s", COMMAND_CACHE_OBJECTS, object_name);
+
+		filehandle object_fh = {0};
+		bool object_stored = platformOpenFile(&object_fh, object_path, PLATFORM_FILECONTEXT_EXISTING,
+			PLATFORM_FILEMODE_READONLY) && object_fh.file_size == object_size;
+		platformCloseFile(&object_fh);
+		if (!object_stored)
+			stored = commandCacheCopyFile(commit, buffer, spec->outputs[output_index], object_path);
+
+		int line_length = snprintf(manifest + manifest_length, COMMAND_CACHE_MANIFEST_SIZE - (size_t)manifest_length,
+			"%s %llu %s\n", object_name, (unsigned long long)object_size, spec->outputs[output_index]);
+		if (line_length < 0 || (size_t)(manifest_length + line_length) >= COMMAND_CACHE_MANIFEST_SIZE)
+			stored = false;
+		else
+			manifest_length += line_length;
+	}
+
+	// The manifest is written last and committed after the objects, so a key only
+	// ever maps to objects that are fully stored.
+	if (stored)
+	{
+		char manifest_path[COMMAND_CACHE_PATH_SIZE];
+		snprintf(manifest_path, sizeof(manifest_path), "%s/%s", COMMAND_CACHE_COMMANDS, key->text);
+
+		commit_file manifest_file = {0};
+		stored = fileCommitOpen(commit, &manifest_file, manifest_path, true);
+		if (stored)
+		{
+			fileCommitWrite(&manifest_file, manifest, (size_t)manifest_length);
+			stored = fileCommitClose(commit, &manifest_file, true);
+		}
+	}
+
+	arena_restore(arena, stash_point);
+	return stored;
+
+}
@@ -0,0 +1,120 @@
+/**
+ * The command cache lets a command that declares its inputs and outputs skip
+ * running when none of its inputs have changed. A command declares them with
+ * annotations ahead of the command itself:
+ *
+ * 		#!! {in: schema.json gen.py} {out: schema.h} {env: PYTHON} python gen.py
+ *
+ * The command's key hashes its text, the values of the named environment variables
+ * along with PATH, the declared output paths and the contents of every input. The
+ * outputs of a command that succeeds are stored by the hash of their contents under
+ * ".sourcery/cache/objects", and the key maps to them through a manifest under
+ * ".sourcery/cache/commands". When the key is found again, the outputs are copied
+ * back from the store rather than running the command.
+ *
+ * Paths are relative to the working directory Sourcery was run from. Keys and
+ * objects are both named by SHA-256 digests, so neither can be mistaken for
+ * another, and an object is only reused or restored when it's as large as the file
+ * it was stored from.
+ */
+#ifndef SOURCERY_CACHE_COMMAND_CACHE_H
+#define SOURCERY_CACHE_COMMAND_CACHE_H
+#include <sourcery/generics.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/memory/alloc.h>
+
+#define COMMAND_CACHE_ROOT 				".sourcery"
+#define COMMAND_CACHE_DIRECTORY 		".sourcery/cache"
+#define COMMAND_CACHE_OBJECTS 			".sourcery/cache/objects"
+#define COMMAND_CACHE_COMMANDS 			".sourcery/cache/commands"
+#define COMMAND_CACHE_VERSION 			2
+
+#define COMMAND_CACHE_MAX_PATHS 		32
+#define COMMAND_CACHE_PATH_SIZE 		1024
+#define COMMAND_CACHE_CHUNK_SIZE 		KILOBYTES(64)
+#define COMMAND_CACHE_MANIFEST_SIZE 	KILOBYTES(64)
+
+/**
+ * A command's key, the hexadecimal SHA-256 digest that names its manifest.
+ */
+typedef struct command_cache_key
+{
+	char text[HASH_SHA256_TEXT_SIZE];
+} command_cache_key;
+
+/**
+ * A command with its annotations split out. Every string points into the directive
+ * the spec was parsed from.
+ */
+typedef struct command_cache_spec
+{
+	char* 	command;
+
+	char* 	inputs[COMMAND_CACHE_MAX_PATHS];
+	uint32 	input_count;
+	char* 	outputs[COMMAND_CACHE_MAX_PATHS];
+	uint32 	output_count;
+	char* 	environment[COMMAND_CACHE_MAX_PATHS];
+	uint32 	environment_count;
+} command_cache_spec;
+
+/**
+ * Splits the annotations off of a command directive. The directive is modified in
+ * place and the command that follows the annotations is always returned within the
+ * spec, whether or not the command can be cached.
+ *
+ * @param directive The command directive, which is modified.
+ * @param spec The spec to fill out.
+ *
+ * @returns True if the command declared at least one output and can be cached,
+ * false if it must always be run.
+ */
+bool
+commandCacheParse(char* directive, command_cache_spec* spec);
+
+/**
+ * Computes the key of a command.
+ *
+ * @param arena The arena to place the read buffer on, which is released before
+ * returning.
+ * @param spec The command's spec.
+ * @param key Set to the command's key.
+ *
+ * @returns True if the key was computed, false if an input couldn't be read, in
+ * which case the command must be run.
+ */
+bool
+commandCacheComputeKey(mem_arena* arena, command_cache_spec* spec, command_cache_key* key);
+
+/**
+ * Restores a command's outputs from the store. Nothing is restored unless every
+ * output is present in the store.
+ *
+ * @param arena The arena to place the copy buffers on, which are released before
+ * returning.
+ * @param commit The commit the outputs are written through.
+ * @param spec The command's spec.
+ * @param key The command's key.
+ *
+ * @returns True if every output was restored, false if the command must be run.
+ */
+bool
+commandCacheRestore(mem_arena* arena, file_commit* commit, command_cache_spec* spec, command_cache_key* key);
+
+/**
+ * Stores the outputs of a command that succeeded.
+ *
+ * @param arena The arena to place the copy buffers on, which are released before
+ * returning.
+ * @param commit The commit the store is written through.
+ * @param spec The command's spec.
+ * @param key The command's key.
+ *
+ * @returns True if the outputs were stored, false if an output is missing or the
+ * store couldn't be written to.
+ */
+bool
+commandCacheStore(mem_arena* arena, file_commit* commit, command_cache_spec* spec, command_cache_key* key);
+
+#endif
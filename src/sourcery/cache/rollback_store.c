@@ -0,0 +1,335 @@
+#include <sourcery/cache/rollback_store.h>
+#include <stdio.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/memory/memutils.h>
+#include <sourcery/string/string_utils.h>
+
+/**
+ * Names the contents of an open file by their SHA-256 digest, reading it from its
+ * start.
+ */
+internal void
+rollbackHashFile(filehandle* fh, uint8* buffer, char* object_name)
+{
+
+	hash_sha256 hash;
+	hashSha256Begin(&hash);
+
+	fh->read_ptr = 0;
+	size_t bytes_read = 0;
+	while ((bytes_read = platformReadFile(fh, buffer, ROLLBACK_STORE_CHUNK_SIZE)) > 0)
+		hashSha256Update(&hash, buffer, bytes_read);
+
+	uint8 digest[HASH_SHA256_SIZE];
+	hashSha256Finish(&hash, digest);
+	hashSha256Format(digest, object_name);
+
+}
+
+/**
+ * Determines if a blob is stored whole, which is when it's as large as the file it
+ * was stored from.
+ */
+internal bool
+rollbackObjectStored(const char* object_path, uint64 file_size)
+{
+
+	filehandle object_fh = {0};
+	if (!platformOpenFile(&object_fh, object_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	bool stored = (object_fh.file_size == file_size);
+	platformCloseFile(&object_fh);
+	return stored;
+
+}
+
+/**
+ * Fills a file being committed with the whole of an open file. The file is cloned
+ * where the filesystem allows it, otherwise copied by the kernel and whatever is
+ * left is copied through the buffer.
+ */
+internal bool
+rollbackCopyFile(commit_file* destination, filehandle* source, uint8* buffer)
+{
+
+	if (platformCloneFile(&destination->fh, source))
+		return true;
+
+	source->read_ptr = platformCopyFileRange(&destination->fh, source, 0, source->file_size);
+	size_t bytes_read = 0;
+	while (!destination->write_failed && (bytes_read = platformReadFile(source, buffer, ROLLBACK_STORE_CHUNK_SIZE)) > 0)
+		fileCommitWrite(destination, buffer, bytes_read);
+
+	return !destination->write_failed;
+
+}
+
+/**
+ * @returns The number of the latest snapshot, or zero if there's none.
+ */
+internal uint64
+rollbackReadHead(void)
+{
+
+	filehandle head_fh = {0};
+	if (!platformOpenFile(&head_fh, ROLLBACK_STORE_HEAD, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return 0;
+
+	char head_text[32] = {0};
+	platformReadFile(&head_fh, head_text, sizeof(head_text) - 1);
+	platformCloseFile(&head_fh);
+
+	unsigned long long sequence = 0;
+	if (sscanf(head_text, "%llu", &sequence) != 1)
+		return 0;
+	return (uint64)sequence;
+
+}
+
+internal bool
+rollbackWriteHead(file_commit* commit, uint64 sequence)
+{
+
+	commit_file head_file = {0};
+	if (!fileCommitOpen(commit, &head_file, ROLLBACK_STORE_HEAD, true))
+		return false;
+
+	char head_text[32];
+	int head_length = snprintf(head_text, sizeof(head_text), "%llu\n", (unsigned long long)sequence);
+	fileCommitWrite(&head_file, head_text, (size_t)head_length);
+	return fileCommitClose(commit, &head_file, true);
+
+}
+
+internal void
+rollbackFormatSnapshotPath(char* buffer, size_t buffer_size, uint64 sequence)
+{
+	snprintf(buffer, buffer_size, "%s/%010llu", ROLLBACK_STORE_SNAPSHOTS, (unsigned long long)sequence);
+}
+
+/**
+ * Writes out the manifest lines gathered so far.
+ */
+internal void
+rollbackFlushLines(rollback_snapshot* snapshot)
+{
+	fileCommitWrite(&snapshot->manifest, snapshot->lines, snapshot->lines_used);
+	snapshot->failed = snapshot->failed || snapshot->manifest.write_failed;
+	snapshot->lines_used = 0;
+}
+
+void
+rollbackSnapshotCreate(rollback_snapshot* snapshot, mem_arena* arena, file_commit* commit)
+{
+
+	memory_set(snapshot, sizeof(rollback_snapshot), 0);
+	snapshot->commit = commit;
+	snapshot->buffer = arena_push_array(arena, uint8, ROLLBACK_STORE_CHUNK_SIZE);
+	snapshot->lines = arena_push_array(arena, char, ROLLBACK_STORE_MANIFEST_BUFFER);
+
+}
+
+/**
+ * Begins the snapshot that follows the latest one, which is done by its first save
+ * so that a run which saves nothing leaves the store untouched.
+ */
+internal bool
+rollbackSnapshotBegin(rollback_snapshot* snapshot)
+{
+
+	snapshot->begun = true;
+	snapshot->sequence = rollbackReadHead() + 1;
+
+	platformCreateDirectory(ROLLBACK_STORE_ROOT);
+	platformCreateDirectory(ROLLBACK_STORE_DIRECTORY);
+	platformCreateDirectory(ROLLBACK_STORE_OBJECTS);
+	platformCreateDirectory(ROLLBACK_STORE_SNAPSHOTS);
+
+	rollbackFormatSnapshotPath(snapshot->manifest_path, sizeof(snapshot->manifest_path), snapshot->sequence);
+	if (!fileCommitOpen(snapshot->commit, &snapshot->manifest, snapshot->manifest_path, true))
+	{
+		snapshot->failed = true;
+		return false;
+	}
+
+	snapshot->lines_used = (size_t)snprintf(snapshot->lines, ROLLBACK_STORE_MANIFEST_BUFFER,
+		"sourcery-rollback %d\n", ROLLBACK_STORE_VERSION);
+	return true;
+
+}
+
+bool
+rollbackSnapshotSaveFile(rollback_snapshot* snapshot, const char* path)
+{
+
+	if (!snapshot->begun)
+		rollbackSnapshotBegin(snapshot);
+	if (snapshot->failed)
+		return false;
+
+	// Manifests are line based, so a path that spans lines can't be listed.
+	for (const char* c = path; *c != '\0'; ++c)
+	{
+		if (*c == '\n' || *c == '\r')
+			return false;
+	}
+
+	filehandle source = {0};
+	if (!platformOpenFile(&source, path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return false;
+
+	char object_name[HASH_SHA256_TEXT_SIZE];
+	rollbackHashFile(&source, snapshot->buffer, object_name);
+	uint64 file_size = source.read_ptr;
+
+	// Blobs are named by the digest of their contents, so a blob that's already
+	// stored whole is already correct, whichever run stored it.
+	char object_path[FILE_COMMIT_PATH_SIZE];
+	snprintf(object_path, sizeof(object_path), "%s/%s", ROLLBACK_STORE_OBJECTS, object_name);
+	bool saved = true;
+	if (!rollbackObjectStored(object_path, file_size))
+	{
+		commit_file object_file = {0};
+		saved = fileCommitOpen(snapshot->commit, &object_file, object_path, true);
+		if (saved)
+		{
+			bool copied = rollbackCopyFile(&object_file, &source, snapshot->buffer);
+			saved = fileCommitClose(snapshot->commit, &object_file, copied);
+		}
+	}
+	platformCloseFile(&source);
+	if (!saved)
+		return false;
+
+	char line[FILE_COMMIT_PATH_SIZE + 64];
+	int line_length = snprintf(line, sizeof(line), "%s %llu %s\n", object_name, (unsigned long long)file_size, path);
+	if (line_length < 0 || (size_t)line_length >= sizeof(line))
+		return false;
+
+	if (snapshot->lines_used + (size_t)line_length > ROLLBACK_STORE_MANIFEST_BUFFER)
+		rollbackFlushLines(snapshot);
+	for (int c_index = 0; c_index < line_length; ++c_index)
+		snapshot->lines[snapshot->lines_used++] = line[c_index];
+	snapshot->file_count++;
+	return true;
+
+}
+
+bool
+rollbackSnapshotFinish(rollback_snapshot* snapshot)
+{
+
+	if (!snapshot->begun)
+		return true;
+
+	// The head moves last, once the snapshot it names is complete. A snapshot that
+	// saved nothing is discarded.
+	bool finished = !snapshot->failed;
+	if (snapshot->manifest.fh.platform_handle_size != 0)
+	{
+		bool keep = (finished && snapshot->file_count != 0);
+		if (keep)
+			rollbackFlushLines(snapshot);
+		bool kept = fileCommitClose(snapshot->commit, &snapshot->manifest, keep && !snapshot->failed);
+		if (keep)
+			finished = kept && rollbackWriteHead(snapshot->commit, snapshot->sequence);
+	}
+
+	// The next save begins the snapshot after this one.
+	snapshot->begun = false;
+	snapshot->failed = false;
+	snapshot->lines_used = 0;
+	snapshot->file_count = 0;
+	return finished;
+
+}
+
+uint32
+rollbackRestore(mem_arena* arena, file_commit* commit, uint32* files_restored)
+{
+
+	*files_restored = 0;
+	uint64 sequence = rollbackReadHead();
+	if (sequence == 0)
+		return ROLLBACK_RESTORE_NOTHING;
+
+	char manifest_path[FILE_COMMIT_PATH_SIZE];
+	rollbackFormatSnapshotPath(manifest_path, sizeof(manifest_path), sequence);
+	filehandle manifest_fh = {0};
+	if (!platformOpenFile(&manifest_fh, manifest_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return ROLLBACK_RESTORE_FAILED;
+
+	size_t stash_point = arena_stash(arena);
+	uint8* buffer = arena_push_array(arena, uint8, ROLLBACK_STORE_CHUNK_SIZE);
+	char* manifest = arena_push_array(arena, char, manifest_fh.file_size + 1);
+	size_t manifest_length = platformReadFile(&manifest_fh, manifest, manifest_fh.file_size);
+	manifest[manifest_length] = '\0';
+	platformCloseFile(&manifest_fh);
+
+	int version = 0;
+	int header_length = 0;
+	bool restored = (sscanf(manifest, "sourcery-rollback %d\n%n", &version, &header_length) == 1 &&
+		header_length > 0 && version >= ROLLBACK_STORE_OLDEST_VERSION && version <= ROLLBACK_STORE_VERSION);
+
+	// Every file is attempted, even after one fails, so that as much as possible
+	// is put back.
+	char* line = restored ? manifest + header_length : manifest + manifest_length;
+	while (*line != '\0')
+	{
+
+		char* line_end = line;
+		while (*line_end != '\n' && *line_end != '\0')
+			line_end++;
+		char line_terminator = *line_end;
+		*line_end = '\0';
+
+		char object_name[HASH_SHA256_TEXT_SIZE];
+		unsigned long long file_size = 0;
+		int path_offset = 0;
+		bool file_restored = (sscanf(line, "%64s %llu %n", object_name, &file_size, &path_offset) == 2 &&
+			path_offset > 0 && line[path_offset] != '\0');
+
+		filehandle object_fh = {0};
+		if (file_restored)
+		{
+			char object_path[FILE_COMMIT_PATH_SIZE];
+			snprintf(object_path, sizeof(object_path), "%s/%s", ROLLBACK_STORE_OBJECTS, object_name);
+			file_restored = platformOpenFile(&object_fh, object_path, PLATFORM_FILECONTEXT_EXISTING,
+				PLATFORM_FILEMODE_READONLY) && object_fh.file_size == (size_t)file_size;
+		}
+
+		if (file_restored)
+		{
+			commit_file restored_file = {0};
+			file_restored = fileCommitOpen(commit, &restored_file, line + path_offset, true);
+			if (file_restored)
+			{
+				bool copied = rollbackCopyFile(&restored_file, &object_fh, buffer);
+				file_restored = fileCommitClose(commit, &restored_file, copied);
+			}
+		}
+		platformCloseFile(&object_fh);
+
+		if (file_restored)
+			(*files_restored)++;
+		else
+			restored = false;
+
+		if (line_terminator == '\0')
+			break;
+		line = line_end + 1;
+
+	}
+
+	// The snapshot's manifest is left behind rather than removed, the next snapshot
+	// simply takes its number.
+	if (restored)
+		restored = rollbackWriteHead(commit, sequence - 1);
+
+	arena_restore(arena, stash_point);
+	return restored ? ROLLBACK_RESTORE_COMPLETE : ROLLBACK_RESTORE_FAILED;
+
+}
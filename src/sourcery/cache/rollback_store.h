@@ -0,0 +1,121 @@
+/**
+ * The rollback store keeps the contents that files had before a run modified them,
+ * so that "sourcery --rollback" can put them back. Contents are stored once as
+ * blobs named by the SHA-256 of their bytes under ".sourcery/rollback/objects", and
+ * are shared by every snapshot that saves the same contents. Where the filesystem
+ * supports it, blobs are clones of the files they were saved from, so saving a
+ * file that's stored for the first time costs no more than a reflink.
+ *
+ * Each run that saves files writes one snapshot, a manifest under
+ * ".sourcery/rollback/snapshots" listing the blob of each file it saved. Snapshots
+ * are numbered in the order they were taken and ".sourcery/rollback/HEAD" holds the
+ * number of the latest. A rollback restores the latest snapshot and steps the head
+ * back to the one before it, so repeated rollbacks step back through earlier runs.
+ *
+ * Everything is written through a file commit, and the head is written last, so it
+ * only ever names a snapshot whose blobs are already stored. A blob is only reused
+ * when it's as large as the file being saved, and only restored when it's as large
+ * as the manifest says the file was. Paths are relative to
+ * the working directory Sourcery was run from. Blobs are never removed, removing
+ * ".sourcery/rollback" discards every snapshot at once.
+ */
+#ifndef SOURCERY_CACHE_ROLLBACK_STORE_H
+#define SOURCERY_CACHE_ROLLBACK_STORE_H
+#include <sourcery/generics.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/memory/alloc.h>
+
+#define ROLLBACK_STORE_ROOT 		".sourcery"
+#define ROLLBACK_STORE_DIRECTORY 	".sourcery/rollback"
+#define ROLLBACK_STORE_OBJECTS 		".sourcery/rollback/objects"
+#define ROLLBACK_STORE_SNAPSHOTS 	".sourcery/rollback/snapshots"
+#define ROLLBACK_STORE_HEAD 		".sourcery/rollback/HEAD"
+#define ROLLBACK_STORE_VERSION 		2
+
+/**
+ * Snapshots from before blobs were named by their SHA-256 differ only in how their
+ * blobs are named, so they can still be restored.
+ */
+#define ROLLBACK_STORE_OLDEST_VERSION 	1
+
+#define ROLLBACK_STORE_CHUNK_SIZE 		KILOBYTES(64)
+#define ROLLBACK_STORE_MANIFEST_BUFFER 	KILOBYTES(64)
+
+#define ROLLBACK_RESTORE_FAILED 	0
+#define ROLLBACK_RESTORE_COMPLETE 	1
+#define ROLLBACK_RESTORE_NOTHING 	2
+
+/**
+ * A snapshot being taken. It's begun by its first save and its manifest is written
+ * as files are saved rather than held until the end, so a snapshot of any number
+ * of files takes a fixed amount of memory.
+ */
+typedef struct rollback_snapshot
+{
+	file_commit* 	commit;
+	commit_file 	manifest;
+	char 			manifest_path[FILE_COMMIT_PATH_SIZE];
+	uint64 			sequence;
+	bool 			begun;
+
+	uint8* 	buffer;
+	char* 	lines;
+	size_t 	lines_used;
+
+	uint32 	file_count;
+	bool 	failed;
+} rollback_snapshot;
+
+/**
+ * Initializes a snapshot without touching the store. The snapshot can be taken,
+ * finished and taken again any number of times.
+ *
+ * @param snapshot The snapshot to initialize.
+ * @param arena The arena to place the snapshot's buffers on, which must outlive it.
+ * @param commit The commit the store is written through.
+ */
+void
+rollbackSnapshotCreate(rollback_snapshot* snapshot, mem_arena* arena, file_commit* commit);
+
+/**
+ * Saves the current contents of a file into the snapshot, which must be done
+ * before the file is modified. The first save begins a snapshot that follows the
+ * latest one.
+ *
+ * @param snapshot The snapshot.
+ * @param path The path of the file.
+ *
+ * @returns True if the file was saved, false if not, in which case the file
+ * mustn't be modified.
+ */
+bool
+rollbackSnapshotSaveFile(rollback_snapshot* snapshot, const char* path);
+
+/**
+ * Finishes a snapshot, making it the latest. A snapshot that saved no files is
+ * discarded rather than kept. The next save begins a new snapshot.
+ *
+ * @param snapshot The snapshot to finish.
+ *
+ * @returns True if the snapshot was kept or had nothing to keep, false if it
+ * couldn't be written.
+ */
+bool
+rollbackSnapshotFinish(rollback_snapshot* snapshot);
+
+/**
+ * Restores every file of the latest snapshot and then steps the head back to the
+ * snapshot before it. A snapshot that couldn't be fully restored remains the
+ * latest, so the rollback can be tried again.
+ *
+ * @param arena The arena to load the snapshot on, which is released before returning.
+ * @param commit The commit the restored files are written through.
+ * @param files_restored Set to the number of files restored.
+ *
+ * @returns ROLLBACK_RESTORE_COMPLETE if every file was restored,
+ * ROLLBACK_RESTORE_NOTHING if there's no snapshot or ROLLBACK_RESTORE_FAILED.
+ */
+uint32
+rollbackRestore(mem_arena* arena, file_commit* commit, uint32* files_restored);
+
+#endif
@@ -8,6 +8,7 @@
 #define PLATFORM_FILECONTEXT_NEW 1
 #define PLATFORM_FILECONTEXT_EXISTING 2
 #define PLATFORM_FILECONTEXT_ALWAYS 3
+#define PLATFORM_FILECONTEXT_STREAM 4
 
 #define PLATFORM_FILEMODE_READONLY 1
 #define PLATFORM_FILEMODE_APPEND 2
@@ -32,6 +33,20 @@ typedef struct filehandle
 	size_t write_ptr;
 } filehandle;
 
+/**
+ * Identifies the contents a file held when it was stamped. A file rewritten in
+ * place changes its size or modification time, and a file replaced by another
+ * changes its index, so contents read earlier can be told apart from contents
+ * written since.
+ */
+typedef struct file_stamp
+{
+	uint64 device;
+	uint64 index;
+	uint64 size;
+	uint64 modified_time;
+} file_stamp;
+
 /**
  * ---------------------------------------------------------------------------------------------------------------------
  * Platform Specific Definitions
@@ -92,6 +107,136 @@ platformReadFile(filehandle* fh, void* buffer, size_t buffer_size);
 size_t
 platformWriteFile(filehandle* fh, void* buffer, size_t buffer_size);
 
+/**
+ * Appends a range of one file to another without the bytes passing through the
+ * process, where the platform can copy between files itself. The source's read
+ * pointer is left alone. Fewer bytes than requested are copied whenever the
+ * platform can't copy them, such as between filesystems or to a stream, and the
+ * caller is expected to write the rest itself.
+ * 
+ * @param destination The filehandle to append to, at its write pointer.
+ * @param source The filehandle to copy from.
+ * @param source_offset Where the range begins within the source.
+ * @param size The size, in bytes, of the range.
+ * 
+ * @returns The number of bytes that were copied.
+ */
+size_t
+platformCopyFileRange(filehandle* destination, filehandle* source, size_t source_offset, size_t size);
+
+/**
+ * Makes a file share the contents of another where the filesystem supports it, so
+ * that neither the bytes nor the disk space are copied until either file changes.
+ * The destination is replaced by the whole of the source.
+ * 
+ * @param destination The filehandle to clone into, which must be empty.
+ * @param source The filehandle to clone.
+ * 
+ * @returns True if the file was cloned, false if the filesystem can't clone it, in
+ * which case the caller is expected to copy it instead.
+ */
+bool
+platformCloneFile(filehandle* destination, filehandle* source);
+
+/**
+ * Flushes everything written to a file through to the disk, blocking until the
+ * disk has it.
+ * 
+ * @param fh The filehandle to flush.
+ * 
+ * @returns True if the file was flushed, false if not.
+ */
+bool
+platformSyncFile(filehandle* fh);
+
+/**
+ * Flushes everything written to the filesystems holding the given files through to
+ * the disk. Each filesystem is flushed once, no matter how many of the files it
+ * holds, so flushing many files this way costs far less than flushing each. Where
+ * a platform can't flush a filesystem, or the files span more filesystems than it
+ * keeps track of, the remaining files are flushed one by one instead. Nothing
+ * beyond the given files' filesystems is flushed.
+ * 
+ * @param paths The files whose filesystems are flushed.
+ * @param path_count The number of files.
+ * 
+ * @returns True if every filesystem was flushed, false if not.
+ */
+bool
+platformSyncFilesystems(char** paths, uint32 path_count);
+
+/**
+ * Stamps an open file with the identity of its current contents.
+ * 
+ * @param fh The filehandle of the file.
+ * @param stamp The stamp to fill out.
+ * 
+ * @returns True if the file was stamped, false if not.
+ */
+bool
+platformGetFileStamp(filehandle* fh, file_stamp* stamp);
+
+/**
+ * Stamps the file at a path with the identity of its current contents.
+ * 
+ * @param file_path The path to the file.
+ * @param stamp The stamp to fill out.
+ * 
+ * @returns True if the file was stamped, false if it doesn't exist.
+ */
+bool
+platformGetPathStamp(const char* file_path, file_stamp* stamp);
+
+/**
+ * Asks the system to start reading a whole file into its cache in the background,
+ * so that reading it later doesn't wait on the disk. It's only a hint, the file
+ * reads the same whether or not it's honoured.
+ * 
+ * @param fh The filehandle of the file.
+ * 
+ * @returns True if the hint was given, false if the platform has no such hint.
+ */
+bool
+platformPrefetchFile(filehandle* fh);
+
+/**
+ * Opens the process's standard input as a read-only filehandle. Standard input
+ * isn't seekable and its size isn't known ahead of time, so the filehandle is
+ * given the stream context and the file size is always zero. Reads consume the
+ * stream sequentially until EOF. Closing the filehandle doesn't close standard
+ * input.
+ * 
+ * @param fh A pointer to a filehandle struct to be filled out.
+ * 
+ * @returns True if standard input is available, false otherwise.
+ */
+bool
+platformOpenStandardInput(filehandle* fh);
+
+/**
+ * Takes the process's standard output for writing raw bytes. Until it's released,
+ * everything else the process writes to standard output, including the output of
+ * the processes it starts, goes to standard error instead. Anything buffered for
+ * standard output must be flushed before it's claimed.
+ * 
+ * Standard output isn't seekable, so the filehandle is given the stream context
+ * and writes are always sequential.
+ * 
+ * @param fh A pointer to a filehandle struct to be filled out.
+ * 
+ * @returns True if standard output was claimed, false otherwise.
+ */
+bool
+platformClaimStandardOutput(filehandle* fh);
+
+/**
+ * Hands standard output back to the rest of the process.
+ * 
+ * @param fh The filehandle returned by platformClaimStandardOutput().
+ */
+void
+platformReleaseStandardOutput(filehandle* fh);
+
 
 
 /**
@@ -104,4 +249,27 @@ platformWriteFile(filehandle* fh, void* buffer, size_t buffer_size);
 bool
 platformCreateDirectory(const char* file_path);
 
+/**
+ * Renames a file, replacing the destination if it exists. The destination either
+ * refers to the old file or the new one, never to a partial file, so writing to a
+ * temporary name and renaming over the real one replaces a file atomically.
+ * 
+ * @param source_path The file to rename.
+ * @param destination_path The new name of the file.
+ * 
+ * @returns True if the file was renamed, false if not.
+ */
+bool
+platformRenameFile(const char* source_path, const char* destination_path);
+
+/**
+ * Removes a file.
+ * 
+ * @param file_path The file to remove.
+ * 
+ * @returns True if the file was removed, false if not.
+ */
+bool
+platformRemoveFile(const char* file_path);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#ifndef SOURCERY_FILESYSTEM_DIRECTORY_H
+#define SOURCERY_FILESYSTEM_DIRECTORY_H
+#include <sourcery/generics.h>
+
+#define PLATFORM_PATHTYPE_NONE 0
+#define PLATFORM_PATHTYPE_FILE 1
+#define PLATFORM_PATHTYPE_DIRECTORY 2
+#define PLATFORM_PATHTYPE_OTHER 3
+#define PLATFORM_PATHTYPE_UNKNOWN 4
+
+#define PLATFORM_CREATEDIR_FAILED 	0
+#define PLATFORM_CREATEDIR_CREATED 	1
+#define PLATFORM_CREATEDIR_EXISTS 	2
+
+/**
+ * Represents an open directory being enumerated. Entries are read in bulk into
+ * the caller-provided buffer and handed back one at a time, so the buffer bounds
+ * how many system calls an enumeration takes.
+ *
+ * Directories may be opened relative to an already open parent, which lets
+ * platforms that support it skip resolving the full path for every directory in
+ * a deep tree. Platforms that don't support relative opens use the full path,
+ * which is why both are provided when opening a directory.
+ */
+typedef struct dirhandle
+{
+	size_t platform_handle_ptr;
+	size_t platform_handle_size;
+
+	const char* path;
+
+	uint8* 	buffer;
+	size_t 	buffer_size;
+	size_t 	buffer_length;
+	size_t 	buffer_offset;
+	bool 	end_of_directory;
+} dirhandle;
+
+/**
+ * A single entry within a directory. The name is only valid until the next read
+ * from the directory handle it came from. Some filesystems don't report the type
+ * of an entry, in which case it is PLATFORM_PATHTYPE_UNKNOWN and should be looked
+ * up with platformGetPathTypeAt().
+ */
+typedef struct direntry
+{
+	const char* name;
+	uint32 		type;
+} direntry;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_directory.c
+ */
+
+/**
+ * Opens a directory for enumeration.
+ *
+ * @param dh The directory handle to fill out.
+ * @param parent An open parent directory that name is relative to, or NULL if name
+ * is relative to the working directory.
+ * @param name The name of the directory relative to the parent.
+ * @param path The full path of the directory. This must outlive the handle.
+ * @param buffer The buffer entries are read into. This must outlive the enumeration.
+ * @param buffer_size The size of the buffer, in bytes.
+ *
+ * @returns True if the directory was opened, false if not.
+ */
+bool
+platformOpenDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path,
+	void* buffer, size_t buffer_size);
+
+/**
+ * Opens a directory only so that paths can be created relative to it. The handle
+ * can't be enumerated and is closed with platformCloseDirectory().
+ *
+ * @param dh The directory handle to fill out.
+ * @param parent An open parent directory that name is relative to, or NULL if name
+ * is relative to the working directory.
+ * @param name The name of the directory relative to the parent.
+ * @param path The full path of the directory. This must outlive the handle.
+ *
+ * @returns True if the directory was opened, false if not.
+ */
+bool
+platformOpenParentDirectory(dirhandle* dh, dirhandle* parent, const char* name, const char* path);
+
+/**
+ * Creates a directory relative to an open parent. An existing directory isn't an
+ * error, but an existing file of the same name is.
+ *
+ * @param parent An open parent directory that name is relative to, or NULL if name
+ * is relative to the working directory.
+ * @param name The name of the directory relative to the parent.
+ * @param path The full path of the directory, used by platforms without relative
+ * creation.
+ *
+ * @returns One of the PLATFORM_CREATEDIR values.
+ */
+uint32
+platformCreateDirectoryAt(dirhandle* parent, const char* name, const char* path);
+
+/**
+ * Reads the next entry from a directory. The "." and ".." entries are skipped.
+ *
+ * @param dh The directory handle to read from.
+ * @param entry The entry to fill out.
+ *
+ * @returns True if an entry was read, false once the directory is exhausted.
+ */
+bool
+platformReadDirectory(dirhandle* dh, direntry* entry);
+
+/**
+ * Closes a directory handle. Directories opened relative to it remain valid.
+ *
+ * @param dh The directory handle to close.
+ */
+void
+platformCloseDirectory(dirhandle* dh);
+
+/**
+ * Determines what a path refers to. Symbolic links are followed.
+ *
+ * @param path The path to check.
+ *
+ * @returns One of the PLATFORM_PATHTYPE values, PLATFORM_PATHTYPE_NONE if the
+ * path doesn't exist.
+ */
+uint32
+platformGetPathType(const char* path);
+
+/**
+ * Determines what an entry within an open directory refers to. Symbolic links
+ * aren't followed and are reported as PLATFORM_PATHTYPE_OTHER, as they are when
+ * read from the directory.
+ *
+ * @param dh The directory the entry belongs to.
+ * @param name The name of the entry.
+ *
+ * @returns One of the PLATFORM_PATHTYPE values, PLATFORM_PATHTYPE_NONE if the
+ * entry doesn't exist.
+ */
+uint32
+platformGetPathTypeAt(dirhandle* dh, const char* name);
+
+/**
+ * Fetches the process's current working directory.
+ *
+ * @param buffer The buffer to write the null-terminated path into.
+ * @param buffer_size The size of the buffer, in bytes.
+ *
+ * @returns True if the path fit within the buffer, false if not.
+ */
+bool
+platformGetWorkingDirectory(char* buffer, size_t buffer_size);
+
+/**
+ * Changes the process's current working directory.
+ *
+ * @param path The directory to change to.
+ *
+ * @returns True if the working directory was changed, false if not.
+ */
+bool
+platformSetWorkingDirectory(const char* path);
+
+#endif
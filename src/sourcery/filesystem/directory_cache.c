@@ -0,0 +1,303 @@
+#include <sourcery/filesystem/directory_cache.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/memory/memutils.h>
+
+internal bool
+directoryCacheIsSeparator(char c)
+{
+#if defined(PLATFORM_WINDOWS)
+	return (c == '/' || c == '\\');
+#else
+	return (c == '/');
+#endif
+}
+
+/**
+ * Copies a path with repeated separators collapsed and any trailing separator
+ * removed, so that each directory has exactly one key.
+ *
+ * @returns The length of the copy, or zero if the path is empty or too long.
+ */
+internal size_t
+directoryCacheNormalize(char* buffer, const char* path)
+{
+
+	size_t length = 0;
+	for (const char* c = path; *c != '\0'; ++c)
+	{
+		if (length > 0 && directoryCacheIsSeparator(*c) && directoryCacheIsSeparator(buffer[length - 1]))
+			continue;
+		if (length == DIRECTORY_CACHE_MAX_PATH - 1)
+			return 0;
+		buffer[length++] = *c;
+	}
+
+	if (length > 1 && directoryCacheIsSeparator(buffer[length - 1]))
+		length--;
+	buffer[length] = '\0';
+	return length;
+
+}
+
+internal directory_cache_entry*
+directoryCacheFind(directory_cache* cache, const char* path, size_t path_length, uint64 hash)
+{
+
+	uint32 slot_index = (uint32)hash & (DIRECTORY_CACHE_SLOT_COUNT - 1);
+	while (cache->slots[slot_index] != 0)
+	{
+		directory_cache_entry* entry = &cache->entries[cache->slots[slot_index] - 1];
+		if (entry->hash == hash && entry->path_length == path_length)
+		{
+			size_t c_index = 0;
+			while (c_index < path_length && entry->path[c_index] == path[c_index])
+				c_index++;
+			if (c_index == path_length)
+				return entry;
+		}
+		slot_index = (slot_index + 1) & (DIRECTORY_CACHE_SLOT_COUNT - 1);
+	}
+
+	return NULL;
+
+}
+
+/**
+ * Adds a directory to the cache. Nothing is added once the cache is full, the
+ * directory then simply has to be made from its full path.
+ */
+internal directory_cache_entry*
+directoryCacheInsert(directory_cache* cache, const char* path, size_t path_length, uint64 hash)
+{
+
+	if (cache->entry_count == DIRECTORY_CACHE_MAX_ENTRIES ||
+		cache->path_pool_used + path_length + 1 > DIRECTORY_CACHE_PATH_POOL)
+		return NULL;
+
+	directory_cache_entry* entry = &cache->entries[cache->entry_count++];
+	entry->hash = hash;
+	entry->path = cache->path_pool + cache->path_pool_used;
+	entry->path_length = path_length;
+	entry->handle_open = false;
+	for (size_t c_index = 0; c_index < path_length; ++c_index)
+		entry->path[c_index] = path[c_index];
+	entry->path[path_length] = '\0';
+	cache->path_pool_used += path_length + 1;
+
+	uint32 slot_index = (uint32)hash & (DIRECTORY_CACHE_SLOT_COUNT - 1);
+	while (cache->slots[slot_index] != 0)
+		slot_index = (slot_index + 1) & (DIRECTORY_CACHE_SLOT_COUNT - 1);
+	cache->slots[slot_index] = cache->entry_count;
+
+	return entry;
+
+}
+
+internal void
+directoryCacheCloseHandles(directory_cache* cache, directory_cache_entry* keep)
+{
+
+	for (uint32 entry_index = 0; entry_index < cache->entry_count; ++entry_index)
+	{
+		directory_cache_entry* entry = &cache->entries[entry_index];
+		if (entry->handle_open && entry != keep)
+		{
+			platformCloseDirectory(&entry->handle);
+			entry->handle_open = false;
+			cache->open_handles--;
+		}
+	}
+
+}
+
+/**
+ * Opens the handle of a cached directory, making room if too many are open. The
+ * directory is opened relative to its parent when its parent's handle is given.
+ */
+internal bool
+directoryCacheOpenHandle(directory_cache* cache, directory_cache_entry* entry,
+	directory_cache_entry* parent, const char* name)
+{
+
+	if (cache->open_handles == DIRECTORY_CACHE_MAX_HANDLES)
+		directoryCacheCloseHandles(cache, parent);
+
+	dirhandle* parent_handle = (parent != NULL) ? &parent->handle : NULL;
+	entry->handle_open = platformOpenParentDirectory(&entry->handle, parent_handle, name, entry->path);
+	if (entry->handle_open)
+		cache->open_handles++;
+	return entry->handle_open;
+
+}
+
+/**
+ * Makes each missing component of a normalized path, starting below its nearest
+ * cached ancestor. The path is modified while walking but restored before returning.
+ *
+ * @param stale Set when a cached ancestor couldn't be used, in which case the
+ * cache may be out of date and the walk is worth retrying from scratch.
+ */
+internal uint32
+directoryCacheWalk(directory_cache* cache, char* path, size_t path_length, bool* stale)
+{
+
+	*stale = false;
+	uint64 path_hash = hashMemory64(path, path_length, HASH64_SEED);
+	if (directoryCacheFind(cache, path, path_length, path_hash) != NULL)
+		return PLATFORM_CREATEDIR_EXISTS;
+
+	// Find the nearest ancestor that's known to exist. Without one, the first
+	// component is made relative to the working directory and keeps any root.
+	directory_cache_entry* parent = NULL;
+	size_t component_start = 0;
+	for (size_t separator = path_length - 1; separator > 0; --separator)
+	{
+		if (!directoryCacheIsSeparator(path[separator]))
+			continue;
+		uint64 prefix_hash = hashMemory64(path, separator, HASH64_SEED);
+		parent = directoryCacheFind(cache, path, separator, prefix_hash);
+		if (parent != NULL)
+		{
+			component_start = separator + 1;
+			break;
+		}
+	}
+
+	uint32 result = PLATFORM_CREATEDIR_EXISTS;
+	while (component_start < path_length)
+	{
+
+		size_t component_end = component_start;
+		if (directoryCacheIsSeparator(path[component_end]))
+			component_end++;
+		while (component_end < path_length && !directoryCacheIsSeparator(path[component_end]))
+			component_end++;
+		bool last_component = (component_end == path_length);
+
+		// Without a parent handle the name is the full path of the component.
+		char separator = path[component_end];
+		path[component_end] = '\0';
+		const char* name = (parent != NULL) ? path + component_start : path;
+
+		if (parent != NULL && !parent->handle_open &&
+			!directoryCacheOpenHandle(cache, parent, NULL, parent->path))
+		{
+			path[component_end] = separator;
+			*stale = true;
+			return PLATFORM_CREATEDIR_FAILED;
+		}
+
+		uint32 status = platformCreateDirectoryAt((parent != NULL) ? &parent->handle : NULL, name, path);
+		if (status == PLATFORM_CREATEDIR_FAILED)
+		{
+
+			// Ancestors outside of the cache may refuse to be created even though
+			// they exist, such as drive roots or directories that aren't writable.
+			if (parent == NULL && !last_component &&
+				platformGetPathType(path) == PLATFORM_PATHTYPE_DIRECTORY)
+				status = PLATFORM_CREATEDIR_EXISTS;
+			else
+			{
+				path[component_end] = separator;
+				*stale = (parent != NULL);
+				return PLATFORM_CREATEDIR_FAILED;
+			}
+
+		}
+		if (status == PLATFORM_CREATEDIR_CREATED)
+			result = PLATFORM_CREATEDIR_CREATED;
+
+		// Only directories that have children still to be made need their handle.
+		directory_cache_entry* entry = directoryCacheInsert(cache, path, component_end,
+			hashMemory64(path, component_end, HASH64_SEED));
+		if (entry != NULL && !last_component)
+			directoryCacheOpenHandle(cache, entry, parent, name);
+
+		path[component_end] = separator;
+		parent = entry;
+		component_start = component_end + 1;
+
+	}
+
+	return result;
+
+}
+
+void
+directoryCacheCreate(directory_cache* cache, mem_arena* arena)
+{
+
+	directory_cache empty_cache = {0};
+	*cache = empty_cache;
+	cache->entries = arena_push_array_zero(arena, directory_cache_entry, DIRECTORY_CACHE_MAX_ENTRIES);
+	cache->slots = arena_push_array_zero(arena, uint32, DIRECTORY_CACHE_SLOT_COUNT);
+	cache->path_pool = arena_push_array_zero(arena, char, DIRECTORY_CACHE_PATH_POOL);
+
+}
+
+void
+directoryCacheClear(directory_cache* cache)
+{
+
+	if (cache->entry_count == 0)
+		return;
+
+	directoryCacheCloseHandles(cache, NULL);
+	memory_set(cache->slots, sizeof(uint32) * DIRECTORY_CACHE_SLOT_COUNT, 0);
+	cache->entry_count = 0;
+	cache->path_pool_used = 0;
+
+}
+
+void
+directoryCacheDestroy(directory_cache* cache)
+{
+	directoryCacheCloseHandles(cache, NULL);
+}
+
+uint32
+directoryCacheMakeDirectory(directory_cache* cache, const char* path)
+{
+
+	char normalized_path[DIRECTORY_CACHE_MAX_PATH];
+	size_t path_length = directoryCacheNormalize(normalized_path, path);
+	if (path_length == 0)
+		return PLATFORM_CREATEDIR_FAILED;
+
+	// A full cache starts over rather than leaving new directories uncached.
+	if (cache->entry_count + 64 > DIRECTORY_CACHE_MAX_ENTRIES ||
+		cache->path_pool_used + DIRECTORY_CACHE_MAX_PATH > DIRECTORY_CACHE_PATH_POOL)
+		directoryCacheClear(cache);
+
+	bool stale = false;
+	uint32 result = directoryCacheWalk(cache, normalized_path, path_length, &stale);
+	if (result == PLATFORM_CREATEDIR_FAILED && stale)
+	{
+		directoryCacheClear(cache);
+		result = directoryCacheWalk(cache, normalized_path, path_length, &stale);
+	}
+
+	return result;
+
+}
+
+bool
+directoryCacheMakeParents(directory_cache* cache, const char* file_path)
+{
+
+	char normalized_path[DIRECTORY_CACHE_MAX_PATH];
+	size_t path_length = directoryCacheNormalize(normalized_path, file_path);
+	if (path_length == 0)
+		return false;
+
+	// Files directly within the working directory or the root have nothing to make.
+	size_t separator = path_length;
+	while (separator > 0 && !directoryCacheIsSeparator(normalized_path[separator - 1]))
+		separator--;
+	if (separator <= 1)
+		return true;
+
+	normalized_path[separator - 1] = '\0';
+	return (directoryCacheMakeDirectory(cache, normalized_path) != PLATFORM_CREATEDIR_FAILED);
+
+}
@@ -0,0 +1,99 @@
+/**
+ * The directory cache remembers which directories a run has already created or
+ * found, so that making a directory which is known to exist costs no system calls
+ * at all. Directories that do have to be made are created one component at a time
+ * relative to the handle of their nearest known parent, rather than resolving the
+ * full path again for every component.
+ *
+ * The cache only knows what the run itself did. Anything else that removes a
+ * directory, such as a command, must be followed by directoryCacheClear().
+ * Creation through a handle to a removed directory fails, in which case the cache
+ * clears itself and tries once more from the full path.
+ */
+#ifndef SOURCERY_FILESYSTEM_DIRECTORY_CACHE_H
+#define SOURCERY_FILESYSTEM_DIRECTORY_CACHE_H
+#include <sourcery/generics.h>
+#include <sourcery/filesystem/directory.h>
+#include <sourcery/memory/alloc.h>
+
+#define DIRECTORY_CACHE_MAX_ENTRIES 	2048
+#define DIRECTORY_CACHE_SLOT_COUNT 		4096
+#define DIRECTORY_CACHE_PATH_POOL 		KILOBYTES(256)
+#define DIRECTORY_CACHE_MAX_HANDLES 	64
+#define DIRECTORY_CACHE_MAX_PATH 		4096
+
+/**
+ * A directory known to exist. Its handle is only open while it's being used as
+ * the parent of new directories.
+ */
+typedef struct directory_cache_entry
+{
+	uint64 		hash;
+	char* 		path;
+	size_t 		path_length;
+
+	dirhandle 	handle;
+	bool 		handle_open;
+} directory_cache_entry;
+
+typedef struct directory_cache
+{
+	directory_cache_entry* 	entries;
+	uint32 					entry_count;
+	uint32* 				slots;
+
+	char* 	path_pool;
+	size_t 	path_pool_used;
+
+	uint32 	open_handles;
+} directory_cache;
+
+/**
+ * Initializes an empty directory cache.
+ *
+ * @param cache The directory cache to initialize.
+ * @param arena The arena to place the cache on, which must outlive it.
+ */
+void
+directoryCacheCreate(directory_cache* cache, mem_arena* arena);
+
+/**
+ * Forgets every directory and closes the cached handles.
+ *
+ * @param cache The directory cache.
+ */
+void
+directoryCacheClear(directory_cache* cache);
+
+/**
+ * Releases the cached handles. The cache must be created again before reuse.
+ *
+ * @param cache The directory cache to destroy.
+ */
+void
+directoryCacheDestroy(directory_cache* cache);
+
+/**
+ * Makes a directory along with any of its missing parents.
+ *
+ * @param cache The directory cache.
+ * @param path The path of the directory.
+ *
+ * @returns PLATFORM_CREATEDIR_CREATED if any directory was created,
+ * PLATFORM_CREATEDIR_EXISTS if they all existed or PLATFORM_CREATEDIR_FAILED.
+ */
+uint32
+directoryCacheMakeDirectory(directory_cache* cache, const char* path);
+
+/**
+ * Makes the missing parent directories of a file that's about to be created.
+ *
+ * @param cache The directory cache.
+ * @param file_path The path of the file.
+ *
+ * @returns True if the file's directory exists, false if it couldn't be made.
+ */
+bool
+directoryCacheMakeParents(directory_cache* cache, const char* file_path);
+
+#endif
@@ -0,0 +1,638 @@
+#include <stdio.h>
+#include <sourcery/filesystem/directory_scan.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/log/log.h>
+#include <sourcery/string/string_utils.h>
+#include <sourcery/trace/trace.h>
+
+/**
+ * An entry collected from a directory listing. Listings are collected in full
+ * before any entry is filtered, since the ignore file may appear anywhere in it.
+ */
+typedef struct scan_entry
+{
+	char* 	name;
+	uint32 	type;
+
+	struct scan_entry* next;
+} scan_entry;
+
+/**
+ * Pushes onto an arena only if the allocation fits, since running out of room
+ * during a walk shouldn't bring down the whole run.
+ */
+internal void*
+directoryScanPush(mem_arena* arena, size_t size)
+{
+	if (arena->offset + size >= arena->size)
+		return NULL;
+	return arena_push_zero(arena, size);
+}
+
+internal char*
+directoryScanCopyString(mem_arena* arena, const char* string)
+{
+	size_t string_size = strLength(string) + 1;
+	char* copy = (char*)directoryScanPush(arena, string_size);
+	if (copy != NULL)
+		strCopy(copy, string_size, string, string_size);
+	return copy;
+}
+
+internal char*
+directoryScanJoinPath(mem_arena* arena, const char* parent, const char* name)
+{
+
+	size_t parent_length = strLength(parent);
+	size_t name_length = strLength(name);
+
+	// Roots may be provided with a trailing separator.
+	bool needs_separator = (parent_length > 0 &&
+		parent[parent_length - 1] != '/' && parent[parent_length - 1] != '\\');
+
+	size_t path_size = parent_length + (needs_separator ? 1 : 0) + name_length + 1;
+	char* path = (char*)directoryScanPush(arena, path_size);
+	if (path == NULL)
+		return NULL;
+
+	strCopy(path, path_size, parent, parent_length);
+	if (needs_separator)
+		path[parent_length++] = '/';
+	strCopy(path + parent_length, path_size - parent_length, name, name_length + 1);
+
+	return path;
+
+}
+
+internal bool
+directoryScanMatchesExtension(directory_scan* scan, const char* name)
+{
+
+	if (scan->extension_count == 0)
+		return true;
+
+	const char* extension = NULL;
+	for (const char* c = name; *c != '\0'; ++c)
+	{
+		if (*c == '.')
+			extension = c + 1;
+	}
+
+	if (extension == NULL)
+		return false;
+
+	for (size_t extension_index = 0; extension_index < scan->extension_count; ++extension_index)
+	{
+		if (strEquals(scan->extensions[extension_index], extension))
+			return true;
+	}
+
+	return false;
+
+}
+
+internal bool
+directoryScanIsIgnored(scan_ignore_pattern* patterns, const char* name, bool is_directory)
+{
+
+	for (scan_ignore_pattern* current = patterns; current != NULL; current = current->next)
+	{
+		if (current->directory_only && !is_directory)
+			continue;
+		if (strMatchWildcard(current->pattern, name))
+			return true;
+	}
+
+	return false;
+
+}
+
+/**
+ * Releases a reference to a directory, closing its handle once nothing else needs
+ * to open relative to it. The scan mutex must be held.
+ */
+internal void
+directoryScanRelease(scan_directory* directory)
+{
+	if (--directory->references == 0)
+		platformCloseDirectory(&directory->handle);
+}
+
+/**
+ * Reads the ignore file in a directory and places its patterns ahead of the ones
+ * inherited from the parent directories.
+ */
+internal void
+directoryScanLoadIgnoreFile(scan_worker* worker, scan_directory* directory)
+{
+
+	directory_scan* scan = worker->scan;
+
+	char* ignore_path = directoryScanJoinPath(&worker->arena, directory->path, DIRECTORY_SCAN_IGNORE_FILE);
+	if (ignore_path == NULL)
+		return;
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, ignore_path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return;
+
+	char* ignore_source = (char*)directoryScanPush(&worker->arena, fh.file_size + 1);
+	if (ignore_source == NULL)
+	{
+		platformCloseFile(&fh);
+		return;
+	}
+
+	size_t bytes_read = platformReadFile(&fh, ignore_source, fh.file_size);
+	ignore_source[bytes_read] = '\0';
+	platformCloseFile(&fh);
+
+	// The patterns outlive this directory's walk, so they go on the shared arena.
+	platformLockMutex(&scan->mutex);
+
+	size_t offset = 0;
+	bool has_next_line = true;
+	while (has_next_line)
+	{
+
+		char* line = ignore_source + offset;
+		size_t line_length = 0;
+		while (line[line_length] != '\0' && line[line_length] != '\n')
+			line_length++;
+		has_next_line = (line[line_length] != '\0');
+		offset += line_length + 1;
+
+		// Trim trailing whitespace and carriage returns.
+		while (line_length > 0 && (line[line_length - 1] == ' ' ||
+			line[line_length - 1] == '\t' || line[line_length - 1] == '\r'))
+			line_length--;
+
+		if (line_length == 0 || line[0] == '#')
+			continue;
+
+		bool directory_only = (line[line_length - 1] == '/');
+		if (directory_only)
+			line_length--;
+
+		scan_ignore_pattern* pattern = (scan_ignore_pattern*)directoryScanPush(&scan->arena,
+			sizeof(scan_ignore_pattern) + line_length + 1);
+		if (pattern == NULL)
+		{
+			scan->out_of_memory = true;
+			break;
+		}
+
+		pattern->pattern = (char*)(pattern + 1);
+		strCopy(pattern->pattern, line_length + 1, line, line_length);
+		pattern->pattern[line_length] = '\0';
+		pattern->directory_only = directory_only;
+		pattern->next = directory->ignore_patterns;
+		directory->ignore_patterns = pattern;
+
+	}
+
+	platformUnlockMutex(&scan->mutex);
+
+}
+
+internal void
+directoryScanDirectory(scan_worker* worker, scan_directory* directory)
+{
+
+	directory_scan* scan = worker->scan;
+
+	// Roots are opened by their path, everything else relative to its parent.
+	dirhandle* parent_handle = (directory->parent != NULL) ? &directory->parent->handle : NULL;
+	bool directory_opened = platformOpenDirectory(&directory->handle, parent_handle, directory->name,
+		directory->path, worker->entry_buffer, DIRECTORY_SCAN_ENTRY_BUFFER);
+
+	if (directory->parent != NULL)
+	{
+		platformLockMutex(&scan->mutex);
+		directoryScanRelease(directory->parent);
+		platformUnlockMutex(&scan->mutex);
+	}
+
+	if (!directory_opened)
+	{
+		logError("Warning: Unable to open the directory %s.\n", directory->path);
+		platformLockMutex(&scan->mutex);
+		directoryScanRelease(directory);
+		platformUnlockMutex(&scan->mutex);
+		return;
+	}
+
+	// Collect the listing onto the worker's scratch arena.
+	scan_entry* entries = NULL;
+	bool has_ignore_file = false;
+	direntry entry = {0};
+	while (platformReadDirectory(&directory->handle, &entry))
+	{
+
+		if (strEquals(entry.name, DIRECTORY_SCAN_IGNORE_FILE))
+		{
+			has_ignore_file = true;
+			continue;
+		}
+
+		if (strEquals(entry.name, DIRECTORY_SCAN_ROLLBACK_DIR))
+			continue;
+
+		scan_entry* current_entry = (scan_entry*)directoryScanPush(&worker->arena, sizeof(scan_entry));
+		char* entry_name = directoryScanCopyString(&worker->arena, entry.name);
+		if (current_entry == NULL || entry_name == NULL)
+		{
+			logError("Warning: The listing of %s is too large, some entries were skipped.\n", directory->path);
+			break;
+		}
+
+		current_entry->name = entry_name;
+		current_entry->type = entry.type;
+		current_entry->next = entries;
+		entries = current_entry;
+
+	}
+
+	if (has_ignore_file)
+		directoryScanLoadIgnoreFile(worker, directory);
+
+	// Resolve and filter each entry before anything is shared.
+	scan_entry* accepted_entries = NULL;
+	while (entries != NULL)
+	{
+
+		scan_entry* current_entry = entries;
+		entries = entries->next;
+
+		if (current_entry->type == PLATFORM_PATHTYPE_UNKNOWN)
+			current_entry->type = platformGetPathTypeAt(&directory->handle, current_entry->name);
+
+		// Links are only followed to files, following them to directories risks cycles.
+		if (current_entry->type == PLATFORM_PATHTYPE_OTHER)
+		{
+			char* entry_path = directoryScanJoinPath(&worker->arena, directory->path, current_entry->name);
+			if (entry_path == NULL || platformGetPathType(entry_path) != PLATFORM_PATHTYPE_FILE)
+				continue;
+			current_entry->type = PLATFORM_PATHTYPE_FILE;
+		}
+
+		bool is_directory = (current_entry->type == PLATFORM_PATHTYPE_DIRECTORY);
+		if (is_directory && !scan->recursive)
+			continue;
+		if (!is_directory && (current_entry->type != PLATFORM_PATHTYPE_FILE ||
+			!directoryScanMatchesExtension(scan, current_entry->name)))
+			continue;
+		if (directoryScanIsIgnored(directory->ignore_patterns, current_entry->name, is_directory))
+			continue;
+
+		current_entry->next = accepted_entries;
+		accepted_entries = current_entry;
+
+	}
+
+	// Hand over everything that was accepted in a single pass under the lock.
+	platformLockMutex(&scan->mutex);
+
+	if (scan->keep_directories)
+	{
+		scan_file* kept_directory = (scan_file*)directoryScanPush(&scan->arena, sizeof(scan_file));
+		if (kept_directory != NULL)
+		{
+			kept_directory->path = directory->path;
+			kept_directory->next = scan->directory_head;
+			scan->directory_head = kept_directory;
+		}
+		else
+		{
+			scan->out_of_memory = true;
+		}
+	}
+
+	bool found_directory = false;
+	bool found_file = false;
+	for (scan_entry* current_entry = accepted_entries; current_entry != NULL; current_entry = current_entry->next)
+	{
+
+		char* entry_path = directoryScanJoinPath(&scan->arena, directory->path, current_entry->name);
+		if (entry_path == NULL)
+		{
+			scan->out_of_memory = true;
+			break;
+		}
+
+		if (current_entry->type == PLATFORM_PATHTYPE_DIRECTORY)
+		{
+			scan_directory* child = (scan_directory*)directoryScanPush(&scan->arena, sizeof(scan_directory));
+			char* child_name = directoryScanCopyString(&scan->arena, current_entry->name);
+			if (child == NULL || child_name == NULL)
+			{
+				scan->out_of_memory = true;
+				break;
+			}
+
+			child->path = entry_path;
+			child->name = child_name;
+			child->references = 1;
+			child->parent = directory;
+			child->ignore_patterns = directory->ignore_patterns;
+			child->next = scan->pending_directories;
+			scan->pending_directories = child;
+
+			directory->references++;
+			found_directory = true;
+		}
+		else
+		{
+			scan_file* file = (scan_file*)directoryScanPush(&scan->arena, sizeof(scan_file));
+			if (file == NULL)
+			{
+				scan->out_of_memory = true;
+				break;
+			}
+
+			file->path = entry_path;
+			if (scan->file_tail != NULL)
+				scan->file_tail->next = file;
+			else
+				scan->file_head = file;
+			scan->file_tail = file;
+
+			found_file = true;
+		}
+
+	}
+
+	directoryScanRelease(directory);
+
+	if (found_directory)
+		platformBroadcastCondition(&scan->work_condition);
+	if (found_file)
+		platformSignalCondition(&scan->file_condition);
+
+	platformUnlockMutex(&scan->mutex);
+
+}
+
+internal void
+directoryScanWorker(void* user_data)
+{
+
+	scan_worker* worker = (scan_worker*)user_data;
+	directory_scan* scan = worker->scan;
+	TRACE_NAME_THREAD("directoryScan");
+
+	// The worker's partition of the heap is untouched until now, so its pages can
+	// still be placed on the worker's own node.
+	virtual_bind_local_node(worker->entry_buffer, DIRECTORY_SCAN_THREAD_SIZE);
+
+	platformLockMutex(&scan->mutex);
+	while (true)
+	{
+
+		// Wait until there's a directory to walk or every other worker has run dry.
+		while (scan->pending_directories == NULL && scan->active_workers > 0)
+			platformWaitCondition(&scan->work_condition, &scan->mutex);
+
+		if (scan->pending_directories == NULL)
+			break;
+
+		scan_directory* directory = scan->pending_directories;
+		scan->pending_directories = directory->next;
+		scan->active_workers++;
+		platformUnlockMutex(&scan->mutex);
+
+		TRACE_ZONE_BEGIN("directoryScanDirectory");
+		directoryScanDirectory(worker, directory);
+		TRACE_ZONE_END();
+		arena_clear(&worker->arena);
+
+		platformLockMutex(&scan->mutex);
+		scan->active_workers--;
+
+		// The last worker to run dry ends the walk for everyone.
+		if (scan->pending_directories == NULL && scan->active_workers == 0)
+		{
+			scan->walk_complete = true;
+			platformBroadcastCondition(&scan->work_condition);
+			platformBroadcastCondition(&scan->file_condition);
+		}
+
+	}
+	platformUnlockMutex(&scan->mutex);
+
+}
+
+bool
+directoryScanCreate(directory_scan* scan, bool recursive, const char* extensions, uint32 thread_count)
+{
+
+	if (thread_count < 1)
+		thread_count = 1;
+	if (thread_count > DIRECTORY_SCAN_MAX_THREADS)
+		thread_count = DIRECTORY_SCAN_MAX_THREADS;
+
+	size_t heap_size = DIRECTORY_SCAN_SHARED_SIZE + DIRECTORY_SCAN_THREAD_SIZE * thread_count;
+	void* heap = NULL;
+	if (!virtual_allocate(&heap, &heap_size, 0))
+		return false;
+
+	scan->heap = heap;
+	scan->recursive = recursive;
+
+	// Partition each worker's scratch arena off the end of the heap.
+	arena_allocate(heap, DIRECTORY_SCAN_SHARED_SIZE, &scan->arena);
+	scan->workers = arena_push_array_zero(&scan->arena, scan_worker, thread_count);
+	scan->worker_count = thread_count;
+	for (uint32 worker_index = 0; worker_index < thread_count; ++worker_index)
+	{
+		scan_worker* worker = &scan->workers[worker_index];
+		void* worker_region = (uint8*)heap + DIRECTORY_SCAN_SHARED_SIZE + DIRECTORY_SCAN_THREAD_SIZE * worker_index;
+		worker->scan = scan;
+		worker->entry_buffer = worker_region;
+		arena_allocate((uint8*)worker_region + DIRECTORY_SCAN_ENTRY_BUFFER,
+			DIRECTORY_SCAN_THREAD_SIZE - DIRECTORY_SCAN_ENTRY_BUFFER, &worker->arena);
+	}
+
+	// Split the extension list, accepting both "txt" and ".txt".
+	scan->extensions = NULL;
+	scan->extension_count = 0;
+	if (extensions != NULL && extensions[0] != '\0')
+	{
+		size_t extension_capacity = 1;
+		for (const char* c = extensions; *c != '\0'; ++c)
+		{
+			if (*c == ',')
+				extension_capacity++;
+		}
+
+		scan->extensions = arena_push_array_zero(&scan->arena, char*, extension_capacity);
+		char* extension_list = directoryScanCopyString(&scan->arena, extensions);
+		char* current = extension_list;
+		while (current != NULL)
+		{
+			char* separator = current;
+			while (*separator != '\0' && *separator != ',')
+				separator++;
+
+			char* next = (*separator == ',') ? separator + 1 : NULL;
+			*separator = '\0';
+
+			if (*current == '.')
+				current++;
+			if (*current != '\0')
+				scan->extensions[scan->extension_count++] = current;
+
+			current = next;
+		}
+	}
+
+	platformCreateMutex(&scan->mutex);
+	platformCreateCondition(&scan->work_condition);
+	platformCreateCondition(&scan->file_condition);
+
+	scan->pending_directories = NULL;
+	scan->active_workers = 0;
+	scan->walk_complete = false;
+	scan->out_of_memory = false;
+	scan->file_head = NULL;
+	scan->file_tail = NULL;
+	scan->keep_directories = false;
+	scan->directory_head = NULL;
+
+	return true;
+
+}
+
+void
+directoryScanPushFile(directory_scan* scan, const char* path)
+{
+
+	scan_file* file = (scan_file*)directoryScanPush(&scan->arena, sizeof(scan_file));
+	char* file_path = directoryScanCopyString(&scan->arena, path);
+	if (file == NULL || file_path == NULL)
+	{
+		scan->out_of_memory = true;
+		return;
+	}
+
+	file->path = file_path;
+	if (scan->file_tail != NULL)
+		scan->file_tail->next = file;
+	else
+		scan->file_head = file;
+	scan->file_tail = file;
+
+}
+
+void
+directoryScanPushDirectory(directory_scan* scan, const char* path)
+{
+
+	scan_directory* directory = (scan_directory*)directoryScanPush(&scan->arena, sizeof(scan_directory));
+	char* directory_path = directoryScanCopyString(&scan->arena, path);
+	if (directory == NULL || directory_path == NULL)
+	{
+		scan->out_of_memory = true;
+		return;
+	}
+
+	directory->path = directory_path;
+	directory->name = directory_path;
+	directory->references = 1;
+	directory->next = scan->pending_directories;
+	scan->pending_directories = directory;
+
+}
+
+void
+directoryScanKeepDirectories(directory_scan* scan)
+{
+	scan->keep_directories = true;
+}
+
+void
+directoryScanStart(directory_scan* scan)
+{
+
+	// With nothing to walk, the queued files are all there is.
+	if (scan->pending_directories == NULL)
+	{
+		scan->walk_complete = true;
+		return;
+	}
+
+	uint32 started_count = 0;
+	for (uint32 worker_index = 0; worker_index < scan->worker_count; ++worker_index)
+	{
+		scan_worker* worker = &scan->workers[worker_index];
+		if (platformCreateThread(&worker->thread, directoryScanWorker, worker))
+			started_count++;
+	}
+
+	// If no threads could be started, walk on the calling thread instead.
+	if (started_count == 0)
+		directoryScanWorker(&scan->workers[0]);
+
+}
+
+bool
+directoryScanNextFile(directory_scan* scan, char** path)
+{
+
+	platformLockMutex(&scan->mutex);
+
+	while (scan->file_head == NULL && !scan->walk_complete)
+		platformWaitCondition(&scan->file_condition, &scan->mutex);
+
+	scan_file* file = scan->file_head;
+	if (file != NULL)
+	{
+		scan->file_head = file->next;
+		if (scan->file_head == NULL)
+			scan->file_tail = NULL;
+		*path = file->path;
+	}
+
+	platformUnlockMutex(&scan->mutex);
+
+	return (file != NULL);
+
+}
+
+bool
+directoryScanNextDirectory(directory_scan* scan, char** path)
+{
+
+	platformLockMutex(&scan->mutex);
+
+	scan_file* directory = scan->directory_head;
+	if (directory != NULL)
+	{
+		scan->directory_head = directory->next;
+		*path = directory->path;
+	}
+
+	platformUnlockMutex(&scan->mutex);
+
+	return (directory != NULL);
+
+}
+
+void
+directoryScanDestroy(directory_scan* scan)
+{
+
+	for (uint32 worker_index = 0; worker_index < scan->worker_count; ++worker_index)
+		platformJoinThread(&scan->workers[worker_index].thread);
+
+	if (scan->out_of_memory)
+		logError("Warning: The directory scan ran out of memory, some files were skipped.\n");
+
+	platformDestroyCondition(&scan->file_condition);
+	platformDestroyCondition(&scan->work_condition);
+	platformDestroyMutex(&scan->mutex);
+
+	arena_release(&scan->arena);
+	virtual_free(&scan->heap);
+
+}
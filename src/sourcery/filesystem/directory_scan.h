@@ -0,0 +1,192 @@
+/**
+ * The directory scanner expands the directories provided on the CLI into the
+ * list of scripts to process. Directories are walked by a pool of threads, each
+ * pulling the next pending directory and opening it relative to its already open
+ * parent. Files are handed to the consumer as soon as their directory has been
+ * read, so processing can begin long before the walk over a large tree finishes.
+ *
+ * Filtering happens during the walk:
+ * 		1. 	Only files with one of the requested extensions are kept, if any
+ * 			extensions were requested.
+ * 		2. 	A ".sourceryignore" file within a directory lists wildcard patterns,
+ * 			one per line, matched against entry names in that directory and all
+ * 			directories below it. Patterns ending with '/' only match directories
+ * 			and lines beginning with '#' are comments.
+ * 		3. 	The ".sourcery" rollback directory is never entered.
+ *
+ * The scanner owns its own virtual allocation, which is split into a shared arena
+ * for the paths handed to the consumer and a scratch arena for each thread.
+ */
+#ifndef SOURCERY_FILESYSTEM_DIRECTORY_SCAN_H
+#define SOURCERY_FILESYSTEM_DIRECTORY_SCAN_H
+#include <sourcery/generics.h>
+#include <sourcery/filesystem/directory.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/thread/thread.h>
+
+#define DIRECTORY_SCAN_IGNORE_FILE 		".sourceryignore"
+#define DIRECTORY_SCAN_ROLLBACK_DIR 	".sourcery"
+
+#define DIRECTORY_SCAN_MAX_THREADS 		16
+#define DIRECTORY_SCAN_SHARED_SIZE 		MEGABYTES(128)
+#define DIRECTORY_SCAN_THREAD_SIZE 		MEGABYTES(8)
+#define DIRECTORY_SCAN_ENTRY_BUFFER 	KILOBYTES(64)
+
+typedef struct scan_ignore_pattern
+{
+	char* 	pattern;
+	bool 	directory_only;
+
+	struct scan_ignore_pattern* next;
+} scan_ignore_pattern;
+
+/**
+ * A directory that is waiting to be walked or is being walked. The directory's
+ * handle stays open while any of its children have yet to be opened relative
+ * to it, which is tracked by the reference count.
+ */
+typedef struct scan_directory
+{
+	dirhandle 	handle;
+	char* 		path;
+	char* 		name;
+	uint32 		references;
+
+	struct scan_directory* 	parent;
+	scan_ignore_pattern* 	ignore_patterns;
+
+	struct scan_directory* 	next;
+} scan_directory;
+
+typedef struct scan_file
+{
+	char* path;
+
+	struct scan_file* next;
+} scan_file;
+
+typedef struct scan_worker
+{
+	platform_thread 		thread;
+	struct directory_scan* 	scan;
+	mem_arena 				arena;
+	void* 					entry_buffer;
+} scan_worker;
+
+typedef struct directory_scan
+{
+	bool 	recursive;
+	char** 	extensions;
+	size_t 	extension_count;
+
+	void* 		heap;
+	mem_arena 	arena;
+
+	platform_mutex 		mutex;
+	platform_condition 	work_condition;
+	platform_condition 	file_condition;
+
+	scan_directory* pending_directories;
+	uint32 			active_workers;
+	bool 			walk_complete;
+	bool 			out_of_memory;
+
+	scan_file* file_head;
+	scan_file* file_tail;
+
+	bool 		keep_directories;
+	scan_file* 	directory_head;
+
+	scan_worker* 	workers;
+	uint32 			worker_count;
+} directory_scan;
+
+/**
+ * Initializes a directory scan.
+ *
+ * @param scan The directory scan to initialize.
+ * @param recursive If true, subdirectories are walked, otherwise only the files
+ * directly within the provided directories are found.
+ * @param extensions A comma-separated list of file extensions to keep, or NULL to
+ * keep every file.
+ * @param thread_count The number of threads to walk with.
+ *
+ * @returns True if the scan was initialized, false if its memory couldn't be allocated.
+ */
+bool
+directoryScanCreate(directory_scan* scan, bool recursive, const char* extensions, uint32 thread_count);
+
+/**
+ * Queues a file to be handed to the consumer as-is, without any filtering. Files
+ * are handed back in the order they were queued, ahead of any found by the walk.
+ * This must be called before directoryScanStart().
+ *
+ * @param scan The directory scan.
+ * @param path The path to the file.
+ */
+void
+directoryScanPushFile(directory_scan* scan, const char* path);
+
+/**
+ * Queues a root directory to be walked. This must be called before directoryScanStart().
+ *
+ * @param scan The directory scan.
+ * @param path The path to the directory.
+ */
+void
+directoryScanPushDirectory(directory_scan* scan, const char* path);
+
+/**
+ * Has the walk keep the path of every directory it enters, the roots included, so
+ * that they can be fetched once it completes. This must be called before
+ * directoryScanStart().
+ *
+ * @param scan The directory scan.
+ */
+void
+directoryScanKeepDirectories(directory_scan* scan);
+
+/**
+ * Starts walking the queued directories in the background.
+ *
+ * @param scan The directory scan.
+ */
+void
+directoryScanStart(directory_scan* scan);
+
+/**
+ * Fetches the next file found by the scan, blocking until one is available or
+ * the walk has completed.
+ *
+ * @param scan The directory scan.
+ * @param path Set to the path of the file, which remains valid until the scan is
+ * destroyed.
+ *
+ * @returns True if a file was returned, false once every file has been returned.
+ */
+bool
+directoryScanNextFile(directory_scan* scan, char** path);
+
+/**
+ * Fetches the next directory entered by a scan that keeps its directories. This
+ * may only be called once directoryScanNextFile() has returned false.
+ *
+ * @param scan The directory scan.
+ * @param path Set to the path of the directory, which remains valid until the scan
+ * is destroyed.
+ *
+ * @returns True if a directory was returned, false once every directory has been
+ * returned.
+ */
+bool
+directoryScanNextDirectory(directory_scan* scan, char** path);
+
+/**
+ * Waits for the walk to finish and releases the scan's threads and memory.
+ *
+ * @param scan The directory scan to destroy.
+ */
+void
+directoryScanDestroy(directory_scan* scan);
+
+#endif
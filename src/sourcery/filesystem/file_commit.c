@@ -0,0 +1,152 @@
+#include <sourcery/filesystem/file_commit.h>
+#include <stdio.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/string/string_utils.h>
+
+void
+fileCommitCreate(file_commit* commit, mem_arena* arena, uint32 durability)
+{
+
+	file_commit empty_commit = {0};
+	*commit = empty_commit;
+	commit->durability = durability;
+	commit->pending_paths = arena_push_array_zero(arena, char*, FILE_COMMIT_MAX_PENDING);
+	commit->pending_hashes = arena_push_array_zero(arena, uint64, FILE_COMMIT_MAX_PENDING);
+	commit->path_pool = arena_push_array_zero(arena, char, FILE_COMMIT_PATH_POOL);
+
+}
+
+bool
+fileCommitOpen(file_commit* commit, commit_file* file, const char* path, bool atomic)
+{
+
+	commit_file empty_file = {0};
+	*file = empty_file;
+	file->path = path;
+	file->temporary = (atomic || commit->durability != FILE_COMMIT_NONE);
+
+	const char* open_path = path;
+	if (file->temporary)
+	{
+		int path_length = snprintf(file->temporary_path, sizeof(file->temporary_path), "%s%s",
+			path, FILE_COMMIT_SUFFIX);
+		if (path_length < 0 || (size_t)path_length >= sizeof(file->temporary_path))
+			return false;
+		open_path = file->temporary_path;
+	}
+
+	return platformOpenFile(&file->fh, open_path, PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE);
+
+}
+
+void
+fileCommitWrite(commit_file* file, const void* buffer, size_t buffer_size)
+{
+	if (platformWriteFile(&file->fh, (void*)buffer, buffer_size) != buffer_size)
+		file->write_failed = true;
+}
+
+/**
+ * Adds a closed file to the pending list by its temporary name. A file written
+ * again before it's committed is already pending under the same name.
+ */
+internal bool
+fileCommitQueue(file_commit* commit, const char* temporary_path)
+{
+
+	size_t path_length = strLength(temporary_path);
+	uint64 path_hash = hashMemory64(temporary_path, path_length, HASH64_SEED);
+	for (uint32 pending_index = 0; pending_index < commit->pending_count; ++pending_index)
+	{
+		if (commit->pending_hashes[pending_index] == path_hash &&
+			strEquals(commit->pending_paths[pending_index], temporary_path))
+			return true;
+	}
+
+	// A full list is committed early, so the file only has to wait for the next one.
+	bool committed = true;
+	if (commit->pending_count == FILE_COMMIT_MAX_PENDING ||
+		commit->path_pool_used + path_length + 1 > FILE_COMMIT_PATH_POOL)
+		committed = fileCommitFlush(commit);
+
+	char* pending_path = commit->path_pool + commit->path_pool_used;
+	for (size_t c_index = 0; c_index <= path_length; ++c_index)
+		pending_path[c_index] = temporary_path[c_index];
+	commit->path_pool_used += path_length + 1;
+
+	commit->pending_paths[commit->pending_count] = pending_path;
+	commit->pending_hashes[commit->pending_count] = path_hash;
+	commit->pending_count++;
+	return committed;
+
+}
+
+bool
+fileCommitClose(file_commit* commit, commit_file* file, bool keep)
+{
+
+	// A file written in place has already replaced its destination, so a discarded
+	// one is removed rather than left partially written.
+	bool kept = (keep && !file->write_failed);
+	if (!file->temporary)
+	{
+		platformCloseFile(&file->fh);
+		if (!keep)
+			platformRemoveFile(file->path);
+		return kept;
+	}
+
+	if (kept && commit->durability == FILE_COMMIT_FILE)
+		kept = platformSyncFile(&file->fh);
+	platformCloseFile(&file->fh);
+
+	if (!kept)
+	{
+		platformRemoveFile(file->temporary_path);
+		return false;
+	}
+
+	if (commit->durability == FILE_COMMIT_RUN)
+		return fileCommitQueue(commit, file->temporary_path);
+	return platformRenameFile(file->temporary_path, file->path);
+
+}
+
+bool
+fileCommitFlush(file_commit* commit)
+{
+
+	if (commit->pending_count == 0)
+		return true;
+
+	// Nothing is renamed unless everything reached the disk, otherwise a crash could
+	// leave a destination replaced by a partial file.
+	bool synced = platformSyncFilesystems(commit->pending_paths, commit->pending_count);
+	bool committed = synced;
+	for (uint32 pending_index = 0; pending_index < commit->pending_count; ++pending_index)
+	{
+
+		char* temporary_path = commit->pending_paths[pending_index];
+		if (!synced)
+		{
+			platformRemoveFile(temporary_path);
+			continue;
+		}
+
+		// The destination is the temporary name without its suffix.
+		size_t path_length = strLength(temporary_path) - FILE_COMMIT_SUFFIX_LENGTH;
+		char destination_path[FILE_COMMIT_PATH_SIZE];
+		for (size_t c_index = 0; c_index < path_length; ++c_index)
+			destination_path[c_index] = temporary_path[c_index];
+		destination_path[path_length] = '\0';
+
+		if (!platformRenameFile(temporary_path, destination_path))
+			committed = false;
+
+	}
+
+	commit->pending_count = 0;
+	commit->path_pool_used = 0;
+	return committed;
+
+}
@@ -0,0 +1,123 @@
+/**
+ * File commits decide how durably the files a run writes reach the disk. There
+ * are three levels of durability:
+ * 		1. 	None, files are written and left for the system to flush whenever it
+ * 			likes. A crash may leave files empty or partially written.
+ * 		2. 	Run, files are written to temporary names beside their destinations.
+ * 			When the files are committed, the filesystems holding them are flushed
+ * 			once and then every file is renamed over its destination in the order
+ * 			it was written.
+ * 		3. 	File, each file is flushed and renamed over its destination as soon as
+ * 			it's closed.
+ *
+ * With either of the last two, a crash leaves each destination holding either
+ * its old contents or its new contents, never a partial file. The run level only
+ * pays for a flush of each filesystem per commit rather than one for every file.
+ * Files at the run level aren't visible under their own names until they're
+ * committed, so anything that reads them, such as a command, must commit first.
+ */
+#ifndef SOURCERY_FILESYSTEM_FILE_COMMIT_H
+#define SOURCERY_FILESYSTEM_FILE_COMMIT_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/memory/alloc.h>
+
+#define FILE_COMMIT_NONE 	0
+#define FILE_COMMIT_RUN 	1
+#define FILE_COMMIT_FILE 	2
+
+#define FILE_COMMIT_SUFFIX 			".sourcery-tmp"
+#define FILE_COMMIT_SUFFIX_LENGTH 	(sizeof(FILE_COMMIT_SUFFIX) - 1)
+#define FILE_COMMIT_PATH_SIZE 		4096
+#define FILE_COMMIT_MAX_PENDING 	4096
+#define FILE_COMMIT_PATH_POOL 		MEGABYTES(1)
+
+/**
+ * The files written since the last commit, held by their temporary names. A full
+ * list is committed early rather than growing.
+ */
+typedef struct file_commit
+{
+	uint32 durability;
+
+	char** 		pending_paths;
+	uint64* 	pending_hashes;
+	uint32 		pending_count;
+	char* 		path_pool;
+	size_t 		path_pool_used;
+} file_commit;
+
+/**
+ * A file being written through a commit.
+ */
+typedef struct commit_file
+{
+	filehandle 	fh;
+	bool 		write_failed;
+
+	const char* path;
+	bool 		temporary;
+	char 		temporary_path[FILE_COMMIT_PATH_SIZE];
+} commit_file;
+
+/**
+ * Initializes a commit with nothing pending.
+ *
+ * @param commit The commit to initialize.
+ * @param arena The arena to place the pending list on, which must outlive it.
+ * @param durability One of the FILE_COMMIT levels.
+ */
+void
+fileCommitCreate(file_commit* commit, mem_arena* arena, uint32 durability);
+
+/**
+ * Opens a file for writing, replacing any file of the same name once the file is
+ * closed. At the none level the file is written in place unless it's asked to be
+ * replaced atomically.
+ *
+ * @param commit The commit.
+ * @param file The file to open.
+ * @param path The path of the file, which must stay valid until it's closed.
+ * @param atomic True if the file must never be seen partially written.
+ *
+ * @returns True if the file was opened, false if not.
+ */
+bool
+fileCommitOpen(file_commit* commit, commit_file* file, const char* path, bool atomic);
+
+/**
+ * Writes to a file that was opened. A failed write fails the file.
+ *
+ * @param file The file to write to.
+ * @param buffer The bytes to write.
+ * @param buffer_size The number of bytes to write.
+ */
+void
+fileCommitWrite(commit_file* file, const void* buffer, size_t buffer_size);
+
+/**
+ * Closes a file, which is flushed and renamed into place at the file level and
+ * left pending at the run level. A file that failed or is discarded never
+ * replaces its destination, other than a file written in place, which is removed
+ * when it's discarded.
+ *
+ * @param commit The commit.
+ * @param file The file to close.
+ * @param keep False to discard the file.
+ *
+ * @returns True if the file was kept without fail, false if not.
+ */
+bool
+fileCommitClose(file_commit* commit, commit_file* file, bool keep);
+
+/**
+ * Flushes the pending files and then renames each of them into place.
+ *
+ * @param commit The commit.
+ *
+ * @returns True if every pending file was committed, false if not.
+ */
+bool
+fileCommitFlush(file_commit* commit);
+
+#endif
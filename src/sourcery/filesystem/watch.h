@@ -0,0 +1,93 @@
+#ifndef SOURCERY_FILESYSTEM_WATCH_H
+#define SOURCERY_FILESYSTEM_WATCH_H
+#include <sourcery/generics.h>
+
+#define PLATFORM_WATCH_INFINITE 0xFFFFFFFF
+
+/**
+ * A filewatch reports changes made within a set of directories. Directories are
+ * watched rather than individual files since editors commonly save by writing a
+ * new file and renaming it over the original, which would silently end a watch
+ * placed on the file itself.
+ *
+ * Events are read in bulk into the caller-provided buffer and handed back one at
+ * a time.
+ */
+typedef struct filewatch
+{
+	size_t platform_handle_ptr;
+	size_t platform_handle_size;
+
+	uint8* 	buffer;
+	size_t 	buffer_size;
+	size_t 	buffer_length;
+	size_t 	buffer_offset;
+
+	uint32 	watch_count;
+} filewatch;
+
+/**
+ * A change within a watched directory. The name is the entry that changed and is
+ * only valid until the next read. Platforms which can't tell which entry changed
+ * report a NULL name, meaning anything within the directory may have changed.
+ */
+typedef struct watchevent
+{
+	uint32 		watch_id;
+	const char* name;
+} watchevent;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_watch.c
+ */
+
+/**
+ * Creates a filewatch with no directories being watched.
+ *
+ * @param watch The filewatch to fill out.
+ * @param buffer The buffer events are read into. This must outlive the filewatch.
+ * @param buffer_size The size of the buffer, in bytes.
+ *
+ * @returns True if the filewatch was created, false if not.
+ */
+bool
+platformCreateWatch(filewatch* watch, void* buffer, size_t buffer_size);
+
+/**
+ * Begins watching a directory for entries being written, created or renamed into it.
+ *
+ * @param watch The filewatch to add the directory to.
+ * @param directory_path The directory to watch.
+ * @param watch_id Set to the identifier reported by events within this directory.
+ *
+ * @returns True if the directory is being watched, false if not.
+ */
+bool
+platformAddWatch(filewatch* watch, const char* directory_path, uint32* watch_id);
+
+/**
+ * Waits for the next change within any of the watched directories.
+ *
+ * @param watch The filewatch to wait on.
+ * @param timeout_milliseconds How long to wait for a change, PLATFORM_WATCH_INFINITE
+ * to wait until one happens.
+ * @param event The event to fill out.
+ *
+ * @returns True if an event was read, false if the timeout elapsed first.
+ */
+bool
+platformReadWatch(filewatch* watch, uint32 timeout_milliseconds, watchevent* event);
+
+/**
+ * Stops watching all directories and releases the filewatch.
+ *
+ * @param watch The filewatch to destroy.
+ */
+void
+platformDestroyWatch(filewatch* watch);
+
+#endif
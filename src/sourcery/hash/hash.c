@@ -0,0 +1,214 @@
+#include <sourcery/hash/hash.h>
+
+#define HASH64_MULTIPLIER ((uint64)0xFF51AFD7ED558CCD)
+
+internal uint64
+hashMix64(uint64 value)
+{
+	value ^= value >> 33;
+	value *= HASH64_MULTIPLIER;
+	value ^= value >> 33;
+	return value;
+}
+
+uint64
+hashMemory64(const void* buffer, size_t buffer_size, uint64 seed)
+{
+
+	const uint8* bytes = (const uint8*)buffer;
+	uint64 hash = seed ^ ((uint64)buffer_size * HASH64_MULTIPLIER);
+
+	// Consume eight bytes at a time, assembled byte-wise so that unaligned
+	// buffers and either endianness give the same result.
+	size_t byte_index = 0;
+	while (byte_index + 8 <= buffer_size)
+	{
+		uint64 word = 0;
+		for (uint32 shift = 0; shift < 8; ++shift)
+			word |= (uint64)bytes[byte_index + shift] << (shift * 8);
+
+		hash = (hash ^ hashMix64(word)) * HASH64_SEED;
+		hash = (hash << 31) | (hash >> 33);
+		byte_index += 8;
+	}
+
+	// Fold in whatever remains.
+	uint64 tail = 0;
+	for (uint32 shift = 0; byte_index < buffer_size; ++byte_index, ++shift)
+		tail |= (uint64)bytes[byte_index] << (shift * 8);
+
+	hash = (hash ^ hashMix64(tail)) * HASH64_SEED;
+	return hashMix64(hash);
+
+}
+
+persist const uint32 hash_sha256_rounds[64] =
+{
+	0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+	0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+	0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+	0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+	0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+	0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+	0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+	0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2,
+};
+
+internal uint32
+hashRotateRight32(uint32 value, uint32 count)
+{
+	return (value >> count) | (value << (32 - count));
+}
+
+/**
+ * Folds one 64-byte block into the digest's state.
+ */
+internal void
+hashSha256Block(hash_sha256* hash, const uint8* block)
+{
+
+	uint32 schedule[64];
+	for (uint32 word_index = 0; word_index < 16; ++word_index)
+	{
+		const uint8* word = block + word_index * 4;
+		schedule[word_index] = ((uint32)word[0] << 24) | ((uint32)word[1] << 16) |
+			((uint32)word[2] << 8) | (uint32)word[3];
+	}
+	for (uint32 word_index = 16; word_index < 64; ++word_index)
+	{
+		uint32 early = schedule[word_index - 15];
+		uint32 late = schedule[word_index - 2];
+		uint32 sigma0 = hashRotateRight32(early, 7) ^ hashRotateRight32(early, 18) ^ (early >> 3);
+		uint32 sigma1 = hashRotateRight32(late, 17) ^ hashRotateRight32(late, 19) ^ (late >> 10);
+		schedule[word_index] = schedule[word_index - 16] + sigma0 + schedule[word_index - 7] + sigma1;
+	}
+
+	uint32 a = hash->state[0], b = hash->state[1], c = hash->state[2], d = hash->state[3];
+	uint32 e = hash->state[4], f = hash->state[5], g = hash->state[6], h = hash->state[7];
+	for (uint32 round_index = 0; round_index < 64; ++round_index)
+	{
+		uint32 sum1 = hashRotateRight32(e, 6) ^ hashRotateRight32(e, 11) ^ hashRotateRight32(e, 25);
+		uint32 choose = (e & f) ^ (~e & g);
+		uint32 first = h + sum1 + choose + hash_sha256_rounds[round_index] + schedule[round_index];
+		uint32 sum0 = hashRotateRight32(a, 2) ^ hashRotateRight32(a, 13) ^ hashRotateRight32(a, 22);
+		uint32 majority = (a & b) ^ (a & c) ^ (b & c);
+		uint32 second = sum0 + majority;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + first;
+		d = c;
+		c = b;
+		b = a;
+		a = first + second;
+	}
+
+	hash->state[0] += a;
+	hash->state[1] += b;
+	hash->state[2] += c;
+	hash->state[3] += d;
+	hash->state[4] += e;
+	hash->state[5] += f;
+	hash->state[6] += g;
+	hash->state[7] += h;
+
+}
+
+void
+hashSha256Begin(hash_sha256* hash)
+{
+
+	hash->state[0] = 0x6A09E667;
+	hash->state[1] = 0xBB67AE85;
+	hash->state[2] = 0x3C6EF372;
+	hash->state[3] = 0xA54FF53A;
+	hash->state[4] = 0x510E527F;
+	hash->state[5] = 0x9B05688C;
+	hash->state[6] = 0x1F83D9AB;
+	hash->state[7] = 0x5BE0CD19;
+	hash->length = 0;
+	hash->block_used = 0;
+
+}
+
+void
+hashSha256Update(hash_sha256* hash, const void* buffer, size_t buffer_size)
+{
+
+	const uint8* bytes = (const uint8*)buffer;
+	hash->length += buffer_size;
+
+	// Top up a partial block first, then take whole blocks straight from the buffer.
+	if (hash->block_used != 0)
+	{
+		while (hash->block_used < 64 && buffer_size > 0)
+		{
+			hash->block[hash->block_used++] = *bytes++;
+			buffer_size--;
+		}
+		if (hash->block_used < 64)
+			return;
+		hashSha256Block(hash, hash->block);
+		hash->block_used = 0;
+	}
+
+	while (buffer_size >= 64)
+	{
+		hashSha256Block(hash, bytes);
+		bytes += 64;
+		buffer_size -= 64;
+	}
+
+	while (buffer_size > 0)
+	{
+		hash->block[hash->block_used++] = *bytes++;
+		buffer_size--;
+	}
+
+}
+
+void
+hashSha256Finish(hash_sha256* hash, uint8* digest)
+{
+
+	// The input is padded with a single set bit, then zeroes up to the last eight
+	// bytes of a block, which hold the input's length in bits.
+	uint64 bit_length = hash->length * 8;
+	hash->block[hash->block_used++] = 0x80;
+	if (hash->block_used > 56)
+	{
+		while (hash->block_used < 64)
+			hash->block[hash->block_used++] = 0;
+		hashSha256Block(hash, hash->block);
+		hash->block_used = 0;
+	}
+	while (hash->block_used < 56)
+		hash->block[hash->block_used++] = 0;
+	for (uint32 byte_index = 0; byte_index < 8; ++byte_index)
+		hash->block[56 + byte_index] = (uint8)(bit_length >> (56 - byte_index * 8));
+	hashSha256Block(hash, hash->block);
+
+	for (uint32 word_index = 0; word_index < 8; ++word_index)
+	{
+		digest[word_index * 4 + 0] = (uint8)(hash->state[word_index] >> 24);
+		digest[word_index * 4 + 1] = (uint8)(hash->state[word_index] >> 16);
+		digest[word_index * 4 + 2] = (uint8)(hash->state[word_index] >> 8);
+		digest[word_index * 4 + 3] = (uint8)(hash->state[word_index]);
+	}
+
+}
+
+void
+hashSha256Format(const uint8* digest, char* text)
+{
+
+	persist const char hex_digits[] = "0123456789abcdef";
+	for (uint32 byte_index = 0; byte_index < HASH_SHA256_SIZE; ++byte_index)
+	{
+		text[byte_index * 2 + 0] = hex_digits[digest[byte_index] >> 4];
+		text[byte_index * 2 + 1] = hex_digits[digest[byte_index] & 0xF];
+	}
+	text[HASH_SHA256_SIZE * 2] = '\0';
+
+}
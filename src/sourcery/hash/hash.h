@@ -0,0 +1,77 @@
+#ifndef SOURCERY_HASH_HASH_H
+#define SOURCERY_HASH_HASH_H
+#include <sourcery/generics.h>
+
+#define HASH64_SEED ((uint64)0x9E3779B97F4A7C15)
+
+/**
+ * Computes a fast, non-cryptographic 64-bit hash over a region of memory. The
+ * seed allows a hash to be continued across several regions by passing the
+ * previous result back in, which lets large files be hashed in chunks. Chained
+ * hashes are only comparable when the same chunk sizes were used.
+ *
+ * This is only suitable for detecting changes and bucketing, it must never be
+ * relied on where an adversary controls the input.
+ *
+ * @param buffer The region of memory to hash.
+ * @param buffer_size The size of the region, in bytes.
+ * @param seed The starting value, HASH64_SEED or a previous result.
+ *
+ * @returns The 64-bit hash.
+ */
+uint64
+hashMemory64(const void* buffer, size_t buffer_size, uint64 seed);
+
+#define HASH_SHA256_SIZE 		32
+#define HASH_SHA256_TEXT_SIZE 	(HASH_SHA256_SIZE * 2 + 1)
+
+/**
+ * A SHA-256 digest being computed. Unlike hashMemory64(), the digest doesn't
+ * depend on how the input was split up, and two different inputs can be trusted
+ * to never share one, so it's what names anything stored by its contents.
+ */
+typedef struct hash_sha256
+{
+	uint32 	state[8];
+	uint64 	length;
+	uint8 	block[64];
+	uint32 	block_used;
+} hash_sha256;
+
+/**
+ * Begins a SHA-256 digest.
+ *
+ * @param hash The digest to begin.
+ */
+void
+hashSha256Begin(hash_sha256* hash);
+
+/**
+ * Continues a SHA-256 digest with a region of memory.
+ *
+ * @param hash The digest.
+ * @param buffer The region of memory to hash.
+ * @param buffer_size The size of the region, in bytes.
+ */
+void
+hashSha256Update(hash_sha256* hash, const void* buffer, size_t buffer_size);
+
+/**
+ * Finishes a SHA-256 digest, after which it must be begun again to be reused.
+ *
+ * @param hash The digest.
+ * @param digest Set to the digest's bytes.
+ */
+void
+hashSha256Finish(hash_sha256* hash, uint8* digest);
+
+/**
+ * Formats a digest as lowercase hexadecimal.
+ *
+ * @param digest The digest's bytes.
+ * @param text The buffer to place the text in, HASH_SHA256_TEXT_SIZE bytes long.
+ */
+void
+hashSha256Format(const uint8* digest, char* text);
+
+#endif
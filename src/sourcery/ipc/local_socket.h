@@ -0,0 +1,147 @@
+/**
+ * Local sockets connect processes on the same machine. Along with ordinary data,
+ * a message may carry the sender's standard input, output and error handles so
+ * that the receiver can work directly on the sender's terminal or pipes.
+ *
+ * Sockets are private to the user who created them. A listening socket can only
+ * be reached by its owner, and both ends drop a connection whose other end runs
+ * as a different user.
+ */
+#ifndef SOURCERY_IPC_LOCAL_SOCKET_H
+#define SOURCERY_IPC_LOCAL_SOCKET_H
+#include <sourcery/generics.h>
+
+typedef struct localsocket
+{
+	size_t platform_handle_ptr;
+	size_t platform_handle_size;
+} localsocket;
+
+/**
+ * The standard input, output and error handles of a process, in that order.
+ */
+typedef struct standard_handles
+{
+	size_t 	platform_handles[3];
+	bool 	valid;
+} standard_handles;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_local_socket.c
+ */
+
+/**
+ * Finds a directory that only the current user can reach, for placing sockets in.
+ * This is the user's runtime directory when it has one, or otherwise a directory
+ * of the user's own within the temporary directory, which is created if needed.
+ *
+ * @param buffer The buffer to place the directory's path in.
+ * @param buffer_size The size of the buffer, in bytes.
+ *
+ * @returns True if the directory was found, false if there's no private directory
+ * to be had or its path doesn't fit.
+ */
+bool
+platformGetLocalSocketDirectory(char* buffer, size_t buffer_size);
+
+/**
+ * Creates a socket at the given path and begins listening for connections. A
+ * stale socket of our own left at the path is replaced, a live one, or anything
+ * we don't own, is not. The socket can only be reached by the current user.
+ *
+ * @param listener The socket to fill out.
+ * @param socket_path The path to create the socket at.
+ *
+ * @returns True if the socket is listening, false if not.
+ */
+bool
+platformListenLocalSocket(localsocket* listener, const char* socket_path);
+
+/**
+ * Blocks until a connection is made to a listening socket. A connection from
+ * another user is closed straight away and not accepted.
+ *
+ * @param listener The listening socket.
+ * @param connection The socket to fill out with the new connection.
+ *
+ * @returns True if a connection was accepted, false if not.
+ */
+bool
+platformAcceptLocalSocket(localsocket* listener, localsocket* connection);
+
+/**
+ * Connects to a listening socket, so long as it's listened on by the current user.
+ *
+ * @param connection The socket to fill out.
+ * @param socket_path The path of the listening socket.
+ *
+ * @returns True if the connection was made, false if not.
+ */
+bool
+platformConnectLocalSocket(localsocket* connection, const char* socket_path);
+
+/**
+ * Sends the entire buffer over a connection.
+ *
+ * @param connection The connection to send on.
+ * @param buffer The data to send.
+ * @param buffer_size The size of the data, in bytes.
+ * @param attach_standard_handles If true, this process's standard handles are sent
+ * along with the data.
+ *
+ * @returns True if everything was sent, false if not.
+ */
+bool
+platformSendLocalSocket(localsocket* connection, const void* buffer, size_t buffer_size,
+	bool attach_standard_handles);
+
+/**
+ * Receives exactly buffer_size bytes from a connection.
+ *
+ * @param connection The connection to receive on.
+ * @param buffer The buffer to receive into.
+ * @param buffer_size The number of bytes to receive.
+ * @param handles If not NULL, filled out with any standard handles that were sent.
+ * The handles belong to the caller and must be released.
+ *
+ * @returns True if everything was received, false if the connection closed first.
+ */
+bool
+platformReceiveLocalSocket(localsocket* connection, void* buffer, size_t buffer_size,
+	standard_handles* handles);
+
+/**
+ * Closes a socket. Closing a listening socket also removes it from the filesystem,
+ * as long as the socket there is still our own.
+ *
+ * @param socket The socket to close.
+ * @param socket_path The path the socket listens at, or NULL for connections.
+ */
+void
+platformCloseLocalSocket(localsocket* socket, const char* socket_path);
+
+/**
+ * Installs handles as this process's standard handles. The handles that were
+ * installed before are kept in previous so that they can be put back.
+ *
+ * @param handles The handles to install.
+ * @param previous Filled out with the handles that were replaced.
+ *
+ * @returns True if the handles were installed, false if not.
+ */
+bool
+platformSwapStandardHandles(standard_handles* handles, standard_handles* previous);
+
+/**
+ * Closes a set of standard handles which were received or replaced.
+ *
+ * @param handles The handles to close.
+ */
+void
+platformReleaseStandardHandles(standard_handles* handles);
+
+#endif
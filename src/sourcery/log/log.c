@@ -0,0 +1,413 @@
+#include <sourcery/log/log.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sourcery/thread/atomics.h>
+#include <sourcery/thread/thread.h>
+#include <sourcery/time/clock.h>
+
+#if defined(_MSC_VER)
+#	define log_thread_local __declspec(thread)
+#else
+#	define log_thread_local _Thread_local
+#endif
+
+/**
+ * Records are padded to a multiple of the header size so that the space left at
+ * the end of a ring always fits a padding record, which the writer skips.
+ */
+#define LOG_RECORD_PADDING 0xFFFFFFFF
+
+typedef struct log_record_header
+{
+	uint32 	size;
+	uint32 	level;
+	uint64 	ticket;
+} log_record_header;
+
+#define logRecordSpan(size) \
+	(((size) + (uint32)sizeof(log_record_header) - 1) & ~((uint32)sizeof(log_record_header) - 1))
+
+/**
+ * Each logBegin() starts a new generation, which tells threads that the ring
+ * they were handed by an earlier run is no longer theirs. The flags and the
+ * generation are read by every thread that logs, so they're only ever accessed
+ * atomically.
+ */
+persist volatile bool 	log_active;
+persist volatile bool 	log_stopping;
+persist uint32 			log_verbosity = LOG_LEVEL_INFO;
+persist volatile uint32 log_generation;
+
+persist platform_mutex 	log_mutex;
+persist platform_mutex 	log_drain_mutex;
+persist bool 			log_mutexes_created;
+persist log_ring* 		log_rings;
+persist volatile uint64 log_ring_count;
+persist platform_thread log_writer;
+
+/**
+ * Tickets order every message. The gap before script n is ticket 2n and script n
+ * itself is ticket 2n + 1. A script's slot in the done window holds n + 1 once
+ * it has been closed.
+ */
+persist volatile uint64 log_scripts_opened;
+persist volatile uint64 log_script_done[LOG_SCRIPT_WINDOW];
+persist volatile uint64 log_current_ticket;
+
+persist char* 	log_write_buffer;
+persist size_t 	log_write_length;
+
+persist log_thread_local log_ring* 	log_thread_ring;
+persist log_thread_local uint32 	log_thread_generation;
+
+internal log_ring*
+logGetThreadRing(void)
+{
+
+	uint32 generation = atomicLoadAcquire32(&log_generation);
+	if (log_thread_generation == generation)
+		return log_thread_ring;
+
+	platformLockMutex(&log_mutex);
+	log_thread_ring = NULL;
+	uint64 ring_count = atomicLoadAcquire64(&log_ring_count);
+	if (ring_count < LOG_MAX_THREADS)
+	{
+		log_thread_ring = &log_rings[ring_count];
+		atomicStoreRelease64(&log_ring_count, ring_count + 1);
+	}
+	log_thread_generation = generation;
+	platformUnlockMutex(&log_mutex);
+
+	return log_thread_ring;
+
+}
+
+internal void
+logFlushWriteBuffer(void)
+{
+	if (log_write_length > 0)
+		fwrite(log_write_buffer, 1, log_write_length, stdout);
+	log_write_length = 0;
+	fflush(stdout);
+}
+
+internal void
+logEmitText(const char* text, size_t text_length)
+{
+
+	if (log_write_length + text_length > LOG_WRITE_BUFFER)
+	{
+		fwrite(log_write_buffer, 1, log_write_length, stdout);
+		log_write_length = 0;
+	}
+
+	for (size_t c_index = 0; c_index < text_length; ++c_index)
+		log_write_buffer[log_write_length++] = text[c_index];
+
+}
+
+/**
+ * Emits every message of a ticket sitting at the head of a ring. Rings only ever
+ * hold tickets in increasing order, so a ring whose head is a later ticket holds
+ * none of the current one.
+ *
+ * @returns True if any message was emitted.
+ */
+internal bool
+logDrainTicket(uint64 ticket)
+{
+
+	bool emitted = false;
+	uint64 ring_count = atomicLoadAcquire64(&log_ring_count);
+	for (uint64 ring_index = 0; ring_index < ring_count; ++ring_index)
+	{
+		log_ring* ring = &log_rings[ring_index];
+		uint64 read_offset = ring->read_offset;
+		uint64 write_offset = atomicLoadAcquire64(&ring->write_offset);
+
+		while (read_offset < write_offset)
+		{
+			log_record_header* header = (log_record_header*)(ring->buffer + (read_offset & (LOG_RING_SIZE - 1)));
+			if (header->level != LOG_RECORD_PADDING)
+			{
+				if (header->ticket != ticket)
+					break;
+				logEmitText((const char*)(header + 1), header->size - sizeof(log_record_header));
+				emitted = true;
+			}
+			read_offset += logRecordSpan(header->size);
+		}
+
+		atomicStoreRelease64(&ring->read_offset, read_offset);
+	}
+
+	return emitted;
+
+}
+
+/**
+ * Emits everything that can be emitted in order. This is the only consumer of the
+ * rings and must be called with the drain mutex held.
+ *
+ * @param final If true, no more scripts are coming, so the gap after the last
+ * script is complete.
+ */
+internal void
+logDrain(bool final)
+{
+
+	uint64 ticket = log_current_ticket;
+	while (true)
+	{
+
+		bool emitted = logDrainTicket(ticket);
+
+		uint64 script = ticket / 2;
+		bool ticket_done = (ticket % 2 == 0) ?
+			(final || atomicLoadAcquire64(&log_scripts_opened) > script) :
+			(atomicLoadAcquire64(&log_script_done[script % LOG_SCRIPT_WINDOW]) == script + 1);
+
+		if (!ticket_done)
+		{
+			if (!emitted)
+				break;
+			continue;
+		}
+
+		// Messages written before the ticket was done are visible now, so one more
+		// pass catches any that were missed.
+		if (logDrainTicket(ticket))
+			continue;
+
+		ticket++;
+		atomicStoreRelease64(&log_current_ticket, ticket);
+
+		// Past the last script, the final gap has been written.
+		if (final && ticket % 2 == 1 && ticket / 2 >= atomicLoadAcquire64(&log_scripts_opened))
+			break;
+
+	}
+
+	logFlushWriteBuffer();
+
+}
+
+internal void
+logWriterProc(void* user_data)
+{
+
+	(void)user_data;
+	while (!atomicLoadAcquire32(&log_stopping))
+	{
+		platformLockMutex(&log_drain_mutex);
+		logDrain(false);
+		platformUnlockMutex(&log_drain_mutex);
+		platformSleepMilliseconds(1);
+	}
+
+}
+
+void
+logBegin(mem_arena* arena, uint32 verbosity)
+{
+
+	if (!log_mutexes_created)
+	{
+		platformCreateMutex(&log_mutex);
+		platformCreateMutex(&log_drain_mutex);
+		log_mutexes_created = true;
+	}
+
+	log_verbosity = verbosity;
+	log_rings = arena_push_array_zero(arena, log_ring, LOG_MAX_THREADS);
+	for (uint32 ring_index = 0; ring_index < LOG_MAX_THREADS; ++ring_index)
+		log_rings[ring_index].buffer = arena_push_array(arena, uint8, LOG_RING_SIZE);
+	log_write_buffer = arena_push_array(arena, char, LOG_WRITE_BUFFER);
+	log_write_length = 0;
+
+	log_ring_count = 0;
+	log_scripts_opened = 0;
+	log_current_ticket = 0;
+	for (uint32 script_index = 0; script_index < LOG_SCRIPT_WINDOW; ++script_index)
+		log_script_done[script_index] = 0;
+	atomicStoreRelease32(&log_generation, atomicLoadAcquire32(&log_generation) + 1);
+
+	// Anything printed directly beforehand has to land first.
+	fflush(stdout);
+
+	atomicStoreRelease32(&log_stopping, false);
+	atomicStoreRelease32(&log_active, platformCreateThread(&log_writer, logWriterProc, NULL));
+
+}
+
+void
+logEnd(void)
+{
+
+	if (!atomicLoadAcquire32(&log_active))
+		return;
+
+	atomicStoreRelease32(&log_stopping, true);
+	platformJoinThread(&log_writer);
+
+	platformLockMutex(&log_drain_mutex);
+	logDrain(true);
+	platformUnlockMutex(&log_drain_mutex);
+	atomicStoreRelease32(&log_active, false);
+
+}
+
+void
+logFlush(void)
+{
+
+	if (!atomicLoadAcquire32(&log_active))
+	{
+		fflush(stdout);
+		return;
+	}
+
+	platformLockMutex(&log_drain_mutex);
+	logDrain(false);
+	platformUnlockMutex(&log_drain_mutex);
+
+}
+
+uint32
+logGetVerbosity(void)
+{
+	return log_verbosity;
+}
+
+void
+logOpenScript(void)
+{
+
+	if (!atomicLoadAcquire32(&log_active))
+		return;
+
+	log_ring* ring = logGetThreadRing();
+	if (ring == NULL)
+		return;
+
+	// A script can only take a slot in the done window once the writer has moved
+	// past the script that last held it.
+	uint64 script = atomicFetchAdd64(&log_scripts_opened, 1);
+	while (script >= atomicLoadAcquire64(&log_current_ticket) / 2 + LOG_SCRIPT_WINDOW)
+		platformSleepMilliseconds(1);
+
+	ring->script = script;
+	ring->script_open = true;
+
+}
+
+void
+logCloseScript(void)
+{
+
+	if (!atomicLoadAcquire32(&log_active))
+		return;
+
+	log_ring* ring = logGetThreadRing();
+	if (ring == NULL || !ring->script_open)
+		return;
+
+	atomicStoreRelease64(&log_script_done[ring->script % LOG_SCRIPT_WINDOW], ring->script + 1);
+	ring->script_open = false;
+
+}
+
+internal void
+logWriteVariadic(uint32 level, const char* format, va_list arguments)
+{
+
+	if (level > log_verbosity)
+		return;
+
+	log_ring* ring = atomicLoadAcquire32(&log_active) ? logGetThreadRing() : NULL;
+	if (ring == NULL)
+	{
+		vprintf(format, arguments);
+		return;
+	}
+
+	char message[LOG_MAX_MESSAGE];
+	int message_length = vsnprintf(message, sizeof(message), format, arguments);
+	if (message_length <= 0)
+		return;
+	if ((size_t)message_length >= sizeof(message))
+		message_length = (int)sizeof(message) - 1;
+
+	uint32 header_size = (uint32)sizeof(log_record_header);
+	uint32 record_size = logRecordSpan(header_size + (uint32)message_length);
+
+	// A record that won't fit before the end of the ring is preceded by padding
+	// that runs to the end, so every record is contiguous.
+	uint64 write_offset = ring->write_offset;
+	uint64 space_to_end = LOG_RING_SIZE - (write_offset & (LOG_RING_SIZE - 1));
+	uint64 padding_size = (space_to_end < record_size) ? space_to_end : 0;
+
+	// The writer is the only thing that frees space, so a full ring waits on it.
+	while (write_offset + padding_size + record_size - atomicLoadAcquire64(&ring->read_offset) > LOG_RING_SIZE)
+		platformSleepMilliseconds(1);
+
+	if (padding_size > 0)
+	{
+		log_record_header* padding = (log_record_header*)(ring->buffer + (write_offset & (LOG_RING_SIZE - 1)));
+		padding->size = (uint32)padding_size;
+		padding->level = LOG_RECORD_PADDING;
+		padding->ticket = 0;
+		write_offset += padding_size;
+	}
+
+	log_record_header* header = (log_record_header*)(ring->buffer + (write_offset & (LOG_RING_SIZE - 1)));
+	header->size = header_size + (uint32)message_length;
+	header->level = level;
+	header->ticket = ring->script_open ?
+		ring->script * 2 + 1 :
+		atomicLoadAcquire64(&log_scripts_opened) * 2;
+
+	char* text = (char*)(header + 1);
+	for (int c_index = 0; c_index < message_length; ++c_index)
+		text[c_index] = message[c_index];
+
+	atomicStoreRelease64(&ring->write_offset, write_offset + record_size);
+
+}
+
+void
+logWrite(uint32 level, const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	logWriteVariadic(level, format, arguments);
+	va_end(arguments);
+}
+
+void
+logError(const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	logWriteVariadic(LOG_LEVEL_ERROR, format, arguments);
+	va_end(arguments);
+}
+
+void
+logInfo(const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	logWriteVariadic(LOG_LEVEL_INFO, format, arguments);
+	va_end(arguments);
+}
+
+void
+logDebug(const char* format, ...)
+{
+	va_list arguments;
+	va_start(arguments, format);
+	logWriteVariadic(LOG_LEVEL_DEBUG, format, arguments);
+	va_end(arguments);
+}
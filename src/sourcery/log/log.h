@@ -0,0 +1,113 @@
+/**
+ * The log keeps console output off of the hot path. Each thread formats its
+ * messages into its own ring buffer without taking a lock, and a single writer
+ * thread drains the rings to standard output in large writes.
+ *
+ * Output is ordered by script rather than by when it was written. Every message
+ * belongs to the script its thread has open, or to the gap between scripts if it
+ * has none, and the writer only moves on to a script's messages once everything
+ * before it is complete. Within a script, messages stay in the order they were
+ * written, which is line order. Runs therefore produce the same output however
+ * their scripts are spread across threads.
+ *
+ * Messages are only written if their level is at or below the verbosity. Outside
+ * of logBegin() and logEnd(), messages are printed directly.
+ */
+#ifndef SOURCERY_LOG_LOG_H
+#define SOURCERY_LOG_LOG_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+
+#define LOG_LEVEL_ERROR 	0
+#define LOG_LEVEL_INFO 		1
+#define LOG_LEVEL_DEBUG 	2
+
+#define LOG_MAX_THREADS 	32
+#define LOG_RING_SIZE 		KILOBYTES(64)
+#define LOG_MAX_MESSAGE 	KILOBYTES(2)
+#define LOG_SCRIPT_WINDOW 	4096
+#define LOG_WRITE_BUFFER 	KILOBYTES(64)
+
+/**
+ * A single-producer, single-consumer ring of messages. The owning thread advances
+ * the write offset and the writer advances the read offset, each publishing with
+ * a release store. Both are kept on their own cache lines.
+ */
+typedef struct log_ring
+{
+	uint8* 	buffer;
+	uint64 	script;
+	bool 	script_open;
+
+	uint8 			producer_padding[40];
+	volatile uint64 write_offset;
+	uint8 			write_padding[56];
+	volatile uint64 read_offset;
+	uint8 			read_padding[56];
+} log_ring;
+
+/**
+ * Begins logging through the rings and starts the writer thread.
+ *
+ * @param arena The arena to place the rings on.
+ * @param verbosity The highest level of message to write.
+ */
+void
+logBegin(mem_arena* arena, uint32 verbosity);
+
+/**
+ * Writes out every remaining message and stops the writer thread. The verbosity
+ * stays in effect for messages printed directly afterwards.
+ */
+void
+logEnd(void);
+
+/**
+ * Blocks until the messages written so far are on standard output, so that output
+ * written around the log, such as a child process's, lands after them. Messages
+ * waiting on an earlier script that is still open can't be written yet.
+ */
+void
+logFlush(void);
+
+/**
+ * Fetches the highest level of message being written.
+ *
+ * @returns The verbosity.
+ */
+uint32
+logGetVerbosity(void);
+
+/**
+ * Opens the next script on the calling thread. Messages written by the thread
+ * belong to the script until it is closed. Scripts are ordered by when they were
+ * opened.
+ */
+void
+logOpenScript(void);
+
+/**
+ * Closes the script open on the calling thread, letting the writer move past it.
+ */
+void
+logCloseScript(void);
+
+/**
+ * Writes a formatted message, which should end with its own newline.
+ *
+ * @param level The level of the message.
+ * @param format The printf-style format of the message.
+ */
+void
+logWrite(uint32 level, const char* format, ...);
+
+/**
+ * Writes a formatted message at the error, info or debug level.
+ *
+ * @param format The printf-style format of the message.
+ */
+void logError(const char* format, ...);
+void logInfo(const char* format, ...);
+void logDebug(const char* format, ...);
+
+#endif
@@ -6,6 +6,7 @@ arena_allocate(void* region, size_t region_size, mem_arena* arena)
 	arena->buffer = region;
 	arena->size = region_size;
 	arena->offset = 0;
+	arena->stats = NULL;
 
 	return;
 }
@@ -17,6 +18,7 @@ arena_release(mem_arena* arena)
 	arena->buffer = NULL;
 	arena->size = 0;
 	arena->offset = 0;
+	arena->stats = NULL;
 
 	return;
 
@@ -41,6 +43,17 @@ arena_push(mem_arena* arena, size_t size)
 	void* buffer = (uint8*)arena->buffer + arena->offset;
 	arena->offset += size;
 
+	if (arena->stats != NULL)
+	{
+		mem_arena_stats* stats = arena->stats;
+		stats->push_count++;
+		stats->bytes_pushed += size;
+		stats->tags[stats->current_tag].push_count++;
+		stats->tags[stats->current_tag].bytes_pushed += size;
+		if (arena->offset > stats->peak_offset)
+			stats->peak_offset = arena->offset;
+	}
+
 	return buffer;
 
 }
@@ -53,6 +66,12 @@ arena_push_zero(mem_arena* arena, size_t size)
 	void* buffer = arena_push(arena, size);
 	memory_set(buffer, size, 0x00);
 
+	if (arena->stats != NULL)
+	{
+		arena->stats->bytes_zeroed += size;
+		arena->stats->tags[arena->stats->current_tag].bytes_zeroed += size;
+	}
+
 	return buffer;
 
 }
@@ -61,8 +80,12 @@ void
 arena_pop(mem_arena* arena, size_t size)
 {
 
-	arena->offset -= size;
-	if (arena->offset < 0) arena->offset = 0;
+	// The offset is unsigned, so clamp before subtracting rather than after.
+	if (size > arena->offset) arena->offset = 0;
+	else arena->offset -= size;
+
+	if (arena->stats != NULL)
+		arena->stats->pop_count++;
 
 }
 
@@ -72,6 +95,9 @@ arena_clear(mem_arena* arena)
 
 	arena->offset = 0;
 
+	if (arena->stats != NULL)
+		arena->stats->clear_count++;
+
 }
 
 size_t
@@ -84,4 +110,108 @@ void
 arena_restore(mem_arena* arena, size_t stash_offset)
 {
 	arena->offset = stash_offset;
+
+	if (arena->stats != NULL)
+		arena->stats->restore_count++;
+}
+
+void
+arena_stats_attach(mem_arena* arena, mem_arena_stats* stats)
+{
+	memory_set(stats, sizeof(*stats), 0x00);
+	stats->peak_offset = arena->offset;
+	stats->tags[0].name = "untagged";
+	stats->tag_count = 1;
+	arena->stats = stats;
+}
+
+void
+arena_stats_detach(mem_arena* arena)
+{
+	arena->stats = NULL;
+}
+
+/**
+ * Finds a tag by name, registering it if it's new.
+ * 
+ * @returns The index of the tag, or 0, "untagged", once every tag slot is taken.
+ */
+internal uint32
+arena_stats_find_tag(mem_arena_stats* stats, const char* name)
+{
+
+	// Tags are almost always string literals, so the pointer usually matches.
+	for (uint32 tag_index = 0; tag_index < stats->tag_count; ++tag_index)
+	{
+		const char* left = stats->tags[tag_index].name;
+		const char* right = name;
+		while (left != right && *left != '\0' && *left == *right)
+		{
+			left++;
+			right++;
+		}
+
+		if (left == right || *left == *right)
+			return tag_index;
+	}
+
+	if (stats->tag_count < ARENA_STATS_MAX_TAGS)
+	{
+		stats->tags[stats->tag_count].name = name;
+		return stats->tag_count++;
+	}
+
+	return 0;
+
+}
+
+uint32
+arena_stats_tag(mem_arena* arena, const char* name)
+{
+
+	mem_arena_stats* stats = arena->stats;
+	if (stats == NULL)
+		return 0;
+
+	uint32 previous_tag = stats->current_tag;
+	stats->current_tag = arena_stats_find_tag(stats, name);
+	return previous_tag;
+
+}
+
+void
+arena_stats_untag(mem_arena* arena, uint32 previous_tag)
+{
+	if (arena->stats != NULL)
+		arena->stats->current_tag = previous_tag;
+}
+
+void
+arena_stats_merge(mem_arena_stats* stats, const mem_arena_stats* other)
+{
+
+	if (stats->tag_count == 0)
+	{
+		stats->tags[0].name = "untagged";
+		stats->tag_count = 1;
+	}
+
+	if (other->peak_offset > stats->peak_offset)
+		stats->peak_offset = other->peak_offset;
+	stats->push_count += other->push_count;
+	stats->bytes_pushed += other->bytes_pushed;
+	stats->bytes_zeroed += other->bytes_zeroed;
+	stats->pop_count += other->pop_count;
+	stats->restore_count += other->restore_count;
+	stats->clear_count += other->clear_count;
+
+	for (uint32 tag_index = 0; tag_index < other->tag_count; ++tag_index)
+	{
+		const mem_arena_tag_stats* other_tag = &other->tags[tag_index];
+		mem_arena_tag_stats* tag = &stats->tags[arena_stats_find_tag(stats, other_tag->name)];
+		tag->push_count += other_tag->push_count;
+		tag->bytes_pushed += other_tag->bytes_pushed;
+		tag->bytes_zeroed += other_tag->bytes_zeroed;
+	}
+
 }
@@ -62,6 +62,40 @@
 #include <sourcery/generics.h>
 #include <sourcery/memory/memutils.h>
 
+#define ARENA_STATS_MAX_TAGS 16
+
+/**
+ * Allocation counters for the pushes made while a particular tag was active.
+ */
+typedef struct mem_arena_tag_stats
+{
+	const char* name;
+	uint64 		push_count;
+	uint64 		bytes_pushed;
+	uint64 		bytes_zeroed;
+} mem_arena_tag_stats;
+
+/**
+ * Optional accounting for an arena. Once attached with arena_stats_attach(), the
+ * arena counts every operation made on it and keeps its high-water mark. Pushes
+ * are also attributed to the tag that is active at the time, which callers set
+ * with arena_stats_tag() around the work they want measured. Tag 0 is "untagged".
+ */
+typedef struct mem_arena_stats
+{
+	size_t 	peak_offset;
+	uint64 	push_count;
+	uint64 	bytes_pushed;
+	uint64 	bytes_zeroed;
+	uint64 	pop_count;
+	uint64 	restore_count;
+	uint64 	clear_count;
+
+	uint32 				current_tag;
+	uint32 				tag_count;
+	mem_arena_tag_stats tags[ARENA_STATS_MAX_TAGS];
+} mem_arena_stats;
+
 /**
  * A memory arena is a region of dynamically allocated memory which monotonically
  * grows as a stack and can be pushed/popped as needed.
@@ -71,6 +105,8 @@ typedef struct
 	size_t size;
 	size_t offset;
 	void* buffer;
+
+	mem_arena_stats* stats;
 } mem_arena;
 
 /**
@@ -166,6 +202,57 @@ arena_stash(mem_arena* arena);
 void
 arena_restore(mem_arena* arena, size_t stash_offset);
 
+/**
+ * Begins accounting for an arena. The stats are zeroed and the arena's current
+ * offset becomes the starting high-water mark.
+ * 
+ * @param arena The arena to account for.
+ * @param stats The stats to accumulate into, which must outlive the attachment.
+ */
+void
+arena_stats_attach(mem_arena* arena, mem_arena_stats* stats);
+
+/**
+ * Stops accounting for an arena. The stats keep what was accumulated.
+ * 
+ * @param arena The arena to stop accounting for.
+ */
+void
+arena_stats_detach(mem_arena* arena);
+
+/**
+ * Attributes the pushes that follow to a tag, registering the tag on its first use.
+ * Once every tag slot is taken, further tags fall back to "untagged". This does
+ * nothing if the arena has no stats attached.
+ * 
+ * @param arena The arena being accounted for.
+ * @param name The name of the tag.
+ * 
+ * @returns The tag that was active before, to be handed to arena_stats_untag().
+ */
+uint32
+arena_stats_tag(mem_arena* arena, const char* name);
+
+/**
+ * Returns to the tag that was active before a call to arena_stats_tag().
+ * 
+ * @param arena The arena being accounted for.
+ * @param previous_tag The value returned by arena_stats_tag().
+ */
+void
+arena_stats_untag(mem_arena* arena, uint32 previous_tag);
+
+/**
+ * Adds the stats of one arena to another's, such as to total a set of arenas that
+ * do the same job. Tags are matched by name, and the high-water mark is the
+ * highest of the two.
+ * 
+ * @param stats The stats to add to. Zeroed stats are a valid starting point.
+ * @param other The stats to add, which are left as they are.
+ */
+void
+arena_stats_merge(mem_arena_stats* stats, const mem_arena_stats* other);
+
 /**
  * -----------------------------------------------------------------------------
  * Platform Specific Definitions
@@ -189,6 +276,52 @@ arena_restore(mem_arena* arena, size_t stash_offset);
  */
 bool virtual_allocate(void** region, size_t* region_size, uint64 base);
 
+/**
+ * Flags that change how virtual_allocate_flags() backs a region.
+ * 		1. 	Huge pages back the region with pages of VIRTUAL_HUGE_PAGE_SIZE, which
+ * 			cover large buffers with far fewer TLB entries. Explicit huge pages are
+ * 			tried first, and only exist if the system reserved them. Otherwise
+ * 			the region is aligned to the huge page size and the system is asked
+ * 			to back it with transparent huge pages when it can. A region smaller
+ * 			than a huge page uses ordinary pages.
+ * 		2. 	Local node places the region's pages on the memory node of the calling
+ * 			thread's processor, which should be the thread that will use it. Pages
+ * 			spill onto other nodes once the local node is full.
+ *
+ * Both are requests rather than guarantees, and a region is still allocated when
+ * the system can't honor them.
+ */
+#define VIRTUAL_ALLOCATE_HUGE_PAGES 	0x1
+#define VIRTUAL_ALLOCATE_LOCAL_NODE 	0x2
+
+#define VIRTUAL_HUGE_PAGE_SIZE 	MEGABYTES(2)
+
+/**
+ * Allocates a region of space as virtual_allocate() does, backed according to the
+ * provided flags.
+ * 
+ * @param region The pointer that will be set to the beginning adress of dynamic storage.
+ * @param region_size The size request to allocate which will be updated to the size returned.
+ * @param base If this value is non-zero, the beginning address of the allocation will
+ * attempt to use the provided base location.
+ * @param flags Any of the VIRTUAL_ALLOCATE flags.
+ * 
+ * @returns True if the allocation was successful, false if not.
+ */
+bool virtual_allocate_flags(void** region, size_t* region_size, uint64 base, uint32 flags);
+
+/**
+ * Places the pages of part of a region on the memory node of the calling thread's
+ * processor, which is how a thread claims its partition of a shared region. Only
+ * pages that haven't been touched yet are placed.
+ * 
+ * @param region The page-aligned start of the part to place.
+ * @param region_size The size of the part to place.
+ * 
+ * @returns True if the part was placed, false if the system can't place pages.
+ */
+bool virtual_bind_local_node(void* region, size_t region_size);
+
 /**
  * Frees a region of memory provided by virtual allocate.
  * 
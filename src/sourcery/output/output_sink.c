@@ -0,0 +1,577 @@
+#include <sourcery/output/output_sink.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/string/string_utils.h>
+
+/**
+ * The offsets of the ustar header fields that are filled in.
+ */
+#define TAR_FIELD_NAME 		0
+#define TAR_FIELD_MODE 		100
+#define TAR_FIELD_UID 		108
+#define TAR_FIELD_GID 		116
+#define TAR_FIELD_SIZE 		124
+#define TAR_FIELD_MTIME 	136
+#define TAR_FIELD_CHECKSUM 	148
+#define TAR_FIELD_TYPE 		156
+#define TAR_FIELD_MAGIC 	257
+#define TAR_FIELD_VERSION 	263
+#define TAR_FIELD_PREFIX 	345
+
+#define TAR_NAME_SIZE 		100
+#define TAR_PREFIX_SIZE 	155
+
+#define TAR_TYPE_FILE 		'0'
+#define TAR_TYPE_DIRECTORY 	'5'
+#define TAR_TYPE_PAX 		'x'
+
+internal bool
+outputSinkIsSeparator(char c)
+{
+#if defined(PLATFORM_WINDOWS)
+	return (c == '/' || c == '\\');
+#else
+	return (c == '/');
+#endif
+}
+
+internal size_t
+outputSinkTarPadding(size_t size)
+{
+	return (OUTPUT_SINK_TAR_BLOCK_SIZE - (size % OUTPUT_SINK_TAR_BLOCK_SIZE)) % OUTPUT_SINK_TAR_BLOCK_SIZE;
+}
+
+/**
+ * Writes a value as zero-padded octal that fills all but the last byte of a field,
+ * which is left as the terminator.
+ */
+internal void
+outputSinkTarOctal(uint8* field, size_t field_size, uint64 value)
+{
+
+	field[field_size - 1] = '\0';
+	for (size_t digit_index = field_size - 1; digit_index > 0; --digit_index)
+	{
+		field[digit_index - 1] = (uint8)('0' + (value & 7));
+		value >>= 3;
+	}
+
+}
+
+internal void
+outputSinkTarCopy(uint8* destination, const char* source, size_t length)
+{
+	for (size_t c_index = 0; c_index < length; ++c_index)
+		destination[c_index] = (uint8)source[c_index];
+}
+
+/**
+ * Sets the size of an entry and its checksum, which is computed with the checksum
+ * field itself treated as spaces.
+ */
+internal void
+outputSinkTarSeal(uint8* header, uint64 size)
+{
+
+	outputSinkTarOctal(header + TAR_FIELD_SIZE, 12, size);
+	for (size_t c_index = 0; c_index < 8; ++c_index)
+		header[TAR_FIELD_CHECKSUM + c_index] = ' ';
+
+	uint64 checksum = 0;
+	for (size_t c_index = 0; c_index < OUTPUT_SINK_TAR_BLOCK_SIZE; ++c_index)
+		checksum += header[c_index];
+	outputSinkTarOctal(header + TAR_FIELD_CHECKSUM, 7, checksum);
+
+}
+
+/**
+ * Reserves space at the end of the buffer, or returns NULL if it won't fit.
+ */
+internal uint8*
+outputSinkTarReserve(output_sink* sink, size_t size)
+{
+
+	if (sink->buffer_used + size > OUTPUT_SINK_TAR_BUFFER_SIZE)
+		return NULL;
+
+	uint8* reserved = sink->buffer + sink->buffer_used;
+	sink->buffer_used += size;
+	return reserved;
+
+}
+
+/**
+ * Fills out a header with everything but its size and checksum. The path is split
+ * between the name and prefix fields if it's too long for the name alone, and
+ * false is returned if it's too long for both.
+ */
+internal bool
+outputSinkTarHeader(output_sink* sink, uint8* header, const char* path, size_t path_length, uint8 type)
+{
+
+	memory_set(header, OUTPUT_SINK_TAR_BLOCK_SIZE, 0);
+	outputSinkTarOctal(header + TAR_FIELD_MODE, 8, (type == TAR_TYPE_DIRECTORY) ? 0755 : 0644);
+	outputSinkTarOctal(header + TAR_FIELD_UID, 8, 0);
+	outputSinkTarOctal(header + TAR_FIELD_GID, 8, 0);
+	outputSinkTarOctal(header + TAR_FIELD_MTIME, 12, sink->modified_time);
+	header[TAR_FIELD_TYPE] = type;
+	outputSinkTarCopy(header + TAR_FIELD_MAGIC, "ustar", 6);
+	outputSinkTarCopy(header + TAR_FIELD_VERSION, "00", 2);
+
+	if (path_length <= TAR_NAME_SIZE)
+	{
+		outputSinkTarCopy(header + TAR_FIELD_NAME, path, path_length);
+		return true;
+	}
+
+	// The split has to land on a separator, the name gets as much as it can hold.
+	for (size_t split = path_length - TAR_NAME_SIZE - 1; split < path_length - 1 && split <= TAR_PREFIX_SIZE; ++split)
+	{
+		if (path[split] != '/' || split == 0)
+			continue;
+		outputSinkTarCopy(header + TAR_FIELD_PREFIX, path, split);
+		outputSinkTarCopy(header + TAR_FIELD_NAME, path + split + 1, path_length - split - 1);
+		return true;
+	}
+
+	outputSinkTarCopy(header + TAR_FIELD_NAME, path, TAR_NAME_SIZE);
+	return false;
+
+}
+
+/**
+ * Begins an entry, returning its header so the size can be sealed once known.
+ * Paths that don't fit in the header are preceded by a pax header holding the path.
+ */
+internal uint8*
+outputSinkTarBeginEntry(output_sink* sink, const char* path, size_t path_length, uint8 type)
+{
+
+	size_t entry_start = sink->buffer_used;
+	uint8 header_block[OUTPUT_SINK_TAR_BLOCK_SIZE];
+	if (!outputSinkTarHeader(sink, header_block, path, path_length, type))
+	{
+
+		// A pax record is "<length> path=<path>\n" where the length counts itself.
+		size_t record_length = path_length + 7;
+		size_t digit_count = 1;
+		for (size_t remaining = record_length; remaining >= 10; remaining /= 10)
+			digit_count++;
+		record_length += digit_count;
+		size_t total_digits = 1;
+		for (size_t remaining = record_length; remaining >= 10; remaining /= 10)
+			total_digits++;
+		if (total_digits > digit_count)
+			record_length++;
+
+		uint8* pax_header = outputSinkTarReserve(sink, OUTPUT_SINK_TAR_BLOCK_SIZE);
+		uint8* pax_record = outputSinkTarReserve(sink, record_length + outputSinkTarPadding(record_length));
+		if (pax_header == NULL || pax_record == NULL)
+		{
+			sink->buffer_used = entry_start;
+			return NULL;
+		}
+
+		const char* pax_name = "././@PaxHeader";
+		outputSinkTarHeader(sink, pax_header, pax_name, strLength(pax_name), TAR_TYPE_PAX);
+		outputSinkTarSeal(pax_header, record_length);
+
+		size_t record_offset = 0;
+		uint64 length_value = record_length;
+		for (size_t digit_index = total_digits; digit_index > 0; --digit_index)
+		{
+			pax_record[digit_index - 1] = (uint8)('0' + (length_value % 10));
+			length_value /= 10;
+		}
+		record_offset += total_digits;
+		outputSinkTarCopy(pax_record + record_offset, " path=", 6);
+		record_offset += 6;
+		outputSinkTarCopy(pax_record + record_offset, path, path_length);
+		record_offset += path_length;
+		pax_record[record_offset++] = '\n';
+		memory_set(pax_record + record_offset, outputSinkTarPadding(record_length), 0);
+
+	}
+
+	uint8* header = outputSinkTarReserve(sink, OUTPUT_SINK_TAR_BLOCK_SIZE);
+	if (header == NULL)
+	{
+		sink->buffer_used = entry_start;
+		return NULL;
+	}
+	outputSinkTarCopy(header, (const char*)header_block, OUTPUT_SINK_TAR_BLOCK_SIZE);
+	return header;
+
+}
+
+internal void
+outputSinkTarFlush(output_sink* sink)
+{
+
+	if (sink->buffer_used == 0)
+		return;
+	if (platformWriteFile(&sink->archive, sink->buffer, sink->buffer_used) != sink->buffer_used)
+		sink->write_failed = true;
+	sink->buffer_used = 0;
+
+}
+
+/**
+ * Copies a path as it should appear in the archive, without leading "./" or "/",
+ * repeated separators or a trailing separator.
+ *
+ * @returns The length of the copy, zero if nothing is left or it's too long.
+ */
+internal size_t
+outputSinkTarNormalize(char* buffer, const char* path)
+{
+
+	while (true)
+	{
+		if (outputSinkIsSeparator(path[0]))
+			path++;
+		else if (path[0] == '.' && outputSinkIsSeparator(path[1]))
+			path += 2;
+		else
+			break;
+	}
+
+	// Archives always separate with '/'.
+	size_t length = 0;
+	for (const char* c = path; *c != '\0'; ++c)
+	{
+		char character = outputSinkIsSeparator(*c) ? '/' : *c;
+		if (length > 0 && character == '/' && buffer[length - 1] == '/')
+			continue;
+		if (length == DIRECTORY_CACHE_MAX_PATH - 2)
+			return 0;
+		buffer[length++] = character;
+	}
+
+	if (length > 0 && buffer[length - 1] == '/')
+		length--;
+	if (length == 1 && buffer[0] == '.')
+		length = 0;
+	buffer[length] = '\0';
+	return length;
+
+}
+
+/**
+ * Writes an entry for each directory along a normalized path that hasn't been
+ * written yet. Only the first directory_length bytes of the path are directories.
+ *
+ * @returns PLATFORM_CREATEDIR_CREATED if any entry was written,
+ * PLATFORM_CREATEDIR_EXISTS if none were or PLATFORM_CREATEDIR_FAILED.
+ */
+internal uint32
+outputSinkTarDirectories(output_sink* sink, char* path, size_t directory_length)
+{
+
+	uint32 result = PLATFORM_CREATEDIR_EXISTS;
+	for (size_t prefix_length = 1; prefix_length <= directory_length; ++prefix_length)
+	{
+
+		if (prefix_length != directory_length && path[prefix_length] != '/')
+			continue;
+
+		// Hashes are never zero so that zero can mark an empty slot. Once the set is
+		// mostly full, directories are written again rather than tracked.
+		uint64 prefix_hash = hashMemory64(path, prefix_length, HASH64_SEED) | 1;
+		uint32 slot_index = (uint32)prefix_hash & (OUTPUT_SINK_TAR_DIRECTORY_SLOTS - 1);
+		while (sink->directory_hashes[slot_index] != 0 && sink->directory_hashes[slot_index] != prefix_hash)
+			slot_index = (slot_index + 1) & (OUTPUT_SINK_TAR_DIRECTORY_SLOTS - 1);
+		if (sink->directory_hashes[slot_index] == prefix_hash)
+			continue;
+		if (sink->directory_count < OUTPUT_SINK_TAR_DIRECTORY_SLOTS / 4 * 3)
+		{
+			sink->directory_hashes[slot_index] = prefix_hash;
+			sink->directory_count++;
+		}
+
+		// Directory entries are named with a trailing separator.
+		char separator = path[prefix_length];
+		path[prefix_length] = '/';
+		uint8* header = outputSinkTarBeginEntry(sink, path, prefix_length + 1, TAR_TYPE_DIRECTORY);
+		path[prefix_length] = separator;
+		if (header == NULL)
+			return PLATFORM_CREATEDIR_FAILED;
+		outputSinkTarSeal(header, 0);
+		result = PLATFORM_CREATEDIR_CREATED;
+
+	}
+
+	return result;
+
+}
+
+void
+outputSinkCreateFilesystem(output_sink* sink, directory_cache* directories, file_commit* commit)
+{
+
+	output_sink empty_sink = {0};
+	*sink = empty_sink;
+	sink->type = OUTPUT_SINK_FILESYSTEM;
+	sink->directories = directories;
+	sink->commit = commit;
+
+}
+
+void
+outputSinkCreateCallbacks(output_sink* sink, output_callbacks* callbacks)
+{
+
+	output_sink empty_sink = {0};
+	*sink = empty_sink;
+	sink->type = OUTPUT_SINK_CALLBACKS;
+	sink->callbacks = *callbacks;
+
+}
+
+bool
+outputSinkCreateTar(output_sink* sink, mem_arena* arena, const char* archive_path)
+{
+
+	output_sink empty_sink = {0};
+	*sink = empty_sink;
+	sink->type = OUTPUT_SINK_TAR;
+
+	sink->archive_is_stdout = (archive_path[0] == '-' && archive_path[1] == '\0');
+	bool archive_opened = sink->archive_is_stdout ?
+		platformClaimStandardOutput(&sink->archive) :
+		platformOpenFile(&sink->archive, archive_path, PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE);
+	if (!archive_opened)
+		return false;
+
+	size_t buffer_size = OUTPUT_SINK_TAR_BUFFER_SIZE;
+	void* buffer = NULL;
+	if (!virtual_allocate(&buffer, &buffer_size, 0))
+	{
+		if (sink->archive_is_stdout)
+			platformReleaseStandardOutput(&sink->archive);
+		else
+			platformCloseFile(&sink->archive);
+		return false;
+	}
+	sink->buffer = (uint8*)buffer;
+	sink->directory_hashes = arena_push_array_zero(arena, uint64, OUTPUT_SINK_TAR_DIRECTORY_SLOTS);
+
+	const char* source_date_epoch = getenv("SOURCE_DATE_EPOCH");
+	sink->modified_time = (source_date_epoch != NULL && source_date_epoch[0] != '\0') ?
+		(uint64)strtoull(source_date_epoch, NULL, 10) : (uint64)time(NULL);
+
+	return true;
+
+}
+
+bool
+outputSinkDestroy(output_sink* sink)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+	{
+		if (sink->file.fh.platform_handle_size != 0)
+			fileCommitClose(sink->commit, &sink->file, false);
+		return true;
+	}
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+		return true;
+
+	// An archive ends with two empty blocks.
+	uint8* trailer = outputSinkTarReserve(sink, OUTPUT_SINK_TAR_BLOCK_SIZE * 2);
+	if (trailer == NULL)
+	{
+		outputSinkTarFlush(sink);
+		trailer = outputSinkTarReserve(sink, OUTPUT_SINK_TAR_BLOCK_SIZE * 2);
+	}
+	memory_set(trailer, OUTPUT_SINK_TAR_BLOCK_SIZE * 2, 0);
+	outputSinkTarFlush(sink);
+
+	if (sink->archive_is_stdout)
+		platformReleaseStandardOutput(&sink->archive);
+	else
+		platformCloseFile(&sink->archive);
+	void* buffer = sink->buffer;
+	virtual_free(&buffer);
+	sink->buffer = NULL;
+
+	return !sink->write_failed;
+
+}
+
+void
+outputSinkInvalidate(output_sink* sink)
+{
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+		directoryCacheClear(sink->directories);
+}
+
+uint32
+outputSinkMakeDirectory(output_sink* sink, const char* path)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+		return directoryCacheMakeDirectory(sink->directories, path);
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+	{
+		output_callbacks* callbacks = &sink->callbacks;
+		return (callbacks->make_directory != NULL) ?
+			callbacks->make_directory(callbacks->user_data, path) : PLATFORM_CREATEDIR_EXISTS;
+	}
+
+	char archive_path[DIRECTORY_CACHE_MAX_PATH];
+	size_t path_length = outputSinkTarNormalize(archive_path, path);
+	if (path_length == 0)
+	{
+		bool names_root = (path[0] != '\0' && strLength(path) < DIRECTORY_CACHE_MAX_PATH - 2);
+		return names_root ? PLATFORM_CREATEDIR_EXISTS : PLATFORM_CREATEDIR_FAILED;
+	}
+
+	if (sink->buffer_used >= OUTPUT_SINK_TAR_FLUSH_SIZE)
+		outputSinkTarFlush(sink);
+	return outputSinkTarDirectories(sink, archive_path, path_length);
+
+}
+
+bool
+outputSinkBeginFile(output_sink* sink, const char* path)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+	{
+		return directoryCacheMakeParents(sink->directories, path) &&
+			fileCommitOpen(sink->commit, &sink->file, path, false);
+	}
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+	{
+		output_callbacks* callbacks = &sink->callbacks;
+		return (callbacks->begin_file == NULL || callbacks->begin_file(callbacks->user_data, path));
+	}
+
+	char archive_path[DIRECTORY_CACHE_MAX_PATH];
+	size_t path_length = outputSinkTarNormalize(archive_path, path);
+	if (path_length == 0)
+		return false;
+
+	// Whole entries are flushed so that the one being begun has room to grow.
+	if (sink->buffer_used >= OUTPUT_SINK_TAR_FLUSH_SIZE)
+		outputSinkTarFlush(sink);
+
+	size_t directory_length = path_length;
+	while (directory_length > 0 && archive_path[directory_length - 1] != '/')
+		directory_length--;
+	if (directory_length > 1 &&
+		outputSinkTarDirectories(sink, archive_path, directory_length - 1) == PLATFORM_CREATEDIR_FAILED)
+		return false;
+
+	sink->entry_start_offset = sink->buffer_used;
+	if (outputSinkTarBeginEntry(sink, archive_path, path_length, TAR_TYPE_FILE) == NULL)
+		return false;
+	sink->entry_header_offset = sink->buffer_used - OUTPUT_SINK_TAR_BLOCK_SIZE;
+	sink->entry_open = true;
+	sink->entry_overflowed = false;
+	return true;
+
+}
+
+void
+outputSinkWriteFile(output_sink* sink, const void* buffer, size_t buffer_size)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+	{
+		fileCommitWrite(&sink->file, buffer, buffer_size);
+		return;
+	}
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+	{
+		output_callbacks* callbacks = &sink->callbacks;
+		if (callbacks->write_file != NULL)
+			callbacks->write_file(callbacks->user_data, buffer, buffer_size);
+		return;
+	}
+
+	if (!sink->entry_open || sink->entry_overflowed)
+		return;
+
+	uint8* data = outputSinkTarReserve(sink, buffer_size);
+	if (data == NULL)
+	{
+		sink->entry_overflowed = true;
+		return;
+	}
+	outputSinkTarCopy(data, (const char*)buffer, buffer_size);
+
+}
+
+void
+outputSinkWriteFileRange(output_sink* sink, filehandle* source, size_t source_offset,
+	const void* buffer, size_t buffer_size)
+{
+
+	size_t bytes_copied = 0;
+	if (sink->type == OUTPUT_SINK_FILESYSTEM && source != NULL && buffer_size >= OUTPUT_SINK_COPY_RANGE_SIZE)
+		bytes_copied = platformCopyFileRange(&sink->file.fh, source, source_offset, buffer_size);
+
+	// Whatever couldn't be copied is written, which is everything for the other sinks.
+	if (bytes_copied < buffer_size)
+		outputSinkWriteFile(sink, (const uint8*)buffer + bytes_copied, buffer_size - bytes_copied);
+
+}
+
+bool
+outputSinkEndFile(output_sink* sink)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+		return fileCommitClose(sink->commit, &sink->file, true);
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+	{
+		output_callbacks* callbacks = &sink->callbacks;
+		return (callbacks->end_file == NULL || callbacks->end_file(callbacks->user_data));
+	}
+
+	if (!sink->entry_open)
+		return false;
+	sink->entry_open = false;
+
+	// A file too large for the buffer is dropped from the archive entirely, along
+	// with any pax header that preceded it.
+	uint64 data_size = sink->buffer_used - sink->entry_header_offset - OUTPUT_SINK_TAR_BLOCK_SIZE;
+	uint8* padding = sink->entry_overflowed ? NULL : outputSinkTarReserve(sink, outputSinkTarPadding(data_size));
+	if (padding == NULL)
+	{
+		sink->buffer_used = sink->entry_start_offset;
+		return false;
+	}
+	memory_set(padding, outputSinkTarPadding(data_size), 0);
+	outputSinkTarSeal(sink->buffer + sink->entry_header_offset, data_size);
+	return true;
+
+}
+
+void
+outputSinkDiscardFile(output_sink* sink)
+{
+
+	if (sink->type == OUTPUT_SINK_FILESYSTEM)
+	{
+		fileCommitClose(sink->commit, &sink->file, false);
+		return;
+	}
+	else if (sink->type == OUTPUT_SINK_CALLBACKS)
+	{
+		output_callbacks* callbacks = &sink->callbacks;
+		if (callbacks->discard_file != NULL)
+			callbacks->discard_file(callbacks->user_data);
+		return;
+	}
+
+	// The entry is still entirely within the buffer, its header included.
+	if (!sink->entry_open)
+		return;
+	sink->entry_open = false;
+	sink->buffer_used = sink->entry_start_offset;
+
+}
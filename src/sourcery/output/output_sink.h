@@ -0,0 +1,214 @@
+/**
+ * The output sink is where the directories and files generated by a run end up.
+ * The filesystem sink creates them in place through the directory cache. The
+ * callback sink hands them to an application that embeds Sourcery. The tar
+ * sink instead writes each of them as an entry of a single ustar archive, so that
+ * a generated tree which is only going to be packaged costs one sequential write
+ * rather than a system call for every directory and file.
+ *
+ * Files are written between outputSinkBeginFile() and outputSinkEndFile() and only
+ * one file may be open at a time. A tar entry's size precedes its data, so the
+ * tar sink holds each file in its buffer until the file ends. The largest file an
+ * archive can hold is therefore OUTPUT_SINK_TAR_BUFFER_SIZE, less whatever the
+ * buffer held when the file was begun.
+ *
+ * Paths that don't fit in a ustar header are written with a pax extended header.
+ * Leading "./" and "/" are removed from archived paths, as tar itself does.
+ */
+#ifndef SOURCERY_OUTPUT_OUTPUT_SINK_H
+#define SOURCERY_OUTPUT_OUTPUT_SINK_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory_cache.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/memory/alloc.h>
+
+#define OUTPUT_SINK_FILESYSTEM 	0
+#define OUTPUT_SINK_TAR 		1
+#define OUTPUT_SINK_CALLBACKS 	2
+
+#define OUTPUT_SINK_TAR_BUFFER_SIZE 	MEGABYTES(64)
+#define OUTPUT_SINK_TAR_FLUSH_SIZE 		MEGABYTES(1)
+#define OUTPUT_SINK_TAR_DIRECTORY_SLOTS 16384
+#define OUTPUT_SINK_TAR_BLOCK_SIZE 		512
+
+/**
+ * Ranges of a file at least this large are copied by the filesystem sink without
+ * passing through the process. Smaller ranges aren't worth more than a write.
+ */
+#define OUTPUT_SINK_COPY_RANGE_SIZE 	KILOBYTES(64)
+
+/**
+ * The procedures an embedding application provides to receive the output itself.
+ * Each is handed the user data it was registered with. A procedure left NULL
+ * accepts its event without doing anything. The directory procedure returns one
+ * of the PLATFORM_CREATEDIR values and the file procedures return false to fail
+ * the file. The discard procedure is called instead of the end procedure when a
+ * file is abandoned partway through.
+ */
+typedef uint32 (*output_directory_proc)(void* user_data, const char* path);
+typedef bool (*output_begin_file_proc)(void* user_data, const char* path);
+typedef void (*output_write_file_proc)(void* user_data, const void* buffer, size_t buffer_size);
+typedef bool (*output_end_file_proc)(void* user_data);
+
+typedef struct output_callbacks
+{
+	void* user_data;
+
+	output_directory_proc 	make_directory;
+	output_begin_file_proc 	begin_file;
+	output_write_file_proc 	write_file;
+	output_end_file_proc 	end_file;
+	output_end_file_proc 	discard_file;
+} output_callbacks;
+
+typedef struct output_sink
+{
+	uint32 type;
+
+	// The filesystem sink.
+	directory_cache* 	directories;
+	file_commit* 		commit;
+	commit_file 		file;
+
+	// The callback sink.
+	output_callbacks callbacks;
+
+	// The tar sink.
+	filehandle 	archive;
+	bool 		archive_is_stdout;
+	uint64 		modified_time;
+	uint8* 		buffer;
+	size_t 		buffer_used;
+	uint64* 	directory_hashes;
+	uint32 		directory_count;
+	bool 		write_failed;
+
+	size_t 	entry_start_offset;
+	size_t 	entry_header_offset;
+	bool 	entry_open;
+	bool 	entry_overflowed;
+} output_sink;
+
+/**
+ * Initializes a sink that creates directories and files in place.
+ *
+ * @param sink The sink to initialize.
+ * @param directories The directory cache used to create directories.
+ * @param commit The commit that files are written through.
+ */
+void
+outputSinkCreateFilesystem(output_sink* sink, directory_cache* directories, file_commit* commit);
+
+/**
+ * Initializes a sink that writes a tar archive. The modification time of every
+ * entry is taken from SOURCE_DATE_EPOCH when it's set, so archives can be made
+ * reproducible, and is the time the archive was created otherwise.
+ *
+ * @param sink The sink to initialize.
+ * @param arena The arena to place the sink's bookkeeping on, which must outlive it.
+ * @param archive_path The file to write the archive to, or "-" for standard output.
+ *
+ * @returns True if the archive was opened, false if not.
+ */
+bool
+outputSinkCreateTar(output_sink* sink, mem_arena* arena, const char* archive_path);
+
+/**
+ * Initializes a sink that hands every directory and file to the application.
+ *
+ * @param sink The sink to initialize.
+ * @param callbacks The procedures to call, which are copied.
+ */
+void
+outputSinkCreateCallbacks(output_sink* sink, output_callbacks* callbacks);
+
+/**
+ * Finishes the sink, which ends and flushes an archive.
+ *
+ * @param sink The sink to destroy.
+ *
+ * @returns True if everything was written out, false if any write failed.
+ */
+bool
+outputSinkDestroy(output_sink* sink);
+
+/**
+ * Forgets what the sink knows about the filesystem, which must be done after
+ * anything else may have changed it.
+ *
+ * @param sink The sink.
+ */
+void
+outputSinkInvalidate(output_sink* sink);
+
+/**
+ * Makes a directory along with any of its missing parents.
+ *
+ * @param sink The sink.
+ * @param path The path of the directory.
+ *
+ * @returns PLATFORM_CREATEDIR_CREATED if any directory was created,
+ * PLATFORM_CREATEDIR_EXISTS if they all existed or PLATFORM_CREATEDIR_FAILED.
+ */
+uint32
+outputSinkMakeDirectory(output_sink* sink, const char* path);
+
+/**
+ * Begins a file, replacing any file of the same name. Missing parent directories
+ * are made first.
+ *
+ * @param sink The sink.
+ * @param path The path of the file, which must stay valid until the file ends.
+ *
+ * @returns True if the file was begun, false if not.
+ */
+bool
+outputSinkBeginFile(output_sink* sink, const char* path);
+
+/**
+ * Appends to the file that was begun.
+ *
+ * @param sink The sink.
+ * @param buffer The bytes to append.
+ * @param buffer_size The number of bytes to append.
+ */
+void
+outputSinkWriteFile(output_sink* sink, const void* buffer, size_t buffer_size);
+
+/**
+ * Appends bytes to the file that was begun which are also held, unchanged, by
+ * another open file. The filesystem sink copies large ranges from that file
+ * directly, every other sink writes them from the buffer.
+ *
+ * @param sink The sink.
+ * @param source The file holding the bytes, or NULL if they're only in memory.
+ * @param source_offset Where the bytes begin within the source.
+ * @param buffer The bytes to append.
+ * @param buffer_size The number of bytes to append.
+ */
+void
+outputSinkWriteFileRange(output_sink* sink, filehandle* source, size_t source_offset,
+	const void* buffer, size_t buffer_size);
+
+/**
+ * Ends the file that was begun.
+ *
+ * @param sink The sink.
+ *
+ * @returns True if the whole file was written, false if not.
+ */
+bool
+outputSinkEndFile(output_sink* sink);
+
+/**
+ * Abandons the file that was begun, such as when its text couldn't be read in
+ * full. Nothing of the file is kept. A file it would have replaced is left as it
+ * was, unless the file was being written in place.
+ *
+ * @param sink The sink.
+ */
+void
+outputSinkDiscardFile(output_sink* sink);
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ * Hardware performance counters count events within the CPU, such as cycles and
+ * cache misses, for the calling thread. Which counters exist depends on the CPU,
+ * the OS and its permissions, so any of them may be unavailable. Virtual machines
+ * commonly expose none of the hardware counters at all.
+ */
+#ifndef SOURCERY_PERF_PERF_COUNTERS_H
+#define SOURCERY_PERF_PERF_COUNTERS_H
+#include <sourcery/generics.h>
+
+#define PERF_COUNTER_CYCLES 			0
+#define PERF_COUNTER_INSTRUCTIONS 		1
+#define PERF_COUNTER_CACHE_MISSES 		2
+#define PERF_COUNTER_BRANCH_MISSES 		3
+#define PERF_COUNTER_PAGE_FAULTS 		4
+#define PERF_COUNTER_COUNT 				5
+
+/**
+ * The counters opened for a single thread. Counters which couldn't be opened are
+ * marked as unavailable and always read as zero. The platform keeps a handle for
+ * each available counter, in counter order.
+ */
+typedef struct perf_counters
+{
+	size_t 	platform_handles[PERF_COUNTER_COUNT];
+
+	bool 	available[PERF_COUNTER_COUNT];
+	uint32 	available_count;
+} perf_counters;
+
+typedef struct perf_sample
+{
+	uint64 values[PERF_COUNTER_COUNT];
+} perf_sample;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_perf_counters.c
+ */
+
+/**
+ * Opens and starts every counter the platform allows for the calling thread. The
+ * counters only count the calling thread, not the processes it spawns.
+ *
+ * @param counters The counters to fill out.
+ *
+ * @returns True if at least one counter was opened, false if none were.
+ */
+bool
+platformOpenPerfCounters(perf_counters* counters);
+
+/**
+ * Reads the running totals of the counters. This must be called on the thread the
+ * counters were opened on.
+ *
+ * @param counters The open counters.
+ * @param sample The sample to fill out.
+ *
+ * @returns True if the counters were read, false if not.
+ */
+bool
+platformReadPerfCounters(perf_counters* counters, perf_sample* sample);
+
+/**
+ * Closes the counters. This may be called from any thread.
+ *
+ * @param counters The counters to close.
+ */
+void
+platformClosePerfCounters(perf_counters* counters);
+
+#endif
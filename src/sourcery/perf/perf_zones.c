@@ -0,0 +1,276 @@
+#include <sourcery/perf/perf_zones.h>
+
+#if defined(SOURCERY_PERF_COUNTERS)
+
+#include <stdio.h>
+#include <sourcery/thread/thread.h>
+
+#if defined(_MSC_VER)
+#	define perf_thread_local __declspec(thread)
+#else
+#	define perf_thread_local _Thread_local
+#endif
+
+/**
+ * Each perfZonesBegin() starts a new generation, which tells threads that the
+ * totals they were handed by an earlier run are no longer theirs.
+ */
+persist volatile bool 	perf_zones_enabled;
+persist uint32 			perf_zones_generation;
+persist volatile uint64 perf_zones_input_bytes;
+
+persist platform_mutex 		perf_zones_mutex;
+persist bool 				perf_zones_mutex_created;
+persist perf_zone_thread* 	perf_zones_threads;
+persist uint32 				perf_zones_thread_count;
+
+persist perf_thread_local perf_zone_thread* perf_zones_thread;
+persist perf_thread_local uint32 			perf_zones_thread_generation;
+
+persist const char* perf_counter_names[PERF_COUNTER_COUNT] =
+{
+	"cycles", "instructions", "cache misses", "branch misses", "page faults"
+};
+
+/**
+ * Fetches the calling thread's totals, handing it a slot and opening its counters
+ * on its first zone of the run. Threads beyond PERF_ZONES_MAX_THREADS, or whose
+ * counters couldn't be opened, aren't counted.
+ */
+internal perf_zone_thread*
+perfZonesGetThread(void)
+{
+
+	if (perf_zones_thread_generation == perf_zones_generation)
+		return perf_zones_thread;
+
+	platformLockMutex(&perf_zones_mutex);
+	perf_zones_thread = NULL;
+	if (perf_zones_thread_count < PERF_ZONES_MAX_THREADS)
+		perf_zones_thread = &perf_zones_threads[perf_zones_thread_count++];
+	perf_zones_thread_generation = perf_zones_generation;
+	platformUnlockMutex(&perf_zones_mutex);
+
+	if (perf_zones_thread != NULL)
+	{
+		perf_zones_thread->counters_opened = platformOpenPerfCounters(&perf_zones_thread->counters);
+		for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+			perf_zones_thread->available[counter_index] = perf_zones_thread->counters.available[counter_index];
+	}
+
+	return perf_zones_thread;
+
+}
+
+bool
+perfZonesBegin(mem_arena* arena)
+{
+
+	if (!perf_zones_mutex_created)
+	{
+		platformCreateMutex(&perf_zones_mutex);
+		perf_zones_mutex_created = true;
+	}
+
+	perf_zones_threads = arena_push_array_zero(arena, perf_zone_thread, PERF_ZONES_MAX_THREADS);
+	perf_zones_thread_count = 0;
+	perf_zones_input_bytes = 0;
+	perf_zones_generation++;
+
+	perf_zone_thread* thread = perfZonesGetThread();
+	if (thread == NULL || !thread->counters_opened)
+	{
+		printf("Warning: Performance counters aren't available, they may need perf_event_paranoid lowered.\n");
+		return false;
+	}
+
+	for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+	{
+		if (!thread->counters.available[counter_index])
+			printf("Warning: The %s counter isn't available and won't be reported.\n", perf_counter_names[counter_index]);
+	}
+
+	perf_zones_enabled = true;
+	return true;
+
+}
+
+void
+perfZonesEnd(void)
+{
+
+	perf_zones_enabled = false;
+	for (uint32 thread_index = 0; thread_index < perf_zones_thread_count; ++thread_index)
+	{
+		perf_zone_thread* thread = &perf_zones_threads[thread_index];
+		if (thread->counters_opened)
+			platformClosePerfCounters(&thread->counters);
+		thread->counters_opened = false;
+	}
+
+}
+
+void
+perfZoneBegin(const char* name)
+{
+
+	if (!perf_zones_enabled)
+		return;
+
+	perf_zone_thread* thread = perfZonesGetThread();
+	if (thread == NULL || !thread->counters_opened)
+		return;
+
+	// Zones nested deeper than the stack are dropped, but still counted so that
+	// their ends pair up correctly.
+	if (thread->open_depth < PERF_ZONES_MAX_DEPTH)
+	{
+		thread->open_names[thread->open_depth] = name;
+		platformReadPerfCounters(&thread->counters, &thread->open_samples[thread->open_depth]);
+	}
+	thread->open_depth++;
+
+}
+
+void
+perfZoneEnd(void)
+{
+
+	if (!perf_zones_enabled)
+		return;
+
+	perf_zone_thread* thread = perfZonesGetThread();
+	if (thread == NULL || !thread->counters_opened || thread->open_depth == 0)
+		return;
+
+	thread->open_depth--;
+	if (thread->open_depth >= PERF_ZONES_MAX_DEPTH)
+		return;
+
+	perf_sample end_sample = {0};
+	platformReadPerfCounters(&thread->counters, &end_sample);
+
+	// Zone names are literals, so the same zone almost always has the same pointer.
+	const char* name = thread->open_names[thread->open_depth];
+	perf_zone_totals* totals = NULL;
+	for (uint32 zone_index = 0; zone_index < thread->zone_count; ++zone_index)
+	{
+		if (thread->zones[zone_index].name == name)
+		{
+			totals = &thread->zones[zone_index];
+			break;
+		}
+	}
+
+	if (totals == NULL)
+	{
+		if (thread->zone_count >= PERF_ZONES_MAX_ZONES)
+			return;
+		totals = &thread->zones[thread->zone_count++];
+		totals->name = name;
+	}
+
+	perf_sample* start_sample = &thread->open_samples[thread->open_depth];
+	for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+		totals->values[counter_index] += end_sample.values[counter_index] - start_sample->values[counter_index];
+	totals->calls++;
+
+}
+
+void
+perfZonesNameThread(const char* name)
+{
+
+	if (!perf_zones_enabled)
+		return;
+
+	perf_zone_thread* thread = perfZonesGetThread();
+	if (thread != NULL)
+		thread->thread_name = name;
+
+}
+
+void
+perfZonesAddInput(uint64 bytes)
+{
+	if (perf_zones_enabled)
+		perf_zones_input_bytes += bytes;
+}
+
+/**
+ * Formats a counter's total into a column, or a dash if the thread couldn't open
+ * the counter.
+ */
+internal void
+perfZonesFormatCount(char* buffer, size_t buffer_size, perf_zone_thread* thread, uint64* values,
+	uint32 counter_index)
+{
+	if (thread->available[counter_index])
+		snprintf(buffer, buffer_size, "%llu", (unsigned long long)values[counter_index]);
+	else
+		snprintf(buffer, buffer_size, "-");
+}
+
+/**
+ * Formats a ratio into a column, or a dash if the thread couldn't open either of
+ * the counters it's made from.
+ */
+internal void
+perfZonesFormatRatio(char* buffer, size_t buffer_size, bool available, real64 numerator, real64 denominator)
+{
+	if (available && denominator > 0.0)
+		snprintf(buffer, buffer_size, "%.2f", numerator / denominator);
+	else
+		snprintf(buffer, buffer_size, "-");
+}
+
+void
+perfZonesPrintReport(void)
+{
+
+	if (perf_zones_threads == NULL)
+		return;
+
+	real64 input_kilobytes = (real64)perf_zones_input_bytes / (real64)KILOBYTES(1);
+	printf("Performance Counters (%.2fKB of input):\n", input_kilobytes);
+
+	for (uint32 thread_index = 0; thread_index < perf_zones_thread_count; ++thread_index)
+	{
+		perf_zone_thread* thread = &perf_zones_threads[thread_index];
+		if (thread->zone_count == 0)
+			continue;
+
+		printf("\tThread %u (%s):\n", thread_index, thread->thread_name ? thread->thread_name : "unnamed");
+		printf("\t\t%-24s %8s %14s %14s %6s %12s %12s %10s %10s %10s\n", "Zone", "Calls", "Cycles",
+			"Instructions", "IPC", "Cache miss", "Branch miss", "Faults", "Cache/KB", "Branch/KB");
+
+		for (uint32 zone_index = 0; zone_index < thread->zone_count; ++zone_index)
+		{
+			perf_zone_totals* totals = &thread->zones[zone_index];
+			uint64* values = totals->values;
+
+			char columns[PERF_COUNTER_COUNT][24];
+			for (uint32 counter_index = 0; counter_index < PERF_COUNTER_COUNT; ++counter_index)
+				perfZonesFormatCount(columns[counter_index], sizeof(columns[counter_index]), thread, values, counter_index);
+
+			char ipc[16];
+			char cache_per_kb[16];
+			char branch_per_kb[16];
+			perfZonesFormatRatio(ipc, sizeof(ipc),
+				thread->available[PERF_COUNTER_CYCLES] && thread->available[PERF_COUNTER_INSTRUCTIONS],
+				(real64)values[PERF_COUNTER_INSTRUCTIONS], (real64)values[PERF_COUNTER_CYCLES]);
+			perfZonesFormatRatio(cache_per_kb, sizeof(cache_per_kb), thread->available[PERF_COUNTER_CACHE_MISSES],
+				(real64)values[PERF_COUNTER_CACHE_MISSES], input_kilobytes);
+			perfZonesFormatRatio(branch_per_kb, sizeof(branch_per_kb), thread->available[PERF_COUNTER_BRANCH_MISSES],
+				(real64)values[PERF_COUNTER_BRANCH_MISSES], input_kilobytes);
+
+			printf("\t\t%-24s %8llu %14s %14s %6s %12s %12s %10s %10s %10s\n", totals->name,
+				(unsigned long long)totals->calls, columns[PERF_COUNTER_CYCLES], columns[PERF_COUNTER_INSTRUCTIONS],
+				ipc, columns[PERF_COUNTER_CACHE_MISSES], columns[PERF_COUNTER_BRANCH_MISSES],
+				columns[PERF_COUNTER_PAGE_FAULTS], cache_per_kb, branch_per_kb);
+		}
+	}
+
+}
+
+#endif
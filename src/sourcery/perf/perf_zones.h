@@ -0,0 +1,113 @@
+/**
+ * Counter zones total the hardware performance counters over named zones of a
+ * run, per thread, so that a phase can be judged as memory-bound or branch-bound
+ * rather than just slow. Each thread opens its own counters on its first zone and
+ * a zone's totals include the zones nested within it.
+ *
+ * Counter zones only exist in builds with SOURCERY_PERF_COUNTERS defined, which
+ * the PERFDEBUG build type does. Their zones are the trace zones, opening a trace
+ * zone opens a counter zone of the same name, see trace.h. Even when compiled in,
+ * counters are only read between perfZonesBegin() and perfZonesEnd().
+ *
+ * Reading the counters is a system call, so zones should stay coarse.
+ */
+#ifndef SOURCERY_PERF_PERF_ZONES_H
+#define SOURCERY_PERF_PERF_ZONES_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/perf/perf_counters.h>
+
+#define PERF_ZONES_MAX_THREADS 	32
+#define PERF_ZONES_MAX_ZONES 	16
+#define PERF_ZONES_MAX_DEPTH 	16
+
+#if defined(SOURCERY_PERF_COUNTERS)
+
+typedef struct perf_zone_totals
+{
+	const char* name;
+	uint64 		calls;
+	uint64 		values[PERF_COUNTER_COUNT];
+} perf_zone_totals;
+
+typedef struct perf_zone_thread
+{
+	perf_counters 	counters;
+	bool 			counters_opened;
+	bool 			available[PERF_COUNTER_COUNT];
+	const char* 	thread_name;
+
+	perf_zone_totals 	zones[PERF_ZONES_MAX_ZONES];
+	uint32 				zone_count;
+
+	const char* 	open_names[PERF_ZONES_MAX_DEPTH];
+	perf_sample 	open_samples[PERF_ZONES_MAX_DEPTH];
+	uint32 			open_depth;
+} perf_zone_thread;
+
+/**
+ * Begins counting zones. The calling thread's counters are opened straight away
+ * so that a missing counter can be reported before the run begins.
+ *
+ * @param arena The arena to place the per-thread totals on.
+ *
+ * @returns True if any counter could be opened, false if none could, in which
+ * case nothing is counted.
+ */
+bool
+perfZonesBegin(mem_arena* arena);
+
+/**
+ * Stops counting zones and closes every thread's counters. The totals remain
+ * until the next perfZonesBegin(). This should only be called once the threads
+ * being counted have stopped.
+ */
+void
+perfZonesEnd(void);
+
+/**
+ * Opens a zone on the calling thread.
+ *
+ * @param name The name of the zone, which must be a string literal.
+ */
+void
+perfZoneBegin(const char* name);
+
+/**
+ * Closes the zone most recently opened on the calling thread.
+ */
+void
+perfZoneEnd(void);
+
+/**
+ * Names the calling thread in the report.
+ *
+ * @param name The name of the thread, which must be a string literal.
+ */
+void
+perfZonesNameThread(const char* name);
+
+/**
+ * Adds to the number of input bytes the run has processed, which the report
+ * divides the miss counts by.
+ *
+ * @param bytes The number of bytes processed.
+ */
+void
+perfZonesAddInput(uint64 bytes);
+
+/**
+ * Prints the totals of every zone on every thread.
+ */
+void
+perfZonesPrintReport(void);
+
+#	define PERF_ZONES_ADD_INPUT(bytes) 	perfZonesAddInput(bytes)
+
+#else
+
+#	define PERF_ZONES_ADD_INPUT(bytes)
+
+#endif
+
+#endif
@@ -0,0 +1,278 @@
+#include <sourcery/pipeline/script_pipeline.h>
+#include <sourcery/trace/trace.h>
+
+/**
+ * Reads a script into a slot. A script that doesn't fit, or isn't to be loaded, is
+ * only hinted to the system's cache. A file that can't be opened is left for the
+ * script's own open to report.
+ */
+internal void
+scriptPipelineLoad(script_pipeline* pipeline, script_slot* slot, char* path)
+{
+
+	filehandle empty_fh = {0};
+	script_index empty_index = {0};
+	slot->path = path;
+	slot->fh = empty_fh;
+	slot->text = NULL;
+	slot->text_size = 0;
+	slot->loaded = false;
+	slot->index = empty_index;
+	slot->indexed = false;
+	arena_clear(&slot->arena);
+
+	if (!platformOpenFile(&slot->fh, path, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+		return;
+
+	// The stamp is taken before the file is read, so a write made while it's read
+	// shows up as a change.
+	bool fits = (pipeline->load_text && slot->fh.file_size < SCRIPT_PIPELINE_TEXT_LIMIT);
+	if (fits && platformGetFileStamp(&slot->fh, &slot->stamp))
+	{
+		uint32 previous_tag = arena_stats_tag(&slot->arena, "loadSource");
+		slot->text = arena_push_array(&slot->arena, char, slot->fh.file_size + 1);
+		arena_stats_untag(&slot->arena, previous_tag);
+		slot->text_size = platformReadFile(&slot->fh, slot->text, slot->fh.file_size);
+		slot->text[slot->text_size] = '\0';
+		slot->loaded = true;
+		pipeline->stats.scripts_loaded++;
+		return;
+	}
+
+	platformPrefetchFile(&slot->fh);
+	platformCloseFile(&slot->fh);
+
+}
+
+/**
+ * Indexes a loaded script on the rest of its slot. A script whose index wouldn't
+ * fit is indexed by the executor instead.
+ */
+internal void
+scriptPipelineIndex(script_pipeline* pipeline, script_slot* slot)
+{
+
+	if (!slot->loaded)
+		return;
+
+	uint32 previous_tag = arena_stats_tag(&slot->arena, "createSourceTree");
+	slot->indexed = sourceryIndexScript(&slot->arena, slot->text, slot->text_size, &slot->index);
+	arena_stats_untag(&slot->arena, previous_tag);
+	if (slot->indexed)
+		pipeline->stats.scripts_indexed++;
+
+}
+
+/**
+ * Unloads a slot whose file has changed since it was read, which happens when an
+ * earlier script writes a later one.
+ */
+internal void
+scriptPipelineValidate(script_pipeline* pipeline, script_slot* slot)
+{
+
+	if (!slot->loaded)
+		return;
+
+	file_stamp current_stamp = {0};
+	bool unchanged = platformGetPathStamp(slot->path, &current_stamp) &&
+		current_stamp.device == slot->stamp.device &&
+		current_stamp.index == slot->stamp.index &&
+		current_stamp.size == slot->stamp.size &&
+		current_stamp.modified_time == slot->stamp.modified_time;
+	if (!unchanged)
+	{
+		platformCloseFile(&slot->fh);
+		slot->loaded = false;
+		slot->indexed = false;
+		pipeline->stats.scripts_reread++;
+	}
+
+}
+
+internal void
+scriptPipelineReader(void* user_data)
+{
+
+	script_pipeline* pipeline = (script_pipeline*)user_data;
+	TRACE_NAME_THREAD("scriptReader");
+
+	script_slot* slot = NULL;
+	while (spscQueuePop(&pipeline->free_queue, (void**)&slot))
+	{
+
+		char* path = NULL;
+		if (!directoryScanNextFile(pipeline->scan, &path))
+			break;
+
+		TRACE_ZONE_BEGIN("readScript");
+		scriptPipelineLoad(pipeline, slot, path);
+		TRACE_ZONE_END();
+
+		if (!spscQueuePush(&pipeline->read_queue, slot))
+			break;
+
+	}
+
+	// Closing the queue tells the indexer there's nothing more to come.
+	spscQueueClose(&pipeline->read_queue);
+
+}
+
+internal void
+scriptPipelineIndexer(void* user_data)
+{
+
+	script_pipeline* pipeline = (script_pipeline*)user_data;
+	TRACE_NAME_THREAD("scriptIndexer");
+
+	script_slot* slot = NULL;
+	while (spscQueuePop(&pipeline->read_queue, (void**)&slot))
+	{
+
+		TRACE_ZONE_BEGIN("indexScript");
+		scriptPipelineIndex(pipeline, slot);
+		TRACE_ZONE_END();
+
+		if (!spscQueuePush(&pipeline->ready_queue, slot))
+			break;
+
+	}
+
+	spscQueueClose(&pipeline->ready_queue);
+
+}
+
+bool
+scriptPipelineCreate(script_pipeline* pipeline, directory_scan* scan, bool load_text)
+{
+
+	script_pipeline empty_pipeline = {0};
+	*pipeline = empty_pipeline;
+
+	size_t heap_size = SCRIPT_PIPELINE_QUEUE_SIZE + SCRIPT_PIPELINE_SLOT_SIZE * SCRIPT_PIPELINE_SLOTS;
+	if (!virtual_allocate(&pipeline->heap, &heap_size, 0))
+		return false;
+
+	pipeline->scan = scan;
+	pipeline->load_text = load_text;
+
+	// The queues are partitioned off the front of the heap and the slots after them.
+	arena_allocate(pipeline->heap, SCRIPT_PIPELINE_QUEUE_SIZE, &pipeline->queue_arena);
+	spscQueueCreate(&pipeline->read_queue, &pipeline->queue_arena, SCRIPT_PIPELINE_SLOTS);
+	spscQueueCreate(&pipeline->ready_queue, &pipeline->queue_arena, SCRIPT_PIPELINE_SLOTS);
+	spscQueueCreate(&pipeline->free_queue, &pipeline->queue_arena, SCRIPT_PIPELINE_SLOTS);
+
+	for (uint32 slot_index = 0; slot_index < SCRIPT_PIPELINE_SLOTS; ++slot_index)
+	{
+		script_slot* slot = &pipeline->slots[slot_index];
+		arena_allocate((uint8*)pipeline->heap + SCRIPT_PIPELINE_QUEUE_SIZE + SCRIPT_PIPELINE_SLOT_SIZE * slot_index,
+			SCRIPT_PIPELINE_SLOT_SIZE, &slot->arena);
+		spscQueuePush(&pipeline->free_queue, slot);
+	}
+
+	// The initial slots aren't the executor handing anything back.
+	spsc_queue_stats empty_stats = {0};
+	pipeline->free_queue.stats = empty_stats;
+	return true;
+
+}
+
+void
+scriptPipelineTrackMemory(script_pipeline* pipeline)
+{
+	pipeline->stats.memory_tracked = true;
+	for (uint32 slot_index = 0; slot_index < SCRIPT_PIPELINE_SLOTS; ++slot_index)
+		arena_stats_attach(&pipeline->slots[slot_index].arena, &pipeline->slots[slot_index].arena_stats);
+}
+
+void
+scriptPipelineStart(script_pipeline* pipeline)
+{
+
+	// Without a reader there's nothing for an indexer to take. The reader mostly
+	// waits on the disk, but the indexer would only take turns with the executor
+	// on a single processor.
+	pipeline->reader_threaded = platformCreateThread(&pipeline->reader, scriptPipelineReader, pipeline);
+	if (pipeline->reader_threaded && platformGetProcessorCount() > 1)
+		pipeline->indexer_threaded = platformCreateThread(&pipeline->indexer, scriptPipelineIndexer, pipeline);
+
+}
+
+bool
+scriptPipelineNext(script_pipeline* pipeline, script_slot** slot)
+{
+
+	// Stages without a thread are run here, on the executor. The executor always
+	// hands its slot back first, so a free slot is waiting without a reader.
+	script_slot* next_slot = NULL;
+	if (!pipeline->reader_threaded)
+	{
+		char* path = NULL;
+		if (!directoryScanNextFile(pipeline->scan, &path))
+			return false;
+
+		spscQueuePop(&pipeline->free_queue, (void**)&next_slot);
+		scriptPipelineLoad(pipeline, next_slot, path);
+	}
+	else
+	{
+		spsc_queue* queue = pipeline->indexer_threaded ? &pipeline->ready_queue : &pipeline->read_queue;
+		if (!spscQueuePop(queue, (void**)&next_slot))
+			return false;
+	}
+
+	if (!pipeline->indexer_threaded)
+		scriptPipelineIndex(pipeline, next_slot);
+
+	scriptPipelineValidate(pipeline, next_slot);
+	*slot = next_slot;
+	return true;
+
+}
+
+void
+scriptPipelineRelease(script_pipeline* pipeline, script_slot* slot)
+{
+
+	platformCloseFile(&slot->fh);
+	slot->loaded = false;
+	slot->indexed = false;
+	spscQueuePush(&pipeline->free_queue, slot);
+
+}
+
+void
+scriptPipelineDestroy(script_pipeline* pipeline)
+{
+
+	// Closing every queue ends each stage wherever it's waiting.
+	spscQueueClose(&pipeline->free_queue);
+	spscQueueClose(&pipeline->read_queue);
+	spscQueueClose(&pipeline->ready_queue);
+	if (pipeline->indexer_threaded)
+		platformJoinThread(&pipeline->indexer);
+	if (pipeline->reader_threaded)
+		platformJoinThread(&pipeline->reader);
+
+	// Scripts in the pipeline but never taken still have their files open.
+	for (uint32 slot_index = 0; slot_index < SCRIPT_PIPELINE_SLOTS; ++slot_index)
+	{
+		script_slot* slot = &pipeline->slots[slot_index];
+		platformCloseFile(&slot->fh);
+		if (pipeline->stats.memory_tracked)
+			arena_stats_merge(&pipeline->stats.memory, &slot->arena_stats);
+		arena_release(&slot->arena);
+	}
+
+	pipeline->stats.read_queue = pipeline->read_queue.stats;
+	pipeline->stats.ready_queue = pipeline->ready_queue.stats;
+	pipeline->stats.free_queue = pipeline->free_queue.stats;
+	spscQueueDestroy(&pipeline->free_queue);
+	spscQueueDestroy(&pipeline->ready_queue);
+	spscQueueDestroy(&pipeline->read_queue);
+
+	arena_release(&pipeline->queue_arena);
+	virtual_free(&pipeline->heap);
+
+}
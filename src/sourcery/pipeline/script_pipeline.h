@@ -0,0 +1,175 @@
+/**
+ * The script pipeline overlaps the stages of processing a run's scripts, so the
+ * disk and every processor are busy at once rather than in turn. Each stage runs on
+ * its own thread and hands scripts to the next through a bounded queue:
+ * 		1. 	The reader takes files from a directory scan in order and loads each
+ * 			into a free slot.
+ * 		2. 	The indexer splits each loaded script into its lines and determines
+ * 			the directive type of each.
+ * 		3. 	The executor, the thread that takes scripts from the pipeline, runs
+ * 			their directives and hands each slot back to the reader once its
+ * 			script is done.
+ * Generated files are written by the executor as each directive runs, since later
+ * directives, and the commands they start, expect the files before them to exist.
+ *
+ * There's a fixed number of slots, each a fixed-size partition of the pipeline's
+ * own virtual allocation, so at most a few scripts are ever held in memory however
+ * many there are. A stage that falls behind fills the queue in front of it, which
+ * holds back the stages feeding it until a slot comes free.
+ *
+ * Scripts too large for a slot, and every script when text isn't loaded, are only
+ * opened and hinted to the system so that its cache reads them ahead, and are read
+ * as they always are when their turn comes. Scripts may write the scripts that
+ * follow them, so a slot is only handed over loaded if its file is still the file
+ * that was read. Otherwise the slot comes back unloaded and the script is read
+ * from its file.
+ */
+#ifndef SOURCERY_PIPELINE_SCRIPT_PIPELINE_H
+#define SOURCERY_PIPELINE_SCRIPT_PIPELINE_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/directory_scan.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/sourcery.h>
+#include <sourcery/thread/spsc_queue.h>
+#include <sourcery/thread/thread.h>
+
+#define SCRIPT_PIPELINE_SLOTS 		4
+#define SCRIPT_PIPELINE_SLOT_SIZE 	MEGABYTES(16)
+#define SCRIPT_PIPELINE_TEXT_LIMIT 	MEGABYTES(4)
+#define SCRIPT_PIPELINE_QUEUE_SIZE 	KILOBYTES(4)
+
+/**
+ * A script on its way through the pipeline. The file stays open while the slot is
+ * loaded, so that ranges of it can be copied straight into generated files. The
+ * text and its index share the slot's arena, which has stats of its own since the
+ * slots are used by different stages at once.
+ */
+typedef struct script_slot
+{
+	char* 		path;
+	filehandle 	fh;
+	file_stamp 	stamp;
+	mem_arena 	arena;
+	mem_arena_stats arena_stats;
+
+	char* 	text;
+	size_t 	text_size;
+	bool 	loaded;
+
+	script_index 	index;
+	bool 			indexed;
+} script_slot;
+
+/**
+ * What the pipeline did over its lifetime. The read queue runs from the reader to
+ * the indexer, the ready queue from the indexer to the executor and the free queue
+ * from the executor back to the reader. Scripts reread are those whose files were
+ * written after they were loaded. The memory stats total every slot's arena, and
+ * are only gathered when tracked with scriptPipelineTrackMemory().
+ */
+typedef struct script_pipeline_stats
+{
+	spsc_queue_stats 	read_queue;
+	spsc_queue_stats 	ready_queue;
+	spsc_queue_stats 	free_queue;
+
+	uint64 	scripts_loaded;
+	uint64 	scripts_indexed;
+	uint64 	scripts_reread;
+
+	bool 			memory_tracked;
+	mem_arena_stats memory;
+} script_pipeline_stats;
+
+typedef struct script_pipeline
+{
+	directory_scan* scan;
+	bool 			load_text;
+
+	void* 			heap;
+	mem_arena 		queue_arena;
+	script_slot 	slots[SCRIPT_PIPELINE_SLOTS];
+
+	spsc_queue 	read_queue;
+	spsc_queue 	ready_queue;
+	spsc_queue 	free_queue;
+
+	platform_thread 	reader;
+	platform_thread 	indexer;
+	bool 				reader_threaded;
+	bool 				indexer_threaded;
+
+	script_pipeline_stats stats;
+} script_pipeline;
+
+/**
+ * Initializes a pipeline over a directory scan, which must outlive it.
+ *
+ * @param pipeline The pipeline to initialize.
+ * @param scan The directory scan to take files from, which mustn't be read from by
+ * anything else once the pipeline starts.
+ * @param load_text If true, scripts that fit a slot are loaded and indexed,
+ * otherwise scripts are only hinted to the system's cache.
+ *
+ * @returns True if the pipeline was initialized, false if its memory couldn't be
+ * allocated.
+ */
+bool
+scriptPipelineCreate(script_pipeline* pipeline, directory_scan* scan, bool load_text);
+
+/**
+ * Accounts for the memory each slot uses to load and index its scripts, attributed
+ * to the "loadSource" and "createSourceTree" tags as the same work is when done on
+ * the run's own arena. The totals are in the pipeline's stats once it's destroyed.
+ * This must be done before the pipeline starts.
+ *
+ * @param pipeline The pipeline.
+ */
+void
+scriptPipelineTrackMemory(script_pipeline* pipeline);
+
+/**
+ * Starts the reader and indexer threads. The indexer only has its own thread when
+ * there's more than one processor. A stage without a thread is run by the executor
+ * as each script is taken instead.
+ *
+ * @param pipeline The pipeline.
+ */
+void
+scriptPipelineStart(script_pipeline* pipeline);
+
+/**
+ * Takes the next script, blocking until it's been through every stage before the
+ * executor or the scan has no more files. The slot must be released before the
+ * next script is taken.
+ *
+ * @param pipeline The pipeline.
+ * @param slot Set to the slot holding the script. If the slot isn't loaded, the
+ * script must be read from its path.
+ *
+ * @returns True if a script was taken, false once every script has been taken.
+ */
+bool
+scriptPipelineNext(script_pipeline* pipeline, script_slot** slot);
+
+/**
+ * Hands a slot back to the reader, closing its file.
+ *
+ * @param pipeline The pipeline.
+ * @param slot The slot returned by scriptPipelineNext().
+ */
+void
+scriptPipelineRelease(script_pipeline* pipeline, script_slot* slot);
+
+/**
+ * Stops every stage and releases the pipeline's threads and memory. Scripts in the
+ * pipeline but never taken are discarded. This must be done before the scan is
+ * destroyed. The pipeline's stats remain readable afterwards.
+ *
+ * @param pipeline The pipeline to destroy.
+ */
+void
+scriptPipelineDestroy(script_pipeline* pipeline);
+
+#endif
@@ -0,0 +1,295 @@
+#include <sourcery/process/command_report.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sourcery/filehandle.h>
+
+/**
+ * The longest a single character becomes once escaped for JSON, which is \u00XX.
+ */
+#define COMMAND_REPORT_ESCAPE_SIZE 6
+
+persist command_report 	command_report_active;
+persist bool 			command_report_enabled;
+
+/**
+ * Copies a string into a fixed-size field, marking it with an ellipsis when it
+ * had to be truncated.
+ */
+internal void
+commandReportCopyText(char* destination, const char* source)
+{
+
+	size_t length = 0;
+	while (source[length] != '\0' && length < COMMAND_REPORT_TEXT_SIZE - 1)
+	{
+		destination[length] = source[length];
+		length++;
+	}
+	destination[length] = '\0';
+
+	if (source[length] != '\0')
+	{
+		destination[length - 1] = '.';
+		destination[length - 2] = '.';
+		destination[length - 3] = '.';
+	}
+
+}
+
+void
+commandReportBegin(mem_arena* arena)
+{
+
+	command_report empty_report = {0};
+	command_report_active = empty_report;
+	command_report_active.records = arena_push_array_zero(arena, command_record, COMMAND_REPORT_MAX_RECORDS);
+	command_report_enabled = true;
+
+}
+
+void
+commandReportEnd(void)
+{
+	command_report_enabled = false;
+}
+
+void
+commandReportRecord(const char* command, const char* source, process_stats* stats)
+{
+
+	if (!command_report_enabled)
+		return;
+
+	command_report* report = &command_report_active;
+	report->command_count++;
+	if (stats->exit_code != 0)
+		report->failed_count++;
+	report->total_wall_nanoseconds += stats->wall_nanoseconds;
+	report->total_user_nanoseconds += stats->user_nanoseconds;
+	report->total_system_nanoseconds += stats->system_nanoseconds;
+	if (stats->max_resident_kilobytes > report->peak_resident_kilobytes)
+		report->peak_resident_kilobytes = stats->max_resident_kilobytes;
+
+	// Once the records are full, a command only displaces the fastest kept one.
+	command_record* record = NULL;
+	if (report->record_count < COMMAND_REPORT_MAX_RECORDS)
+	{
+		record = &report->records[report->record_count++];
+	}
+	else
+	{
+		command_record* fastest = &report->records[0];
+		for (uint32 record_index = 1; record_index < report->record_count; ++record_index)
+		{
+			if (report->records[record_index].stats.wall_nanoseconds < fastest->stats.wall_nanoseconds)
+				fastest = &report->records[record_index];
+		}
+
+		if (fastest->stats.wall_nanoseconds >= stats->wall_nanoseconds)
+			return;
+		record = fastest;
+	}
+
+	commandReportCopyText(record->command, command);
+	commandReportCopyText(record->source, source);
+	record->sequence = report->command_count;
+	record->stats = *stats;
+
+}
+
+/**
+ * Orders records slowest first, and by the order they ran when equally slow.
+ */
+internal int
+commandReportCompareRecords(const void* left, const void* right)
+{
+
+	const command_record* left_record = (const command_record*)left;
+	const command_record* right_record = (const command_record*)right;
+
+	if (left_record->stats.wall_nanoseconds != right_record->stats.wall_nanoseconds)
+		return (left_record->stats.wall_nanoseconds > right_record->stats.wall_nanoseconds) ? -1 : 1;
+	return (left_record->sequence < right_record->sequence) ? -1 : 1;
+
+}
+
+internal real64
+commandReportMilliseconds(uint64 nanoseconds)
+{
+	return (real64)nanoseconds / 1000000.0;
+}
+
+void
+commandReportPrint(void)
+{
+
+	command_report* report = &command_report_active;
+	if (report->records == NULL)
+		return;
+
+	qsort(report->records, report->record_count, sizeof(command_record), commandReportCompareRecords);
+
+	printf("Command Report:\n");
+	printf("\tCommands run:      %10llu\n", (unsigned long long)report->command_count);
+	printf("\tCommands failed:   %10llu\n", (unsigned long long)report->failed_count);
+	printf("\tTotal wall time:   %10.2fms\n", commandReportMilliseconds(report->total_wall_nanoseconds));
+	printf("\tTotal user time:   %10.2fms\n", commandReportMilliseconds(report->total_user_nanoseconds));
+	printf("\tTotal system time: %10.2fms\n", commandReportMilliseconds(report->total_system_nanoseconds));
+	printf("\tPeak resident:     %10.2fMB\n", (real64)report->peak_resident_kilobytes / 1024.0);
+
+	if (report->record_count == 0)
+		return;
+
+	printf("\tSlowest commands:\n");
+	printf("\t\t%10s %10s %10s %10s %10s %10s %5s  %s\n", "Wall ms", "User ms", "Sys ms", "RSS MB",
+		"Blocks in", "Blocks out", "Exit", "Command");
+
+	uint32 print_count = report->record_count;
+	if (print_count > COMMAND_REPORT_PRINT_LIMIT)
+		print_count = COMMAND_REPORT_PRINT_LIMIT;
+
+	for (uint32 record_index = 0; record_index < print_count; ++record_index)
+	{
+		command_record* record = &report->records[record_index];
+		printf("\t\t%10.2f %10.2f %10.2f %10.2f %10llu %10llu %5d  %.60s\n",
+			commandReportMilliseconds(record->stats.wall_nanoseconds),
+			commandReportMilliseconds(record->stats.user_nanoseconds),
+			commandReportMilliseconds(record->stats.system_nanoseconds),
+			(real64)record->stats.max_resident_kilobytes / 1024.0,
+			(unsigned long long)record->stats.input_blocks, (unsigned long long)record->stats.output_blocks,
+			record->stats.exit_code, record->command);
+	}
+
+}
+
+/**
+ * Appends text to the write buffer, flushing it to the file when it fills.
+ */
+internal void
+commandReportWriteText(filehandle* fh, char* buffer, size_t* buffer_length, const char* text, int text_length)
+{
+	if (text_length <= 0)
+		return;
+
+	if (*buffer_length + (size_t)text_length > COMMAND_REPORT_WRITE_BUFFER)
+	{
+		platformWriteFile(fh, buffer, *buffer_length);
+		*buffer_length = 0;
+	}
+
+	for (int c_index = 0; c_index < text_length; ++c_index)
+		buffer[(*buffer_length)++] = text[c_index];
+}
+
+/**
+ * Escapes a string for a JSON string literal. Tabs, newlines and carriage returns
+ * take their short escapes and every other control character is written as \u00XX.
+ * A string that doesn't fit is cut short between escapes, never within one.
+ */
+internal void
+commandReportEscapeJSON(char* destination, size_t destination_size, const char* source)
+{
+
+	persist const char hex_digits[] = "0123456789ABCDEF";
+
+	size_t length = 0;
+	for (size_t c_index = 0; source[c_index] != '\0'; ++c_index)
+	{
+		unsigned char c = (unsigned char)source[c_index];
+		char escape[COMMAND_REPORT_ESCAPE_SIZE];
+		size_t escape_length = 0;
+		if (c == '"' || c == '\\')
+		{
+			escape[escape_length++] = '\\';
+			escape[escape_length++] = (char)c;
+		}
+		else if (c == '\t' || c == '\n' || c == '\r')
+		{
+			escape[escape_length++] = '\\';
+			escape[escape_length++] = (c == '\t') ? 't' : (c == '\n') ? 'n' : 'r';
+		}
+		else if (c < 0x20)
+		{
+			escape[escape_length++] = '\\';
+			escape[escape_length++] = 'u';
+			escape[escape_length++] = '0';
+			escape[escape_length++] = '0';
+			escape[escape_length++] = hex_digits[c >> 4];
+			escape[escape_length++] = hex_digits[c & 0xF];
+		}
+		else
+		{
+			escape[escape_length++] = (char)c;
+		}
+
+		if (length + escape_length + 1 > destination_size)
+			break;
+		for (size_t escape_index = 0; escape_index < escape_length; ++escape_index)
+			destination[length++] = escape[escape_index];
+	}
+	destination[length] = '\0';
+
+}
+
+bool
+commandReportWriteJSON(mem_arena* arena, const char* path)
+{
+
+	command_report* report = &command_report_active;
+	if (report->records == NULL)
+		return false;
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, path, PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE))
+		return false;
+
+	qsort(report->records, report->record_count, sizeof(command_record), commandReportCompareRecords);
+
+	size_t stash_point = arena_stash(arena);
+	char* write_buffer = arena_push_array(arena, char, COMMAND_REPORT_WRITE_BUFFER);
+	size_t write_length = 0;
+
+	char line[COMMAND_REPORT_TEXT_SIZE * COMMAND_REPORT_ESCAPE_SIZE * 2 + 512];
+	int line_length = snprintf(line, sizeof(line),
+		"{\"command_count\":%llu,\"failed_count\":%llu,\"total_wall_ms\":%.3f,\"total_user_ms\":%.3f,"
+		"\"total_system_ms\":%.3f,\"peak_resident_kb\":%llu,\"commands\":[",
+		(unsigned long long)report->command_count, (unsigned long long)report->failed_count,
+		commandReportMilliseconds(report->total_wall_nanoseconds),
+		commandReportMilliseconds(report->total_user_nanoseconds),
+		commandReportMilliseconds(report->total_system_nanoseconds),
+		(unsigned long long)report->peak_resident_kilobytes);
+	commandReportWriteText(&fh, write_buffer, &write_length, line, line_length);
+
+	char escaped_command[COMMAND_REPORT_TEXT_SIZE * COMMAND_REPORT_ESCAPE_SIZE];
+	char escaped_source[COMMAND_REPORT_TEXT_SIZE * COMMAND_REPORT_ESCAPE_SIZE];
+	for (uint32 record_index = 0; record_index < report->record_count; ++record_index)
+	{
+		command_record* record = &report->records[record_index];
+		commandReportEscapeJSON(escaped_command, sizeof(escaped_command), record->command);
+		commandReportEscapeJSON(escaped_source, sizeof(escaped_source), record->source);
+
+		line_length = snprintf(line, sizeof(line),
+			"%s\n{\"command\":\"%s\",\"source\":\"%s\",\"sequence\":%llu,\"exit_code\":%d,\"signal\":%u,"
+			"\"wall_ms\":%.3f,\"user_ms\":%.3f,\"system_ms\":%.3f,\"max_resident_kb\":%llu,"
+			"\"input_blocks\":%llu,\"output_blocks\":%llu,\"voluntary_switches\":%llu,\"involuntary_switches\":%llu}",
+			record_index == 0 ? "" : ",", escaped_command, escaped_source, (unsigned long long)record->sequence,
+			record->stats.exit_code, record->stats.signal,
+			commandReportMilliseconds(record->stats.wall_nanoseconds),
+			commandReportMilliseconds(record->stats.user_nanoseconds),
+			commandReportMilliseconds(record->stats.system_nanoseconds),
+			(unsigned long long)record->stats.max_resident_kilobytes,
+			(unsigned long long)record->stats.input_blocks, (unsigned long long)record->stats.output_blocks,
+			(unsigned long long)record->stats.voluntary_switches,
+			(unsigned long long)record->stats.involuntary_switches);
+		commandReportWriteText(&fh, write_buffer, &write_length, line, line_length);
+	}
+
+	line_length = snprintf(line, sizeof(line), "\n]}\n");
+	commandReportWriteText(&fh, write_buffer, &write_length, line, line_length);
+	platformWriteFile(&fh, write_buffer, write_length);
+	platformCloseFile(&fh);
+
+	arena_restore(arena, stash_point);
+	return true;
+
+}
@@ -0,0 +1,86 @@
+/**
+ * The command report keeps what each command a run executed cost, so that the
+ * commands dominating a run can be found once it finishes. Only the slowest
+ * COMMAND_REPORT_MAX_RECORDS commands are kept, but the totals cover every one.
+ *
+ * Like the trace, the report is shared by the whole run and is only recorded into
+ * between commandReportBegin() and commandReportEnd().
+ */
+#ifndef SOURCERY_PROCESS_COMMAND_REPORT_H
+#define SOURCERY_PROCESS_COMMAND_REPORT_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/process/process.h>
+
+#define COMMAND_REPORT_MAX_RECORDS 		1024
+#define COMMAND_REPORT_TEXT_SIZE 		256
+#define COMMAND_REPORT_PRINT_LIMIT 		10
+#define COMMAND_REPORT_WRITE_BUFFER 	KILOBYTES(64)
+
+/**
+ * A single command and what it cost. The command and source are copied, and
+ * truncated if they don't fit.
+ */
+typedef struct command_record
+{
+	char 			command[COMMAND_REPORT_TEXT_SIZE];
+	char 			source[COMMAND_REPORT_TEXT_SIZE];
+	uint64 			sequence;
+	process_stats 	stats;
+} command_record;
+
+typedef struct command_report
+{
+	command_record* records;
+	uint32 			record_count;
+
+	uint64 	command_count;
+	uint64 	failed_count;
+	uint64 	total_wall_nanoseconds;
+	uint64 	total_user_nanoseconds;
+	uint64 	total_system_nanoseconds;
+	uint64 	peak_resident_kilobytes;
+} command_report;
+
+/**
+ * Begins recording the commands that are run.
+ *
+ * @param arena The arena to place the records on.
+ */
+void
+commandReportBegin(mem_arena* arena);
+
+/**
+ * Stops recording commands. The records remain until the next commandReportBegin().
+ */
+void
+commandReportEnd(void);
+
+/**
+ * Records a command that was run. Nothing is recorded outside of a report.
+ *
+ * @param command The command that was run.
+ * @param source The name of the script the command came from.
+ * @param stats What the command cost to run.
+ */
+void
+commandReportRecord(const char* command, const char* source, process_stats* stats);
+
+/**
+ * Prints the totals and the slowest commands, slowest first.
+ */
+void
+commandReportPrint(void);
+
+/**
+ * Writes the totals and every kept command, slowest first, to a JSON file.
+ *
+ * @param arena The arena to place the write buffer on.
+ * @param path The path of the file to write.
+ *
+ * @returns True if the report was written, false if not.
+ */
+bool
+commandReportWriteJSON(mem_arena* arena, const char* path);
+
+#endif
@@ -2,17 +2,135 @@
  * Processes need to be created using OS-specific calls and therefore these interfaces
  * must be defined in their corresponding OS definitions.
  */
-#ifndef SOURCERY_MEMORY_ALLOC_H
-#define SOURCERY_MEMORY_ALLOC_H
+#ifndef SOURCERY_PROCESS_PROCESS_H
+#define SOURCERY_PROCESS_PROCESS_H
 #include <sourcery/generics.h>
 
 /**
- * Creates a new process using the provided
+ * What a child process cost to run. Platforms that can't report a field leave it
+ * as zero. The block counts are the filesystem reads and writes the child had to
+ * go to storage for, or on Windows its read and write operations.
+ */
+typedef struct process_stats
+{
+	int32 	exit_code;
+	uint32 	signal;
+
+	uint64 	wall_nanoseconds;
+	uint64 	user_nanoseconds;
+	uint64 	system_nanoseconds;
+	uint64 	max_resident_kilobytes;
+
+	uint64 	input_blocks;
+	uint64 	output_blocks;
+	uint64 	voluntary_switches;
+	uint64 	involuntary_switches;
+} process_stats;
+
+/**
+ * Creates a new process using the provided command and waits for it to exit.
  * 
  * @param invoc The command to invoke on the CLI.
+ * @param stats Filled out with what the process cost to run, or NULL if that
+ * isn't needed.
+ * 
+ * @returns The exit code of the process, which is zero on success, or -1 if the
+ * process couldn't be created. A process killed by a signal returns 128 plus the
+ * signal, as a shell would report it.
+ */
+int platformRunCLIProcess(char* invoc, process_stats* stats);
+
+/**
+ * A process whose standard output is captured rather than shown, such as a command
+ * whose output becomes the value of a variable. Its standard error still goes to
+ * the terminal. A capture is started and finished separately, so several may run
+ * at once.
+ */
+typedef struct process_capture
+{
+	size_t 	platform_handles[2];
+	bool 	running;
+	uint64 	start_time;
+} process_capture;
+
+/**
+ * Starts a process with its standard output captured, without waiting for it.
+ *
+ * @param capture The capture to start.
+ * @param invoc The command to invoke on the CLI.
+ *
+ * @returns True if the process was started, false if it couldn't be created.
+ */
+bool platformStartCaptureProcess(process_capture* capture, char* invoc);
+
+/**
+ * Reads a captured process's output until it closes it, then waits for it to exit.
+ * Output past the end of the buffer is read and discarded, so the process is never
+ * left blocked on a full pipe.
+ *
+ * @param capture The capture started by platformStartCaptureProcess().
+ * @param buffer The buffer to place the output in.
+ * @param buffer_size The size of the buffer, in bytes.
+ * @param output_size Set to the size of all of the output, which is larger than the
+ * buffer if the output didn't fit.
+ * @param stats Filled out with what the process cost to run, or NULL if that
+ * isn't needed.
+ *
+ * @returns The exit code of the process, as platformRunCLIProcess() returns it.
+ */
+int platformFinishCaptureProcess(process_capture* capture, char* buffer, size_t buffer_size,
+	size_t* output_size, process_stats* stats);
+
+/**
+ * A shell kept running alongside a script, which the script's commands are
+ * streamed to one at a time. The shell is only spawned once, so a command only
+ * pays for whatever it runs itself. Commands share the shell's state, as the lines
+ * of a shell script would, so a "cd" or a variable carries over to later commands.
+ *
+ * Each command is followed by a sentinel that writes the command's sequence number
+ * and exit code to a separate status pipe, which is how its exit code is observed.
+ * A command that exits the shell ends the session, and the next command starts a
+ * new one.
+ */
+typedef struct shell_session
+{
+	size_t 	platform_handles[3];
+	bool 	open;
+	uint64 	sequence;
+
+	char 	status_buffer[64];
+	uint32 	status_length;
+} shell_session;
+
+/**
+ * Starts a shell session.
+ * 
+ * @param session The session to start.
+ * 
+ * @returns True if the shell was started, false if the platform doesn't support
+ * sessions or the shell couldn't be spawned.
+ */
+bool platformOpenShellSession(shell_session* session);
+
+/**
+ * Runs a command within a shell session, starting the session if it isn't open,
+ * and waits for the command to finish.
+ * 
+ * @param session The session to run the command within.
+ * @param invoc The command to run.
+ * @param stats Filled out with the command's exit code and wall time, or NULL if
+ * that isn't needed. The shell reaps the command, so its resource usage can't be
+ * observed and is left as zero.
+ * 
+ * @returns The exit code of the command, or -1 if the session couldn't be started.
+ */
+int platformRunShellCommand(shell_session* session, char* invoc, process_stats* stats);
+
+/**
+ * Ends a shell session, waiting for the shell to exit.
  * 
- * @returns The status of the running function, non-zero values indicate failure.
+ * @param session The session to end.
  */
-int platformRunCLIProcess(char* invoc);
+void platformCloseShellSession(shell_session* session);
 
-#endif
\ No newline at end of file
+#endif
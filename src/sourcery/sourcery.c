@@ -0,0 +1,1325 @@
+#include <sourcery/sourcery.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sourcery/cache/command_cache.h>
+#include <sourcery/log/log.h>
+#include <sourcery/memory/memutils.h>
+#include <sourcery/perf/perf_zones.h>
+#include <sourcery/process/command_report.h>
+#include <sourcery/stream/directive_stripper.h>
+#include <sourcery/stream/line_stream.h>
+#include <sourcery/string/string_utils.h>
+#include <sourcery/structures/node_trunk.h>
+#include <sourcery/time/clock.h>
+#include <sourcery/trace/trace.h>
+
+/**
+ * Loads a text source from a file and places it within a memory arena. The file
+ * is left open so that ranges of it can be copied straight into generated files,
+ * the offsets within the source being the offsets within the file.
+ * 
+ * @param fh The filehandle to open the file with, which the caller closes.
+ * 
+ * @returns The null-terminated source, or NULL if the file couldn't be opened.
+ */
+internal char*
+loadSource(mem_arena* arena, const char* file, filehandle* fh)
+{
+	// Attempt to open the file.
+	if (!platformOpenFile(fh, file, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+	{
+		logError("Error: Unable to open the file %s for reading.\n", file);
+		return NULL;
+	}
+
+	// Once the file is open, determine how large the text file is and add one
+	// byte for null-termination to create the buffer using the memory arena.
+	size_t file_size = fh->file_size + 1;
+	char* file_buffer = arena_push_array_zero(arena, char, file_size);
+
+	// Read the file into the buffer. The file may have shrunk since it was opened.
+	size_t bytes_read = platformReadFile(fh, file_buffer, fh->file_size);
+	file_buffer[bytes_read] = '\0';
+	PERF_ZONES_ADD_INPUT(bytes_read);
+
+	return file_buffer;
+}
+
+/**
+ * Copies a text source from memory into a memory arena.
+ * 
+ * @returns The null-terminated copy of the source.
+ */
+internal char*
+copySource(mem_arena* arena, const char* source, size_t source_size)
+{
+	char* source_buffer = arena_push_array(arena, char, source_size + 1);
+	for (size_t c_index = 0; c_index < source_size; ++c_index)
+		source_buffer[c_index] = source[c_index];
+	source_buffer[source_size] = '\0';
+	PERF_ZONES_ADD_INPUT(source_size);
+	return source_buffer;
+}
+
+internal uint32
+getDirectiveType(char directive_character)
+{
+	switch(directive_character)
+	{
+		case '#':
+			return (uint32)DIRECTIVE_HEADER;
+		case '!':
+			return (uint32)DIRECTIVE_COMMAND;
+		case '%':
+			return (uint32)DIRECTIVE_MAKEDIR;
+		case '+':
+			return (uint32)DIRECTIVE_MAKEFILE;
+		case '$':
+			return (uint32)DIRECTIVE_VARIABLE;
+		default:
+			return (uint32)DIRECTIVE_UNDEFINED;
+	}
+}
+
+uint32
+getLineDirectiveType(const char* line, size_t line_length)
+{
+	if (line_length > 2 && line[0] == '#' && line[1] == '!')
+		return getDirectiveType(line[2]);
+	return (uint32)DIRECTIVE_UNDEFINED;
+}
+
+/**
+ * Reads a directive line into its parts, as described by directive_line. The
+ * text and name are copied onto the arena, so they outlive the line.
+ * 
+ * @param arena The memory arena to copy the text and name onto.
+ * @param line The directive's line.
+ * @param line_length The length of the line, in bytes.
+ * @param line_index The number of lines in the script before this one.
+ * @param directive_type The directive type of the line.
+ * @param directive The directive line to fill out.
+ */
+internal void
+readDirectiveLine(mem_arena* arena, const char* line, size_t line_length, uint64 line_index,
+	uint32 directive_type, directive_line* directive)
+{
+
+	directive->type = directive_type;
+	directive->line_number = line_index + 1;
+	directive->text = arena_push_array_zero(arena, char, line_length + 1);
+	strSubstring(directive->text, line_length + 1, line, 3, STR_END);
+	directive->name = directive->text;
+	directive->body_offset = 0;
+	directive->has_body = false;
+	directive->multiline = false;
+	if (directive_type != DIRECTIVE_MAKEFILE)
+		return;
+
+	// Separate the filename from the body.
+	size_t separator_location = 0;
+	directive->has_body = strSearchToken(":", directive->text, 0, &separator_location);
+	if (directive->has_body)
+	{
+		directive->name = arena_push_array_zero(arena, char, separator_location + 1);
+		strSubstring(directive->name, separator_location + 1, directive->text, 0, separator_location);
+		directive->body_offset = separator_location + 1;
+	}
+
+	size_t multiline_location = 0;
+	if (strSearchToken("<<(", directive->text, 0, &multiline_location))
+	{
+		directive->body_offset = multiline_location + 3;
+		directive->has_body = true;
+		directive->multiline = true;
+	}
+
+}
+
+/**
+ * Reports a directive that has no implementation.
+ * 
+ * @param directive The directive line.
+ * @param line The whole line the directive is on.
+ */
+internal void
+reportUnknownDirective(directive_line* directive, const char* line)
+{
+	logError("Unrecognized/unimplemented directive on line %4llu\n%s\n",
+		(unsigned long long)directive->line_number, line);
+}
+
+/**
+ * Names a directive type for reporting.
+ * 
+ * @param directive_type The directive type.
+ * 
+ * @returns The name of the directive type.
+ */
+internal const char*
+getDirectiveName(uint32 directive_type)
+{
+	switch (directive_type)
+	{
+		case DIRECTIVE_MAKEFILE:
+			return "directive:makefile";
+		case DIRECTIVE_MAKEDIR:
+			return "directive:makedir";
+		case DIRECTIVE_COMMAND:
+			return "directive:command";
+		case DIRECTIVE_HEADER:
+			return "directive:header";
+		case DIRECTIVE_VARIABLE:
+			return "directive:variable";
+		default:
+			return "directive:other";
+	}
+}
+
+/**
+ * Performs a make directory directive. Missing parents are made along with the
+ * directory and a directory that already exists isn't an error.
+ * 
+ * @param script The script the directive came from.
+ * @param directory_path The path of the directory to create.
+ */
+internal void
+runMakeDirectoryDirective(script_context* script, const char* directory_path)
+{
+	uint32 status = outputSinkMakeDirectory(script->options->output, directory_path);
+	if (status == PLATFORM_CREATEDIR_CREATED)
+	{
+		logInfo("Directory was created at %s.\n", directory_path);
+		script->summary->directories_created++;
+	}
+	else if (status == PLATFORM_CREATEDIR_EXISTS)
+	{
+		logDebug("Directory already exists at %s.\n", directory_path);
+	}
+	else
+	{
+		logError("Directory couldn't be created at %s.\n", directory_path);
+		script->summary->failures++;
+	}
+}
+
+/**
+ * Commits the files that are pending, reporting a failure to commit them.
+ * 
+ * @returns True if every pending file was committed, false if not.
+ */
+internal bool
+commitFiles(run_options* options)
+{
+	if (fileCommitFlush(options->commit))
+		return true;
+	logError("Error: Unable to commit the generated files to the disk.\n");
+	options->summary->failures++;
+	return false;
+}
+
+/**
+ * Performs a command directive, blocking until the command completes. When
+ * commands are batched, the command is run within the script's shell session,
+ * which is started by the script's first command. What the command cost is added
+ * to the command report, as is a command that couldn't be started at all.
+ * 
+ * A command that declares its outputs is looked up in the command cache first,
+ * and its outputs are restored rather than running it if its inputs are unchanged.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param script The script the command came from.
+ * @param directive The command directive, which has its annotations split off.
+ */
+internal void
+runCommandDirective(mem_arena* arena, script_context* script, char* directive)
+{
+
+	// Files that are still pending would be missing to the command.
+	commitFiles(script->options);
+
+	command_cache_spec cache_spec = {0};
+	command_cache_key cache_key = {0};
+	bool cacheable = commandCacheParse(directive, &cache_spec) && script->options->command_cache &&
+		commandCacheComputeKey(arena, &cache_spec, &cache_key);
+	char* command = cache_spec.command;
+
+	if (cacheable && commandCacheRestore(arena, script->options->commit, &cache_spec, &cache_key))
+	{
+		logInfo("Restored the outputs of '%s' from the cache.\n", command);
+		script->summary->commands_restored++;
+		return;
+	}
+
+	// The command writes to the terminal directly, so everything logged before it
+	// has to be out first.
+	logInfo("Executing '%s'.\n", command);
+	logFlush();
+
+	// An application that embeds us may run the command itself. Otherwise, platforms
+	// without shell sessions fall back to a process per command.
+	run_options* options = script->options;
+	bool batched = options->batch_commands && options->run_command == NULL;
+	if (batched && !script->shell.open && !script->shell_unavailable)
+		script->shell_unavailable = !platformOpenShellSession(&script->shell);
+
+	process_stats stats = {0};
+	int exit_code = 0;
+	uint64 start_time = platformGetTimeNanoseconds();
+	if (options->run_command != NULL)
+		exit_code = options->run_command(options->command_user_data, command, &stats);
+	else if (script->shell_unavailable || !batched)
+		exit_code = platformRunCLIProcess(command, &stats);
+	else
+		exit_code = platformRunShellCommand(&script->shell, command, &stats);
+	if (exit_code < 0)
+	{
+		// Nothing ran, so there's nothing to count but how long it took to fail.
+		logError("Error: Unable to run '%s'.\n", command);
+		script->summary->failures++;
+		stats.exit_code = exit_code;
+		if (stats.wall_nanoseconds == 0)
+			stats.wall_nanoseconds = platformGetTimeNanoseconds() - start_time;
+		commandReportRecord(command, script->source_name, &stats);
+		return;
+	}
+	else if (exit_code != 0)
+	{
+		logError("Warning: '%s' exited with status %d.\n", command, exit_code);
+		script->summary->failures++;
+	}
+	script->summary->commands_run++;
+
+	// The command may have removed directories the output knows about.
+	outputSinkInvalidate(script->options->output);
+
+	commandReportRecord(command, script->source_name, &stats);
+
+	if (cacheable && exit_code == 0 && !commandCacheStore(arena, script->options->commit, &cache_spec, &cache_key))
+		logError("Warning: Unable to store the outputs of '%s' in the cache.\n", command);
+
+}
+
+/**
+ * Waits for a command run for a variable and takes its value, reporting the command
+ * as a command directive's would be. A value the run already has is left as it is.
+ * 
+ * @param script The script that needed the value.
+ * @param value The value of the command.
+ */
+internal void
+finishCommandValue(script_context* script, command_value* value)
+{
+
+	if (value->evaluated)
+		return;
+
+	process_stats stats = {0};
+	commandValuesFinish(script->options->command_values, value, &stats);
+	if (value->exit_code < 0)
+	{
+		logError("Error: Unable to run '%s'.\n", value->command);
+		script->summary->failures++;
+		stats.exit_code = value->exit_code;
+		commandReportRecord(value->command, script->source_name, &stats);
+		return;
+	}
+	else if (value->exit_code != 0)
+	{
+		logError("Warning: '%s' exited with status %d.\n", value->command, value->exit_code);
+		script->summary->failures++;
+	}
+	if (value->truncated)
+		logError("Warning: The output of '%s' was cut short at %zu bytes.\n", value->command, value->value_length);
+	script->summary->commands_run++;
+
+	outputSinkInvalidate(script->options->output);
+	commandReportRecord(value->command, script->source_name, &stats);
+
+}
+
+/**
+ * Starts the command of a command variable, unless the run already has its value
+ * or is already running it.
+ * 
+ * @param script The script the variable belongs to.
+ * @param variable The variable.
+ */
+internal void
+startCommandVariable(script_context* script, symbol* variable)
+{
+
+	if (variable->value != NULL || variable->failed)
+		return;
+
+	bool added = false;
+	variable->value = commandValuesFindOrAdd(script->options->command_values, variable->definition,
+		variable->definition_length, &added);
+	if (variable->value == NULL)
+	{
+		logError("Error: Unable to hold the value of {{%s}}, the run has no room left for command values.\n",
+			variable->name);
+		script->summary->failures++;
+		variable->failed = true;
+		return;
+	}
+	else if (!added)
+	{
+		return;
+	}
+
+	// Files that are still pending would be missing to the command.
+	commitFiles(script->options);
+	logInfo("Evaluating '%s' for {{%s}}.\n", variable->definition, variable->name);
+	logFlush();
+	if (!commandValuesStart(variable->value))
+	{
+		logError("Error: Unable to run '%s'.\n", variable->definition);
+		script->summary->failures++;
+	}
+
+}
+
+/**
+ * Evaluates a variable, waiting on its command if it's a command variable.
+ * 
+ * @param script The script the variable belongs to.
+ * @param variable The variable.
+ * @param value_length Set to the length of the value.
+ * 
+ * @returns The value, which is empty if it couldn't be evaluated.
+ */
+internal const char*
+evaluateVariable(script_context* script, symbol* variable, size_t* value_length)
+{
+
+	if (!variable->command)
+	{
+		*value_length = variable->definition_length;
+		return variable->definition;
+	}
+
+	startCommandVariable(script, variable);
+	if (variable->failed)
+	{
+		*value_length = 0;
+		return "";
+	}
+
+	finishCommandValue(script, variable->value);
+	*value_length = variable->value->value_length;
+	return variable->value->value;
+
+}
+
+/**
+ * Performs a variable directive, which defines a variable for the rest of the
+ * script. Only a prefetched command is started now, everything else waits for the
+ * variable's first reference.
+ * 
+ * @param arena The memory arena to place the definition on, which must hold it
+ * until the script is done.
+ * @param script The script the directive came from.
+ * @param directive The variable directive, after its directive token.
+ */
+internal void
+runVariableDirective(mem_arena* arena, script_context* script, const char* directive)
+{
+
+	symbol* variable = symbolTableDefine(arena, &script->symbols, directive);
+	if (variable == NULL)
+	{
+		logError("Error: Malformed variable definition '%s'.\n", directive);
+		script->summary->failures++;
+		return;
+	}
+
+	logDebug("Defined {{%s}}.\n", variable->name);
+	if (variable->prefetch)
+		startCommandVariable(script, variable);
+
+}
+
+/**
+ * Finds the next reference to one of the script's variables within a range of
+ * text. A reference is a defined variable's name within double braces, anything
+ * else is left as it's written.
+ * 
+ * @param script The script.
+ * @param text The text to search.
+ * @param start The offset to begin searching at.
+ * @param end The offset just past the range.
+ * @param reference_start Set to the offset of the reference's opening braces.
+ * @param reference_end Set to the offset just past its closing braces.
+ * @param variable Set to the variable referenced.
+ * 
+ * @returns True if a reference was found.
+ */
+internal bool
+findReference(script_context* script, const char* text, size_t start, size_t end,
+	size_t* reference_start, size_t* reference_end, symbol** variable)
+{
+
+	for (size_t c_index = start; c_index + 1 < end; ++c_index)
+	{
+		if (text[c_index] != '{' || text[c_index + 1] != '{')
+			continue;
+
+		size_t name_start = c_index + 2;
+		size_t name_end = name_start;
+		while (name_end < end && name_end - name_start <= SYMBOL_NAME_LIMIT &&
+			symbolIsNameCharacter(text[name_end]))
+			name_end++;
+		if (name_end + 2 > end || text[name_end] != '}' || text[name_end + 1] != '}')
+			continue;
+
+		symbol* found = symbolTableFind(&script->symbols, text + name_start, name_end - name_start);
+		if (found == NULL)
+			continue;
+
+		*reference_start = c_index;
+		*reference_end = name_end + 2;
+		*variable = found;
+		return true;
+	}
+
+	return false;
+
+}
+
+/**
+ * Replaces the references to the script's variables within a directive's arguments
+ * with their values.
+ * 
+ * @param arena The memory arena to place the expanded arguments on.
+ * @param script The script the directive came from.
+ * @param text The arguments.
+ * 
+ * @returns The expanded arguments, or the arguments themselves if they don't
+ * reference any variable.
+ */
+internal char*
+expandReferences(mem_arena* arena, script_context* script, char* text)
+{
+
+	if (script->symbols.count == 0)
+		return text;
+
+	// The first pass evaluates each variable and measures the expansion, so the
+	// second only has to copy the values.
+	size_t text_length = strLength(text);
+	size_t expanded_length = 0;
+	size_t start = 0;
+	size_t reference_start = 0;
+	size_t reference_end = 0;
+	symbol* variable = NULL;
+	bool referenced = false;
+	while (findReference(script, text, start, text_length, &reference_start, &reference_end, &variable))
+	{
+		size_t value_length = 0;
+		evaluateVariable(script, variable, &value_length);
+		expanded_length += (reference_start - start) + value_length;
+		start = reference_end;
+		referenced = true;
+	}
+	if (!referenced)
+		return text;
+	expanded_length += text_length - start;
+
+	char* expanded = arena_push_array(arena, char, expanded_length + 1);
+	size_t expanded_offset = 0;
+	start = 0;
+	while (findReference(script, text, start, text_length, &reference_start, &reference_end, &variable))
+	{
+		size_t value_length = 0;
+		const char* value = evaluateVariable(script, variable, &value_length);
+		strCopy(expanded + expanded_offset, reference_start - start, text + start, reference_start - start);
+		expanded_offset += reference_start - start;
+		strCopy(expanded + expanded_offset, value_length, value, value_length);
+		expanded_offset += value_length;
+		start = reference_end;
+	}
+	strCopy(expanded + expanded_offset, text_length - start, text + start, text_length - start);
+	expanded[expanded_length] = '\0';
+	return expanded;
+
+}
+
+/**
+ * Rewrites a script without its directives, once its contents are saved to the
+ * rollback snapshot. The stripped script replaces the original through the commit,
+ * so the original is never seen partially rewritten. A script that can't be saved
+ * is left as it is.
+ * 
+ * @param arena The memory arena to place the stripper's buffers on.
+ * @param script The script, whose name is the path it was read from.
+ * @param source_file The script's open file, which is closed.
+ */
+internal void
+stripSourceFile(mem_arena* arena, script_context* script, filehandle* source_file)
+{
+
+	run_options* options = script->options;
+	const char* file_name = script->source_name;
+	if (!rollbackSnapshotSaveFile(options->snapshot, file_name))
+	{
+		platformCloseFile(source_file);
+		logError("Error: Unable to save %s for rollback, its directives were left in place.\n", file_name);
+		script->summary->failures++;
+		return;
+	}
+
+	size_t stash_point = arena_stash(arena);
+	commit_file stripped_file = {0};
+	bool stripped = fileCommitOpen(options->commit, &stripped_file, file_name, true);
+	if (stripped)
+	{
+		directive_stripper stripper = {0};
+		directiveStripperCreate(arena, &stripper, source_file, &stripped_file);
+		bool written = directiveStripperRun(&stripper);
+
+		// The original has to be closed before it can be replaced on some platforms.
+		platformCloseFile(source_file);
+		stripped = fileCommitClose(options->commit, &stripped_file, written);
+	}
+	platformCloseFile(source_file);
+	arena_restore(arena, stash_point);
+
+	if (stripped)
+	{
+		logInfo("Stripped the directives from %s.\n", file_name);
+		script->summary->sources_stripped++;
+	}
+	else
+	{
+		logError("Error: Unable to strip the directives from %s.\n", file_name);
+		script->summary->failures++;
+	}
+
+}
+
+/**
+ * Finishes with a script, waiting on any command it prefetched but never needed,
+ * ending its shell session if it started one and letting the log move past it.
+ * 
+ * @param script The script to finish with.
+ */
+internal void
+finishScript(script_context* script)
+{
+
+	// Only a script that defined variables can have started a command.
+	command_values* values = script->options->command_values;
+	for (uint32 value_index = 0; script->symbols.count != 0 && value_index < values->entry_count; ++value_index)
+		finishCommandValue(script, &values->entries[value_index]);
+
+	if (script->shell.open)
+		platformCloseShellSession(&script->shell);
+	logCloseScript();
+
+}
+
+internal node_trunk*
+createSourceTree(mem_arena* arena, char* source)
+{
+	// Generate a tree for each line in the source file.
+	node_trunk* sourceTree = createLinkedList(arena);
+
+	// Go through each line and then build the linked list.
+	uint64 lineIndex = 0;
+	size_t offset = 0;
+	bool has_next_line = true;
+	while (has_next_line)
+	{
+		
+		// Create the line source structure.
+		line_source* currentLineSource = pushNodeStruct(arena, sourceTree, line_source);
+		
+		// Determine the length of the line, allocate a line buffer, then copy
+		// over the contents of the string from the text source.
+		size_t line_offset = offset;
+		size_t currentLineLength = strLineLength(source, offset);
+		char* lineBuffer = arena_push_array_zero(arena, char, currentLineLength + 1);
+
+		has_next_line = strCopyLine(lineBuffer, currentLineLength + 1, source, offset, &offset);
+
+		// Fill out the line source structure. We assume the directive is undefined
+		// until line processing begins.
+		currentLineSource->lineDirectiveType = DIRECTIVE_UNDEFINED;
+		currentLineSource->lineNumber = lineIndex++;
+		currentLineSource->stringPtr = lineBuffer;
+		currentLineSource->stringLength = currentLineLength;
+		currentLineSource->sourceOffset = line_offset;
+
+	}
+
+	// Reverse the source file to be in the proper orientation.
+	reverseLinkedList(sourceTree);
+
+	// Return the trunk.
+	return sourceTree;
+}
+
+/**
+ * Splits a text source into its lines and determines the directive type of each.
+ * Once we know what each directive type is, we can then begin processing each
+ * directive based on each type.
+ */
+internal void
+indexSource(mem_arena* arena, char* source, script_index* index)
+{
+
+	TRACE_ZONE_BEGIN("createSourceTree");
+	index->lines = createSourceTree(arena, source);
+	TRACE_ZONE_END();
+
+	TRACE_ZONE_BEGIN("classifyDirectives");
+	index->directive_count = 0;
+	node_branch* currentNode = index->lines->next;
+	while (currentNode != NULL)
+	{
+		line_source* currentLine = (line_source*)currentNode->branch;
+		currentLine->lineDirectiveType = getLineDirectiveType(currentLine->stringPtr,
+			currentLine->stringLength);
+		if (currentLine->lineDirectiveType != DIRECTIVE_UNDEFINED)
+			index->directive_count++;
+
+		currentNode = currentNode->next;
+	}
+	TRACE_ZONE_END();
+
+}
+
+/**
+ * Writes a range of the source to the file being generated as it lies. Lines on
+ * Windows end with a carriage return that's only written as a newline, so there
+ * the range is split at each.
+ * 
+ * @param output The output sink with a file begun.
+ * @param source_file The script's file, or NULL if the script is only in memory.
+ * @param source The text of the script.
+ * @param start The offset of the range within the source.
+ * @param end The offset just past the range.
+ */
+internal void
+writeSourceText(output_sink* output, filehandle* source_file, const char* source, size_t start, size_t end)
+{
+
+#if defined(PLATFORM_WINDOWS)
+	for (size_t c_index = start; c_index + 1 < end; ++c_index)
+	{
+		if (source[c_index] == '\r' && source[c_index + 1] == '\n')
+		{
+			outputSinkWriteFileRange(output, source_file, start, source + start, c_index - start);
+			outputSinkWriteFile(output, "\n", 1);
+			start = c_index + 2;
+			c_index++;
+		}
+	}
+#endif
+
+	outputSinkWriteFileRange(output, source_file, start, source + start, end - start);
+
+}
+
+/**
+ * Writes a range of the source to the file being generated, followed by a newline.
+ * The range is written as it is rather than line by line, so that large bodies
+ * are handed to the output in one piece. References to the script's variables are
+ * written as their values, with the text between them still written as it lies.
+ * 
+ * @param script The script, whose output sink has a file begun.
+ * @param source_file The script's file, or NULL if the script is only in memory.
+ * @param source The text of the script.
+ * @param start The offset of the range within the source.
+ * @param end The offset just past the range.
+ */
+internal void
+writeSourceRange(script_context* script, filehandle* source_file, const char* source, size_t start, size_t end)
+{
+
+	output_sink* output = script->options->output;
+	size_t reference_start = 0;
+	size_t reference_end = 0;
+	symbol* variable = NULL;
+	while (script->symbols.count != 0 &&
+		findReference(script, source, start, end, &reference_start, &reference_end, &variable))
+	{
+		size_t value_length = 0;
+		const char* value = evaluateVariable(script, variable, &value_length);
+		writeSourceText(output, source_file, source, start, reference_start);
+		outputSinkWriteFile(output, value, value_length);
+		start = reference_end;
+	}
+
+	writeSourceText(output, source_file, source, start, end);
+	outputSinkWriteFile(output, "\n", 1);
+
+}
+
+/**
+ * Processes a script, handling directives, and then performing
+ * any actions that the directives require. An arena is required
+ * for storing the script and should be sized appropriately.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param options The options of the run.
+ * @param file_name The path to the script, or its name if it's in memory.
+ * @param source The script's text if it's in memory, or NULL to load the file.
+ * @param source_size The size of the script's text, in bytes.
+ * @param loaded_file The open file the script's text was loaded from, in which case
+ * the text is null-terminated and used where it lies, or NULL.
+ * @param index The index of the loaded text, or NULL to index it here.
+ * 
+ * @returns True if the script was processed, false if it couldn't be opened.
+ */
+internal bool
+processSource(mem_arena* arena, run_options* options, const char* file_name,
+	const char* source, size_t source_size, filehandle* loaded_file, const script_index* index)
+{
+
+	// Stash the current position of the arena offset pointer.
+	size_t stash_point = arena_stash(arena);
+
+	script_context script = {0};
+	script.source_name = file_name;
+	script.options = options;
+	script.summary = options->summary;
+	script.summary->scripts++;
+	logOpenScript();
+	logDebug("Processing %s.\n", file_name);
+
+	// Get the text source and then split into a source line tree.
+	TRACE_ZONE_BEGIN("loadSource");
+	uint32 previous_tag = arena_stats_tag(arena, "loadSource");
+	filehandle source_file = {0};
+	filehandle* source_handle = loaded_file;
+	char* text_source = (char*)source;
+	if (loaded_file != NULL)
+	{
+		PERF_ZONES_ADD_INPUT(source_size);
+	}
+	else if (source != NULL)
+		text_source = copySource(arena, source, source_size);
+	else
+		text_source = loadSource(arena, file_name, &source_file);
+	if (source_file.platform_handle_size != 0)
+		source_handle = &source_file;
+	TRACE_ZONE_END();
+	if (text_source == NULL)
+	{
+		arena_stats_untag(arena, previous_tag);
+		script.summary->failures++;
+		logCloseScript();
+		return false;
+	}
+
+	// A script indexed ahead of time already has its lines and directive types.
+	script_index source_index = {0};
+	arena_stats_tag(arena, "createSourceTree");
+	if (index == NULL)
+	{
+		indexSource(arena, text_source, &source_index);
+		index = &source_index;
+	}
+	arena_stats_untag(arena, previous_tag);
+	script.directive_count = index->directive_count;
+
+	// Now that we have the directive types defined, we can begin processing each
+	// directive as we come across them.
+	node_branch* currentNode = index->lines->next;
+	while (currentNode != NULL)
+	{
+		line_source* currentLine = (line_source*)currentNode->branch;
+
+		// Variables last for the rest of the script, so they're defined outside of
+		// any directive's stash.
+		if (currentLine->lineDirectiveType == DIRECTIVE_VARIABLE)
+		{
+			TRACE_ZONE_BEGIN("directive:variable");
+			uint32 previous_tag = arena_stats_tag(arena, "directive:variable");
+			runVariableDirective(arena, &script, currentLine->stringPtr + 3);
+			arena_stats_untag(arena, previous_tag);
+			TRACE_ZONE_END();
+		}
+		else if (currentLine->lineDirectiveType != DIRECTIVE_NONE &&
+			currentLine->lineDirectiveType != DIRECTIVE_UNDEFINED)
+		{
+
+			// Set a stash point so we can freely allocate per directive.
+			size_t directive_stash_point = arena_stash(arena);
+			uint32 previous_tag = arena_stats_tag(arena, getDirectiveName(currentLine->lineDirectiveType));
+
+			directive_line directive = {0};
+			readDirectiveLine(arena, currentLine->stringPtr, currentLine->stringLength, currentLine->lineNumber,
+				currentLine->lineDirectiveType, &directive);
+
+			// Perform the required processes.
+			switch(currentLine->lineDirectiveType)
+			{
+				
+				case DIRECTIVE_MAKEDIR:
+				{
+					// We can now create the directory.
+					TRACE_ZONE_BEGIN("directive:makedir");
+					runMakeDirectoryDirective(&script, expandReferences(arena, &script, directive.text));
+					TRACE_ZONE_END();
+					break;
+				}
+				case DIRECTIVE_MAKEFILE:
+				{
+					// The makefile procedure make be multiline, and therefore we need to
+					// account for that by scanning ahead for the contents should that be the case.
+					TRACE_ZONE_BEGIN("directive:makefile");
+					char* new_file_name = directive.name;
+
+					// The text is written as the range of the source it occupies, which begins
+					// after the colon, or after the multiline operator when there is one.
+					size_t text_start = currentLine->sourceOffset + 3 + directive.body_offset;
+					size_t text_end = currentLine->sourceOffset + currentLine->stringLength;
+					if (directive.multiline)
+					{
+
+						// Since the first line may contain the ending token, the search for it begins
+						// on the directive line itself, right after the multiline operator.
+						size_t working_offset = 3 + directive.body_offset;
+						while (currentNode != NULL)
+						{
+							size_t multiline_end_location = 0;
+							bool multiline_end_found = strSearchToken(")>>", currentLine->stringPtr,
+								working_offset, &multiline_end_location);
+							text_end = currentLine->sourceOffset + ((multiline_end_found) ?
+								multiline_end_location : currentLine->stringLength);
+
+							// Exit the loop, a missing end operator runs to the end of the source.
+							if (multiline_end_found || currentNode->next == NULL)
+								break;
+							else
+							{
+								currentNode = currentNode->next;
+								currentLine = (line_source*)currentNode->branch;
+								working_offset = 0;
+							}
+						}
+					}
+
+					// Write the text straight from the source.
+					output_sink* output = options->output;
+					new_file_name = expandReferences(arena, &script, new_file_name);
+					bool file_opened = outputSinkBeginFile(output, new_file_name);
+					if (file_opened && directive.has_body)
+						writeSourceRange(&script, source_handle, text_source, text_start, text_end);
+					if (file_opened && outputSinkEndFile(output))
+					{
+						logInfo("File %s was created.\n", new_file_name);
+						script.summary->files_created++;
+					}
+					else
+					{
+						logError("Unable to create %s.\n", new_file_name);
+						script.summary->failures++;
+					}
+
+					TRACE_ZONE_END();
+					break;
+				}
+				case DIRECTIVE_COMMAND:
+				{
+					TRACE_ZONE_BEGIN("directive:command");
+					runCommandDirective(arena, &script, expandReferences(arena, &script, directive.text));
+					TRACE_ZONE_END();
+					break;
+				}
+				default:
+				{
+					reportUnknownDirective(&directive, currentLine->stringPtr);
+					break;
+				}
+			}
+
+			// Restore the stash point back to where it should be.
+			arena_stats_untag(arena, previous_tag);
+			arena_restore(arena, directive_stash_point);
+		}
+		currentNode = currentNode->next;
+	}
+
+	// Only a script read from its file is rewritten, and one without directives
+	// would be rewritten unchanged.
+	if (options->strip_directives && source_handle != NULL && script.directive_count != 0)
+	{
+		TRACE_ZONE_BEGIN("stripSourceFile");
+		stripSourceFile(arena, &script, source_handle);
+		TRACE_ZONE_END();
+	}
+	finishScript(&script);
+	platformCloseFile(&source_file);
+
+	// Restore the arena back to its last position.
+	arena_restore(arena, stash_point);
+	return true;
+
+}
+
+/**
+ * Processes a text source as a stream, executing each directive as soon as its
+ * line is complete. Multiline file bodies are handed to the file as each line
+ * arrives rather than being collected first. Since the source is never held in
+ * memory all at once, this allows scripts far larger than the arena, as well as
+ * standard input, to be processed.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param options The options of the run.
+ * @param source An open filehandle to read the script from.
+ * @param source_name The name of the source, used for error reporting.
+ * @param strippable True if the source is the file it's named after, which may be
+ * rewritten without its directives once it's processed.
+ */
+internal void
+processSourceStream(mem_arena* arena, run_options* options, filehandle* source, const char* source_name,
+	bool strippable)
+{
+
+	// Stash the current position of the arena offset pointer.
+	size_t stash_point = arena_stash(arena);
+
+	script_context script = {0};
+	script.source_name = source_name;
+	script.options = options;
+	script.summary = options->summary;
+	script.summary->scripts++;
+	logOpenScript();
+	logDebug("Processing %s.\n", source_name);
+
+	line_stream stream = {0};
+	uint32 previous_tag = arena_stats_tag(arena, "lineStreamCreate");
+	lineStreamCreate(arena, &stream, source, SOURCE_STREAM_CHUNK_SIZE, SOURCE_STREAM_CARRY_RESERVE);
+	arena_stats_untag(arena, previous_tag);
+
+	char* line = NULL;
+	size_t line_length = 0;
+	while (lineStreamNext(&stream, &line, &line_length))
+	{
+
+		uint32 directive_type = getLineDirectiveType(line, line_length);
+		if (directive_type == DIRECTIVE_UNDEFINED)
+			continue;
+		script.directive_count++;
+
+		// Variables last for the rest of the script, so they're defined outside of
+		// any directive's stash.
+		if (directive_type == DIRECTIVE_VARIABLE)
+		{
+			TRACE_ZONE_BEGIN("directive:variable");
+			uint32 previous_tag = arena_stats_tag(arena, "directive:variable");
+			runVariableDirective(arena, &script, line + 3);
+			arena_stats_untag(arena, previous_tag);
+			TRACE_ZONE_END();
+			continue;
+		}
+
+		// Set a stash point so we can freely allocate per directive.
+		size_t directive_stash_point = arena_stash(arena);
+		uint32 previous_tag = arena_stats_tag(arena, getDirectiveName(directive_type));
+
+		directive_line directive = {0};
+		readDirectiveLine(arena, line, line_length, stream.line_number - 1, directive_type, &directive);
+
+		switch (directive_type)
+		{
+
+			case DIRECTIVE_MAKEDIR:
+			{
+				TRACE_ZONE_BEGIN("directive:makedir");
+				runMakeDirectoryDirective(&script, expandReferences(arena, &script, directive.text));
+				TRACE_ZONE_END();
+				break;
+			}
+			case DIRECTIVE_MAKEFILE:
+			{
+				TRACE_ZONE_BEGIN("directive:makefile");
+				char* text_contents = directive.text + directive.body_offset;
+				output_sink* output = options->output;
+				char* new_file_name = expandReferences(arena, &script, directive.name);
+				bool file_opened = outputSinkBeginFile(output, new_file_name);
+
+				if (directive.multiline)
+				{
+
+					// Each body line is written as soon as it is read. The body must be
+					// consumed even if the file couldn't be opened so that its lines
+					// aren't mistaken for directives. A body line too long for the stream
+					// ends the script, and the file along with it.
+					char* working_line = text_contents;
+					while (true)
+					{
+						size_t multiline_end_location = 0;
+						bool multiline_end_found = strSearchToken(")>>", working_line, 0, &multiline_end_location);
+						size_t working_length = (multiline_end_found) ?
+							multiline_end_location : strLength(working_line);
+
+						if (file_opened)
+							writeSourceRange(&script, NULL, working_line, 0, working_length);
+
+						if (multiline_end_found ||
+							!lineStreamNext(&stream, &working_line, &line_length))
+							break;
+					}
+
+					if (file_opened && stream.overflow)
+					{
+						outputSinkDiscardFile(output);
+						file_opened = false;
+					}
+
+				}
+				else if (directive.has_body && file_opened)
+					writeSourceRange(&script, NULL, text_contents, 0, strLength(text_contents));
+
+				if (file_opened && outputSinkEndFile(output))
+				{
+					logInfo("File %s was created.\n", new_file_name);
+					script.summary->files_created++;
+				}
+				else
+				{
+					logError("Unable to create %s.\n", new_file_name);
+					script.summary->failures++;
+				}
+
+				TRACE_ZONE_END();
+				break;
+			}
+			case DIRECTIVE_COMMAND:
+			{
+				TRACE_ZONE_BEGIN("directive:command");
+				runCommandDirective(arena, &script, expandReferences(arena, &script, directive.text));
+				TRACE_ZONE_END();
+				break;
+			}
+			default:
+			{
+				reportUnknownDirective(&directive, line);
+				break;
+			}
+
+		}
+
+		// Restore the stash point back to where it should be.
+		arena_stats_untag(arena, previous_tag);
+		arena_restore(arena, directive_stash_point);
+
+	}
+
+	// The script ends at the line that overflowed, so whatever follows it never ran.
+	if (stream.overflow)
+	{
+		logError("Error: Line %zu of %s exceeds the %zu byte line limit, the rest of it was skipped.\n",
+			stream.line_number + 1, source_name, (size_t)SOURCE_STREAM_CARRY_RESERVE);
+		script.summary->failures++;
+	}
+	PERF_ZONES_ADD_INPUT(source->read_ptr);
+
+	// The stripper streams the source again rather than anything being kept from
+	// this pass, so memory stays bound either way. A script that didn't run to its
+	// end keeps its directives.
+	if (options->strip_directives && strippable && script.directive_count != 0 && !stream.overflow)
+	{
+		TRACE_ZONE_BEGIN("stripSourceFile");
+		stripSourceFile(arena, &script, source);
+		TRACE_ZONE_END();
+	}
+	finishScript(&script);
+
+	// Restore the arena back to its last position.
+	arena_restore(arena, stash_point);
+
+}
+
+/**
+ * Opens a file and processes it as a stream.
+ * 
+ * @param arena The memory arena to perform dynamic storage allocations with.
+ * @param options The options of the run.
+ * @param file_name The path to the file to process.
+ * 
+ * @returns True if the file was processed, false if it couldn't be opened.
+ */
+internal bool
+processSourceFileStreamed(mem_arena* arena, run_options* options, const char* file_name)
+{
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, file_name, PLATFORM_FILECONTEXT_EXISTING, PLATFORM_FILEMODE_READONLY))
+	{
+		logError("Error: Unable to open the file %s for reading.\n", file_name);
+		options->summary->failures++;
+		return false;
+	}
+
+	processSourceStream(arena, options, &fh, file_name, true);
+	platformCloseFile(&fh);
+	return true;
+}
+
+bool
+sourceryCreate(sourcery_context* context, mem_arena* arena)
+{
+
+	sourcery_context empty_context = {0};
+	*context = empty_context;
+
+	if (arena == NULL)
+	{
+		size_t heap_size = SOURCERY_CONTEXT_MEMORY;
+		if (!virtual_allocate(&context->owned_heap, &heap_size, 0))
+			return false;
+		arena_allocate(context->owned_heap, heap_size, &context->owned_arena);
+		arena = &context->owned_arena;
+	}
+	context->arena = arena;
+
+	context->options.command_cache = true;
+	context->options.summary = &context->summary;
+	context->options.output = &context->output;
+	context->options.commit = &context->commit;
+	context->options.snapshot = &context->snapshot;
+	context->options.command_values = &context->command_values;
+
+	directoryCacheCreate(&context->directories, context->arena);
+	fileCommitCreate(&context->commit, context->arena, FILE_COMMIT_NONE);
+	outputSinkCreateFilesystem(&context->output, &context->directories, &context->commit);
+	rollbackSnapshotCreate(&context->snapshot, context->arena, &context->commit);
+	commandValuesCreate(&context->command_values, context->arena);
+	return true;
+
+}
+
+bool
+sourceryDestroy(sourcery_context* context)
+{
+
+	bool output_written = outputSinkDestroy(&context->output);
+	output_written = sourceryCommit(context) && output_written;
+	directoryCacheDestroy(&context->directories);
+
+	if (context->owned_heap != NULL)
+	{
+		arena_release(&context->owned_arena);
+		virtual_free(&context->owned_heap);
+	}
+	return output_written;
+
+}
+
+bool
+sourcerySetArchive(sourcery_context* context, const char* archive_path)
+{
+
+	output_sink archive_sink = {0};
+	if (!outputSinkCreateTar(&archive_sink, context->arena, archive_path))
+		return false;
+
+	outputSinkDestroy(&context->output);
+	context->output = archive_sink;
+	return true;
+
+}
+
+void
+sourcerySetOutputCallbacks(sourcery_context* context, output_callbacks* callbacks)
+{
+	outputSinkDestroy(&context->output);
+	outputSinkCreateCallbacks(&context->output, callbacks);
+}
+
+void
+sourcerySetCommandCallback(sourcery_context* context, command_proc run_command, void* user_data)
+{
+	context->options.run_command = run_command;
+	context->options.command_user_data = user_data;
+}
+
+void
+sourcerySetDurability(sourcery_context* context, uint32 durability)
+{
+	commitFiles(&context->options);
+	context->commit.durability = durability;
+}
+
+bool
+sourceryCommit(sourcery_context* context)
+{
+
+	// The snapshot joins the files it saved, so it's committed along with them.
+	bool snapshot_kept = rollbackSnapshotFinish(&context->snapshot);
+	if (!snapshot_kept)
+	{
+		logError("Error: Unable to keep the rollback snapshot of the stripped sources.\n");
+		context->options.summary->failures++;
+	}
+	return commitFiles(&context->options) && snapshot_kept;
+
+}
+
+uint32
+sourceryRollback(sourcery_context* context, uint32* files_restored)
+{
+	return rollbackRestore(context->arena, &context->commit, files_restored);
+}
+
+void
+sourceryInvalidate(sourcery_context* context)
+{
+	outputSinkInvalidate(&context->output);
+	commandValuesClear(&context->command_values);
+}
+
+bool
+sourceryProcessFile(sourcery_context* context, const char* file_name)
+{
+	return context->options.stream_mode ?
+		processSourceFileStreamed(context->arena, &context->options, file_name) :
+		processSource(context->arena, &context->options, file_name, NULL, 0, NULL, NULL);
+}
+
+bool
+sourceryIndexScript(mem_arena* arena, const char* text, size_t text_size, script_index* index)
+{
+
+	// Each line takes its node, its line source and a copy of itself, so counting
+	// the lines gives the most the index can take.
+	size_t line_count = 1;
+	for (size_t c_index = 0; c_index < text_size; ++c_index)
+	{
+		if (text[c_index] == '\n')
+			line_count++;
+	}
+
+	size_t index_size = sizeof(node_trunk) + text_size +
+		line_count * (sizeof(node_branch) + sizeof(line_source) + 1);
+	if (arena->offset + index_size >= arena->size)
+		return false;
+
+	indexSource(arena, (char*)text, index);
+	return true;
+
+}
+
+bool
+sourceryProcessLoadedFile(sourcery_context* context, const char* file_name, filehandle* fh,
+	const char* text, size_t text_size, const script_index* index)
+{
+	return processSource(context->arena, &context->options, file_name, text, text_size, fh, index);
+}
+
+void
+sourceryProcessBuffer(sourcery_context* context, const char* source, size_t source_size, const char* source_name)
+{
+	processSource(context->arena, &context->options, source_name, source, source_size, NULL, NULL);
+}
+
+void
+sourceryProcessStream(sourcery_context* context, filehandle* source, const char* source_name)
+{
+	processSourceStream(context->arena, &context->options, source, source_name, false);
+}
@@ -0,0 +1,385 @@
+/**
+ * The Sourcery library runs scripts on behalf of the CLI or any application that
+ * embeds it. Everything a run needs is held by a context:
+ * 		1. 	The arena that scripts are loaded and processed on. Each script is
+ * 			processed within a stash of the arena, so the arena only has to hold
+ * 			the largest script rather than every script.
+ * 		2. 	The options that change how scripts are processed.
+ * 		3. 	The output sink that generated directories and files are sent to.
+ * 			They're created in place unless an archive or callbacks are set.
+ * 		4. 	The totals of everything the context's scripts did.
+ * 		5. 	The values of the commands its scripts' variables ran, which each
+ * 			script shares rather than running the commands again.
+ *
+ * Scripts may be processed from files, from memory or from an open stream. An
+ * application that generates many scripts can process them from memory and
+ * receive the output through callbacks, which skips the process and the files
+ * that running the CLI would cost.
+ *
+ * A context isn't thread safe and only one context should be processing at a
+ * time, since the log, trace and command report are shared by the process.
+ */
+#ifndef SOURCERY_SOURCERY_H
+#define SOURCERY_SOURCERY_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/cache/rollback_store.h>
+#include <sourcery/filesystem/directory_cache.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/output/output_sink.h>
+#include <sourcery/process/process.h>
+#include <sourcery/structures/node_trunk.h>
+#include <sourcery/symbols/symbol_table.h>
+
+/**
+ * -----------------------------------------------------------------------------
+ * Line Source & Enumerations
+ * -----------------------------------------------------------------------------
+ */
+
+#define DIRECTIVE_NONE 				0
+#define DIRECTIVE_UNDEFINED 		1
+#define DIRECTIVE_MAKEFILE 			2
+#define DIRECTIVE_MAKEDIR 			3
+#define DIRECTIVE_COMMAND 			4
+#define DIRECTIVE_HEADER 			5
+#define DIRECTIVE_VARIABLE 			6
+#define DIRECTIVE_MACROINLINE 		7
+#define DIRECTIVE_MACROFUNCTION		8
+
+typedef struct line_source
+{
+	char* 	stringPtr;
+	size_t 	stringLength;
+	size_t 	sourceOffset;
+
+	uint64 	lineNumber;
+	uint32 	lineDirectiveType;
+} line_source;
+
+/**
+ * Determines the directive type of a line. Directives must appear at the very
+ * start of a line, and lines shorter than three characters can't be directives.
+ *
+ * @param line The line to classify.
+ * @param line_length The length of the line, in bytes.
+ *
+ * @returns The directive type, or DIRECTIVE_UNDEFINED if the line isn't a directive.
+ */
+uint32
+getLineDirectiveType(const char* line, size_t line_length);
+
+/**
+ * A directive line as it's read by both the loaded and the streamed paths, so a
+ * script is classified and reported the same way whichever path processes it.
+ * Lines are numbered from 1. The text is the directive without its "#!" prefix
+ * and type character.
+ *
+ * A file directive's name runs up to its first colon, or is the whole text without
+ * one, and its body follows the colon. If the multiline operator appears anywhere
+ * in the text, the body begins right after it and runs on to the end operator.
+ */
+typedef struct directive_line
+{
+	uint32 	type;
+	uint64 	line_number;
+	char* 	text;
+
+	char* 	name;
+	size_t 	body_offset;
+	bool 	has_body;
+	bool 	multiline;
+} directive_line;
+
+/**
+ * A script split into its lines, each with its directive type determined. Indexing
+ * is separate from processing so that a script can be indexed on another thread
+ * while the script before it is processed.
+ */
+typedef struct script_index
+{
+	node_trunk* 	lines;
+	uint64 			directive_count;
+} script_index;
+
+/**
+ * The chunk size used when streaming a script and the reserve set aside for
+ * carrying lines across chunk boundaries. The carry reserve is the longest line
+ * a streamed script may contain.
+ */
+#define SOURCE_STREAM_CHUNK_SIZE 		KILOBYTES(64)
+#define SOURCE_STREAM_CARRY_RESERVE 	MEGABYTES(16)
+
+
+/**
+ * -----------------------------------------------------------------------------
+ * Run Options & Script Context
+ * -----------------------------------------------------------------------------
+ */
+
+/**
+ * The totals of a run, which are printed as its summary.
+ */
+typedef struct run_summary
+{
+	uint64 	scripts;
+	uint64 	files_created;
+	uint64 	directories_created;
+	uint64 	commands_run;
+	uint64 	commands_restored;
+	uint64 	sources_stripped;
+	uint64 	failures;
+} run_summary;
+
+/**
+ * Runs a command on behalf of a command directive, in place of starting a process
+ * for it. The procedure fills out what it can of the stats and returns the exit
+ * code of the command, or -1 if it couldn't be run at all.
+ */
+typedef int (*command_proc)(void* user_data, const char* command, process_stats* stats);
+
+/**
+ * The options that change how every script of a run is processed, along with
+ * the totals its scripts add to and where their output goes.
+ */
+typedef struct run_options
+{
+	bool 	stream_mode;
+	bool 	batch_commands;
+	bool 	command_cache;
+	bool 	strip_directives;
+
+	run_summary* 		summary;
+	output_sink* 		output;
+	file_commit* 		commit;
+	rollback_snapshot* 	snapshot;
+	command_values* 	command_values;
+
+	command_proc 	run_command;
+	void* 			command_user_data;
+} run_options;
+
+/**
+ * The state shared by the directives of the script being processed.
+ */
+typedef struct script_context
+{
+	const char* 	source_name;
+	run_options* 	options;
+	run_summary* 	summary;
+
+	shell_session 	shell;
+	bool 			shell_unavailable;
+	uint64 			directive_count;
+
+	symbol_table 	symbols;
+} script_context;
+
+
+/**
+ * -----------------------------------------------------------------------------
+ * Context
+ * -----------------------------------------------------------------------------
+ */
+
+/**
+ * The memory a context reserves for itself when it isn't given an arena.
+ */
+#define SOURCERY_CONTEXT_MEMORY 	MEGABYTES(256)
+
+typedef struct sourcery_context
+{
+	mem_arena* 	arena;
+	mem_arena 	owned_arena;
+	void* 		owned_heap;
+
+	run_options 	options;
+	run_summary 	summary;
+
+	directory_cache 	directories;
+	file_commit 		commit;
+	output_sink 		output;
+	rollback_snapshot 	snapshot;
+	command_values 		command_values;
+} sourcery_context;
+
+/**
+ * Initializes a context. Scripts are processed with the default options: one
+ * process per command, the command cache enabled, output created in place and
+ * files left for the system to flush.
+ *
+ * @param context The context to initialize.
+ * @param arena The arena to process scripts on, or NULL for the context to reserve
+ * SOURCERY_CONTEXT_MEMORY of its own.
+ *
+ * @returns True if the context was initialized, false if its memory couldn't be
+ * reserved.
+ */
+bool
+sourceryCreate(sourcery_context* context, mem_arena* arena);
+
+/**
+ * Finishes with a context, which commits any pending files, ends any archive it
+ * was writing and releases the memory it reserved.
+ *
+ * @param context The context to destroy.
+ *
+ * @returns True if all of the output was written, false if not.
+ */
+bool
+sourceryDestroy(sourcery_context* context);
+
+/**
+ * Writes the directories and files that scripts generate into a tar archive
+ * rather than creating them.
+ *
+ * @param context The context.
+ * @param archive_path The file to write the archive to, or "-" for standard output.
+ *
+ * @returns True if the archive was opened, false if not.
+ */
+bool
+sourcerySetArchive(sourcery_context* context, const char* archive_path);
+
+/**
+ * Hands the directories and files that scripts generate to the application
+ * rather than creating them.
+ *
+ * @param context The context.
+ * @param callbacks The procedures to call, which are copied.
+ */
+void
+sourcerySetOutputCallbacks(sourcery_context* context, output_callbacks* callbacks);
+
+/**
+ * Hands the commands that scripts run to the application rather than starting
+ * a process for each.
+ *
+ * @param context The context.
+ * @param run_command The procedure to call, or NULL to start processes again.
+ * @param user_data The user data handed to the procedure.
+ */
+void
+sourcerySetCommandCallback(sourcery_context* context, command_proc run_command, void* user_data);
+
+/**
+ * Sets how durably the files that scripts write reach the disk, which is one of
+ * the FILE_COMMIT levels. Any files pending under the previous level are
+ * committed first.
+ *
+ * @param context The context.
+ * @param durability The level of durability.
+ */
+void
+sourcerySetDurability(sourcery_context* context, uint32 durability);
+
+/**
+ * Commits the files pending at the run level of durability. Files are committed
+ * before each command, so that the command sees them, and should be committed
+ * again once a run's scripts have all been processed. The rollback snapshot of
+ * the sources stripped since the last commit is kept first, so each commit made
+ * this way is one step of rolling back.
+ *
+ * @param context The context.
+ *
+ * @returns True if every pending file was committed, false if not.
+ */
+bool
+sourceryCommit(sourcery_context* context);
+
+/**
+ * Restores the files saved by the latest rollback snapshot, through the context's
+ * commit. Each rollback steps back one more snapshot.
+ *
+ * @param context The context.
+ * @param files_restored Set to the number of files restored.
+ *
+ * @returns ROLLBACK_RESTORE_COMPLETE if every file was restored,
+ * ROLLBACK_RESTORE_NOTHING if there's no snapshot or ROLLBACK_RESTORE_FAILED.
+ */
+uint32
+sourceryRollback(sourcery_context* context, uint32* files_restored);
+
+/**
+ * Forgets what the context knows about the filesystem, which must be done after
+ * anything other than its scripts may have changed it. The values of commands are
+ * forgotten too, since they're usually taken from the filesystem's state.
+ *
+ * @param context The context.
+ */
+void
+sourceryInvalidate(sourcery_context* context);
+
+/**
+ * Processes a script file. The script is streamed when the stream option is set
+ * and loaded whole otherwise. When the strip option is set, a script that had any
+ * directives is then rewritten without them, once its contents are saved to the
+ * rollback snapshot.
+ *
+ * @param context The context.
+ * @param file_name The path to the script.
+ *
+ * @returns True if the script was processed, false if it couldn't be opened.
+ */
+bool
+sourceryProcessFile(sourcery_context* context, const char* file_name);
+
+/**
+ * Indexes a script's text onto an arena, which may be done on any thread. The
+ * index refers to the text, so both must remain until the script is processed.
+ *
+ * @param arena The arena to place the index on.
+ * @param text The text of the script, null-terminated.
+ * @param text_size The size of the script, in bytes.
+ * @param index The index to fill out.
+ *
+ * @returns True if the script was indexed, false if the index wouldn't fit on the
+ * arena, in which case the arena is left untouched.
+ */
+bool
+sourceryIndexScript(mem_arena* arena, const char* text, size_t text_size, script_index* index);
+
+/**
+ * Processes a script file whose text has already been loaded, such as by the
+ * script pipeline. The text is used where it lies rather than copied, and the
+ * file is used to copy ranges of the script into generated files and to strip it.
+ *
+ * @param context The context.
+ * @param file_name The path to the script.
+ * @param fh The open file the text was loaded from, which the caller closes.
+ * @param text The text of the script, null-terminated, which must remain until
+ * this returns.
+ * @param text_size The size of the script, in bytes.
+ * @param index The index of the text from sourceryIndexScript(), or NULL to index
+ * it here.
+ *
+ * @returns True, since the script is already open.
+ */
+bool
+sourceryProcessLoadedFile(sourcery_context* context, const char* file_name, filehandle* fh,
+	const char* text, size_t text_size, const script_index* index);
+
+/**
+ * Processes a script held in memory. The script is copied, so the buffer may be
+ * reused as soon as this returns.
+ *
+ * @param context The context.
+ * @param source The text of the script, which needn't be null-terminated.
+ * @param source_size The size of the script, in bytes.
+ * @param source_name The name of the script, used for reporting.
+ */
+void
+sourceryProcessBuffer(sourcery_context* context, const char* source, size_t source_size, const char* source_name);
+
+/**
+ * Processes a script as it's read from an open stream, such as standard input.
+ *
+ * @param context The context.
+ * @param source An open filehandle to read the script from.
+ * @param source_name The name of the script, used for reporting.
+ */
+void
+sourceryProcessStream(sourcery_context* context, filehandle* source, const char* source_name);
+
+#endif
@@ -0,0 +1,271 @@
+#include <sourcery/stream/directive_stripper.h>
+#include <sourcery/sourcery.h>
+
+/**
+ * The stripper is a state machine that runs byte by byte, so lines, directive
+ * prefixes and operators may all straddle chunks.
+ * 		1. 	Line start, collecting the first three bytes of a line to see whether
+ * 			it's a directive.
+ * 		2. 	Text, a line that's kept, up to its newline.
+ * 		3. 	Directive, the rest of a directive line that's skipped.
+ * 		4. 	File directive, the rest of a file directive line, watching for the
+ * 			multiline operator.
+ * 		5. 	Body, the body of a multiline file directive, watching for the end
+ * 			operator. A missing end operator runs to the end of the source.
+ */
+#define STRIP_STATE_LINE_START 		0
+#define STRIP_STATE_TEXT 			1
+#define STRIP_STATE_DIRECTIVE 		2
+#define STRIP_STATE_FILE_DIRECTIVE 	3
+#define STRIP_STATE_BODY 			4
+
+void
+directiveStripperCreate(mem_arena* arena, directive_stripper* stripper, filehandle* source,
+	commit_file* output)
+{
+
+	directive_stripper empty_stripper = {0};
+	*stripper = empty_stripper;
+	stripper->source = source;
+	stripper->output = output;
+
+	// The first chunk is read into the first buffer, the second holds nothing yet.
+	stripper->buffers[0] = arena_push_array(arena, char, DIRECTIVE_STRIPPER_CHUNK_SIZE);
+	stripper->buffers[1] = arena_push_array(arena, char, DIRECTIVE_STRIPPER_CHUNK_SIZE);
+	stripper->current_buffer = 1;
+
+	stripper->state = STRIP_STATE_LINE_START;
+	stripper->keeping = true;
+
+}
+
+/**
+ * Advances a partial match of a three byte operator by one byte. On a mismatch the
+ * match falls back to the longest part of it that could still begin the operator,
+ * so that runs such as "<<<(" are matched as the search does.
+ *
+ * @returns The number of bytes of the operator matched, three once it's complete.
+ */
+internal uint32
+directiveStripperMatch(const char* token, uint32 matched, char c)
+{
+
+	while (token[matched] != c)
+	{
+		if (matched == 0)
+			return 0;
+
+		// The bytes matched are the operator's own, so the fallback is found
+		// within the operator.
+		uint32 fallback = matched - 1;
+		while (fallback > 0)
+		{
+			uint32 t_index = 0;
+			while (t_index < fallback && token[matched - fallback + t_index] == token[t_index])
+				t_index++;
+			if (t_index == fallback)
+				break;
+			fallback--;
+		}
+		matched = fallback;
+	}
+	return matched + 1;
+
+}
+
+/**
+ * Writes the kept text up to an offset of the source. Large runs are copied by
+ * the kernel and whatever it didn't copy is written from the two buffers, which
+ * always hold every kept byte that hasn't been written.
+ */
+internal void
+directiveStripperWriteKept(directive_stripper* stripper, size_t kept_end)
+{
+
+	if (kept_end - stripper->kept_start >= DIRECTIVE_STRIPPER_COPY_RANGE_SIZE)
+	{
+		stripper->kept_start += platformCopyFileRange(&stripper->output->fh, stripper->source,
+			stripper->kept_start, kept_end - stripper->kept_start);
+	}
+
+	// The older chunk comes first in the source.
+	uint32 buffer_order[2] = { stripper->current_buffer ^ 1, stripper->current_buffer };
+	for (uint32 order_index = 0; order_index < 2; ++order_index)
+	{
+		uint32 buffer_index = buffer_order[order_index];
+		size_t chunk_start = stripper->chunk_starts[buffer_index];
+		size_t chunk_end = chunk_start + stripper->chunk_lengths[buffer_index];
+		size_t write_start = (stripper->kept_start > chunk_start) ? stripper->kept_start : chunk_start;
+		size_t write_end = (kept_end < chunk_end) ? kept_end : chunk_end;
+		if (write_start < write_end)
+		{
+			fileCommitWrite(stripper->output, stripper->buffers[buffer_index] + (write_start - chunk_start),
+				write_end - write_start);
+		}
+	}
+	stripper->kept_start = kept_end;
+
+}
+
+/**
+ * Ends the directive line at an offset, the next line being kept until it turns
+ * out to be a directive too.
+ */
+internal void
+directiveStripperEndDirective(directive_stripper* stripper, size_t next_line_start)
+{
+	stripper->state = STRIP_STATE_LINE_START;
+	stripper->line_start = next_line_start;
+	stripper->kept_start = next_line_start;
+	stripper->keeping = true;
+}
+
+/**
+ * Runs the state machine over the current chunk.
+ */
+internal void
+directiveStripperStripChunk(directive_stripper* stripper)
+{
+
+	uint32 buffer_index = stripper->current_buffer;
+	char* chunk = stripper->buffers[buffer_index];
+	size_t chunk_start = stripper->chunk_starts[buffer_index];
+	size_t chunk_length = stripper->chunk_lengths[buffer_index];
+
+	size_t c_index = 0;
+	while (c_index < chunk_length)
+	{
+
+		char c = chunk[c_index++];
+		switch (stripper->state)
+		{
+
+			case STRIP_STATE_LINE_START:
+			{
+				// Lines shorter than three bytes can't be directives.
+				if (c == '\n')
+				{
+					stripper->prefix_length = 0;
+					stripper->line_start = chunk_start + c_index;
+					break;
+				}
+
+				stripper->prefix[stripper->prefix_length++] = c;
+				if (stripper->prefix_length < 3)
+					break;
+				stripper->prefix_length = 0;
+
+				uint32 directive_type = getLineDirectiveType(stripper->prefix, 3);
+				if (directive_type == DIRECTIVE_UNDEFINED)
+				{
+					stripper->state = STRIP_STATE_TEXT;
+					break;
+				}
+
+				// The kept text ends where the directive's line begins.
+				directiveStripperWriteKept(stripper, stripper->line_start);
+				stripper->keeping = false;
+				stripper->directives_stripped++;
+				stripper->token_matched = 0;
+				stripper->state = (directive_type == DIRECTIVE_MAKEFILE) ?
+					STRIP_STATE_FILE_DIRECTIVE : STRIP_STATE_DIRECTIVE;
+				break;
+			}
+			case STRIP_STATE_TEXT:
+			{
+				// Kept lines are only looked through for their newline.
+				while (c != '\n' && c_index < chunk_length)
+					c = chunk[c_index++];
+				if (c == '\n')
+				{
+					stripper->state = STRIP_STATE_LINE_START;
+					stripper->line_start = chunk_start + c_index;
+				}
+				break;
+			}
+			case STRIP_STATE_DIRECTIVE:
+			{
+				while (c != '\n' && c_index < chunk_length)
+					c = chunk[c_index++];
+				if (c == '\n')
+					directiveStripperEndDirective(stripper, chunk_start + c_index);
+				break;
+			}
+			case STRIP_STATE_FILE_DIRECTIVE:
+			{
+				if (c == '\n')
+				{
+					directiveStripperEndDirective(stripper, chunk_start + c_index);
+					break;
+				}
+
+				// The end operator may follow on the directive's own line.
+				stripper->token_matched = directiveStripperMatch("<<(", stripper->token_matched, c);
+				if (stripper->token_matched == 3)
+				{
+					stripper->token_matched = 0;
+					stripper->state = STRIP_STATE_BODY;
+				}
+				break;
+			}
+			case STRIP_STATE_BODY:
+			{
+				// Operators never span lines. Once the end is found, the rest of its
+				// line is skipped as part of the directive.
+				if (c == '\n')
+				{
+					stripper->token_matched = 0;
+					break;
+				}
+
+				stripper->token_matched = directiveStripperMatch(")>>", stripper->token_matched, c);
+				if (stripper->token_matched == 3)
+					stripper->state = STRIP_STATE_DIRECTIVE;
+				break;
+			}
+
+		}
+
+	}
+
+}
+
+bool
+directiveStripperRun(directive_stripper* stripper)
+{
+
+	while (!stripper->output->write_failed)
+	{
+
+		// The kept text within the older chunk is written before its buffer is read
+		// into. Only the first bytes of a line are ever held back, and they can't
+		// span a whole chunk, so there's never more than the older chunk to write.
+		uint32 next_buffer = stripper->current_buffer ^ 1;
+		size_t evicted_end = stripper->chunk_starts[next_buffer] + stripper->chunk_lengths[next_buffer];
+		if (stripper->keeping && stripper->kept_start < evicted_end)
+			directiveStripperWriteKept(stripper, evicted_end);
+
+		size_t next_start = stripper->chunk_starts[stripper->current_buffer] +
+			stripper->chunk_lengths[stripper->current_buffer];
+		stripper->source->read_ptr = next_start;
+		size_t bytes_read = platformReadFile(stripper->source, stripper->buffers[next_buffer],
+			DIRECTIVE_STRIPPER_CHUNK_SIZE);
+		if (bytes_read == 0)
+			break;
+
+		stripper->chunk_starts[next_buffer] = next_start;
+		stripper->chunk_lengths[next_buffer] = bytes_read;
+		stripper->current_buffer = next_buffer;
+		directiveStripperStripChunk(stripper);
+
+	}
+
+	// Whatever was kept last runs to the end of the source.
+	if (stripper->keeping)
+	{
+		directiveStripperWriteKept(stripper, stripper->chunk_starts[stripper->current_buffer] +
+			stripper->chunk_lengths[stripper->current_buffer]);
+	}
+	return !stripper->output->write_failed;
+
+}
@@ -0,0 +1,70 @@
+/**
+ * A directive stripper rewrites a source without its directives, which is how
+ * sources are modified in place. Directive lines are skipped along with the body
+ * of a multiline file directive, up to and including the line its end operator is
+ * on. Every other byte is copied exactly as it was, line endings included.
+ *
+ * The source is read in fixed-size chunks into two buffers that take turns, so the
+ * chunk before the current one is still resident while the current one is
+ * stripped. The text kept between two directives is written once its end is found,
+ * and whatever part of it lies within the older chunk is written just before that
+ * buffer is read into. Kept text large enough is copied by the kernel rather than
+ * written from the buffers. The memory a stripper uses is the two buffers,
+ * whatever the size of the source.
+ */
+#ifndef SOURCERY_STREAM_DIRECTIVE_STRIPPER_H
+#define SOURCERY_STREAM_DIRECTIVE_STRIPPER_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/filesystem/file_commit.h>
+#include <sourcery/memory/alloc.h>
+
+#define DIRECTIVE_STRIPPER_CHUNK_SIZE 		KILOBYTES(64)
+#define DIRECTIVE_STRIPPER_COPY_RANGE_SIZE 	KILOBYTES(64)
+
+typedef struct directive_stripper
+{
+	filehandle* 	source;
+	commit_file* 	output;
+
+	char* 	buffers[2];
+	size_t 	chunk_starts[2];
+	size_t 	chunk_lengths[2];
+	uint32 	current_buffer;
+
+	uint32 	state;
+	char 	prefix[3];
+	uint32 	prefix_length;
+	uint32 	token_matched;
+	size_t 	line_start;
+	size_t 	kept_start;
+	bool 	keeping;
+
+	uint64 	directives_stripped;
+} directive_stripper;
+
+/**
+ * Initializes a directive stripper over an open source. The buffers are pushed
+ * onto the provided arena, so the stripper must be released by restoring the
+ * arena to a point before this call.
+ *
+ * @param arena The arena to allocate the buffers from.
+ * @param stripper The stripper to initialize.
+ * @param source The filehandle to read the source from, which must remain open.
+ * @param output The file to write the stripped source to, which must remain open.
+ */
+void
+directiveStripperCreate(mem_arena* arena, directive_stripper* stripper, filehandle* source,
+	commit_file* output);
+
+/**
+ * Strips the whole source, from its start, into the output.
+ *
+ * @param stripper The stripper.
+ *
+ * @returns True if the stripped source was written, false if a write failed.
+ */
+bool
+directiveStripperRun(directive_stripper* stripper);
+
+#endif
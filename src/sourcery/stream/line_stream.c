@@ -0,0 +1,153 @@
+#include <sourcery/stream/line_stream.h>
+#include <sourcery/string/string_utils.h>
+
+void
+lineStreamCreate(mem_arena* arena, line_stream* stream, filehandle* source,
+	size_t chunk_size, size_t carry_reserve)
+{
+
+	stream->source = source;
+
+	// The extra byte allows a line which ends exactly at the end of a chunk to
+	// still be null-terminated in place.
+	stream->chunk_buffer = arena_push_array(arena, char, chunk_size + 1);
+	stream->chunk_size = chunk_size;
+	stream->chunk_length = 0;
+	stream->chunk_offset = 0;
+
+	// The carry buffer is the only thing placed within its partition, so it can
+	// grow by pushing onto the partition without moving.
+	void* carry_region = arena_push(arena, carry_reserve);
+	arena_allocate(carry_region, carry_reserve, &stream->carry_arena);
+	stream->carry_buffer = (char*)carry_region;
+	stream->carry_length = 0;
+
+	stream->line_number = 0;
+	stream->end_of_stream = false;
+	stream->overflow = false;
+
+}
+
+/**
+ * Appends a span of the current chunk onto the carry buffer, growing it as needed.
+ *
+ * @returns True if the span fit within the carry partition, false if not.
+ */
+internal bool
+lineStreamCarry(line_stream* stream, char* span, size_t span_length)
+{
+
+	// Grow the carry buffer in place, keeping room for the null-terminator.
+	size_t required_size = stream->carry_length + span_length + 1;
+	if (required_size > stream->carry_arena.offset)
+	{
+		size_t growth = required_size - stream->carry_arena.offset;
+		if (stream->carry_arena.offset + growth >= stream->carry_arena.size)
+			return false;
+		arena_push(&stream->carry_arena, growth);
+	}
+
+	strCopy(stream->carry_buffer + stream->carry_length, span_length, span, span_length);
+	stream->carry_length += span_length;
+
+	return true;
+
+}
+
+/**
+ * Takes the line ending off a line found up to its newline. Only Windows ends lines
+ * with a carriage return as well, as strLineLength() does for a loaded script, so
+ * elsewhere the carriage return stays part of the line just as it does there.
+ *
+ * @returns The length of the line without its ending.
+ */
+internal size_t
+lineStreamTrimEnding(const char* line, size_t line_length)
+{
+#if defined(PLATFORM_WINDOWS)
+	if (line_length > 0 && line[line_length - 1] == '\r')
+		return line_length - 1;
+#else
+	(void)line;
+#endif
+	return line_length;
+}
+
+bool
+lineStreamNext(line_stream* stream, char** line, size_t* line_length)
+{
+
+	if (stream->overflow)
+		return false;
+
+	stream->carry_length = 0;
+	bool has_carry = false;
+
+	while (true)
+	{
+
+		// Refill the chunk buffer once it has been fully consumed.
+		if (stream->chunk_offset >= stream->chunk_length)
+		{
+			if (stream->end_of_stream)
+				break;
+
+			stream->chunk_length = platformReadFile(stream->source, stream->chunk_buffer, stream->chunk_size);
+			stream->chunk_offset = 0;
+			if (stream->chunk_length == 0)
+			{
+				stream->end_of_stream = true;
+				break;
+			}
+		}
+
+		// Scan for the end of the line within the current chunk.
+		char* span = stream->chunk_buffer + stream->chunk_offset;
+		size_t span_limit = stream->chunk_length - stream->chunk_offset;
+		size_t span_length = 0;
+		while (span_length < span_limit && span[span_length] != '\n')
+			span_length++;
+
+		bool line_complete = (span_length < span_limit);
+
+		// The common case, the whole line is within the chunk. We can hand it
+		// back in place by terminating over the newline.
+		if (line_complete && !has_carry)
+		{
+			stream->chunk_offset += span_length + 1;
+			span_length = lineStreamTrimEnding(span, span_length);
+			span[span_length] = '\0';
+
+			*line = span;
+			*line_length = span_length;
+			stream->line_number++;
+			return true;
+		}
+
+		// Otherwise, the line straddles the chunk boundary and must be carried.
+		if (!lineStreamCarry(stream, span, span_length))
+		{
+			stream->overflow = true;
+			return false;
+		}
+
+		has_carry = true;
+		stream->chunk_offset += span_length + (line_complete ? 1 : 0);
+		if (line_complete)
+			break;
+
+	}
+
+	// The source ended without a trailing line.
+	if (!has_carry)
+		return false;
+
+	stream->carry_length = lineStreamTrimEnding(stream->carry_buffer, stream->carry_length);
+	stream->carry_buffer[stream->carry_length] = '\0';
+
+	*line = stream->carry_buffer;
+	*line_length = stream->carry_length;
+	stream->line_number++;
+	return true;
+
+}
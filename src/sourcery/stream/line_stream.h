@@ -0,0 +1,72 @@
+/**
+ * A line stream reads a text source in fixed-size chunks and hands back one
+ * line at a time, carrying partial lines across chunk boundaries. Unlike the
+ * loadSource() route, the source is never held in memory all at once, which
+ * allows scripts of arbitrary size (or standard input) to be processed.
+ *
+ * The memory used by a line stream is its chunk buffer plus a carry buffer for
+ * lines that straddle a chunk boundary. The carry buffer lives at the bottom of
+ * its own partition of the parent arena and grows in place, so the peak memory
+ * is bounded by the chunk size plus the longest single line in the source.
+ *
+ * Lines are returned without their line endings and are null-terminated. Lines end
+ * at each "\n". On Windows a "\r" before it belongs to the ending as well, as it
+ * does for a loaded script, and elsewhere it's kept as part of the line. The
+ * returned pointer is only valid until the next call to lineStreamNext().
+ */
+#ifndef SOURCERY_STREAM_LINE_STREAM_H
+#define SOURCERY_STREAM_LINE_STREAM_H
+#include <sourcery/generics.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/memory/alloc.h>
+
+typedef struct line_stream
+{
+	filehandle* source;
+
+	char* 	chunk_buffer;
+	size_t 	chunk_size;
+	size_t 	chunk_length;
+	size_t 	chunk_offset;
+
+	mem_arena 	carry_arena;
+	char* 		carry_buffer;
+	size_t 		carry_length;
+
+	size_t 	line_number;
+	bool 	end_of_stream;
+	bool 	overflow;
+} line_stream;
+
+/**
+ * Initializes a line stream over an open filehandle. The chunk buffer and the
+ * carry partition are pushed onto the provided arena, so the stream must be
+ * released by restoring the arena to a point before this call.
+ *
+ * @param arena The arena to allocate the chunk buffer and carry partition from.
+ * @param stream The line stream to initialize.
+ * @param source The filehandle to read from, which must remain open.
+ * @param chunk_size The size, in bytes, of each read from the source.
+ * @param carry_reserve The size, in bytes, reserved for lines spanning chunks. This
+ * is the upper limit on the length of a single line.
+ */
+void
+lineStreamCreate(mem_arena* arena, line_stream* stream, filehandle* source,
+	size_t chunk_size, size_t carry_reserve);
+
+/**
+ * Fetches the next line from the stream.
+ *
+ * @param stream The line stream to read from.
+ * @param line Set to the null-terminated line on success.
+ * @param line_length Set to the length, in bytes, of the line on success.
+ *
+ * @returns True if a line was returned, false at the end of the stream or if a
+ * line didn't fit within the carry reserve, in which case overflow is set. The
+ * stream ends at a line that overflows, every later call returns false too, so
+ * the rest of that line is never mistaken for lines of its own.
+ */
+bool
+lineStreamNext(line_stream* stream, char** line, size_t* line_length);
+
+#endif
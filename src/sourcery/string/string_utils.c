@@ -1,19 +1,22 @@
 #include <sourcery/string/string_utils.h>
 
 void
-strSubstring(char* buffer, size_t buffer_size, char* source_string, size_t start, int64 end)
+strSubstring(char* buffer, size_t buffer_size, const char* source_string, size_t start, size_t end)
 {
 
 	size_t character_index = start;
-	size_t ending_index = end;
 	size_t buffer_index = 0;
-	
-	// If string end is zero, then we want everything up to the end of the string.
-	if (end == -1)
-		end = strLength(source_string) + 1;
+
+	// Nothing can be copied into an empty buffer, not even the null-terminator.
+	if (buffer_size == 0)
+		return;
+
+	// If string end is STR_END, then we want everything up to the end of the string.
+	if (end == STR_END)
+		end = strLength(source_string);
 
 	// Copy over the contents, then null terminate.
-	while (buffer_index < buffer_size && character_index < end)
+	while (buffer_index + 1 < buffer_size && character_index < end)
 		buffer[buffer_index++] = source_string[character_index++];
 	buffer[buffer_index] = '\0';
 
@@ -22,16 +25,16 @@ strSubstring(char* buffer, size_t buffer_size, char* source_string, size_t start
 size_t
 strLength(const char* string)
 {
-	int n = 0;
+	size_t n = 0;
 	while (string[n] != '\0') n++;
 	return n;
 }
 
 size_t
-strLineLength(char* string, int offset)
+strLineLength(const char* string, size_t offset)
 {
 
-	char* current_char = string + offset;
+	const char* current_char = string + offset;
 	size_t line_size = 0;
 	while (current_char[line_size] != '\0')
 	{
@@ -42,7 +45,7 @@ strLineLength(char* string, int offset)
 		if (current_char[line_size] == '\r' && current_char[line_size+1] == '\n')
 			break;
 #else
-		if (current_char == '\n')
+		if (current_char[line_size] == '\n')
 			break;
 #endif
 
@@ -53,48 +56,82 @@ strLineLength(char* string, int offset)
 
 }
 
-int
-strCopyLine(char* buffer, size_t buffer_size, char* string, int offset)
+bool
+strCopyLine(char* buffer, size_t buffer_size, const char* string, size_t offset, size_t* next_offset)
 {
 
 	// Ensure that line fits within the buffer.
-	if (strLineLength(string, offset) + 1 > buffer_size)
+	size_t line_size = strLineLength(string, offset);
+	if (line_size + 1 > buffer_size)
 	{
-		// Assertion for debugging, otherwise just return -1.
+		// Assertion for debugging, otherwise just report that there's nothing more.
 		assert(!"Unable to fit in buffer.");
-		return -1;
+		return false;
 	}
 
-	// Determine the pointer using the provided offset.
-	char* current_char = string + offset;
-	size_t line_size = 0;
-	while (current_char[line_size] != '\0')
-	{
-		// Since Windows uses carriage returns along with the newline,
-		// we need to ensure that we account for that.
-#if defined(PLATFORM_WINDOWS)
-		if (current_char[line_size] == '\r' && current_char[line_size+1] == '\n')
-			break;
-#else
-		if (current_char == '\n')
-			break;
-#endif
-		buffer[line_size] = current_char[line_size];
-		line_size++;
-	}
+	// The line length is already known, so copy it over in one go.
+	const char* current_char = string + offset;
+	strCopy(buffer, buffer_size, current_char, line_size);
 	buffer[line_size] = '\0'; // Null terminate.
 
-	// If its the end of the string, return -1 since there are no other lines.
-	if (current_char[line_size] == '\0') return -1;
-	else
-	{
-		// Once again, Windows is weird so we need to account for that.
+	// If its the end of the string, there are no other lines.
+	if (current_char[line_size] == '\0') return false;
+
+	// Once again, Windows is weird so we need to account for that.
 #if defined(PLATFORM_WINDOWS)
-		return offset + line_size + 2;
+	*next_offset = offset + line_size + 2;
 #else
-		return offset + line_size + 1;
+	*next_offset = offset + line_size + 1;
 #endif
+	return true;
+
+}
+
+bool
+strEquals(const char* left, const char* right)
+{
+	size_t c_index = 0;
+	while (left[c_index] != '\0' && left[c_index] == right[c_index])
+		c_index++;
+	return (left[c_index] == right[c_index]);
+}
+
+bool
+strMatchWildcard(const char* pattern, const char* string)
+{
+
+	// Iterative matching with a single backtrack point, the most recent '*'.
+	const char* star_pattern = NULL;
+	const char* star_string = NULL;
+	while (*string != '\0')
+	{
+		if (*pattern == '*')
+		{
+			star_pattern = ++pattern;
+			star_string = string;
+		}
+		else if (*pattern == '?' || *pattern == *string)
+		{
+			pattern++;
+			string++;
+		}
+		else if (star_pattern != NULL)
+		{
+			pattern = star_pattern;
+			string = ++star_string;
+		}
+		else
+		{
+			return false;
+		}
 	}
+
+	// Any trailing stars match the empty remainder.
+	while (*pattern == '*')
+		pattern++;
+
+	return (*pattern == '\0');
+
 }
 
 char*
@@ -114,7 +151,7 @@ strCopy(char* dest, size_t dest_size, const char* source, size_t source_size)
 	if (dest_size < source_size) return dest;
 
 	// Copy over the contents of the source buffer.
-	int c_index = 0;
+	size_t c_index = 0;
 	while (c_index < source_size)
 	{
 		dest[c_index] = source[c_index];
@@ -125,56 +162,46 @@ strCopy(char* dest, size_t dest_size, const char* source, size_t source_size)
 
 }
 
-int
-strSearchToken(const char* token, const char* string, int offset)
+bool
+strSearchToken(const char* token, const char* string, size_t offset, size_t* location)
 {
 
+	// An empty token can't be searched for.
+	if (token[0] == '\0')
+		return false;
+
 	// Search the string until we reach the null-terminator.
-	int c_index = offset;
+	size_t c_index = offset;
 	while (string[c_index] != '\0')
 	{
 
 		// If the first character of the token matches the first character
 		// of the string, then begin checking for the rest of the characters.
-		int t_index = 0;
-		if (string[c_index] == token[t_index])
+		// The candidate index isn't advanced, so overlapping matches are found.
+		if (string[c_index] == token[0])
 		{
 
-			// Assume the search is valid.
-			bool valid = true;
-
-			// Bump the indexes up.
-			c_index++;
-			t_index++;
+			size_t t_index = 1;
+			while (token[t_index] != '\0' && string[c_index + t_index] == token[t_index])
+				t_index++;
 
-			// As long as we're not at the end of either strings,
-			// match for tokens.
-			while (string[c_index] != '\0' && token[t_index] != '\0')
+			// The whole token matched, so the token begins at the candidate.
+			if (token[t_index] == '\0')
 			{
-				if (string[c_index] != token[t_index])
-				{
-					break;
-				}
-				c_index++;
-				t_index++;
+				*location = c_index;
+				return true;
 			}
 
-			// The loop might fall out because we reached the end of the string
-			// rather than the token. We can check for this by seeing if t_index
-			// reached the string's length.
-			if (t_index != strLength(token)) valid = false;
-
-			// The position is simply c_index - t_index, which places the index
-			// where the token begins.
-			if (valid == true)
-				return c_index-t_index;
+			// The string ran out before the token did, it can't appear any later.
+			if (string[c_index + t_index] == '\0')
+				return false;
 
 		}
 
 		c_index++;
 	}
 
-	return -1;
+	return false;
 
 }
 
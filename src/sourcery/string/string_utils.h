@@ -2,12 +2,19 @@
 #define SOURCERY_STRING_UTILS_H
 #include <sourcery/generics.h>
 
+/**
+ * Used as the ending index for strSubstring() to indicate that everything up to
+ * the end of the string should be copied.
+ */
+#define STR_END ((size_t)-1)
+
 /**
  * Copies a substring from a string into the provided buffer. The
  * ending value should be the index of the element to stop at, not
- * the index of the last character to copy. A value of -1 for end
+ * the index of the last character to copy. A value of STR_END for end
  * indicates that everything from the starting value to the last character
- * should be copied.
+ * should be copied. The copy is truncated to fit the buffer and is always
+ * null-terminated.
  * 
  * @param buffer The buffer to copy the source substring into.
  * @param buffer_size The size of the buffer.
@@ -16,8 +23,8 @@
  * @param end The ending index of the substring.
  */
 void
-strSubstring(char* buffer, size_t buffer_size, char* source_string,
-	size_t start, int64 end);
+strSubstring(char* buffer, size_t buffer_size, const char* source_string,
+	size_t start, size_t end);
 
 /**
  * Returns the length of a string.
@@ -37,21 +44,23 @@ size_t strLength(const char* string);
  * 
  * @returns The size, in bytes, of the line.
  */
-size_t strLineLength(char* string, int offset);
+size_t strLineLength(const char* string, size_t offset);
 
 /**
  * Retrieves a line from a provided string and copies it to the buffer starting
- * from an offset. The value returned is the offset to the next line otherwise
- * returns -1.
+ * from an offset. If another line follows, next_offset is set to its offset.
  * 
  * @param buffer The buffer to copy the line into.
  * @param buffer_size The size of the buffer.
  * @param source_string The string to pull the line from.
  * @param offset The offset into the string to begin looking for a line.
+ * @param next_offset Set to the offset of the next line, if there is one.
  * 
- * @returns The offset to the next line otherwise -1.
+ * @returns True if another line follows, false if this was the last line or the
+ * line couldn't fit within the buffer.
  */
-int strCopyLine(char* buffer, size_t buffer_size, char* source_string, int offset);
+bool strCopyLine(char* buffer, size_t buffer_size, const char* source_string,
+	size_t offset, size_t* next_offset);
 
 /**
  * Searches for the first token within a string.
@@ -59,12 +68,33 @@ int strCopyLine(char* buffer, size_t buffer_size, char* source_string, int offse
  * @param token The token to search for.
  * @param string The string to search in.
  * @param offset The offset to which to begin searching for a token.
+ * @param location Set to the starting index of the token if it was found.
+ * 
+ * @returns True if the token was found within the string, false if not.
+ */
+bool
+strSearchToken(const char* token, const char* string, size_t offset, size_t* location);
+
+/**
+ * Determines if two null-terminated strings are identical.
+ * 
+ * @param left The first string to compare.
+ * @param right The second string to compare.
+ * 
+ * @returns True if both strings contain the same characters, false if not.
+ */
+bool strEquals(const char* left, const char* right);
+
+/**
+ * Matches a string against a wildcard pattern. A '*' matches any run of characters,
+ * including none, and a '?' matches exactly one character.
+ * 
+ * @param pattern The wildcard pattern.
+ * @param string The string to match.
  * 
- * @returns The starting index position of the token, or -1 if the
- * token was not found within the string.
+ * @returns True if the whole string matches the pattern, false if not.
  */
-int
-strSearchToken(const char* token, const char* string, int offset);
+bool strMatchWildcard(const char* pattern, const char* string);
 
 /**
  * Copies a string from source into dest.
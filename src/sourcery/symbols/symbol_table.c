@@ -0,0 +1,222 @@
+#include <sourcery/symbols/symbol_table.h>
+#include <sourcery/hash/hash.h>
+#include <sourcery/string/string_utils.h>
+
+internal bool
+symbolIsSpace(char c)
+{
+	return (c == ' ' || c == '\t' || c == '\r');
+}
+
+bool
+symbolIsNameCharacter(char c)
+{
+	return (charIsAlpha(c) || (c >= '0' && c <= '9') || c == '_');
+}
+
+symbol*
+symbolTableDefine(mem_arena* arena, symbol_table* table, const char* directive)
+{
+
+	const char* cursor = directive;
+	while (symbolIsSpace(*cursor))
+		cursor++;
+
+	// The annotation is written the way the command cache's are.
+	const char* annotation = "{prefetch}";
+	size_t annotation_length = 0;
+	while (annotation[annotation_length] != '\0' && cursor[annotation_length] == annotation[annotation_length])
+		annotation_length++;
+	bool prefetch = (annotation[annotation_length] == '\0');
+	if (prefetch)
+	{
+		cursor += annotation_length;
+		while (symbolIsSpace(*cursor))
+			cursor++;
+	}
+
+	const char* name = cursor;
+	while (symbolIsNameCharacter(*cursor))
+		cursor++;
+	size_t name_length = (size_t)(cursor - name);
+	if (name_length == 0 || name_length > SYMBOL_NAME_LIMIT)
+		return NULL;
+
+	while (symbolIsSpace(*cursor))
+		cursor++;
+	if (*cursor != '=')
+		return NULL;
+	cursor++;
+	while (symbolIsSpace(*cursor))
+		cursor++;
+
+	bool command = (*cursor == '!');
+	if (command)
+	{
+		cursor++;
+		while (symbolIsSpace(*cursor))
+			cursor++;
+	}
+
+	// Trailing whitespace, including the carriage return of a Windows line, isn't
+	// part of the value.
+	const char* definition = cursor;
+	size_t definition_length = strLength(definition);
+	while (definition_length > 0 && symbolIsSpace(definition[definition_length - 1]))
+		definition_length--;
+	if (command && definition_length == 0)
+		return NULL;
+
+	symbol* variable = arena_push_struct_zero(arena, symbol);
+	variable->name = arena_push_array(arena, char, name_length + 1);
+	strCopy(variable->name, name_length + 1, name, name_length);
+	variable->name[name_length] = '\0';
+	variable->name_length = name_length;
+	variable->definition = arena_push_array(arena, char, definition_length + 1);
+	strCopy(variable->definition, definition_length + 1, definition, definition_length);
+	variable->definition[definition_length] = '\0';
+	variable->definition_length = definition_length;
+	variable->command = command;
+	variable->prefetch = prefetch && command;
+
+	variable->next = table->first;
+	table->first = variable;
+	table->count++;
+	return variable;
+
+}
+
+symbol*
+symbolTableFind(symbol_table* table, const char* name, size_t name_length)
+{
+
+	for (symbol* variable = table->first; variable != NULL; variable = variable->next)
+	{
+		if (variable->name_length != name_length)
+			continue;
+
+		size_t c_index = 0;
+		while (c_index < name_length && variable->name[c_index] == name[c_index])
+			c_index++;
+		if (c_index == name_length)
+			return variable;
+	}
+
+	return NULL;
+
+}
+
+void
+commandValuesCreate(command_values* values, mem_arena* arena)
+{
+
+	command_values empty_values = {0};
+	*values = empty_values;
+
+	values->entries = arena_push_array_zero(arena, command_value, COMMAND_VALUES_MAX_ENTRIES);
+	values->slots = arena_push_array_zero(arena, uint32, COMMAND_VALUES_SLOT_COUNT);
+	values->pool = arena_push_array(arena, char, COMMAND_VALUES_POOL);
+
+}
+
+void
+commandValuesClear(command_values* values)
+{
+	for (uint32 slot_index = 0; slot_index < COMMAND_VALUES_SLOT_COUNT; ++slot_index)
+		values->slots[slot_index] = 0;
+	values->entry_count = 0;
+	values->pool_used = 0;
+}
+
+command_value*
+commandValuesFindOrAdd(command_values* values, const char* command, size_t command_length, bool* added)
+{
+
+	*added = false;
+	uint64 hash = hashMemory64(command, command_length, HASH64_SEED);
+	uint32 slot_index = (uint32)hash & (COMMAND_VALUES_SLOT_COUNT - 1);
+	while (values->slots[slot_index] != 0)
+	{
+		command_value* value = &values->entries[values->slots[slot_index] - 1];
+		if (value->hash == hash && value->command_length == command_length)
+		{
+			size_t c_index = 0;
+			while (c_index < command_length && value->command[c_index] == command[c_index])
+				c_index++;
+			if (c_index == command_length)
+				return value;
+		}
+		slot_index = (slot_index + 1) & (COMMAND_VALUES_SLOT_COUNT - 1);
+	}
+
+	if (values->entry_count == COMMAND_VALUES_MAX_ENTRIES ||
+		values->pool_used + command_length + 1 > COMMAND_VALUES_POOL)
+		return NULL;
+
+	command_value empty_value = {0};
+	command_value* value = &values->entries[values->entry_count++];
+	*value = empty_value;
+	value->hash = hash;
+	value->command = values->pool + values->pool_used;
+	value->command_length = command_length;
+	strCopy(value->command, command_length + 1, command, command_length);
+	value->command[command_length] = '\0';
+	values->pool_used += command_length + 1;
+
+	values->slots[slot_index] = values->entry_count;
+	*added = true;
+	return value;
+
+}
+
+bool
+commandValuesStart(command_value* value)
+{
+
+	if (platformStartCaptureProcess(&value->capture, value->command))
+		return true;
+
+	value->evaluated = true;
+	value->exit_code = -1;
+	value->value = "";
+	value->value_length = 0;
+	return false;
+
+}
+
+void
+commandValuesFinish(command_values* values, command_value* value, process_stats* stats)
+{
+
+	// The output is read straight onto the end of the pool, which leaves room for
+	// the null-terminator.
+	size_t pool_left = COMMAND_VALUES_POOL - values->pool_used;
+	size_t buffer_size = (pool_left > 0) ? pool_left - 1 : 0;
+	if (buffer_size > COMMAND_VALUES_VALUE_LIMIT)
+		buffer_size = COMMAND_VALUES_VALUE_LIMIT;
+
+	char* buffer = values->pool + values->pool_used;
+	size_t output_size = 0;
+	value->exit_code = platformFinishCaptureProcess(&value->capture, buffer, buffer_size, &output_size, stats);
+	value->evaluated = true;
+
+	// Commands end their output with a newline, which isn't wanted in the middle of
+	// whatever the value is placed in.
+	size_t value_length = (output_size < buffer_size) ? output_size : buffer_size;
+	value->truncated = (value_length < output_size);
+	while (value_length > 0 && (buffer[value_length - 1] == '\n' || buffer[value_length - 1] == '\r'))
+		value_length--;
+
+	if (pool_left == 0)
+	{
+		value->value = "";
+		value->value_length = 0;
+		return;
+	}
+
+	buffer[value_length] = '\0';
+	value->value = buffer;
+	value->value_length = value_length;
+	values->pool_used += value_length + 1;
+
+}
@@ -0,0 +1,180 @@
+/**
+ * Variables are defined by a script and referenced by the directives after them.
+ * A definition is stored as it's written and only evaluated when the variable is
+ * first referenced, so a variable a script never uses costs nothing.
+ *
+ * A variable is either literal text or the output of a command:
+ * 		#!$NAME=text
+ * 		#!$NAME=!command
+ * 		#!${prefetch} NAME=!command
+ *
+ * Each script has its own symbol table, which is gone once the script is done. The
+ * values of commands are kept for the whole run instead, keyed by the command's
+ * text, so a command that every script of a run defines a variable with is only
+ * ever run once. A prefetched command is started as soon as it's defined and left
+ * running alongside the script until its value is needed, so the commands a script
+ * prefetches run at the same time.
+ */
+#ifndef SOURCERY_SYMBOLS_SYMBOL_TABLE_H
+#define SOURCERY_SYMBOLS_SYMBOL_TABLE_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/process/process.h>
+
+#define SYMBOL_NAME_LIMIT 				64
+#define COMMAND_VALUES_MAX_ENTRIES 		1024
+#define COMMAND_VALUES_SLOT_COUNT 		2048
+#define COMMAND_VALUES_POOL 			MEGABYTES(1)
+#define COMMAND_VALUES_VALUE_LIMIT 		KILOBYTES(64)
+
+/**
+ * The value of a command, which is its output with any trailing newlines removed.
+ * The value is only set once the command has finished, until then the command may
+ * still be running.
+ */
+typedef struct command_value
+{
+	uint64 	hash;
+	char* 	command;
+	size_t 	command_length;
+
+	process_capture capture;
+	bool 			evaluated;
+	int 			exit_code;
+	char* 			value;
+	size_t 			value_length;
+	bool 			truncated;
+} command_value;
+
+/**
+ * The values of every command run for a variable, which last for the whole run.
+ */
+typedef struct command_values
+{
+	command_value* 	entries;
+	uint32 			entry_count;
+	uint32* 		slots;
+
+	char* 	pool;
+	size_t 	pool_used;
+} command_values;
+
+/**
+ * A variable defined by a script. A command variable's value is found once its
+ * command is started, at its first reference or when it's defined if prefetched.
+ */
+typedef struct symbol
+{
+	char* 	name;
+	size_t 	name_length;
+	char* 	definition;
+	size_t 	definition_length;
+
+	bool 	command;
+	bool 	prefetch;
+	bool 	failed;
+
+	command_value* 	value;
+	struct symbol* 	next;
+} symbol;
+
+/**
+ * The variables of a script. Later definitions of a name hide the earlier ones.
+ */
+typedef struct symbol_table
+{
+	symbol* 	first;
+	uint32 		count;
+} symbol_table;
+
+/**
+ * Determines if a character may be part of a variable's name, which are letters,
+ * digits and underscores.
+ *
+ * @param c The character.
+ *
+ * @returns True if it may be part of a name.
+ */
+bool
+symbolIsNameCharacter(char c);
+
+/**
+ * Parses a variable directive and adds its definition to a symbol table.
+ *
+ * @param arena The arena to place the definition on, which must outlive the table.
+ * @param table The symbol table.
+ * @param directive The variable directive, after its directive token.
+ *
+ * @returns The variable defined, or NULL if the directive is malformed.
+ */
+symbol*
+symbolTableDefine(mem_arena* arena, symbol_table* table, const char* directive);
+
+/**
+ * Finds the latest definition of a variable.
+ *
+ * @param table The symbol table.
+ * @param name The name of the variable, which needn't be null-terminated.
+ * @param name_length The length of the name, in bytes.
+ *
+ * @returns The variable, or NULL if it isn't defined.
+ */
+symbol*
+symbolTableFind(symbol_table* table, const char* name, size_t name_length);
+
+/**
+ * Initializes an empty set of command values.
+ *
+ * @param values The command values to initialize.
+ * @param arena The arena to place the values on, which must outlive them.
+ */
+void
+commandValuesCreate(command_values* values, mem_arena* arena);
+
+/**
+ * Forgets every command value, so that each command is run again the next time
+ * it's needed. No command may still be running.
+ *
+ * @param values The command values.
+ */
+void
+commandValuesClear(command_values* values);
+
+/**
+ * Finds the value of a command, or adds it unevaluated if the command hasn't been
+ * seen before.
+ *
+ * @param values The command values.
+ * @param command The command, which needn't be null-terminated.
+ * @param command_length The length of the command, in bytes.
+ * @param added Set to true if the command was added.
+ *
+ * @returns The value, or NULL if the command is new and there's no room for it.
+ */
+command_value*
+commandValuesFindOrAdd(command_values* values, const char* command, size_t command_length, bool* added);
+
+/**
+ * Starts a command added by commandValuesFindOrAdd(). A command that can't be
+ * started is evaluated straight away, to an empty value with an exit code of -1.
+ *
+ * @param value The value of the command.
+ *
+ * @returns True if the command was started.
+ */
+bool
+commandValuesStart(command_value* value);
+
+/**
+ * Waits for a started command and evaluates its value from its output. Output past
+ * COMMAND_VALUES_VALUE_LIMIT, or past the room left for values, is discarded and
+ * the value marked truncated.
+ *
+ * @param values The command values.
+ * @param value The value of the command.
+ * @param stats Filled out with what the command cost to run.
+ */
+void
+commandValuesFinish(command_values* values, command_value* value, process_stats* stats);
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * Atomic operations on naturally aligned 32 and 64-bit values, for the few places where
+ * threads hand data to one another without a mutex. Loads acquire and stores
+ * release, so anything written before a store is visible to a thread once its
+ * load observes the stored value.
+ *
+ * These map onto compiler intrinsics rather than platform calls, so they live
+ * entirely within this header.
+ */
+#ifndef SOURCERY_THREAD_ATOMICS_H
+#define SOURCERY_THREAD_ATOMICS_H
+#include <sourcery/generics.h>
+
+#if defined(_MSC_VER)
+#	include <intrin.h>
+#	define atomicLoadAcquire64(pointer) 			((uint64)_InterlockedOr64((volatile __int64*)(pointer), 0))
+#	define atomicStoreRelease64(pointer, value) 	((void)_InterlockedExchange64((volatile __int64*)(pointer), (__int64)(value)))
+#	define atomicFetchAdd64(pointer, value) 		((uint64)_InterlockedExchangeAdd64((volatile __int64*)(pointer), (__int64)(value)))
+#	define atomicLoadAcquire32(pointer) 			((uint32)_InterlockedOr((volatile long*)(pointer), 0))
+#	define atomicStoreRelease32(pointer, value) 	((void)_InterlockedExchange((volatile long*)(pointer), (long)(value)))
+#else
+#	define atomicLoadAcquire64(pointer) 			__atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#	define atomicStoreRelease64(pointer, value) 	__atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#	define atomicFetchAdd64(pointer, value) 		__atomic_fetch_add((pointer), (value), __ATOMIC_ACQ_REL)
+#	define atomicLoadAcquire32(pointer) 			__atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#	define atomicStoreRelease32(pointer, value) 	__atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+#include <sourcery/thread/spsc_queue.h>
+#include <sourcery/time/clock.h>
+
+void
+spscQueueCreate(spsc_queue* queue, mem_arena* arena, uint64 capacity)
+{
+
+	spsc_queue empty_queue = {0};
+	*queue = empty_queue;
+	queue->items = arena_push_array(arena, void*, capacity);
+	queue->capacity = capacity;
+
+	platformCreateMutex(&queue->mutex);
+	platformCreateCondition(&queue->not_empty);
+	platformCreateCondition(&queue->not_full);
+
+}
+
+bool
+spscQueuePush(spsc_queue* queue, void* item)
+{
+
+	platformLockMutex(&queue->mutex);
+
+	// Only a wait that actually happens is timed, so an unblocked push stays cheap.
+	if (queue->tail - queue->head == queue->capacity && !queue->closed)
+	{
+		uint64 wait_start = platformGetTimeNanoseconds();
+		while (queue->tail - queue->head == queue->capacity && !queue->closed)
+			platformWaitCondition(&queue->not_full, &queue->mutex);
+		queue->stats.full_waits++;
+		queue->stats.full_wait_time += platformGetTimeNanoseconds() - wait_start;
+	}
+
+	bool pushed = !queue->closed;
+	if (pushed)
+	{
+		queue->items[queue->tail++ % queue->capacity] = item;
+
+		uint64 depth = queue->tail - queue->head;
+		queue->stats.push_count++;
+		queue->stats.depth_total += depth;
+		if (depth > queue->stats.depth_peak)
+			queue->stats.depth_peak = depth;
+		platformSignalCondition(&queue->not_empty);
+	}
+
+	platformUnlockMutex(&queue->mutex);
+	return pushed;
+
+}
+
+bool
+spscQueuePop(spsc_queue* queue, void** item)
+{
+
+	platformLockMutex(&queue->mutex);
+
+	if (queue->tail == queue->head && !queue->closed)
+	{
+		uint64 wait_start = platformGetTimeNanoseconds();
+		while (queue->tail == queue->head && !queue->closed)
+			platformWaitCondition(&queue->not_empty, &queue->mutex);
+		queue->stats.empty_waits++;
+		queue->stats.empty_wait_time += platformGetTimeNanoseconds() - wait_start;
+	}
+
+	// Items pushed before the queue was closed are still handed out.
+	bool popped = (queue->tail != queue->head);
+	if (popped)
+	{
+		*item = queue->items[queue->head++ % queue->capacity];
+		platformSignalCondition(&queue->not_full);
+	}
+
+	platformUnlockMutex(&queue->mutex);
+	return popped;
+
+}
+
+void
+spscQueueClose(spsc_queue* queue)
+{
+
+	platformLockMutex(&queue->mutex);
+	queue->closed = true;
+	platformSignalCondition(&queue->not_empty);
+	platformSignalCondition(&queue->not_full);
+	platformUnlockMutex(&queue->mutex);
+
+}
+
+void
+spscQueueDestroy(spsc_queue* queue)
+{
+	platformDestroyCondition(&queue->not_full);
+	platformDestroyCondition(&queue->not_empty);
+	platformDestroyMutex(&queue->mutex);
+}
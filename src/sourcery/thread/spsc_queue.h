@@ -0,0 +1,102 @@
+/**
+ * A bounded queue that hands items from one thread to another, in order. Each queue
+ * has exactly one producing thread and one consuming thread, so at most one thread
+ * is ever waiting on each side and a signal always wakes the right one.
+ *
+ * A producer waits while the queue is full and a consumer while it's empty, which
+ * is how a slow stage holds back the stages that feed it. Closing the queue ends
+ * both: pushes fail straight away, and pops return whatever was left before they
+ * fail too.
+ *
+ * Every queue keeps stats of how deep it ran and how long each side waited on the
+ * other. A queue that's always full points at its consumer as the bottleneck, one
+ * that's always empty at its producer.
+ */
+#ifndef SOURCERY_THREAD_SPSC_QUEUE_H
+#define SOURCERY_THREAD_SPSC_QUEUE_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/thread/thread.h>
+
+/**
+ * The depth is sampled as each item is pushed, including the item. Wait times are
+ * in nanoseconds.
+ */
+typedef struct spsc_queue_stats
+{
+	uint64 	push_count;
+	uint64 	depth_total;
+	uint64 	depth_peak;
+
+	uint64 	full_waits;
+	uint64 	full_wait_time;
+	uint64 	empty_waits;
+	uint64 	empty_wait_time;
+} spsc_queue_stats;
+
+typedef struct spsc_queue
+{
+	void** 	items;
+	uint64 	capacity;
+	uint64 	head;
+	uint64 	tail;
+	bool 	closed;
+
+	platform_mutex 		mutex;
+	platform_condition 	not_empty;
+	platform_condition 	not_full;
+
+	spsc_queue_stats stats;
+} spsc_queue;
+
+/**
+ * Initializes an empty queue.
+ *
+ * @param queue The queue to initialize.
+ * @param arena The arena to place the queue's items on, which must outlive it.
+ * @param capacity The most items the queue holds at once.
+ */
+void
+spscQueueCreate(spsc_queue* queue, mem_arena* arena, uint64 capacity);
+
+/**
+ * Adds an item to the back of the queue, waiting while the queue is full.
+ *
+ * @param queue The queue.
+ * @param item The item to add.
+ *
+ * @returns True if the item was added, false if the queue was closed.
+ */
+bool
+spscQueuePush(spsc_queue* queue, void* item);
+
+/**
+ * Takes the item at the front of the queue, waiting while the queue is empty.
+ *
+ * @param queue The queue.
+ * @param item Set to the item taken.
+ *
+ * @returns True if an item was taken, false once the queue is closed and empty.
+ */
+bool
+spscQueuePop(spsc_queue* queue, void** item);
+
+/**
+ * Closes the queue, waking whichever side is waiting on it. Closing a queue that's
+ * already closed does nothing.
+ *
+ * @param queue The queue to close.
+ */
+void
+spscQueueClose(spsc_queue* queue);
+
+/**
+ * Releases the queue's synchronization primitives. Neither side may be using the
+ * queue, but its stats remain readable.
+ *
+ * @param queue The queue to destroy.
+ */
+void
+spscQueueDestroy(spsc_queue* queue);
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * Threads, mutexes and condition variables need to be created using OS-specific
+ * calls and therefore these interfaces must be defined in their corresponding OS
+ * definitions.
+ *
+ * The synchronization primitives are stored as opaque, fixed-size blocks so that
+ * they can be embedded within structures placed on memory arenas without the
+ * platform headers leaking into the rest of the application.
+ */
+#ifndef SOURCERY_THREAD_THREAD_H
+#define SOURCERY_THREAD_THREAD_H
+#include <sourcery/generics.h>
+
+/**
+ * The procedure a thread begins executing at.
+ */
+typedef void (*threadproc)(void* user_data);
+
+/**
+ * The procedure and its user data are kept with the thread so the platform can
+ * trampoline into it, therefore the structure must outlive the thread.
+ */
+typedef struct platform_thread
+{
+	size_t platform_handle_ptr;
+
+	threadproc 	proc;
+	void* 		user_data;
+} platform_thread;
+
+typedef struct platform_mutex
+{
+	uint64 platform_storage[8];
+} platform_mutex;
+
+typedef struct platform_condition
+{
+	uint64 platform_storage[8];
+} platform_condition;
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_thread.c
+ */
+
+/**
+ * Creates a thread which immediately begins running the provided procedure.
+ *
+ * @param thread The thread structure to fill out.
+ * @param proc The procedure for the thread to run.
+ * @param user_data The pointer passed to the procedure.
+ *
+ * @returns True if the thread was created, false if not.
+ */
+bool
+platformCreateThread(platform_thread* thread, threadproc proc, void* user_data);
+
+/**
+ * Blocks until the thread has finished running and then releases it.
+ *
+ * @param thread The thread to wait on.
+ */
+void
+platformJoinThread(platform_thread* thread);
+
+/**
+ * Returns the number of logical processors available to the process.
+ *
+ * @returns The number of logical processors, always at least one.
+ */
+uint32
+platformGetProcessorCount(void);
+
+/**
+ * Initializes, locks, unlocks and releases a mutex.
+ *
+ * @param mutex The mutex to operate on.
+ */
+void platformCreateMutex(platform_mutex* mutex);
+void platformLockMutex(platform_mutex* mutex);
+void platformUnlockMutex(platform_mutex* mutex);
+void platformDestroyMutex(platform_mutex* mutex);
+
+/**
+ * Initializes and releases a condition variable.
+ *
+ * @param condition The condition variable to operate on.
+ */
+void platformCreateCondition(platform_condition* condition);
+void platformDestroyCondition(platform_condition* condition);
+
+/**
+ * Atomically releases the mutex and waits on the condition variable. The mutex
+ * is held again once this returns. Wake-ups may be spurious, so the condition
+ * being waited on must always be rechecked.
+ *
+ * @param condition The condition variable to wait on.
+ * @param mutex The held mutex protecting the condition.
+ */
+void platformWaitCondition(platform_condition* condition, platform_mutex* mutex);
+
+/**
+ * Wakes one or all of the threads waiting on the condition variable.
+ *
+ * @param condition The condition variable to signal.
+ */
+void platformSignalCondition(platform_condition* condition);
+void platformBroadcastCondition(platform_condition* condition);
+
+#endif
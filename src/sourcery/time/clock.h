@@ -0,0 +1,37 @@
+/**
+ * Timing needs to be done using OS-specific calls and therefore these interfaces
+ * must be defined in their corresponding OS definitions.
+ */
+#ifndef SOURCERY_TIME_CLOCK_H
+#define SOURCERY_TIME_CLOCK_H
+#include <sourcery/generics.h>
+
+#define NANOSECONDS_PER_MILLISECOND 	((uint64)1000000)
+#define NANOSECONDS_PER_SECOND 			((uint64)1000000000)
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------
+ * Platform Specific Definitions
+ * ---------------------------------------------------------------------------------------------------------------------
+ * You will find the platform-specific implementations in
+ * the platform/[target-os]/[target-os]_clock.c
+ */
+
+/**
+ * Returns the current time of a monotonic clock. The value is only meaningful
+ * when compared with other values returned by this function.
+ *
+ * @returns The current time, in nanoseconds.
+ */
+uint64
+platformGetTimeNanoseconds(void);
+
+/**
+ * Suspends the calling thread for at least the given number of milliseconds.
+ *
+ * @param milliseconds The number of milliseconds to sleep for.
+ */
+void
+platformSleepMilliseconds(uint32 milliseconds);
+
+#endif
@@ -0,0 +1,225 @@
+#include <sourcery/trace/trace.h>
+
+#if defined(SOURCERY_TRACE)
+
+#include <stdio.h>
+#include <sourcery/filehandle.h>
+#include <sourcery/thread/atomics.h>
+#include <sourcery/thread/thread.h>
+#include <sourcery/time/clock.h>
+
+#if defined(_MSC_VER)
+#	define trace_thread_local __declspec(thread)
+#else
+#	define trace_thread_local _Thread_local
+#endif
+
+/**
+ * Each traceBegin() starts a new generation, which tells threads that the buffer
+ * they were handed by an earlier trace is no longer theirs. The flag and the
+ * generation are read by every traced thread, so they're only accessed atomically.
+ */
+persist volatile bool 	trace_enabled;
+persist volatile uint32 trace_generation;
+persist uint64 			trace_start_time;
+
+persist platform_mutex 	trace_mutex;
+persist bool 			trace_mutex_created;
+persist trace_buffer* 	trace_buffers;
+persist uint32 			trace_buffer_count;
+
+persist trace_thread_local trace_buffer* 	trace_thread_buffer;
+persist trace_thread_local uint32 			trace_thread_generation;
+
+void
+traceBegin(mem_arena* arena)
+{
+
+	if (!trace_mutex_created)
+	{
+		platformCreateMutex(&trace_mutex);
+		trace_mutex_created = true;
+	}
+
+	trace_buffers = arena_push_array_zero(arena, trace_buffer, TRACE_MAX_THREADS);
+	for (uint32 buffer_index = 0; buffer_index < TRACE_MAX_THREADS; ++buffer_index)
+	{
+		trace_buffers[buffer_index].events = arena_push_array(arena, trace_event, TRACE_EVENTS_PER_THREAD);
+		trace_buffers[buffer_index].thread_index = buffer_index;
+	}
+
+	platformLockMutex(&trace_mutex);
+	trace_buffer_count = 0;
+	atomicStoreRelease32(&trace_generation, atomicLoadAcquire32(&trace_generation) + 1);
+	platformUnlockMutex(&trace_mutex);
+
+	trace_start_time = platformGetTimeNanoseconds();
+	atomicStoreRelease32(&trace_enabled, true);
+
+}
+
+void
+traceEnd(void)
+{
+	atomicStoreRelease32(&trace_enabled, false);
+}
+
+/**
+ * Fetches the calling thread's buffer, handing it one on its first zone of the
+ * trace. Threads beyond TRACE_MAX_THREADS aren't recorded.
+ */
+internal trace_buffer*
+traceGetThreadBuffer(void)
+{
+
+	uint32 generation = atomicLoadAcquire32(&trace_generation);
+	if (trace_thread_generation == generation)
+		return trace_thread_buffer;
+
+	platformLockMutex(&trace_mutex);
+	trace_thread_buffer = NULL;
+	if (trace_buffer_count < TRACE_MAX_THREADS)
+		trace_thread_buffer = &trace_buffers[trace_buffer_count++];
+	trace_thread_generation = atomicLoadAcquire32(&trace_generation);
+	platformUnlockMutex(&trace_mutex);
+
+	return trace_thread_buffer;
+
+}
+
+void
+traceZoneBegin(const char* name)
+{
+
+	if (!atomicLoadAcquire32(&trace_enabled))
+		return;
+
+	trace_buffer* buffer = traceGetThreadBuffer();
+	if (buffer == NULL)
+		return;
+
+	// Zones nested deeper than the stack are dropped, but still counted so that
+	// their ends pair up correctly.
+	if (buffer->open_depth < TRACE_MAX_DEPTH)
+	{
+		buffer->open_names[buffer->open_depth] = name;
+		buffer->open_starts[buffer->open_depth] = platformGetTimeNanoseconds();
+	}
+	buffer->open_depth++;
+
+}
+
+void
+traceZoneEnd(void)
+{
+
+	if (!atomicLoadAcquire32(&trace_enabled))
+		return;
+
+	trace_buffer* buffer = traceGetThreadBuffer();
+	if (buffer == NULL || buffer->open_depth == 0)
+		return;
+
+	buffer->open_depth--;
+	if (buffer->open_depth >= TRACE_MAX_DEPTH)
+		return;
+
+	uint64 end_time = platformGetTimeNanoseconds();
+	trace_event* event = &buffer->events[buffer->write_index & (TRACE_EVENTS_PER_THREAD - 1)];
+	event->name = buffer->open_names[buffer->open_depth];
+	event->start = buffer->open_starts[buffer->open_depth];
+	event->duration = end_time - event->start;
+	buffer->write_index++;
+
+}
+
+void
+traceNameThread(const char* name)
+{
+
+	if (!atomicLoadAcquire32(&trace_enabled))
+		return;
+
+	trace_buffer* buffer = traceGetThreadBuffer();
+	if (buffer != NULL)
+		buffer->thread_name = name;
+
+}
+
+/**
+ * Appends text to the write buffer, flushing it to the file when it fills.
+ */
+internal void
+traceWriteText(filehandle* fh, char* buffer, size_t* buffer_length, const char* text, int text_length)
+{
+	if (text_length <= 0)
+		return;
+
+	if (*buffer_length + (size_t)text_length > TRACE_WRITE_BUFFER_SIZE)
+	{
+		platformWriteFile(fh, buffer, *buffer_length);
+		*buffer_length = 0;
+	}
+
+	for (int c_index = 0; c_index < text_length; ++c_index)
+		buffer[(*buffer_length)++] = text[c_index];
+}
+
+bool
+traceWriteChrome(mem_arena* arena, const char* path)
+{
+
+	if (trace_buffers == NULL)
+		return false;
+
+	filehandle fh = {0};
+	if (!platformOpenFile(&fh, path, PLATFORM_FILECONTEXT_ALWAYS, PLATFORM_FILEMODE_TRUNCATE))
+		return false;
+
+	size_t stash_point = arena_stash(arena);
+	char* write_buffer = arena_push_array(arena, char, TRACE_WRITE_BUFFER_SIZE);
+	size_t write_length = 0;
+
+	char line[512];
+	int line_length = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	traceWriteText(&fh, write_buffer, &write_length, line, line_length);
+
+	bool first_event = true;
+	for (uint32 buffer_index = 0; buffer_index < trace_buffer_count; ++buffer_index)
+	{
+		trace_buffer* buffer = &trace_buffers[buffer_index];
+		uint32 thread_id = buffer->thread_index + 1;
+
+		line_length = snprintf(line, sizeof(line),
+			"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			first_event ? "" : ",\n", thread_id, buffer->thread_name ? buffer->thread_name : "thread");
+		traceWriteText(&fh, write_buffer, &write_length, line, line_length);
+		first_event = false;
+
+		// Only the most recent ring's worth of zones survive.
+		uint64 first_index = 0;
+		if (buffer->write_index > TRACE_EVENTS_PER_THREAD)
+			first_index = buffer->write_index - TRACE_EVENTS_PER_THREAD;
+
+		for (uint64 event_index = first_index; event_index < buffer->write_index; ++event_index)
+		{
+			trace_event* event = &buffer->events[event_index & (TRACE_EVENTS_PER_THREAD - 1)];
+			line_length = snprintf(line, sizeof(line),
+				",\n{\"name\":\"%s\",\"cat\":\"sourcery\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				event->name, thread_id, (real64)(event->start - trace_start_time) / 1000.0,
+				(real64)event->duration / 1000.0);
+			traceWriteText(&fh, write_buffer, &write_length, line, line_length);
+		}
+	}
+
+	line_length = snprintf(line, sizeof(line), "\n]}\n");
+	traceWriteText(&fh, write_buffer, &write_length, line, line_length);
+	platformWriteFile(&fh, write_buffer, write_length);
+	platformCloseFile(&fh);
+
+	arena_restore(arena, stash_point);
+	return true;
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * Tracing records timed zones around the phases of a run so that a run can be
+ * inspected in a trace viewer. Each thread writes its zones to its own ring
+ * buffer, so recording a zone never takes a lock and costs two clock reads. When
+ * a ring fills up, the oldest zones are overwritten.
+ *
+ * Tracing only exists in builds with SOURCERY_TRACE defined, which the PERFDEBUG
+ * build type does. Otherwise the TRACE_ macros expand to nothing and none of this
+ * is compiled. Even when compiled in, zones are only recorded between traceBegin()
+ * and traceEnd().
+ *
+ * 		TRACE_ZONE_BEGIN("loadSource");
+ * 		char* text_source = loadSource(arena, file_name);
+ * 		TRACE_ZONE_END();
+ *
+ * Zones nest and must be ended on the thread that began them, in reverse order.
+ * Zone names must be string literals, since only the pointer is kept.
+ */
+#ifndef SOURCERY_TRACE_TRACE_H
+#define SOURCERY_TRACE_TRACE_H
+#include <sourcery/generics.h>
+#include <sourcery/memory/alloc.h>
+#include <sourcery/perf/perf_zones.h>
+
+#define TRACE_MAX_THREADS 			32
+#define TRACE_MAX_DEPTH 			64
+#define TRACE_EVENTS_PER_THREAD 	16384
+#define TRACE_WRITE_BUFFER_SIZE 	KILOBYTES(64)
+
+#if defined(SOURCERY_TRACE)
+
+typedef struct trace_event
+{
+	const char* name;
+	uint64 		start;
+	uint64 		duration;
+} trace_event;
+
+/**
+ * A thread's ring of completed zones along with the stack of zones it has open.
+ * The write index only ever increases and is wrapped when indexing the ring.
+ */
+typedef struct trace_buffer
+{
+	trace_event* 	events;
+	uint64 			write_index;
+	uint32 			thread_index;
+	const char* 	thread_name;
+
+	const char* 	open_names[TRACE_MAX_DEPTH];
+	uint64 			open_starts[TRACE_MAX_DEPTH];
+	uint32 			open_depth;
+} trace_buffer;
+
+/**
+ * Begins recording zones. The ring buffers for every thread that could record are
+ * reserved on the arena up-front and handed out to threads as they record their
+ * first zone.
+ *
+ * @param arena The arena to reserve the ring buffers on.
+ */
+void
+traceBegin(mem_arena* arena);
+
+/**
+ * Stops recording zones. The recorded zones remain until the next traceBegin().
+ */
+void
+traceEnd(void);
+
+/**
+ * Opens a zone on the calling thread.
+ *
+ * @param name The name of the zone, which must be a string literal.
+ */
+void
+traceZoneBegin(const char* name);
+
+/**
+ * Closes the zone most recently opened on the calling thread.
+ */
+void
+traceZoneEnd(void);
+
+/**
+ * Names the calling thread in the exported trace.
+ *
+ * @param name The name of the thread, which must be a string literal.
+ */
+void
+traceNameThread(const char* name);
+
+/**
+ * Writes the recorded zones to a file in the Chrome trace event format, which
+ * chrome://tracing and Perfetto can open. This should only be called once the
+ * threads being traced have stopped recording.
+ *
+ * @param arena The arena to place the write buffer on.
+ * @param path The path of the file to write.
+ *
+ * @returns True if the trace was written, false if not.
+ */
+bool
+traceWriteChrome(mem_arena* arena, const char* path);
+
+#endif
+
+/**
+ * Trace zones double as counter zones when SOURCERY_PERF_COUNTERS is defined, so
+ * that both reports break a run down the same way.
+ */
+#if defined(SOURCERY_TRACE) && defined(SOURCERY_PERF_COUNTERS)
+#	define TRACE_ZONE_BEGIN(name) 	do { traceZoneBegin(name); perfZoneBegin(name); } while (0)
+#	define TRACE_ZONE_END() 		do { perfZoneEnd(); traceZoneEnd(); } while (0)
+#	define TRACE_NAME_THREAD(name) 	do { traceNameThread(name); perfZonesNameThread(name); } while (0)
+#elif defined(SOURCERY_TRACE)
+#	define TRACE_ZONE_BEGIN(name) 	traceZoneBegin(name)
+#	define TRACE_ZONE_END() 		traceZoneEnd()
+#	define TRACE_NAME_THREAD(name) 	traceNameThread(name)
+#elif defined(SOURCERY_PERF_COUNTERS)
+#	define TRACE_ZONE_BEGIN(name) 	perfZoneBegin(name)
+#	define TRACE_ZONE_END() 		perfZoneEnd()
+#	define TRACE_NAME_THREAD(name) 	perfZonesNameThread(name)
+#else
+#	define TRACE_ZONE_BEGIN(name)
+#	define TRACE_ZONE_END()
+#	define TRACE_NAME_THREAD(name)
+#endif
+
+#endif